@@ -64,6 +64,7 @@ It handles initialization and termination by subclassing wxApp.
 #include "AColor.h"
 #include "AudioIO.h"
 #include "Benchmark.h"
+#include "BenchmarkSuite.h"
 #include "DirManager.h"
 #include "commands/CommandHandler.h"
 #include "commands/AppCommandEvent.h"
@@ -89,12 +90,13 @@ It handles initialization and termination by subclassing wxApp.
 #include "SplashDialog.h"
 #include "FFT.h"
 #include "BlockFile.h"
+#include "BlockCache.h"
+#include "ThreadPool.h"
 #include "ondemand/ODManager.h"
 #include "commands/Keyboard.h"
 #include "widgets/ErrorDialog.h"
 
-//temporarilly commented out till it is added to all projects
-//#include "Profiler.h"
+#include "Profiler.h"
 
 #include "ModuleManager.h"
 
@@ -290,9 +292,9 @@ void QuitAudacity(bool bForce)
    //release ODManager Threads
    ODManager::Quit();
 
-   //print out profile if we have one by deleting it
-   //temporarilly commented out till it is added to all projects
-   //delete Profiler::Instance();
+   //write out the trace if we have one
+   if (!Profiler::Stop())
+      wxFprintf(stderr, wxT("Could not write the trace file\n"));
 
    //delete the static lock for audacity projects
    AudacityProject::DeleteAllProjectsDeleteLock();
@@ -1300,6 +1302,13 @@ Click the 'Help' button for known issue."),
       Sequence::SetMaxDiskBlockSize(lval);
    }
 
+   wxString traceFile;
+   if (parser->Found(wxT("trace"), &traceFile))
+   {
+      Profiler::SetThreadName("Main");
+      Profiler::Start(traceFile);
+   }
+
 // No Splash screen on wx3 whislt we sort out the problem
 // with showing a dialog AND a splash screen during inits.
 #if !wxCHECK_VERSION(3, 0, 0)
@@ -1328,8 +1337,31 @@ Click the 'Help' button for known issue."),
    InitDitherers();
    InitAudioIO();
 
+   // Zero disables the shared cache of decoded block data
+   long blockCacheMB = gPrefs->Read(wxT("/Directories/BlockCacheMB"), 64L);
+   BlockCache::Get().SetBudget(blockCacheMB > 0 ? (size_t)blockCacheMB << 20 : 0);
+
+   // Worker threads for background work such as waveform tiles
+   ThreadPool::Init();
+
    LoadEffects();
 
+   wxString benchmarkFile;
+   if (parser->Found(wxT("benchmark"), &benchmarkFile))
+   {
+#if !wxCHECK_VERSION(3, 0, 0)
+      temporarywindow->Show(false);
+      delete temporarywindow;
+#endif
+
+      bool ok = RunBenchmarkSuite(parser, benchmarkFile);
+      delete parser;
+
+      ODManager::Quit();
+      OnExit();
+      exit(ok ? 0 : 1);
+   }
+
 #ifdef __WXMAC__
 
    // On the Mac, users don't expect a program to quit when you close the last window.
@@ -1526,6 +1558,15 @@ bool AudacityApp::InitTempDir()
 
    bool bSuccess = gPrefs->Write(wxT("/Directories/TempDir"), temp) && gPrefs->Flush();
    DirManager::SetTempDir(temp);
+   DirManager::SetMappingBudget(
+      gPrefs->Read(wxT("/Directories/MappedBlockFilesMB"), 128L));
+
+   bool packBlocks = false;
+   gPrefs->Read(wxT("/Directories/PackBlockFiles"), &packBlocks, false);
+   DirManager::SetPackBlocks(packBlocks);
+   bool compressBlocks = false;
+   gPrefs->Read(wxT("/Directories/CompressBlockFiles"), &compressBlocks, false);
+   DirManager::SetCompressBlocks(compressBlocks);
 
    // Make sure the temp dir isn't locked by another process.
    if (!CreateSingleInstanceChecker(temp))
@@ -1752,6 +1793,34 @@ wxCmdLineParser *AudacityApp::ParseCommandLine()
    /*i18n-hint: This runs a set of automatic tests on Audacity itself */
    parser->AddSwitch(wxT("t"), wxT("test"), _("run self diagnostics"));
 
+   /*i18n-hint: This times Audacity's core operations without showing
+    *           any windows and writes the results to a file */
+   parser->AddOption(wxEmptyString, wxT("benchmark"),
+                     _("run the benchmarks and write the results to a file, or to standard output if it is \"-\""),
+                     wxCMD_LINE_VAL_STRING);
+
+   parser->AddOption(wxEmptyString, wxT("benchmark-format"),
+                     _("benchmark results format: json or csv"),
+                     wxCMD_LINE_VAL_STRING);
+
+   parser->AddOption(wxEmptyString, wxT("benchmark-filter"),
+                     _("only run the benchmarks whose names contain this"),
+                     wxCMD_LINE_VAL_STRING);
+
+   parser->AddOption(wxEmptyString, wxT("benchmark-warmup"),
+                     _("untimed runs of each benchmark"),
+                     wxCMD_LINE_VAL_NUMBER);
+
+   parser->AddOption(wxEmptyString, wxT("benchmark-repeat"),
+                     _("timed runs of each benchmark"),
+                     wxCMD_LINE_VAL_NUMBER);
+
+   /*i18n-hint: This records what Audacity's threads spend their time
+    *           on, and writes it to a file when Audacity quits */
+   parser->AddOption(wxEmptyString, wxT("trace"),
+                     _("record a trace and write it to a file on quitting"),
+                     wxCMD_LINE_VAL_STRING);
+
    /*i18n-hint: This displays the Audacity version */
    parser->AddSwitch(wxT("v"), wxT("version"), _("display Audacity version"));
 
@@ -1772,6 +1841,55 @@ wxCmdLineParser *AudacityApp::ParseCommandLine()
    return NULL;
 }
 
+bool AudacityApp::RunBenchmarkSuite(wxCmdLineParser *parser,
+                                    const wxString &fileName)
+{
+   BenchmarkSuite::Format format = BenchmarkSuite::FormatJSON;
+   if (fileName.Lower().EndsWith(wxT(".csv")))
+      format = BenchmarkSuite::FormatCSV;
+
+   wxString sval;
+   if (parser->Found(wxT("benchmark-format"), &sval))
+   {
+      if (sval.IsSameAs(wxT("csv"), false))
+         format = BenchmarkSuite::FormatCSV;
+      else if (sval.IsSameAs(wxT("json"), false))
+         format = BenchmarkSuite::FormatJSON;
+      else
+      {
+         wxPrintf(_("Benchmark format must be json or csv\n"));
+         return false;
+      }
+   }
+
+   // The benchmarks open and close hidden projects.  Closing the last
+   // one must neither quit nor open a new project, and they must not
+   // change the window placement that the user's projects remember.
+   gIsQuitting = true;
+   SetWindowRectAlreadySaved(true);
+
+   BenchmarkSuite suite;
+
+   long lval;
+   if (parser->Found(wxT("benchmark-warmup"), &lval))
+      suite.SetWarmup(lval);
+   if (parser->Found(wxT("benchmark-repeat"), &lval))
+      suite.SetRepetitions(lval);
+   if (parser->Found(wxT("benchmark-filter"), &sval))
+      suite.SetFilter(sval);
+
+   bool ok = suite.Run();
+
+   if (!suite.Write(fileName, format))
+   {
+      wxPrintf(_("Could not write the benchmark results to %s\n"),
+               fileName.c_str());
+      ok = false;
+   }
+
+   return ok;
+}
+
 // static
 void AudacityApp::AddUniquePathToPathList(wxString path,
                                           wxArrayString &pathList)
@@ -1936,6 +2054,9 @@ int AudacityApp::OnExit()
 
    UnloadEffects();
 
+   // Waits for any jobs still running
+   ThreadPool::Deinit();
+
    DeinitFFT();
    BlockFile::Deinit();
 
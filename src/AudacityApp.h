@@ -229,6 +229,7 @@ class AudacityApp:public wxApp {
    bool CreateSingleInstanceChecker(wxString dir);
 
    wxCmdLineParser *ParseCommandLine();
+   bool RunBenchmarkSuite(wxCmdLineParser *parser, const wxString &fileName);
 
    bool mWindowRectAlreadySaved;
 
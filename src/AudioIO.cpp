@@ -299,6 +299,7 @@ writing audio.
 #include "Resample.h"
 #include "RingBuffer.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
 #include "WaveTrack.h"
 
@@ -525,6 +526,7 @@ AudioIO::AudioIO()
    mAudioThreadFillBuffersLoopRunning = false;
    mAudioThreadFillBuffersLoopActive = false;
    mPortStreamV19 = NULL;
+   mFillEffectsMicros = 0;
 
 #ifdef EXPERIMENTAL_MIDI_OUT
    mMidiStream = NULL;
@@ -545,6 +547,10 @@ AudioIO::AudioIO()
    mSilentBuf = NULL;
    mLastSilentBufSize = 0;
 
+   mPlaybackGroups = NULL;
+   mPlaybackGroupBufs[0] = mPlaybackGroupBufs[1] = NULL;
+   mPlaybackGroupBufSize = 0;
+
    mStreamToken = 0;
 
    mLastPaError = paNoError;
@@ -646,6 +652,9 @@ AudioIO::~AudioIO()
    if(mSilentBuf)
       DeleteSamples(mSilentBuf);
 
+   delete [] mPlaybackGroupBufs[0];
+   delete [] mPlaybackGroupBufs[1];
+
    delete mThread;
 }
 
@@ -1210,9 +1219,10 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
    mPlayLooped = playLooped;
    mCutPreviewGapStart = cutPreviewGapStart;
    mCutPreviewGapLen = cutPreviewGapLen;
-   mPlaybackBuffers = NULL;
+   mPlaybackBuffer = NULL;
    mPlaybackMixers = NULL;
-   mCaptureBuffers = NULL;
+   mPlaybackGroups = NULL;
+   mCaptureBuffer = NULL;
    mResample = NULL;
 
    // with ComputeWarpedLength, it is now possible the calculate the warped length with 100% accuracy
@@ -1232,6 +1242,10 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
 
    mPlaybackRingBufferSecs = 10.0;
    mMaxPlaybackSecsToCopy = 4.0;
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+   mRealtimeLookaheadSecs = 0.2;
+   mMinRealtimeSecsToCopy = 0.02;
+#endif
 
    mCaptureRingBufferSecs = 4.5 + 0.5 * std::min(size_t(16), mCaptureTracks.GetCount());
    mMinCaptureSecsToCopy = 0.2 + 0.2 * std::min(size_t(16), mCaptureTracks.GetCount());
@@ -1304,8 +1318,8 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
       try
       {
          if( mNumPlaybackChannels > 0 ) {
-            // Allocate output buffers.  For every output track we allocate
-            // a ring buffer of five seconds
+            // Allocate output buffers.  All output tracks share one ring
+            // buffer, with a channel for each
             sampleCount playbackBufferSize =
                (sampleCount)(mRate * mPlaybackRingBufferSecs + 0.5f);
             sampleCount playbackMixBufferSize =
@@ -1319,17 +1333,19 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
                return 0;
             }
 
-            mPlaybackBuffers = new RingBuffer* [mPlaybackTracks.GetCount()];
+            mPlaybackBuffer = new RingBuffer(floatSample, playbackBufferSize,
+                                             mPlaybackTracks.GetCount());
+            mPlaybackMixBufferSize = playbackMixBufferSize;
             mPlaybackMixers  = new Mixer*      [mPlaybackTracks.GetCount()];
+            // There are never more groups than tracks
+            mPlaybackGroups = new PlaybackGroup[mPlaybackTracks.GetCount()];
+            ResetPlaybackGroups();
 
             // Set everything to zero in case we have to delete these due to a memory exception.
-            memset(mPlaybackBuffers, 0, sizeof(RingBuffer*)*mPlaybackTracks.GetCount());
             memset(mPlaybackMixers, 0, sizeof(Mixer*)*mPlaybackTracks.GetCount());
 
             for( unsigned int i = 0; i < mPlaybackTracks.GetCount(); i++ )
             {
-               mPlaybackBuffers[i] = new RingBuffer(floatSample, playbackBufferSize);
-
                // MB: use normal time for the end time, not warped time!
                mPlaybackMixers[i]  = new Mixer(1, &mPlaybackTracks[i],
                                                mTimeTrack, mT0, mT1, 1,
@@ -1341,8 +1357,10 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
 
          if( mNumCaptureChannels > 0 )
          {
-            // Allocate input buffers.  For every input track we allocate
-            // a ring buffer of five seconds
+            // Allocate input buffers.  All input tracks share one ring
+            // buffer, with a channel for each, that holds samples just as
+            // PortAudio delivers them; FillBuffers() converts them to the
+            // tracks' formats
             sampleCount captureBufferSize =
                (sampleCount)(mRate * mCaptureRingBufferSecs + 0.5);
 
@@ -1354,18 +1372,16 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
                return 0;
             }
 
-            mCaptureBuffers = new RingBuffer* [mCaptureTracks.GetCount()];
+            mCaptureBuffer = new RingBuffer(mCaptureFormat, captureBufferSize,
+                                            mCaptureTracks.GetCount());
             mResample = new Resample* [mCaptureTracks.GetCount()];
             mFactor = sampleRate / mRate;
 
             // Set everything to zero in case we have to delete these due to a memory exception.
-            memset(mCaptureBuffers, 0, sizeof(RingBuffer*)*mCaptureTracks.GetCount());
             memset(mResample, 0, sizeof(Resample*)*mCaptureTracks.GetCount());
 
             for( unsigned int i = 0; i < mCaptureTracks.GetCount(); i++ )
             {
-               mCaptureBuffers[i] = new RingBuffer( mCaptureTracks[i]->GetSampleFormat(),
-                                                    captureBufferSize );
                mResample[i] = new Resample(true, mFactor, mFactor); // constant rate resampling
             }
          }
@@ -1390,8 +1406,8 @@ int AudioIO::StartStream(WaveTrackArray playbackTracks,
       em.RealtimeInitialize();
 
       // The following adds a new effect processor for each logical track and the
-      // group determination should mimic what is done in audacityAudioCallback()
-      // when calling RealtimeProcess().
+      // group determination should mimic what is done in FillBuffers()
+      // when calling FillPlaybackGroup().
       int group = 0;
       for (size_t i = 0, cnt = mPlaybackTracks.GetCount(); i < cnt; i++)
       {
@@ -1507,12 +1523,10 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
    }
 #endif
 
-   if(mPlaybackBuffers)
+   if(mPlaybackBuffer)
    {
-      for( unsigned int i = 0; i < mPlaybackTracks.GetCount(); i++ )
-         delete mPlaybackBuffers[i];
-      delete [] mPlaybackBuffers;
-      mPlaybackBuffers = NULL;
+      delete mPlaybackBuffer;
+      mPlaybackBuffer = NULL;
    }
 
    if(mPlaybackMixers)
@@ -1523,12 +1537,16 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
       mPlaybackMixers = NULL;
    }
 
-   if(mCaptureBuffers)
+   if(mPlaybackGroups)
    {
-      for( unsigned int i = 0; i < mCaptureTracks.GetCount(); i++ )
-         delete mCaptureBuffers[i];
-      delete [] mCaptureBuffers;
-      mCaptureBuffers = NULL;
+      delete [] mPlaybackGroups;
+      mPlaybackGroups = NULL;
+   }
+
+   if(mCaptureBuffer)
+   {
+      delete mCaptureBuffer;
+      mCaptureBuffer = NULL;
    }
 
    if(mResample)
@@ -1855,13 +1873,12 @@ void AudioIO::StopStream()
       if( mPlaybackTracks.GetCount() > 0 )
       {
          for( unsigned int i = 0; i < mPlaybackTracks.GetCount(); i++ )
-         {
-            delete mPlaybackBuffers[i];
             delete mPlaybackMixers[i];
-         }
 
-         delete[] mPlaybackBuffers;
+         delete mPlaybackBuffer;
          delete[] mPlaybackMixers;
+         delete[] mPlaybackGroups;
+         mPlaybackGroups = NULL;
       }
 
       //
@@ -1884,7 +1901,6 @@ void AudioIO::StopStream()
 
          for( unsigned int i = 0; i < mCaptureTracks.GetCount(); i++ )
             {
-               delete mCaptureBuffers[i];
                delete mResample[i];
 
                WaveTrack* track = mCaptureTracks[i];
@@ -1932,7 +1948,7 @@ void AudioIO::StopStream()
                }
             }
 
-         delete[] mCaptureBuffers;
+         delete mCaptureBuffer;
          delete[] mResample;
       }
    }
@@ -2339,6 +2355,8 @@ finished:
 
 AudioThread::ExitCode AudioThread::Entry()
 {
+   Profiler::SetThreadName("Audio thread");
+
    while( !TestDestroy() )
    {
       // Set LoopActive outside the tests to avoid race condition
@@ -2422,33 +2440,12 @@ MidiThread::ExitCode MidiThread::Entry()
 
 int AudioIO::GetCommonlyAvailPlayback()
 {
-   int commonlyAvail = mPlaybackBuffers[0]->AvailForPut();
-   unsigned int i;
-
-   for( i = 1; i < mPlaybackTracks.GetCount(); i++ )
-   {
-      int thisBlockAvail = mPlaybackBuffers[i]->AvailForPut();
-
-      if( thisBlockAvail < commonlyAvail )
-         commonlyAvail = thisBlockAvail;
-   }
-
-   return commonlyAvail;
+   return mPlaybackBuffer->AvailForPut();
 }
 
 int AudioIO::GetCommonlyAvailCapture()
 {
-   int commonlyAvail = mCaptureBuffers[0]->AvailForGet();
-   unsigned int i;
-
-   for( i = 1; i < mCaptureTracks.GetCount(); i++ )
-   {
-      int avail = mCaptureBuffers[i]->AvailForGet();
-      if( avail < commonlyAvail )
-         commonlyAvail = avail;
-   }
-
-   return commonlyAvail;
+   return mCaptureBuffer->AvailForGet();
 }
 
 #if USE_PORTMIXER
@@ -2811,13 +2808,166 @@ wxString AudioIO::GetDeviceInfo()
    return o.GetString();
 }
 
+wxString AudioIO::GetHealthInfo()
+{
+   AudioIOStats::Counts counts;
+   GetHealthCounts(&counts);
+   return AudioIOStats::Format(counts);
+}
+
+void AudioIO::ResetHealthInfo()
+{
+   mStats.Reset();
+}
+
+int AudioIO::FillPlaybackGroup(int group, int first, int chans, int frames)
+{
+   PlaybackGroup & pg = mPlaybackGroups[group];
+
+   // The first track's selection decides for a stereo pair, as it
+   // does for the processors in StartStream()
+   bool process = false;
+   sampleCount delay = 0;
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+   EffectManager & em = EffectManager::Get();
+   if (mPlaybackTracks[first]->GetSelected() && em.RealtimeIsActive())
+   {
+      process = true;
+      delay = em.GetRealtimeDelay();
+   }
+#endif
+
+   // Feed the effects far enough ahead that the output for all of the
+   // frames comes out of them.  The delay can change between calls, so
+   // this may be more or less than frames.
+   sampleCount toFeed = pg.written + frames + delay - pg.fed;
+   if (toFeed < 0)
+      toFeed = 0;
+
+   if (toFeed > mPlaybackGroupBufSize)
+   {
+      for (int c = 0; c < 2; c++)
+      {
+         delete [] mPlaybackGroupBufs[c];
+         mPlaybackGroupBufs[c] = new float[toFeed];
+      }
+      mPlaybackGroupBufSize = toFeed;
+   }
+
+   // The mixers here aren't actually mixing: they're just doing
+   // resampling, format conversion, and possibly time track warping.
+   // Past the end of the tracks, feed silence so that the tails of
+   // the effects come out.
+   sampleCount read = 0;
+   for (int c = 0; c < chans; c++)
+   {
+      Mixer *mixer = mPlaybackMixers[first + c];
+      float *buf = mPlaybackGroupBufs[c];
+      sampleCount got = 0;
+
+      while (got < toFeed)
+      {
+         sampleCount want = std::min(toFeed - got, mPlaybackMixBufferSize);
+         sampleCount len = mixer->Process(want);
+         memcpy(buf + got, mixer->GetBuffer(), len * sizeof(float));
+         got += len;
+         if (len < want)
+            break;
+      }
+
+      memset(buf + got, 0, (toFeed - got) * sizeof(float));
+
+      if (got > read)
+         read = got;
+   }
+
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+   if (process)
+   {
+      // EffectManager::RealtimeProcess() allocates its buffers on the
+      // stack, so keep the blocks modest
+      wxLongLong_t begin = Profiler::Now();
+      float *bufs[2];
+      for (sampleCount done = 0; done < toFeed; )
+      {
+         sampleCount block = std::min(toFeed - done, (sampleCount) 4096);
+         for (int c = 0; c < chans; c++)
+            bufs[c] = mPlaybackGroupBufs[c] + done;
+         em.RealtimeProcess(group, chans, bufs, block);
+         done += block;
+      }
+      mFillEffectsMicros += Profiler::Now() - begin;
+   }
+#endif
+
+   // The first sample fed this time comes out of the effects delay
+   // samples later; drop what precedes the frames wanted, and fill with
+   // silence if the delay shrank and left a gap
+   sampleCount start = pg.fed - delay;
+   sampleCount gap = 0;
+   sampleCount skip = 0;
+   if (start > pg.written)
+      gap = std::min(start - pg.written, (sampleCount) frames);
+   else
+      skip = pg.written - start;
+
+   for (int c = 0; c < chans; c++)
+   {
+      if (gap > 0)
+         WritePlaybackSilence(first + c, 0, gap);
+      mPlaybackBuffer->WriteChannel(first + c, gap,
+                                    (samplePtr) (mPlaybackGroupBufs[c] + skip),
+                                    floatSample, frames - gap);
+   }
+
+   sampleCount audible = pg.read + read - pg.written;
+   pg.read += read;
+   pg.fed += toFeed;
+   pg.written += frames;
+
+   // With effects, the tails after the end of the tracks count too
+   if (process || audible > frames)
+      return frames;
+   if (audible < 0)
+      return 0;
+   return audible;
+}
+
+void AudioIO::WritePlaybackSilence(int channel, int offset, int frames)
+{
+   if(mLastSilentBufSize < frames)
+   {
+      //delete old if necessary
+      if(mSilentBuf)
+         DeleteSamples(mSilentBuf);
+      mLastSilentBufSize=frames;
+      mSilentBuf = NewSamples(mLastSilentBufSize, floatSample);
+      ClearSamples(mSilentBuf, floatSample, 0, mLastSilentBufSize);
+   }
+   mPlaybackBuffer->WriteChannel(channel, offset, mSilentBuf, floatSample,
+                                 frames);
+}
+
+void AudioIO::ResetPlaybackGroups()
+{
+   memset(mPlaybackGroups, 0,
+          mPlaybackTracks.GetCount() * sizeof(PlaybackGroup));
+}
+
 // This method is the data gateway between the audio thread (which
 // communicates with the disk) and the PortAudio callback thread
 // (which communicates with the audio device).
 void AudioIO::FillBuffers()
 {
+   PROFILE_ZONE("AudioIO::FillBuffers");
+
    unsigned int i;
 
+   // Only calls that move some audio are counted in mStats
+   wxLongLong_t begin = Profiler::Now();
+   bool filled = false;
+   mFillEffectsMicros = 0;
+
    if( mPlaybackTracks.GetCount() > 0 )
    {
       // Though extremely unlikely, it is possible that some buffers
@@ -2827,6 +2977,21 @@ void AudioIO::FillBuffers()
       // ALL buffers, and advance the global time by that much.
       // MB: subtract a few samples because the code below has rounding errors
       int commonlyAvail = GetCommonlyAvailPlayback() - 10;
+      double minSecsToCopy = mMaxPlaybackSecsToCopy;
+
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+      // The realtime effects are applied as the buffers are filled, so
+      // stay only a little ahead of the callback while there are any;
+      // otherwise changes to them would take seconds to be heard
+      if (EffectManager::Get().RealtimeIsActive())
+      {
+         int lookahead = lrint(mRealtimeLookaheadSecs * mRate) -
+                         mPlaybackBuffer->AvailForGet();
+         if (commonlyAvail > lookahead)
+            commonlyAvail = lookahead;
+         minSecsToCopy = mMinRealtimeSecsToCopy;
+      }
+#endif
 
       //
       // Determine how much this will globally advance playback time
@@ -2842,9 +3007,11 @@ void AudioIO::FillBuffers()
       // The exception is if we're at the end of the selected
       // region - then we should just fill the buffer.
       //
-      if (secsAvail >= mMaxPlaybackSecsToCopy ||
+      if (secsAvail >= minSecsToCopy ||
           (!mPlayLooped && (secsAvail > 0 && mWarpedTime+secsAvail >= mWarpedLength)))
       {
+         filled = true;
+
          // Limit maximum buffer size (increases performance)
          if (secsAvail > mMaxPlaybackSecsToCopy)
             secsAvail = mMaxPlaybackSecsToCopy;
@@ -2871,46 +3038,58 @@ void AudioIO::FillBuffers()
 
             secsAvail -= deltat;
 
-            for( i = 0; i < mPlaybackTracks.GetCount(); i++ )
+            // Each group's samples go into its tracks' own channels of the
+            // ring buffer, and are committed for all tracks at once below
+            int numTracks = mPlaybackTracks.GetCount();
+            int frames = lrint(deltat * mRate);
+            int toCommit = 0;
+
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+            EffectManager & em = EffectManager::Get();
+            em.RealtimeProcessStart();
+#endif
+
+            // The groups must match the processors added in StartStream()
+            int group = 0;
+            for( i = 0; (int)i < numTracks; group++ )
             {
-               // The mixer here isn't actually mixing: it's just doing
-               // resampling, format conversion, and possibly time track
-               // warping
-               int processed = 0;
-               samplePtr warpedSamples;
+               int chans = 1;
+               if (mPlaybackTracks[i]->GetLinked() && (int)i + 1 < numTracks)
+                  chans++;
+
                //don't do anything if we have no length.  In particular, Process() will fail an wxAssert
                //that causes a crash since this is not the GUI thread and wxASSERT is a GUI call.
-               if(deltat > 0.0)
-               {
-                  processed = mPlaybackMixers[i]->Process(lrint(deltat * mRate));
-                  warpedSamples = mPlaybackMixers[i]->GetBuffer();
-                  mPlaybackBuffers[i]->Put(warpedSamples, floatSample, processed);
-               }
-               //if looping and processed is less than the full chunk/block/buffer that gets pulled from
-               //other longer tracks, then we still need to advance the ring buffers or
-               //we'll trip up on ourselves when we start them back up again.
-               //if not looping we never start them up again, so its okay to not do anything
-               if(processed < lrint(deltat * mRate) && mPlayLooped)
+               if (frames > 0)
                {
-                  if(mLastSilentBufSize < lrint(deltat * mRate))
-                  {
-                     //delete old if necessary
-                     if(mSilentBuf)
-                        DeleteSamples(mSilentBuf);
-                     mLastSilentBufSize=lrint(deltat * mRate);
-                     mSilentBuf = NewSamples(mLastSilentBufSize, floatSample);
-                     ClearSamples(mSilentBuf, floatSample, 0, mLastSilentBufSize);
-                  }
-                  mPlaybackBuffers[i]->Put(mSilentBuf, floatSample, lrint(deltat * mRate) - processed);
+                  int processed = FillPlaybackGroup(group, i, chans, frames);
+                  if (processed > toCommit)
+                     toCommit = processed;
                }
+
+               i += chans;
             }
 
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+            em.RealtimeProcessEnd();
+#endif
+
+            //if looping and processed is less than the full chunk/block/buffer that gets pulled from
+            //other longer tracks, then we still need to advance the ring buffers or
+            //we'll trip up on ourselves when we start them back up again.
+            //FillPlaybackGroup() always writes all the frames, padding with
+            //silence, so there is nothing more to write.
+            if (mPlayLooped && frames > toCommit)
+               toCommit = frames;
+
+            mPlaybackBuffer->Commit(toCommit);
+
             // msmeyer: If playing looped, check if we are at the end of the buffer
             // and if yes, restart from the beginning.
             if (mPlayLooped && mWarpedTime >= mWarpedLength)
             {
                for (i = 0; i < mPlaybackTracks.GetCount(); i++)
                   mPlaybackMixers[i]->Restart();
+               ResetPlaybackGroups();
                mWarpedTime = 0.0;
             }
 
@@ -2930,11 +3109,15 @@ void AudioIO::FillBuffers()
       if (mAudioThreadShouldCallFillBuffersOnce ||
           deltat >= mMinCaptureSecsToCopy)
       {
+         filled = true;
+
          // Append captured samples to the end of the WaveTracks.
          // The WaveTracks have their own buffering for efficiency.
          XMLStringWriter blockFileLog;
          int numChannels = mCaptureTracks.GetCount();
 
+         // Each track reads its own channel; the frames are consumed for
+         // all channels at once afterwards
          for( i = 0; (int)i < numChannels; i++ )
          {
             int avail = commonlyAvail;
@@ -2945,7 +3128,7 @@ void AudioIO::FillBuffers()
             if( mFactor == 1.0 )
             {
                samplePtr temp = NewSamples(avail, trackFormat);
-               mCaptureBuffers[i]->Get   (temp, trackFormat, avail);
+               mCaptureBuffer->ReadChannel(i, 0, temp, trackFormat, avail);
                mCaptureTracks[i]-> Append(temp, trackFormat, avail, 1,
                                           &appendLog);
                DeleteSamples(temp);
@@ -2955,7 +3138,7 @@ void AudioIO::FillBuffers()
                int size = lrint(avail * mFactor);
                samplePtr temp1 = NewSamples(avail, floatSample);
                samplePtr temp2 = NewSamples(size, floatSample);
-               mCaptureBuffers[i]->Get(temp1, floatSample, avail);
+               mCaptureBuffer->ReadChannel(i, 0, temp1, floatSample, avail);
                /* we are re-sampling on the fly. The last resampling call
                 * must flush any samples left in the rate conversion buffer
                 * so that they get recorded
@@ -2978,10 +3161,15 @@ void AudioIO::FillBuffers()
             }
          }
 
+         mCaptureBuffer->Discard(commonlyAvail);
+
          if (mListener && !blockFileLog.IsEmpty())
             mListener->OnAudioIONewBlockFiles(blockFileLog);
       }
    }  // end of record buffering
+
+   if (filled)
+      mStats.FillDone(Profiler::Now() - begin, mFillEffectsMicros);
 }
 
 void AudioIO::SetListener(AudioIOListener* listener)
@@ -3431,6 +3619,28 @@ static void DoSoftwarePlaythrough(const void *inputBuffer,
          outputBuffer[2*i + 1] = outputBuffer[2*i];
 }
 
+// Counts a callback in AudioIO::mStats when it returns, whichever way
+class AudioCallbackTimer
+{
+ public:
+   AudioCallbackTimer(AudioIOStats &stats, unsigned long frames, double rate)
+      : mStats(stats)
+   {
+      mBegin = Profiler::Now();
+      mBufferMicros = (wxLongLong_t)(frames * 1000000.0 / rate);
+   }
+
+   ~AudioCallbackTimer()
+   {
+      mStats.CallbackEnd(Profiler::Now() - mBegin, mBufferMicros);
+   }
+
+ private:
+   AudioIOStats &mStats;
+   wxLongLong_t mBegin;
+   wxLongLong_t mBufferMicros;
+};
+
 int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
                           unsigned long framesPerBuffer,
 // If there were more of these conditionally used arguments, it 
@@ -3441,8 +3651,16 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
 #else
                           const PaStreamCallbackTimeInfo * WXUNUSED(timeInfo),
 #endif
-                          const PaStreamCallbackFlags WXUNUSED(statusFlags), void * WXUNUSED(userData) )
+                          const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   // Only allocates the first time a trace is recorded
+   if (Profiler::IsRecording())
+      Profiler::SetThreadName("Audio callback");
+   PROFILE_ZONE("audacityAudioCallback");
+
+   gAudioIO->mStats.CallbackBegin(statusFlags);
+   AudioCallbackTimer timer(gAudioIO->mStats, framesPerBuffer, gAudioIO->mRate);
+
    int numPlaybackChannels = gAudioIO->mNumPlaybackChannels;
    int numPlaybackTracks = gAudioIO->mPlaybackTracks.GetCount();
    int numCaptureChannels = gAudioIO->mNumCaptureChannels;
@@ -3596,10 +3814,9 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             else
                gAudioIO->mWarpedTime = gAudioIO->mTime - gAudioIO->mT0;
             for (i = 0; i < (unsigned int)numPlaybackTracks; i++)
-            {
                gAudioIO->mPlaybackMixers[i]->Reposition(gAudioIO->mTime);
-               gAudioIO->mPlaybackBuffers[i]->Discard(gAudioIO->mPlaybackBuffers[i]->AvailForGet());
-            }
+            gAudioIO->ResetPlaybackGroups();
+            gAudioIO->mPlaybackBuffer->Discard(gAudioIO->mPlaybackBuffer->AvailForGet());
 
             // Reload the ring buffers
             gAudioIO->mAudioThreadShouldCallFillBuffersOnce = true;
@@ -3632,13 +3849,17 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             tempBufs[c] = (float *) alloca(framesPerBuffer * sizeof(float));
          }
 
-#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
-         EffectManager & em = EffectManager::Get();
-         em.RealtimeProcessStart();
-#endif
+         // Read the same frames from every track's channel, then consume
+         // them all at once after the loop
+         int playbackAvail = gAudioIO->mPlaybackBuffer->AvailForGet();
+         // Until FillBuffers() has reached the end, a short ring buffer
+         // means it fell behind
+         gAudioIO->mStats.PlaybackFill(playbackAvail, (int)framesPerBuffer,
+                                       gAudioIO->mPlayLooped ||
+                                       gAudioIO->mWarpedTime < gAudioIO->mWarpedLength);
+         if (playbackAvail > (int)framesPerBuffer)
+            playbackAvail = (int)framesPerBuffer;
 
-         bool selected = false;
-         int group = 0;
          int chanCnt = 0;
          float rate = 0.0;
          for (t = 0; t < numPlaybackTracks; t++)
@@ -3662,7 +3883,6 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
 
                rate = vt->GetRate();
                linkFlag = vt->GetLinked();
-               selected = vt->GetSelected();
 
                // If we have a mono track, clear the right channel
                if (!linkFlag)
@@ -3677,15 +3897,16 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             // this is original code prior to r10680 -RBD
             if (cut)
             {
-               gAudioIO->mPlaybackBuffers[t]->Discard(framesPerBuffer);
+               // Nothing to read; the frames are discarded below.
                // keep going here.  
                // we may still need to issue a paComplete.
             }
             else
             {
-               len = gAudioIO->mPlaybackBuffers[t]->Get((samplePtr)tempBufs[chanCnt],
-                                                         floatSample,
-                                                         (int)framesPerBuffer);
+               len = gAudioIO->mPlaybackBuffer->ReadChannel(t, 0,
+                                                            (samplePtr)tempBufs[chanCnt],
+                                                            floatSample,
+                                                            playbackAvail);
                chanCnt++;
             }
 
@@ -3707,24 +3928,17 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             unsigned int len;
             if (cut)
             {
-               len = (unsigned int)
-                  gAudioIO->mPlaybackBuffers[t]->Discard(framesPerBuffer);
+               len = (unsigned int) playbackAvail;
             } else
             {
                len = (unsigned int)
-                  gAudioIO->mPlaybackBuffers[t]->Get((samplePtr)tempFloats,
-                                                     floatSample,
-                                                     (int)framesPerBuffer);
+                  gAudioIO->mPlaybackBuffer->ReadChannel(t, 0,
+                                                         (samplePtr)tempFloats,
+                                                         floatSample,
+                                                         playbackAvail);
             }
 #endif
 
-#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
-            if( !cut && selected )
-            {
-               len = em.RealtimeProcess(group, chanCnt, tempBufs, len);
-            }
-            group++;
-#endif
             // If our buffer is empty and the time indicator is past
             // the end, then we've actually finished playing the entire
             // selection.
@@ -3783,9 +3997,7 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
             chanCnt = 0;
          }
 
-#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
-         em.RealtimeProcessEnd();
-#endif
+         gAudioIO->mPlaybackBuffer->Discard(playbackAvail);
 
          gAudioIO->mLastPlaybackTimeMillis = ::wxGetLocalTimeMillis();
 
@@ -3822,12 +4034,11 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
       if( inputBuffer && (numCaptureChannels > 0) )
       {
          unsigned int len = framesPerBuffer;
-         for( t = 0; t < numCaptureChannels; t++) {
-            unsigned int avail =
-               (unsigned int)gAudioIO->mCaptureBuffers[t]->AvailForPut();
-            if (avail < len)
-               len = avail;
-         }
+         unsigned int avail =
+            (unsigned int)gAudioIO->mCaptureBuffer->AvailForPut();
+         gAudioIO->mStats.CaptureFree((int)avail, (int)framesPerBuffer);
+         if (avail < len)
+            len = avail;
 
          if (len < framesPerBuffer)
          {
@@ -3836,46 +4047,25 @@ int audacityAudioCallback(const void *inputBuffer, void *outputBuffer,
          }
 
          if (len > 0) {
-            for( t = 0; t < numCaptureChannels; t++) {
-
-               // dmazzoni:
-               // Un-interleave.  Ugly special-case code required because the
-               // capture channels could be in three different sample formats;
-               // it'd be nice to be able to call CopySamples, but it can't
-               // handle multiplying by the gain and then clipping.  Bummer.
-
-               switch(gAudioIO->mCaptureFormat) {
-               case floatSample: {
-                  float *inputFloats = (float *)inputBuffer;
-                  for( i = 0; i < len; i++)
-                     tempFloats[i] =
-                        inputFloats[numCaptureChannels*i+t];
-               } break;
-               case int24Sample:
-                  // We should never get here. Audacity's int24Sample format
-                  // is different from PortAudio's sample format and so we
-                  // make PortAudio return float samples when recording in
-                  // 24-bit samples.
-                  wxASSERT(false);
-                  break;
-               case int16Sample: {
-                  short *inputShorts = (short *)inputBuffer;
-                  short *tempShorts = (short *)tempBuffer;
-                  for( i = 0; i < len; i++) {
-                     float tmp = inputShorts[numCaptureChannels*i+t];
-                     if (tmp > 32767)
-                        tmp = 32767;
-                     if (tmp < -32768)
-                        tmp = -32768;
-                     tempShorts[i] = (short)(tmp);
-                  }
-               } break;
-               } // switch
-
-               gAudioIO->mCaptureBuffers[t]->Put((samplePtr)tempBuffer,
-                                                 gAudioIO->mCaptureFormat,
-                                                 len);
-            }
+            // We should never get int24Sample here. Audacity's int24Sample
+            // format is different from PortAudio's sample format and so we
+            // make PortAudio return float samples when recording in
+            // 24-bit samples.
+            wxASSERT(gAudioIO->mCaptureFormat != int24Sample);
+
+            // The ring buffer holds interleaved frames in PortAudio's
+            // format, so the input goes straight in, all channels at once;
+            // FillBuffers() converts to the tracks' formats
+            samplePtr first, second;
+            int firstFrames;
+            int frameSize = SAMPLE_SIZE(gAudioIO->mCaptureFormat) * numCaptureChannels;
+            int reserved = gAudioIO->mCaptureBuffer->Reserve(len, &first,
+                                                             &firstFrames,
+                                                             &second);
+            memcpy(first, inputBuffer, firstFrames * frameSize);
+            memcpy(second, (const char *)inputBuffer + firstFrames * frameSize,
+                   (reserved - firstFrames) * frameSize);
+            gAudioIO->mCaptureBuffer->Commit(reserved);
          }
       }
 
@@ -34,6 +34,7 @@
 
 #include "WaveTrack.h"
 #include "SampleFormat.h"
+#include "AudioIOStats.h"
 
 class AudioIO;
 class RingBuffer;
@@ -306,6 +307,17 @@ class AUDACITY_DLL_API AudioIO {
     */
    wxString GetDeviceInfo();
 
+   /** \brief Get how well the audio callback and audio thread have kept up
+    * since the counts were last reset
+    *
+    * Safe to call while a stream is running. */
+   wxString GetHealthInfo();
+   void GetHealthCounts(AudioIOStats::Counts *counts) { mStats.Get(counts); }
+
+   /** \brief Start counting the audio callback and audio thread health
+    * afresh */
+   void ResetHealthInfo();
+
    /** \brief Ensure selected device names are valid
     *
     */
@@ -360,6 +372,19 @@ private:
                              sampleFormat captureFormat);
    void FillBuffers();
 
+   /** \brief Writes the next frames of a group of playback tracks to their
+    * channels of mPlaybackBuffer
+    *
+    * The group is chans tracks starting at first: one, or two if linked.
+    * Its realtime effects are applied here, on the audio thread, so that
+    * the PortAudio callback only has to copy the results.  Their latency
+    * is compensated by reading further ahead from the mixers and dropping
+    * the start of their output.  Returns how many of the frames are audio
+    * rather than padding after the end of the tracks. */
+   int FillPlaybackGroup(int group, int first, int chans, int frames);
+   void WritePlaybackSilence(int channel, int offset, int frames);
+   void ResetPlaybackGroups();
+
 #ifdef EXPERIMENTAL_MIDI_OUT
    void PrepareMidiIterator(bool send = true, double offset = 0);
    bool StartPortMidiStream();
@@ -377,16 +402,16 @@ private:
    /** \brief Get the number of audio samples free in all of the playback
     * buffers.
     *
-    * Returns the smallest of the buffer free space values in the event that
-    * they are different. */
+    * All playback tracks share one multi-channel buffer, so this is the
+    * same for every track. */
    int GetCommonlyAvailPlayback();
 
    /** \brief Get the number of audio samples ready in all of the recording
     * buffers.
     *
-    * Returns the smallest of the number of samples available for storage in
-    * the recording buffers (i.e. the number of samples that can be read from
-    * all record buffers without underflow). */
+    * All capture channels share one multi-channel buffer, so this is the
+    * number of samples that can be read from every channel without
+    * underflow. */
    int GetCommonlyAvailCapture();
 
    /** \brief get the index of the supplied (named) recording device, or the
@@ -488,12 +513,27 @@ private:
    AudioThread         *mMidiThread;
 #endif
    Resample          **mResample;
-   RingBuffer        **mCaptureBuffers;
+   /// One channel per capture track, in the PortAudio capture format
+   RingBuffer         *mCaptureBuffer;
    WaveTrackArray      mCaptureTracks;
-   RingBuffer        **mPlaybackBuffers;
+   /// One channel per playback track
+   RingBuffer         *mPlaybackBuffer;
    WaveTrackArray      mPlaybackTracks;
 
    Mixer             **mPlaybackMixers;
+   sampleCount         mPlaybackMixBufferSize;
+
+   /// How far each group of playback tracks has got since the start, the
+   /// last seek or the last loop: samples read from its mixers, samples fed
+   /// to the realtime effects including padding, and samples written
+   struct PlaybackGroup {
+      sampleCount read;
+      sampleCount fed;
+      sampleCount written;
+   };
+   PlaybackGroup      *mPlaybackGroups;
+   float              *mPlaybackGroupBufs[2];
+   sampleCount         mPlaybackGroupBufSize;
    volatile int        mStreamToken;
    static int          mNextStreamToken;
    double              mFactor;
@@ -507,6 +547,12 @@ private:
    double              mPlaybackRingBufferSecs;
    double              mCaptureRingBufferSecs;
    double              mMaxPlaybackSecsToCopy;
+#if defined(EXPERIMENTAL_REALTIME_EFFECTS)
+   /// How far ahead of the callback to render while realtime effects are
+   /// active, so that changes to them are heard soon
+   double              mRealtimeLookaheadSecs;
+   double              mMinRealtimeSecsToCopy;
+#endif
    double              mMinCaptureSecsToCopy;
    bool                mPaused;
    PaStream           *mPortStreamV19;
@@ -517,6 +563,9 @@ private:
    unsigned int        mNumPlaybackChannels;
    sampleFormat        mCaptureFormat;
    int                 mLostSamples;
+   AudioIOStats        mStats;
+   /// Time spent in realtime effects during the current FillBuffers()
+   wxLongLong_t        mFillEffectsMicros;
    volatile bool       mAudioThreadShouldCallFillBuffersOnce;
    volatile bool       mAudioThreadFillBuffersLoopRunning;
    volatile bool       mAudioThreadFillBuffersLoopActive;
@@ -0,0 +1,245 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOStats.cpp
+
+*******************************************************************//**
+
+\class AudioIOStats
+\brief Counts how well the audio callback and the audio thread are
+  keeping up.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+#include "AudioIOStats.h"
+
+#include <wx/intl.h>
+
+#include "portaudio.h"
+
+// Upper bounds of the callback load buckets, in percent
+static const int kLoadBounds[AudioIOStats::kNumLoadBuckets - 1] =
+   { 10, 25, 50, 75, 90, 100 };
+
+static void Increment(volatile int *p)
+{
+   StoreRelease(p, *p + 1);
+}
+
+AudioIOStats::AudioIOStats()
+{
+   ClearCallbackCounts();
+   ClearFillCounts();
+   mCallbackReset = 0;
+   mFillReset = 0;
+}
+
+void AudioIOStats::ClearCallbackCounts()
+{
+   int i;
+
+   mCallbacks = 0;
+   for (i = 0; i < kNumLoadBuckets; i++)
+      mLoadHistogram[i] = 0;
+   mMaxCallbackMicros = 0;
+   mLastBufferMicros = 0;
+   for (i = 0; i < kNumXruns; i++)
+      mXruns[i] = 0;
+   mPlaybackUnderruns = 0;
+   mCaptureOverruns = 0;
+   mMinPlaybackFill = -1;
+   mMinCaptureFree = -1;
+}
+
+void AudioIOStats::ClearFillCounts()
+{
+   mFills = 0;
+   for (int i = 0; i < kNumFillBuckets; i++)
+      mFillHistogram[i] = 0;
+   mMaxFillMicros = 0;
+   mEffectsMillis = 0;
+   mEffectsRemainder = 0;
+   mMaxEffectsMicros = 0;
+}
+
+void AudioIOStats::Reset()
+{
+   StoreRelease(&mCallbackReset, 1);
+   StoreRelease(&mFillReset, 1);
+}
+
+void AudioIOStats::CallbackBegin(unsigned long statusFlags)
+{
+   if (LoadAcquire(&mCallbackReset)) {
+      ClearCallbackCounts();
+      StoreRelease(&mCallbackReset, 0);
+   }
+
+   if (statusFlags & paInputUnderflow)
+      Increment(&mXruns[kInputUnderflow]);
+   if (statusFlags & paInputOverflow)
+      Increment(&mXruns[kInputOverflow]);
+   if (statusFlags & paOutputUnderflow)
+      Increment(&mXruns[kOutputUnderflow]);
+   if (statusFlags & paOutputOverflow)
+      Increment(&mXruns[kOutputOverflow]);
+}
+
+void AudioIOStats::CallbackEnd(wxLongLong_t micros, wxLongLong_t bufferMicros)
+{
+   int bucket = kNumLoadBuckets - 1;
+   if (bufferMicros > 0) {
+      wxLongLong_t percent = micros * 100 / bufferMicros;
+      for (int i = 0; i < kNumLoadBuckets - 1; i++) {
+         if (percent < kLoadBounds[i]) {
+            bucket = i;
+            break;
+         }
+      }
+   }
+
+   Increment(&mLoadHistogram[bucket]);
+   if (micros > mMaxCallbackMicros)
+      StoreRelease(&mMaxCallbackMicros, (int)micros);
+   StoreRelease(&mLastBufferMicros, (int)bufferMicros);
+   Increment(&mCallbacks);
+}
+
+void AudioIOStats::PlaybackFill(int avail, int frames, bool more)
+{
+   if (mMinPlaybackFill < 0 || avail < mMinPlaybackFill)
+      StoreRelease(&mMinPlaybackFill, avail);
+
+   // Running short at the very end of playback is expected
+   if (avail < frames && more)
+      Increment(&mPlaybackUnderruns);
+}
+
+void AudioIOStats::CaptureFree(int avail, int frames)
+{
+   if (mMinCaptureFree < 0 || avail < mMinCaptureFree)
+      StoreRelease(&mMinCaptureFree, avail);
+
+   if (avail < frames)
+      Increment(&mCaptureOverruns);
+}
+
+void AudioIOStats::FillDone(wxLongLong_t micros, wxLongLong_t effectsMicros)
+{
+   if (LoadAcquire(&mFillReset)) {
+      ClearFillCounts();
+      StoreRelease(&mFillReset, 0);
+   }
+
+   int bucket = 0;
+   wxLongLong_t limit = 1000;
+   while (bucket < kNumFillBuckets - 1 && micros >= limit) {
+      bucket++;
+      limit *= 2;
+   }
+
+   Increment(&mFillHistogram[bucket]);
+   if (micros > mMaxFillMicros)
+      StoreRelease(&mMaxFillMicros, (int)micros);
+
+   // Kept in milliseconds, so that hours of playback don't overflow
+   int remainder = mEffectsRemainder + (int)effectsMicros;
+   StoreRelease(&mEffectsMillis, mEffectsMillis + remainder / 1000);
+   mEffectsRemainder = remainder % 1000;
+   if (effectsMicros > mMaxEffectsMicros)
+      StoreRelease(&mMaxEffectsMicros, (int)effectsMicros);
+
+   Increment(&mFills);
+}
+
+void AudioIOStats::Get(Counts *counts) const
+{
+   int i;
+
+   counts->callbacks = LoadAcquire(&mCallbacks);
+   for (i = 0; i < kNumLoadBuckets; i++)
+      counts->loadHistogram[i] = LoadAcquire(&mLoadHistogram[i]);
+   counts->maxCallbackMicros = LoadAcquire(&mMaxCallbackMicros);
+   counts->lastBufferMicros = LoadAcquire(&mLastBufferMicros);
+   for (i = 0; i < kNumXruns; i++)
+      counts->xruns[i] = LoadAcquire(&mXruns[i]);
+   counts->playbackUnderruns = LoadAcquire(&mPlaybackUnderruns);
+   counts->captureOverruns = LoadAcquire(&mCaptureOverruns);
+   counts->minPlaybackFill = LoadAcquire(&mMinPlaybackFill);
+   counts->minCaptureFree = LoadAcquire(&mMinCaptureFree);
+
+   counts->fills = LoadAcquire(&mFills);
+   for (i = 0; i < kNumFillBuckets; i++)
+      counts->fillHistogram[i] = LoadAcquire(&mFillHistogram[i]);
+   counts->maxFillMicros = LoadAcquire(&mMaxFillMicros);
+   counts->effectsMillis = LoadAcquire(&mEffectsMillis);
+   counts->maxEffectsMicros = LoadAcquire(&mMaxEffectsMicros);
+}
+
+// static
+wxString AudioIOStats::Format(const Counts &counts)
+{
+   wxString s;
+   int i;
+
+   s += _("Audio callback\n");
+   s += wxString::Format(_("Callbacks: %d\n"), counts.callbacks);
+   s += wxString::Format(_("Buffer lasts: %.2f ms\n"),
+                         counts.lastBufferMicros / 1000.0);
+   s += wxString::Format(_("Longest callback: %.2f ms\n"),
+                         counts.maxCallbackMicros / 1000.0);
+   s += _("Time taken, as a share of the buffer:\n");
+   for (i = 0; i < kNumLoadBuckets; i++) {
+      if (i < kNumLoadBuckets - 1)
+         s += wxString::Format(wxT("   < %3d%%: %d\n"),
+                               kLoadBounds[i], counts.loadHistogram[i]);
+      else
+         s += wxString::Format(_("   late: %d\n"), counts.loadHistogram[i]);
+   }
+
+   s += wxT("\n");
+   s += _("Ring buffers\n");
+   if (counts.minPlaybackFill >= 0)
+      s += wxString::Format(_("Fewest frames ready to play: %d\n"),
+                            counts.minPlaybackFill);
+   s += wxString::Format(_("Playback underruns: %d\n"),
+                         counts.playbackUnderruns);
+   if (counts.minCaptureFree >= 0)
+      s += wxString::Format(_("Least room for recorded frames: %d\n"),
+                            counts.minCaptureFree);
+   s += wxString::Format(_("Recording overruns: %d\n"),
+                         counts.captureOverruns);
+
+   s += wxT("\n");
+   s += _("Reported by the audio device\n");
+   s += wxString::Format(_("Input underflows: %d\n"),
+                         counts.xruns[kInputUnderflow]);
+   s += wxString::Format(_("Input overflows: %d\n"),
+                         counts.xruns[kInputOverflow]);
+   s += wxString::Format(_("Output underflows: %d\n"),
+                         counts.xruns[kOutputUnderflow]);
+   s += wxString::Format(_("Output overflows: %d\n"),
+                         counts.xruns[kOutputOverflow]);
+
+   s += wxT("\n");
+   s += _("Audio thread\n");
+   s += wxString::Format(_("Buffer fills: %d\n"), counts.fills);
+   s += wxString::Format(_("Longest fill: %.2f ms\n"),
+                         counts.maxFillMicros / 1000.0);
+   s += _("Time taken:\n");
+   for (i = 0; i < kNumFillBuckets; i++) {
+      if (i < kNumFillBuckets - 1)
+         s += wxString::Format(wxT("   < %3d ms: %d\n"),
+                               1 << i, counts.fillHistogram[i]);
+      else
+         s += wxString::Format(_("   longer: %d\n"), counts.fillHistogram[i]);
+   }
+   s += wxString::Format(_("Time in realtime effects: %d ms\n"),
+                         counts.effectsMillis);
+   s += wxString::Format(_("Longest in realtime effects: %.2f ms\n"),
+                         counts.maxEffectsMicros / 1000.0);
+
+   return s;
+}
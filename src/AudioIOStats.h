@@ -0,0 +1,127 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  AudioIOStats.h
+
+*******************************************************************//**
+
+\class AudioIOStats
+\brief Counts how well the audio callback and the audio thread are
+  keeping up: how long they take, how close the ring buffers come to
+  running dry or full, and how often PortAudio reports an xrun.
+
+  Each field has exactly one writer: the audio callback, or the audio
+  thread in FillBuffers().  Neither takes a lock.  Any other thread may
+  read them with Get(); each field is read atomically, but the fields
+  are not a consistent snapshot of one moment.
+
+  Reset() only asks for the counts to be cleared; each writer clears its
+  own at the start of its next update, so a reader never races a writer.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_AUDIO_IO_STATS__
+#define __AUDACITY_AUDIO_IO_STATS__
+
+#include <wx/defs.h>
+#include <wx/string.h>
+
+#include "LockFree.h"
+
+class AudioIOStats
+{
+ public:
+   // Callback time as a percentage of the time the buffer lasts:
+   // under 10, 25, 50, 75, 90 and 100, then late
+   enum { kNumLoadBuckets = 7 };
+   // Time in FillBuffers(): under 1, 2, 4, ..., 256 ms, then longer
+   enum { kNumFillBuckets = 10 };
+
+   // The xruns PortAudio reports in its callback flags
+   enum {
+      kInputUnderflow,
+      kInputOverflow,
+      kOutputUnderflow,
+      kOutputOverflow,
+      kNumXruns
+   };
+
+   struct Counts
+   {
+      int callbacks;
+      int loadHistogram[kNumLoadBuckets];
+      int maxCallbackMicros;
+      int lastBufferMicros;
+      int xruns[kNumXruns];
+      int playbackUnderruns;
+      int captureOverruns;
+      int minPlaybackFill;    // frames; -1 if nothing was played
+      int minCaptureFree;     // frames; -1 if nothing was captured
+
+      int fills;
+      int fillHistogram[kNumFillBuckets];
+      int maxFillMicros;
+      int effectsMillis;
+      int maxEffectsMicros;
+   };
+
+   AudioIOStats();
+
+   /// Asks both writers to clear their counts at their next update
+   void Reset();
+
+   /// Reads the counts; may be called from any thread
+   void Get(Counts *counts) const;
+
+   /// Describes the counts for people to read
+   static wxString Format(const Counts &counts);
+
+   // Called only from the audio callback
+
+   /// Call at the start of each callback, with its PortAudio status flags
+   void CallbackBegin(unsigned long statusFlags);
+   /// Call as each callback returns, with the time it took and the time
+   /// its buffer lasts
+   void CallbackEnd(wxLongLong_t micros, wxLongLong_t bufferMicros);
+   /// avail is what the playback ring held; frames is what was wanted.
+   /// more is false once the end of playback has been written to it.
+   void PlaybackFill(int avail, int frames, bool more);
+   /// avail is the space in the capture ring; frames is what was captured
+   void CaptureFree(int avail, int frames);
+
+   // Called only from the audio thread
+
+   /// Call after each FillBuffers(), with the time it took and the part
+   /// of that spent in realtime effects
+   void FillDone(wxLongLong_t micros, wxLongLong_t effectsMicros);
+
+ private:
+   void ClearCallbackCounts();
+   void ClearFillCounts();
+
+   // Written by the callback
+   volatile int mCallbacks;
+   volatile int mLoadHistogram[kNumLoadBuckets];
+   volatile int mMaxCallbackMicros;
+   volatile int mLastBufferMicros;
+   volatile int mXruns[kNumXruns];
+   volatile int mPlaybackUnderruns;
+   volatile int mCaptureOverruns;
+   volatile int mMinPlaybackFill;
+   volatile int mMinCaptureFree;
+
+   // Written by the audio thread
+   volatile int mFills;
+   volatile int mFillHistogram[kNumFillBuckets];
+   volatile int mMaxFillMicros;
+   volatile int mEffectsMillis;
+   volatile int mEffectsRemainder;  // microseconds not yet in mEffectsMillis
+   volatile int mMaxEffectsMicros;
+
+   // Set by Reset(), cleared by the writer once it has cleared its counts
+   volatile int mCallbackReset;
+   volatile int mFillReset;
+};
+
+#endif
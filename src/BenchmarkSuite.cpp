@@ -0,0 +1,1167 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BenchmarkSuite.cpp
+
+*******************************************************************//**
+
+\class BenchmarkCase
+\brief One operation timed by the BenchmarkSuite.
+
+  SetUp() and TearDown() run once around all the repetitions, and
+  Prepare() before each one, none of them timed; RunOnce() is the
+  part that is timed.  SetUp() sets the amount of work one repetition
+  does, in the case's units, so that a throughput can be reported.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/stdpaths.h>
+#include <wx/utils.h>
+
+#if defined(__WXMSW__)
+#include <wx/msw/wrapwin.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "BenchmarkSuite.h"
+#include "BlockCache.h"
+#include "BlockFile.h"
+#include "DirManager.h"
+#include "FFT.h"
+#include "Mix.h"
+#include "Project.h"
+#include "RealFFTf.h"
+#include "Resample.h"
+#include "SampleKernels.h"
+#include "Sequence.h"
+#include "ThreadPool.h"
+#include "WaveTrack.h"
+#include "effects/Effect.h"
+#include "effects/EffectManager.h"
+
+// Seconds, from the best clock the platform has
+static double Now()
+{
+#if defined(__WXMSW__)
+   LARGE_INTEGER count, frequency;
+   QueryPerformanceCounter(&count);
+   QueryPerformanceFrequency(&frequency);
+   return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+static void RemoveTree(const wxString &path)
+{
+   wxDir dir(path);
+   if (!dir.IsOpened())
+      return;
+
+   wxArrayString names;
+   wxString name;
+   bool cont = dir.GetFirst(&name, wxEmptyString,
+                            wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
+   while (cont) {
+      names.Add(path + wxFILE_SEP_PATH + name);
+      cont = dir.GetNext(&name);
+   }
+
+   for (size_t i = 0; i < names.GetCount(); i++) {
+      if (wxDirExists(names[i]))
+         RemoveTree(names[i]);
+      else
+         wxRemoveFile(names[i]);
+   }
+
+   wxRmdir(path);
+}
+
+class BenchmarkCase
+{
+ public:
+   BenchmarkCase(const wxString &name, const wxString &unit)
+   :  mName(name),
+      mUnit(unit),
+      mWork(0),
+      mSkipped(false)
+   {
+   }
+   virtual ~BenchmarkCase() {}
+
+   const wxString &GetName() const { return mName; }
+   const wxString &GetUnit() const { return mUnit; }
+   double GetWork() const { return mWork; }
+   /// True if SetUp() failed because this build can't run the case
+   bool IsSkipped() const { return mSkipped; }
+
+   virtual bool SetUp(BenchmarkSuite & WXUNUSED(suite)) { return true; }
+   virtual bool Prepare() { return true; }
+   virtual bool RunOnce() = 0;
+   /// Called even if SetUp() failed part way
+   virtual void TearDown() {}
+
+ protected:
+   wxString mName;
+   wxString mUnit;
+   double mWork;
+   bool mSkipped;
+};
+
+static Sequence *NewSignalSequence(DirManager *dirManager,
+                                   double seconds, int seed)
+{
+   Sequence *sequence = new Sequence(dirManager, floatSample);
+   sampleCount len = (sampleCount)(seconds * BenchmarkSuite::kRate);
+   sampleCount blockLen = sequence->GetIdealAppendLen();
+   float *buffer = new float[blockLen];
+
+   for (sampleCount pos = 0; pos < len; pos += blockLen) {
+      sampleCount block = std::min(blockLen, len - pos);
+      BenchmarkSuite::FillSignal(buffer, pos, block, seed);
+      sequence->Append((samplePtr)buffer, floatSample, block);
+   }
+
+   delete [] buffer;
+   return sequence;
+}
+
+//
+// Block files
+//
+
+class BlockWriteCase : public BenchmarkCase
+{
+ public:
+   BlockWriteCase()
+   :  BenchmarkCase(wxT("blockfile/write"), wxT("samples")),
+      mBuffer(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mDirManager = suite.GetDirManager();
+      mLen = Sequence::GetMaxDiskBlockSize() / SAMPLE_SIZE(floatSample);
+      mBuffer = new float[mLen];
+      BenchmarkSuite::FillSignal(mBuffer, 0, mLen, 0);
+      mWork = (double)kNumBlocks * mLen;
+      return true;
+   }
+
+   bool Prepare()
+   {
+      Release();
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      for (int i = 0; i < kNumBlocks; i++)
+         mBlocks.push_back(mDirManager->NewSimpleBlockFile((samplePtr)mBuffer,
+                                                           mLen, floatSample));
+      return true;
+   }
+
+   void TearDown()
+   {
+      Release();
+      delete [] mBuffer;
+   }
+
+ private:
+   enum { kNumBlocks = 32 };
+
+   void Release()
+   {
+      for (size_t i = 0; i < mBlocks.size(); i++)
+         mDirManager->Deref(mBlocks[i]);
+      mBlocks.clear();
+   }
+
+   DirManager *mDirManager;
+   sampleCount mLen;
+   float *mBuffer;
+   std::vector<BlockFile *> mBlocks;
+};
+
+class BlockReadCase : public BenchmarkCase
+{
+ public:
+   BlockReadCase(bool cached)
+   :  BenchmarkCase(cached ? wxT("blockfile/read-cached") :
+                             wxT("blockfile/read"),
+                    wxT("samples")),
+      mCached(cached),
+      mDirManager(NULL),
+      mBuffer(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mDirManager = suite.GetDirManager();
+      mLen = Sequence::GetMaxDiskBlockSize() / SAMPLE_SIZE(floatSample);
+      mBuffer = new float[mLen];
+      for (int i = 0; i < kNumBlocks; i++) {
+         BenchmarkSuite::FillSignal(mBuffer, i * mLen, mLen, 0);
+         mBlocks.push_back(mDirManager->NewSimpleBlockFile((samplePtr)mBuffer,
+                                                           mLen, floatSample));
+      }
+      mWork = (double)kNumBlocks * mLen;
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      for (size_t i = 0; i < mBlocks.size(); i++) {
+         int read;
+         if (mCached)
+            read = BlockCache::Get().ReadData(mBlocks[i], (samplePtr)mBuffer,
+                                              floatSample, 0, mLen);
+         else
+            read = mBlocks[i]->ReadData((samplePtr)mBuffer, floatSample,
+                                        0, mLen);
+         if (read != mLen)
+            return false;
+      }
+      return true;
+   }
+
+   void TearDown()
+   {
+      for (size_t i = 0; i < mBlocks.size(); i++) {
+         BlockCache::Get().Evict(mBlocks[i]);
+         mDirManager->Deref(mBlocks[i]);
+      }
+      mBlocks.clear();
+      delete [] mBuffer;
+   }
+
+ private:
+   enum { kNumBlocks = 32 };
+
+   bool mCached;
+   DirManager *mDirManager;
+   sampleCount mLen;
+   float *mBuffer;
+   std::vector<BlockFile *> mBlocks;
+};
+
+//
+// Sequences
+//
+
+class SequenceCase : public BenchmarkCase
+{
+ public:
+   enum Operation {
+      GetOp,
+      SetOp,
+      PasteOp,
+      DeleteOp
+   };
+
+   SequenceCase(const wxString &name, Operation op)
+   :  BenchmarkCase(name, wxT("samples")),
+      mOp(op),
+      mSequence(NULL),
+      mClip(NULL),
+      mBuffer(NULL),
+      mDone(false)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mSequence = NewSignalSequence(suite.GetDirManager(), 120.0, 1);
+      sampleCount numSamples = mSequence->GetNumSamples();
+
+      // Nowhere near block boundaries, so that blocks are split
+      mStart = numSamples / 3 + 1234;
+      mLen = 10 * BenchmarkSuite::kRate + 567;
+
+      switch (mOp)
+      {
+      case GetOp:
+         mBuffer = new float[kGetLen];
+         mWork = numSamples;
+         break;
+      case SetOp:
+         mBuffer = new float[mLen];
+         BenchmarkSuite::FillSignal(mBuffer, 0, mLen, 2);
+         mWork = mLen;
+         break;
+      case PasteOp:
+      case DeleteOp:
+         if (!mSequence->Copy(mStart, mStart + mLen, &mClip))
+            return false;
+         mWork = mLen;
+         break;
+      }
+
+      return true;
+   }
+
+   bool Prepare()
+   {
+      // Undo the previous repetition so that each one starts the same
+      if (mDone) {
+         mDone = false;
+         if (mOp == PasteOp)
+            return mSequence->Delete(mStart, mLen);
+         if (mOp == DeleteOp)
+            return mSequence->Paste(mStart, mClip);
+      }
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      mDone = true;
+
+      switch (mOp)
+      {
+      case GetOp:
+         for (sampleCount pos = 0; pos < mSequence->GetNumSamples();
+              pos += kGetLen) {
+            sampleCount block = std::min((sampleCount)kGetLen,
+                                         mSequence->GetNumSamples() - pos);
+            if (!mSequence->Get((samplePtr)mBuffer, floatSample, pos, block))
+               return false;
+         }
+         return true;
+      case SetOp:
+         return mSequence->Set((samplePtr)mBuffer, floatSample, mStart, mLen);
+      case PasteOp:
+         return mSequence->Paste(mStart, mClip);
+      case DeleteOp:
+         return mSequence->Delete(mStart, mLen);
+      }
+
+      return false;
+   }
+
+   void TearDown()
+   {
+      delete mClip;
+      delete mSequence;
+      delete [] mBuffer;
+   }
+
+ private:
+   // The size of the reads the Mixer does
+   enum { kGetLen = 65536 };
+
+   Operation mOp;
+   Sequence *mSequence;
+   Sequence *mClip;
+   float *mBuffer;
+   sampleCount mStart;
+   sampleCount mLen;
+   bool mDone;
+};
+
+class WaveDisplayCase : public BenchmarkCase
+{
+ public:
+   WaveDisplayCase(const wxString &name, double samplesPerPixel)
+   :  BenchmarkCase(name, wxT("pixels")),
+      mSamplesPerPixel(samplesPerPixel),
+      mSequence(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mSequence = NewSignalSequence(suite.GetDirManager(), 600.0, 4);
+
+      // Screens of up to kWidth pixels, as many as fit in the sequence,
+      // drawn over and over until kPixels pixels have been drawn
+      mWidth = std::min(kWidth,
+                        (int)(mSequence->GetNumSamples() / mSamplesPerPixel));
+      if (mWidth < 1)
+         return false;
+      mScreens = std::max(1, (int)(mSequence->GetNumSamples() /
+                                   (mSamplesPerPixel * mWidth)));
+      mWork = (double)(kPixels / mWidth) * mWidth;
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      float mins[kWidth], maxes[kWidth], rms[kWidth];
+      int bl[kWidth];
+      sampleCount where[kWidth + 1];
+
+      for (int drawn = 0; drawn + mWidth <= kPixels; drawn += mWidth) {
+         double start = (drawn / mWidth) % mScreens * mWidth;
+         for (int i = 0; i <= mWidth; i++)
+            where[i] = (sampleCount)((start + i) * mSamplesPerPixel + 0.5);
+         if (!mSequence->GetWaveDisplay(mins, maxes, rms, bl, mWidth, where,
+                                        mSamplesPerPixel))
+            return false;
+      }
+      return true;
+   }
+
+   void TearDown()
+   {
+      delete mSequence;
+   }
+
+ private:
+   enum {
+      kWidth = 1024,
+      kPixels = 65536
+   };
+
+   double mSamplesPerPixel;
+   Sequence *mSequence;
+   int mWidth;
+   int mScreens;
+};
+
+//
+// Mixing and resampling
+//
+
+class MixerCase : public BenchmarkCase
+{
+ public:
+   MixerCase(const wxString &name, double outRate)
+   :  BenchmarkCase(name, wxT("samples")),
+      mOutRate(outRate),
+      mMixer(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mWork = 0;
+      for (int i = 0; i < kNumTracks; i++) {
+         mTracks[i] = BenchmarkSuite::NewSignalTrack(suite.GetTrackFactory(),
+                                                     30.0, 10 + i);
+         mTracks[i]->SetPan(i % 2 ? 0.5f : -0.5f);
+         mWork += mTracks[i]->GetEndTime() * BenchmarkSuite::kRate;
+      }
+      return true;
+   }
+
+   bool Prepare()
+   {
+      delete mMixer;
+      mMixer = new Mixer(kNumTracks, mTracks, NULL,
+                         0.0, mTracks[0]->GetEndTime(),
+                         2, kBufferSize, true, mOutRate, floatSample);
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      while (mMixer->Process(kBufferSize) > 0)
+         ;
+      return true;
+   }
+
+   void TearDown()
+   {
+      delete mMixer;
+      for (int i = 0; i < kNumTracks; i++)
+         delete mTracks[i];
+   }
+
+ private:
+   enum {
+      kNumTracks = 8,
+      kBufferSize = 4096
+   };
+
+   double mOutRate;
+   WaveTrack *mTracks[kNumTracks];
+   Mixer *mMixer;
+};
+
+class ResampleCase : public BenchmarkCase
+{
+ public:
+   ResampleCase(const wxString &name, bool useBestMethod)
+   :  BenchmarkCase(name, wxT("samples")),
+      mUseBestMethod(useBestMethod),
+      mResample(NULL),
+      mInput(NULL),
+      mOutput(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite & WXUNUSED(suite))
+   {
+      mFactor = 48000.0 / BenchmarkSuite::kRate;
+      mLen = 30 * BenchmarkSuite::kRate;
+      mInput = new float[mLen];
+      BenchmarkSuite::FillSignal(mInput, 0, mLen, 5);
+      mOutputLen = (int)(kBlockLen * mFactor) + 1024;
+      mOutput = new float[mOutputLen];
+      mWork = mLen;
+      return true;
+   }
+
+   bool Prepare()
+   {
+      delete mResample;
+      mResample = new Resample(mUseBestMethod, mFactor, mFactor);
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      int pos = 0;
+      while (pos < mLen) {
+         int block = std::min((int)kBlockLen, mLen - pos);
+         bool last = (pos + block == mLen);
+         int used = 0;
+         mResample->Process(mFactor, mInput + pos, block, last,
+                            &used, mOutput, mOutputLen);
+         if (used <= 0 && !last)
+            return false;
+         pos += last ? block : used;
+      }
+      return true;
+   }
+
+   void TearDown()
+   {
+      delete mResample;
+      delete [] mInput;
+      delete [] mOutput;
+   }
+
+ private:
+   enum { kBlockLen = 16384 };
+
+   bool mUseBestMethod;
+   double mFactor;
+   Resample *mResample;
+   float *mInput;
+   int mLen;
+   float *mOutput;
+   int mOutputLen;
+};
+
+//
+// FFTs
+//
+
+class FFTCase : public BenchmarkCase
+{
+ public:
+   enum Variant {
+      RealVariant,
+      RealFloatVariant,
+      ComplexVariant,
+      PowerSpectrumVariant
+   };
+
+   FFTCase(const wxString &name, Variant variant, int size)
+   :  BenchmarkCase(wxString::Format(wxT("%s-%d"), name.c_str(), size),
+                    wxT("transforms")),
+      mVariant(variant),
+      mSize(size),
+      mHFFT(NULL),
+      mInput(NULL),
+      mReal(NULL),
+      mImag(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite & WXUNUSED(suite))
+   {
+      mNumFrames = kTotalLen / mSize;
+      mInput = new float[kTotalLen];
+      BenchmarkSuite::FillSignal(mInput, 0, kTotalLen, 6);
+      mReal = new float[mSize];
+      mImag = new float[mSize];
+      if (mVariant == RealFloatVariant)
+         mHFFT = GetFFT(mSize);
+      mWork = mNumFrames;
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      for (int i = 0; i < mNumFrames; i++) {
+         float *frame = mInput + i * mSize;
+         switch (mVariant)
+         {
+         case RealVariant:
+            RealFFT(mSize, frame, mReal, mImag);
+            break;
+         case RealFloatVariant:
+            // RealFFTf() works in place
+            memcpy(mReal, frame, mSize * sizeof(float));
+            RealFFTf(mReal, mHFFT);
+            break;
+         case ComplexVariant:
+            FFT(mSize, false, frame, NULL, mReal, mImag);
+            break;
+         case PowerSpectrumVariant:
+            PowerSpectrum(mSize, frame, mReal);
+            break;
+         }
+      }
+      return true;
+   }
+
+   void TearDown()
+   {
+      if (mHFFT)
+         ReleaseFFT(mHFFT);
+      delete [] mInput;
+      delete [] mReal;
+      delete [] mImag;
+   }
+
+ private:
+   enum { kTotalLen = 1 << 21 };
+
+   Variant mVariant;
+   int mSize;
+   int mNumFrames;
+   HFFT mHFFT;
+   float *mInput;
+   float *mReal;
+   float *mImag;
+};
+
+//
+// Effects
+//
+
+class EffectCase : public BenchmarkCase
+{
+ public:
+   EffectCase(const wxString &identifier)
+   :  BenchmarkCase(wxT("effect/") + identifier, wxT("samples")),
+      mIdentifier(identifier),
+      mSource(NULL),
+      mList(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      // Effects are looked up the way batch chains do it
+      mID = EffectManager::Get().GetEffectByIdentifier(mIdentifier);
+      if (mID.IsEmpty()) {
+         mSkipped = true;
+         return false;
+      }
+
+      mFactory = suite.GetTrackFactory();
+      mSource = BenchmarkSuite::NewSignalTrack(mFactory, 30.0, 7);
+      mList = new TrackList();
+      mWork = mSource->GetEndTime() * BenchmarkSuite::kRate;
+      return true;
+   }
+
+   bool Prepare()
+   {
+      // Most effects replace the tracks they process
+      mList->Clear(true);
+      Track *track = mSource->Duplicate();
+      track->SetSelected(true);
+      mList->Add(track);
+      mRegion.setTimes(0.0, track->GetEndTime());
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      // With no parameters and without prompting, effects use the
+      // settings they last used
+      return EffectManager::Get().DoEffect(mID, NULL, CONFIGURED_EFFECT,
+                                           BenchmarkSuite::kRate,
+                                           mList, mFactory, &mRegion,
+                                           wxEmptyString);
+   }
+
+   void TearDown()
+   {
+      if (mList) {
+         mList->Clear(true);
+         delete mList;
+      }
+      delete mSource;
+   }
+
+ private:
+   wxString mIdentifier;
+   PluginID mID;
+   TrackFactory *mFactory;
+   WaveTrack *mSource;
+   TrackList *mList;
+   SelectedRegion mRegion;
+};
+
+//
+// Projects
+//
+
+// A project window that is never shown.  The caller must make sure
+// that closing the last one doesn't quit Audacity.
+static AudacityProject *NewHiddenProject()
+{
+   AudacityProject *project = new AudacityProject(NULL, -1,
+                                                  wxDefaultPosition,
+                                                  wxSize(640, 480));
+   gAudacityProjects.Add(project);
+   return project;
+}
+
+static void AddSignalTracks(AudacityProject *project, double *work)
+{
+   const int numTracks = 4;
+
+   *work = 0;
+   for (int i = 0; i < numTracks; i++) {
+      WaveTrack *track =
+         BenchmarkSuite::NewSignalTrack(project->GetTrackFactory(), 60.0,
+                                        20 + i);
+      *work += track->GetEndTime() * BenchmarkSuite::kRate;
+      project->GetTracks()->Add(track);
+   }
+}
+
+class ProjectSaveCase : public BenchmarkCase
+{
+ public:
+   ProjectSaveCase()
+   :  BenchmarkCase(wxT("project/save"), wxT("samples")),
+      mProject(NULL),
+      mCount(0)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mDir = suite.GetScratchDir();
+      mProject = NewHiddenProject();
+      AddSignalTracks(mProject, &mWork);
+      return true;
+   }
+
+   bool Prepare()
+   {
+      // A new name each time, so that every save writes everything
+      mFileName = mDir + wxFILE_SEP_PATH +
+                  wxString::Format(wxT("save-%d.aup"), mCount++);
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      return mProject->SaveAs(mFileName, false, false);
+   }
+
+   void TearDown()
+   {
+      if (mProject)
+         mProject->Close(true);
+   }
+
+ private:
+   AudacityProject *mProject;
+   wxString mDir;
+   wxString mFileName;
+   int mCount;
+};
+
+class ProjectOpenCase : public BenchmarkCase
+{
+ public:
+   ProjectOpenCase()
+   :  BenchmarkCase(wxT("project/open"), wxT("samples")),
+      mProject(NULL)
+   {
+   }
+
+   bool SetUp(BenchmarkSuite &suite)
+   {
+      mFileName = suite.GetScratchDir() + wxFILE_SEP_PATH + wxT("open.aup");
+
+      AudacityProject *project = NewHiddenProject();
+      AddSignalTracks(project, &mWork);
+      bool ok = project->SaveAs(mFileName, false, false);
+      project->Close(true);
+      return ok;
+   }
+
+   bool Prepare()
+   {
+      if (mProject)
+         mProject->Close(true);
+      mProject = NewHiddenProject();
+      return true;
+   }
+
+   bool RunOnce()
+   {
+      mProject->OpenFile(mFileName, false);
+      TrackListIterator iter(mProject->GetTracks());
+      return iter.First() != NULL;
+   }
+
+   void TearDown()
+   {
+      if (mProject)
+         mProject->Close(true);
+   }
+
+ private:
+   AudacityProject *mProject;
+   wxString mFileName;
+};
+
+//
+// BenchmarkSuite
+//
+
+BenchmarkSuite::BenchmarkSuite()
+{
+   mWarmup = 2;
+   mRepetitions = 10;
+   mDirManager = new DirManager();
+   mFactory = new TrackFactory(mDirManager);
+}
+
+BenchmarkSuite::~BenchmarkSuite()
+{
+   for (size_t i = 0; i < mCases.size(); i++)
+      delete mCases[i];
+
+   delete mFactory;
+   mDirManager->Deref();
+
+   if (!mScratchDir.IsEmpty())
+      RemoveTree(mScratchDir);
+}
+
+void BenchmarkSuite::SetWarmup(int warmup)
+{
+   mWarmup = std::max(0, warmup);
+}
+
+void BenchmarkSuite::SetRepetitions(int repetitions)
+{
+   mRepetitions = std::max(1, repetitions);
+}
+
+void BenchmarkSuite::SetFilter(const wxString &filter)
+{
+   mFilter = filter;
+}
+
+void BenchmarkSuite::AddCases()
+{
+   mCases.push_back(new BlockWriteCase());
+   mCases.push_back(new BlockReadCase(false));
+   mCases.push_back(new BlockReadCase(true));
+
+   mCases.push_back(new SequenceCase(wxT("sequence/get"),
+                                     SequenceCase::GetOp));
+   mCases.push_back(new SequenceCase(wxT("sequence/set"),
+                                     SequenceCase::SetOp));
+   mCases.push_back(new SequenceCase(wxT("sequence/paste"),
+                                     SequenceCase::PasteOp));
+   mCases.push_back(new SequenceCase(wxT("sequence/delete"),
+                                     SequenceCase::DeleteOp));
+
+   // One for each of the summary levels GetWaveDisplay() reads
+   mCases.push_back(new WaveDisplayCase(wxT("sequence/wave-display-samples"),
+                                        8.0));
+   mCases.push_back(new WaveDisplayCase(wxT("sequence/wave-display-256"),
+                                        1000.0));
+   mCases.push_back(new WaveDisplayCase(wxT("sequence/wave-display-64k"),
+                                        100000.0));
+
+   mCases.push_back(new MixerCase(wxT("mixer/process"), kRate));
+   mCases.push_back(new MixerCase(wxT("mixer/process-resampled"), 48000.0));
+
+   mCases.push_back(new ResampleCase(wxT("resample/best"), true));
+   mCases.push_back(new ResampleCase(wxT("resample/fast"), false));
+
+   int sizes[] = { 1024, 16384 };
+   for (size_t i = 0; i < WXSIZEOF(sizes); i++) {
+      mCases.push_back(new FFTCase(wxT("fft/real"),
+                                   FFTCase::RealVariant, sizes[i]));
+      mCases.push_back(new FFTCase(wxT("fft/realf"),
+                                   FFTCase::RealFloatVariant, sizes[i]));
+      mCases.push_back(new FFTCase(wxT("fft/complex"),
+                                   FFTCase::ComplexVariant, sizes[i]));
+      mCases.push_back(new FFTCase(wxT("fft/power-spectrum"),
+                                   FFTCase::PowerSpectrumVariant, sizes[i]));
+   }
+
+   const wxChar *effects[] = {
+      wxT("Amplify"),
+      wxT("Normalize"),
+      wxT("Compressor"),
+      wxT("Echo"),
+      wxT("Phaser"),
+      wxT("Reverb"),
+      wxT("Equalization"),
+      wxT("ChangeSpeed"),
+      wxT("ChangeTempo"),
+   };
+   for (size_t i = 0; i < WXSIZEOF(effects); i++)
+      mCases.push_back(new EffectCase(effects[i]));
+
+   mCases.push_back(new ProjectSaveCase());
+   mCases.push_back(new ProjectOpenCase());
+}
+
+bool BenchmarkSuite::Run()
+{
+   AddCases();
+
+   bool ok = true;
+   for (size_t i = 0; i < mCases.size(); i++) {
+      BenchmarkCase *bc = mCases[i];
+      if (!mFilter.IsEmpty() && bc->GetName().Find(mFilter) == wxNOT_FOUND)
+         continue;
+
+      wxFprintf(stderr, wxT("%-36s "), bc->GetName().c_str());
+      fflush(stderr);
+
+      Result result;
+      RunCase(bc, result);
+      mResults.push_back(result);
+
+      if (result.status == wxT("ok"))
+         wxFprintf(stderr, wxT("%10.3f ms\n"), result.median * 1000.0);
+      else
+         wxFprintf(stderr, wxT("%s\n"), result.status.c_str());
+
+      if (result.status == wxT("failed"))
+         ok = false;
+   }
+
+   return ok;
+}
+
+void BenchmarkSuite::RunCase(BenchmarkCase *bc, Result &result)
+{
+   result.name = bc->GetName();
+   result.unit = bc->GetUnit();
+   result.work = 0;
+   result.repetitions = 0;
+   result.min = result.median = result.mean = result.stddev = result.max = 0;
+   result.cacheHits = result.cacheMisses = 0;
+
+   if (!bc->SetUp(*this)) {
+      result.status = bc->IsSkipped() ? wxT("skipped") : wxT("failed");
+      bc->TearDown();
+      return;
+   }
+   result.work = bc->GetWork();
+
+   std::vector<double> times;
+   BlockCacheStats before, after;
+   bool ok = true;
+   for (int i = 0; ok && i < mWarmup + mRepetitions; i++) {
+      if (i == mWarmup)
+         BlockCache::Get().GetStats(before);
+
+      ok = bc->Prepare();
+      if (!ok)
+         break;
+
+      double start = Now();
+      ok = bc->RunOnce();
+      double elapsed = Now() - start;
+
+      if (i >= mWarmup)
+         times.push_back(elapsed);
+   }
+
+   BlockCache::Get().GetStats(after);
+   result.cacheHits = after.hits - before.hits;
+   result.cacheMisses = after.misses - before.misses;
+
+   bc->TearDown();
+
+   if (!ok) {
+      result.status = wxT("failed");
+      return;
+   }
+
+   std::sort(times.begin(), times.end());
+
+   int n = (int)times.size();
+   double sum = 0;
+   for (int i = 0; i < n; i++)
+      sum += times[i];
+   double mean = sum / n;
+   double squares = 0;
+   for (int i = 0; i < n; i++)
+      squares += (times[i] - mean) * (times[i] - mean);
+
+   result.status = wxT("ok");
+   result.repetitions = n;
+   result.min = times[0];
+   result.max = times[n - 1];
+   result.median = (n % 2) ? times[n / 2] :
+                             (times[n / 2 - 1] + times[n / 2]) / 2;
+   result.mean = mean;
+   result.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+}
+
+static wxString Throughput(double work, double seconds)
+{
+   return wxString::Format(wxT("%.9g"), seconds > 0 ? work / seconds : 0.0);
+}
+
+wxString BenchmarkSuite::FormatJSON() const
+{
+   static const wxChar *levels[] = { wxT("scalar"), wxT("sse2"), wxT("avx2") };
+
+   wxString out;
+   out += wxT("{\n");
+   out += wxString::Format(wxT("  \"version\": \"%s\",\n"),
+                           AUDACITY_VERSION_STRING);
+   out += wxString::Format(wxT("  \"kernels\": \"%s\",\n"),
+                           levels[SampleKernels::GetLevel()]);
+   out += wxString::Format(wxT("  \"threads\": %d,\n"),
+                           ThreadPool::Get() ?
+                           ThreadPool::Get()->GetNumThreads() : 0);
+   out += wxString::Format(wxT("  \"warmup\": %d,\n"), mWarmup);
+   out += wxString::Format(wxT("  \"repetitions\": %d,\n"), mRepetitions);
+   out += wxT("  \"results\": [");
+
+   for (size_t i = 0; i < mResults.size(); i++) {
+      const Result &r = mResults[i];
+      out += (i == 0) ? wxT("\n") : wxT(",\n");
+      out += wxString::Format(wxT("    {\"name\": \"%s\", \"status\": \"%s\", "),
+                              r.name.c_str(), r.status.c_str());
+      out += wxString::Format(wxT("\"unit\": \"%s\", \"work\": %.9g, "),
+                              r.unit.c_str(), r.work);
+      out += wxString::Format(wxT("\"repetitions\": %d, "), r.repetitions);
+      out += wxString::Format(wxT("\"min\": %.9g, \"median\": %.9g, "),
+                              r.min, r.median);
+      out += wxString::Format(wxT("\"mean\": %.9g, \"stddev\": %.9g, "),
+                              r.mean, r.stddev);
+      out += wxString::Format(wxT("\"max\": %.9g, \"throughput\": %s, "),
+                              r.max, Throughput(r.work, r.median).c_str());
+      out += wxString::Format(wxT("\"cache_hits\": %lld, \"cache_misses\": %lld}"),
+                              r.cacheHits, r.cacheMisses);
+   }
+
+   out += wxT("\n  ]\n}\n");
+   return out;
+}
+
+wxString BenchmarkSuite::FormatCSV() const
+{
+   wxString out = wxT("name,status,unit,work,repetitions,")
+                  wxT("min,median,mean,stddev,max,throughput,")
+                  wxT("cache_hits,cache_misses\n");
+
+   for (size_t i = 0; i < mResults.size(); i++) {
+      const Result &r = mResults[i];
+      out += wxString::Format(wxT("%s,%s,%s,%.9g,%d,"),
+                              r.name.c_str(), r.status.c_str(),
+                              r.unit.c_str(), r.work, r.repetitions);
+      out += wxString::Format(wxT("%.9g,%.9g,%.9g,%.9g,%.9g,%s,"),
+                              r.min, r.median, r.mean, r.stddev, r.max,
+                              Throughput(r.work, r.median).c_str());
+      out += wxString::Format(wxT("%lld,%lld\n"),
+                              r.cacheHits, r.cacheMisses);
+   }
+
+   return out;
+}
+
+bool BenchmarkSuite::Write(const wxString &fileName, Format format)
+{
+   wxString out = (format == FormatCSV) ? FormatCSV() : FormatJSON();
+
+   if (fileName == wxT("-")) {
+      fputs(out.mb_str(wxConvUTF8), stdout);
+      fflush(stdout);
+      return true;
+   }
+
+   wxFFile file(fileName, wxT("w"));
+   if (!file.IsOpened())
+      return false;
+
+   return file.Write(out, wxConvUTF8) && file.Close();
+}
+
+void BenchmarkSuite::FillSignal(float *buffer, sampleCount start,
+                                sampleCount len, int seed)
+{
+   double f1 = 2.0 * M_PI * (110.0 + 55.0 * seed) / kRate;
+   double f2 = 2.0 * M_PI * (1234.5 + 17.0 * seed) / kRate;
+
+   for (sampleCount i = 0; i < len; i++) {
+      sampleCount s = start + i;
+
+      // A hash of the position rather than a running generator, so that
+      // any part of the signal can be made on its own
+      unsigned int hash = (unsigned int)s * 2654435761u + seed * 40503u;
+      hash ^= hash >> 15;
+      hash *= 2246822519u;
+      hash ^= hash >> 13;
+      float noise = (float)(hash & 0xffff) / 65536.0f - 0.5f;
+
+      buffer[i] = (float)(0.4 * sin(f1 * s) + 0.2 * sin(f2 * s)) +
+                  0.1f * noise;
+   }
+}
+
+WaveTrack *BenchmarkSuite::NewSignalTrack(TrackFactory *factory,
+                                          double seconds, int seed)
+{
+   WaveTrack *track = factory->NewWaveTrack(floatSample, kRate);
+   sampleCount len = (sampleCount)(seconds * kRate);
+   sampleCount blockLen = track->GetMaxBlockSize();
+   float *buffer = new float[blockLen];
+
+   for (sampleCount pos = 0; pos < len; pos += blockLen) {
+      sampleCount block = std::min(blockLen, len - pos);
+      FillSignal(buffer, pos, block, seed);
+      track->Append((samplePtr)buffer, floatSample, block);
+   }
+   track->Flush();
+
+   delete [] buffer;
+   return track;
+}
+
+wxString BenchmarkSuite::GetScratchDir()
+{
+   if (mScratchDir.IsEmpty()) {
+      mScratchDir = wxStandardPaths::Get().GetTempDir() + wxFILE_SEP_PATH +
+                    wxString::Format(wxT("audacity-benchmark-%lu"),
+                                     (unsigned long)wxGetProcessId());
+      wxMkdir(mScratchDir);
+   }
+   return mScratchDir;
+}
@@ -0,0 +1,119 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BenchmarkSuite.h
+
+*******************************************************************//**
+
+\class BenchmarkSuite
+\brief Times the core operations of Audacity without showing any
+  user interface, and writes the results as JSON or CSV.
+
+  Each case is run a few times untimed to warm up caches, then timed
+  for a number of repetitions.  The results give the minimum, median,
+  mean, standard deviation and maximum time of one repetition, and the
+  amount of work it did, so that runs on different machines or builds
+  can be compared by a script.
+
+  Run it with "audacity --benchmark results.json"; see
+  AudacityApp::ParseCommandLine() for the other options.  The
+  interactive BenchmarkDialog is still there for checking the
+  correctness of the block file system.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BENCHMARK_SUITE__
+#define __AUDACITY_BENCHMARK_SUITE__
+
+#include <vector>
+
+#include <wx/string.h>
+
+#include "SampleFormat.h"
+
+class BenchmarkCase;
+class DirManager;
+class TrackFactory;
+class WaveTrack;
+
+class BenchmarkSuite
+{
+ public:
+   enum Format {
+      FormatJSON,
+      FormatCSV
+   };
+
+   BenchmarkSuite();
+   ~BenchmarkSuite();
+
+   void SetWarmup(int warmup);
+   void SetRepetitions(int repetitions);
+   /// Only the cases whose names contain filter are run.
+   void SetFilter(const wxString &filter);
+
+   /// Runs the cases, reporting progress on stderr.  Returns false if
+   /// any of them failed.
+   bool Run();
+
+   /// Writes the results to fileName, or to stdout if it is "-".
+   bool Write(const wxString &fileName, Format format);
+
+   //
+   // For the cases:
+   //
+
+   enum {
+      kRate = 44100
+   };
+
+   DirManager *GetDirManager() { return mDirManager; }
+   TrackFactory *GetTrackFactory() { return mFactory; }
+
+   /// Fills buffer with samples start...start + len - 1 of a repeatable
+   /// test signal: two sine waves and some noise, different for each seed.
+   static void FillSignal(float *buffer, sampleCount start, sampleCount len,
+                          int seed);
+   /// A new mono track of the given length holding FillSignal().
+   static WaveTrack *NewSignalTrack(TrackFactory *factory, double seconds,
+                                    int seed);
+
+   /// A directory for files the cases write, removed by the destructor.
+   wxString GetScratchDir();
+
+ private:
+   struct Result {
+      wxString name;
+      wxString status;
+      wxString unit;
+      double work;
+      int repetitions;
+      double min;
+      double median;
+      double mean;
+      double stddev;
+      double max;
+      // BlockCache lookups during the timed repetitions
+      long long cacheHits;
+      long long cacheMisses;
+   };
+
+   void AddCases();
+   void RunCase(BenchmarkCase *bc, Result &result);
+   wxString FormatJSON() const;
+   wxString FormatCSV() const;
+
+   int mWarmup;
+   int mRepetitions;
+   wxString mFilter;
+
+   std::vector<BenchmarkCase *> mCases;
+   std::vector<Result> mResults;
+
+   DirManager *mDirManager;
+   TrackFactory *mFactory;
+   wxString mScratchDir;
+};
+
+#endif // __AUDACITY_BENCHMARK_SUITE__
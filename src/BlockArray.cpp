@@ -0,0 +1,378 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockArray.cpp
+
+*******************************************************************//**
+
+\file BlockArray.cpp
+\brief Implements class BlockArray, an AVL tree of block files indexed
+  by position.
+
+  Insertion, removal and splicing are all built on Split() and Join(),
+  as in "Just Join for Parallel Ordered Sets" (Blelloch, Ferizovic and
+  Sun, 2016), which keep the tree balanced without rebuilding it.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <wx/debug.h>
+
+#include "BlockArray.h"
+#include "BlockFile.h"
+
+class BlockNode
+{
+ public:
+   BlockFile *f;
+   sampleCount len;     // of this block
+
+   BlockNode *left;
+   BlockNode *right;
+
+   int height;
+   size_t count;        // blocks in this subtree
+   sampleCount samples; // samples in this subtree
+};
+
+static int Height(const BlockNode *n)
+{
+   return n ? n->height : 0;
+}
+
+static size_t Count(const BlockNode *n)
+{
+   return n ? n->count : 0;
+}
+
+static sampleCount Samples(const BlockNode *n)
+{
+   return n ? n->samples : 0;
+}
+
+static BlockNode *Update(BlockNode *n)
+{
+   int hl = Height(n->left);
+   int hr = Height(n->right);
+   n->height = 1 + (hl > hr ? hl : hr);
+   n->count = 1 + Count(n->left) + Count(n->right);
+   n->samples = n->len + Samples(n->left) + Samples(n->right);
+   return n;
+}
+
+static BlockNode *NewNode(BlockFile *f)
+{
+   wxASSERT(f);
+
+   BlockNode *n = new BlockNode();
+   n->f = f;
+   n->len = f->GetLength();
+   n->left = NULL;
+   n->right = NULL;
+   return Update(n);
+}
+
+static void DeleteTree(BlockNode *n)
+{
+   if (n) {
+      DeleteTree(n->left);
+      DeleteTree(n->right);
+      delete n;
+   }
+}
+
+static BlockNode *RotateLeft(BlockNode *n)
+{
+   BlockNode *r = n->right;
+   n->right = r->left;
+   r->left = Update(n);
+   return Update(r);
+}
+
+static BlockNode *RotateRight(BlockNode *n)
+{
+   BlockNode *l = n->left;
+   n->left = l->right;
+   l->right = Update(n);
+   return Update(l);
+}
+
+// Join() when l is more than one level taller than r
+static BlockNode *JoinRight(BlockNode *l, BlockNode *k, BlockNode *r)
+{
+   BlockNode *c = l->right;
+
+   if (Height(c) <= Height(r) + 1) {
+      k->left = c;
+      k->right = r;
+      Update(k);
+      if (Height(k) <= Height(l->left) + 1) {
+         l->right = k;
+         return Update(l);
+      }
+      l->right = RotateRight(k);
+      Update(l);
+      return RotateLeft(l);
+   }
+
+   l->right = JoinRight(c, k, r);
+   Update(l);
+   if (Height(l->right) <= Height(l->left) + 1)
+      return l;
+   return RotateLeft(l);
+}
+
+// Join() when r is more than one level taller than l
+static BlockNode *JoinLeft(BlockNode *l, BlockNode *k, BlockNode *r)
+{
+   BlockNode *c = r->left;
+
+   if (Height(c) <= Height(l) + 1) {
+      k->left = l;
+      k->right = c;
+      Update(k);
+      if (Height(k) <= Height(r->right) + 1) {
+         r->left = k;
+         return Update(r);
+      }
+      r->left = RotateLeft(k);
+      Update(r);
+      return RotateRight(r);
+   }
+
+   r->left = JoinLeft(l, k, c);
+   Update(r);
+   if (Height(r->left) <= Height(r->right) + 1)
+      return r;
+   return RotateRight(r);
+}
+
+// The blocks of l, then the single node k, then the blocks of r
+static BlockNode *Join(BlockNode *l, BlockNode *k, BlockNode *r)
+{
+   if (Height(l) > Height(r) + 1)
+      return JoinRight(l, k, r);
+   if (Height(r) > Height(l) + 1)
+      return JoinLeft(l, k, r);
+
+   k->left = l;
+   k->right = r;
+   return Update(k);
+}
+
+// Splits n into its first i blocks, *l, and the rest, *r
+static void Split(BlockNode *n, size_t i, BlockNode **l, BlockNode **r)
+{
+   if (!n) {
+      *l = NULL;
+      *r = NULL;
+      return;
+   }
+
+   BlockNode *left = n->left;
+   BlockNode *right = n->right;
+   size_t leftCount = Count(left);
+
+   if (i <= leftCount) {
+      BlockNode *middle;
+      Split(left, i, l, &middle);
+      *r = Join(middle, n, right);
+   }
+   else {
+      BlockNode *middle;
+      Split(right, i - leftCount - 1, &middle, r);
+      *l = Join(left, n, middle);
+   }
+}
+
+// Takes the last node out of n, returning the rest
+static BlockNode *SplitLast(BlockNode *n, BlockNode **last)
+{
+   BlockNode *left = n->left;
+   BlockNode *right = n->right;
+
+   if (!right) {
+      *last = n;
+      return left;
+   }
+
+   BlockNode *rest = SplitLast(right, last);
+   return Join(left, n, rest);
+}
+
+// The blocks of l, then those of r
+static BlockNode *Join2(BlockNode *l, BlockNode *r)
+{
+   if (!l)
+      return r;
+   if (!r)
+      return l;
+
+   BlockNode *last;
+   BlockNode *rest = SplitLast(l, &last);
+   return Join(rest, last, r);
+}
+
+BlockArray::BlockArray()
+{
+   mRoot = NULL;
+}
+
+BlockArray::~BlockArray()
+{
+   DeleteTree(mRoot);
+}
+
+size_t BlockArray::GetCount() const
+{
+   return Count(mRoot);
+}
+
+sampleCount BlockArray::GetNumSamples() const
+{
+   return Samples(mRoot);
+}
+
+int BlockArray::GetHeight() const
+{
+   return Height(mRoot);
+}
+
+static bool IsConsistent(const BlockNode *n)
+{
+   if (!n)
+      return true;
+
+   if (!IsConsistent(n->left) || !IsConsistent(n->right))
+      return false;
+
+   int hl = Height(n->left);
+   int hr = Height(n->right);
+   return n->f && n->len == n->f->GetLength() &&
+          hl - hr <= 1 && hr - hl <= 1 &&
+          n->height == 1 + (hl > hr ? hl : hr) &&
+          n->count == 1 + Count(n->left) + Count(n->right) &&
+          n->samples == n->len + Samples(n->left) + Samples(n->right);
+}
+
+bool BlockArray::IsConsistent() const
+{
+   return ::IsConsistent(mRoot);
+}
+
+// The node of block i, and where that block starts
+static BlockNode *FindNode(BlockNode *n, size_t i, sampleCount *start)
+{
+   sampleCount pos = 0;
+
+   for (;;) {
+      size_t leftCount = Count(n->left);
+      if (i < leftCount) {
+         n = n->left;
+         continue;
+      }
+
+      pos += Samples(n->left);
+      if (i == leftCount)
+         break;
+
+      pos += n->len;
+      i -= leftCount + 1;
+      n = n->right;
+   }
+
+   *start = pos;
+   return n;
+}
+
+SeqBlock BlockArray::Item(size_t i) const
+{
+   wxASSERT(i < Count(mRoot));
+
+   sampleCount start;
+   BlockNode *n = FindNode(mRoot, i, &start);
+   return SeqBlock(n->f, start);
+}
+
+int BlockArray::FindBlock(sampleCount pos) const
+{
+   if (pos < 0 || pos >= Samples(mRoot))
+      return -1;
+
+   BlockNode *n = mRoot;
+   size_t index = 0;
+
+   for (;;) {
+      sampleCount leftSamples = Samples(n->left);
+      if (pos < leftSamples) {
+         n = n->left;
+         continue;
+      }
+
+      if (pos < leftSamples + n->len)
+         return index + Count(n->left);
+
+      pos -= leftSamples + n->len;
+      index += Count(n->left) + 1;
+      n = n->right;
+   }
+}
+
+void BlockArray::Add(BlockFile *f)
+{
+   mRoot = Join(mRoot, NewNode(f), NULL);
+}
+
+void BlockArray::Insert(BlockFile *f, size_t i)
+{
+   wxASSERT(i <= Count(mRoot));
+
+   BlockNode *l, *r;
+   Split(mRoot, i, &l, &r);
+   mRoot = Join(l, NewNode(f), r);
+}
+
+void BlockArray::SetFile(size_t i, BlockFile *f)
+{
+   wxASSERT(i < Count(mRoot));
+
+   sampleCount start;
+   BlockNode *n = FindNode(mRoot, i, &start);
+   wxASSERT(f && f->GetLength() == n->len);
+   n->f = f;
+}
+
+void BlockArray::Replace(size_t i, BlockFile *f)
+{
+   RemoveAt(i);
+   Insert(f, i);
+}
+
+void BlockArray::RemoveAt(size_t i, size_t count)
+{
+   wxASSERT(i + count <= Count(mRoot));
+
+   BlockNode *l, *r, *removed;
+   Split(mRoot, i, &l, &r);
+   Split(r, count, &removed, &r);
+   DeleteTree(removed);
+   mRoot = Join2(l, r);
+}
+
+void BlockArray::InsertArray(size_t i, BlockArray &other)
+{
+   wxASSERT(i <= Count(mRoot));
+
+   BlockNode *l, *r;
+   Split(mRoot, i, &l, &r);
+   mRoot = Join2(Join2(l, other.mRoot), r);
+   other.mRoot = NULL;
+}
+
+void BlockArray::Clear()
+{
+   DeleteTree(mRoot);
+   mRoot = NULL;
+}
@@ -0,0 +1,106 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockArray.h
+
+*******************************************************************//**
+
+\class BlockArray
+\brief The blocks of a Sequence in order, kept in a balanced tree so
+  that a block can be found, inserted or removed anywhere in
+  O(log n) time.
+
+  Every node of the tree knows how many blocks and samples its subtree
+  holds.  The start of a block is counted from the lengths of the
+  blocks before it, rather than stored, so inserting or removing
+  blocks never renumbers the blocks after them.  Item() counts it
+  afresh each time and hands back a SeqBlock by value; nothing in the
+  tree is written by a read, so any number of threads may read an
+  array at once.
+
+  The array holds a BlockFile for each block, but no reference to it;
+  its owner Ref()s and Deref()s the files.  The array remembers the
+  length of each block, so a block's file may only be replaced with
+  SetFile() by one of the same length; use Replace() to put a file of
+  another length in its place.
+
+*//****************************************************************//**
+
+\class SeqBlock
+\brief Data structure containing pointer to a BlockFile and
+   a start time, as BlockArray::Item() gives them out.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_ARRAY__
+#define __AUDACITY_BLOCK_ARRAY__
+
+#include <wx/dynarray.h>
+
+#include "audacity/Types.h"
+
+class BlockFile;
+class BlockNode;
+
+// This is an internal data structure!  For advanced use only.
+class SeqBlock {
+ public:
+   SeqBlock() : f(NULL), start(0) {}
+   SeqBlock(BlockFile *f_, sampleCount start_) : f(f_), start(start_) {}
+
+   BlockFile * f;
+   ///the sample in the global wavetrack that this block starts at.
+   sampleCount start;
+};
+
+// A plain list of SeqBlocks, as read from a project file
+WX_DEFINE_ARRAY(SeqBlock *, SeqBlockList);
+
+class BlockArray
+{
+ public:
+   BlockArray();
+   /// Deletes the tree, but does not Deref() the files
+   ~BlockArray();
+
+   size_t GetCount() const;
+   sampleCount GetNumSamples() const;
+
+   /// The file of the block at index i and where the block starts
+   SeqBlock Item(size_t i) const;
+   SeqBlock operator[](size_t i) const { return Item(i); }
+
+   /// The index of the block holding sample pos, or -1 if pos
+   /// is outside the array
+   int FindBlock(sampleCount pos) const;
+
+   /// The height of the tree, for testing that it stays balanced
+   int GetHeight() const;
+
+   /// Walks the whole tree, in O(n), checking that every block has a
+   /// file of the length the tree holds for it, and that the cached
+   /// counts and heights are right and balanced
+   bool IsConsistent() const;
+
+   void Add(BlockFile *f);
+   void Insert(BlockFile *f, size_t i);
+   /// Puts f in place of the file of block i, which must be as long
+   void SetFile(size_t i, BlockFile *f);
+   /// Puts f in place of the block at index i
+   void Replace(size_t i, BlockFile *f);
+   /// Removes count blocks from index i
+   void RemoveAt(size_t i, size_t count = 1);
+   /// Moves all of the blocks of other into this array, before index i
+   void InsertArray(size_t i, BlockArray &other);
+   /// Removes all of the blocks
+   void Clear();
+
+ private:
+   BlockArray(const BlockArray &);
+   BlockArray &operator=(const BlockArray &);
+
+   BlockNode *mRoot;
+};
+
+#endif // __AUDACITY_BLOCK_ARRAY__
@@ -0,0 +1,269 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockCache.cpp
+
+*******************************************************************//**
+
+\file BlockCache.cpp
+\brief Implements class BlockCache.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <string.h>
+
+#include "BlockCache.h"
+#include "BlockFile.h"
+
+// Until the preferences have been read
+static const size_t kDefaultBudget = 64 << 20;
+
+BlockCache BlockCache::sInstance;
+
+BlockCacheStats::BlockCacheStats()
+{
+   hits = 0;
+   misses = 0;
+   evictions = 0;
+   bytes = 0;
+   entries = 0;
+}
+
+BlockCache::Shard::Shard()
+{
+   head = NULL;
+   tail = NULL;
+   bytes = 0;
+   hits = 0;
+   misses = 0;
+   evictions = 0;
+}
+
+void BlockCache::Shard::Link(Entry *entry)
+{
+   entry->prev = NULL;
+   entry->next = head;
+   if (head)
+      head->prev = entry;
+   head = entry;
+   if (!tail)
+      tail = entry;
+}
+
+void BlockCache::Shard::Unlink(Entry *entry)
+{
+   if (entry->prev)
+      entry->prev->next = entry->next;
+   else
+      head = entry->next;
+
+   if (entry->next)
+      entry->next->prev = entry->prev;
+   else
+      tail = entry->prev;
+}
+
+void BlockCache::Shard::Remove(Entry *entry)
+{
+   entries.erase(EntryKey(entry->file, entry->format));
+
+   if (entry->pending) {
+      entry->cancelled = true;
+      return;
+   }
+
+   Unlink(entry);
+   bytes -= entry->bytes;
+   DeleteSamples(entry->data);
+   delete entry;
+}
+
+void BlockCache::Shard::Trim(size_t budget)
+{
+   while (tail && bytes > budget) {
+      Remove(tail);
+      evictions++;
+   }
+}
+
+BlockCache &BlockCache::Get()
+{
+   return sInstance;
+}
+
+BlockCache::BlockCache()
+{
+   mBudget = kDefaultBudget;
+}
+
+BlockCache::~BlockCache()
+{
+   Clear();
+}
+
+void BlockCache::SetBudget(size_t bytes)
+{
+   mBudget = bytes;
+
+   for (int i = 0; i < kNumShards; i++) {
+      Shard &shard = mShards[i];
+      shard.lock.Lock();
+      shard.Trim(mBudget / kNumShards);
+      shard.lock.Unlock();
+   }
+}
+
+BlockCache::Shard &BlockCache::ShardFor(BlockFile *f)
+{
+   // BlockFiles are heap objects; the low bits carry no information
+   size_t hash = (size_t)f >> 4;
+   return mShards[(hash ^ (hash >> 8)) % kNumShards];
+}
+
+bool BlockCache::ShouldCache(BlockFile *f)
+{
+   // Silent blocks have no file and are cheaper to regenerate than to
+   // copy; on-demand blocks may not have their data yet
+   return mBudget > 0 &&
+          f->GetFileName().IsOk() &&
+          f->IsDataAvailable();
+}
+
+int BlockCache::ReadData(BlockFile *f, samplePtr data, sampleFormat format,
+                         sampleCount start, sampleCount len)
+{
+   if (!ShouldCache(f))
+      return f->ReadData(data, format, start, len);
+
+   Shard &shard = ShardFor(f);
+   size_t sampleSize = SAMPLE_SIZE(format);
+
+   shard.lock.Lock();
+
+   EntryMap::iterator iter = shard.entries.find(EntryKey(f, format));
+   if (iter != shard.entries.end()) {
+      Entry *entry = iter->second;
+
+      if (entry->pending) {
+         // Another thread is reading the block; don't wait for it
+         shard.misses++;
+         shard.lock.Unlock();
+         return f->ReadData(data, format, start, len);
+      }
+
+      shard.Unlink(entry);
+      shard.Link(entry);
+      shard.hits++;
+
+      if (len > entry->len - start)
+         len = entry->len - start;
+      if (len > 0)
+         memcpy(data, entry->data + start * sampleSize, len * sampleSize);
+
+      shard.lock.Unlock();
+      return len;
+   }
+
+   shard.misses++;
+
+   sampleCount blockLen = f->GetLength();
+   size_t bytes = blockLen * sampleSize;
+   if (bytes > mBudget / kNumShards) {
+      shard.lock.Unlock();
+      return f->ReadData(data, format, start, len);
+   }
+
+   Entry *entry = new Entry;
+   entry->file = f;
+   entry->format = format;
+   entry->data = NULL;
+   entry->len = blockLen;
+   entry->bytes = bytes;
+   entry->pending = true;
+   entry->cancelled = false;
+   shard.entries[EntryKey(f, format)] = entry;
+
+   shard.lock.Unlock();
+
+   // Read the whole block outside the lock
+   samplePtr blockData = NewSamples(blockLen, format);
+   bool ok = (f->ReadData(blockData, format, 0, blockLen) == blockLen);
+
+   if (ok) {
+      if (len > blockLen - start)
+         len = blockLen - start;
+      if (len > 0)
+         memcpy(data, blockData + start * sampleSize, len * sampleSize);
+   }
+
+   shard.lock.Lock();
+
+   if (entry->cancelled || !ok) {
+      // A cancelled read may have seen data that has since changed
+      if (!entry->cancelled)
+         shard.entries.erase(EntryKey(f, format));
+      shard.lock.Unlock();
+      delete entry;
+      DeleteSamples(blockData);
+      return f->ReadData(data, format, start, len);
+   }
+
+   entry->data = blockData;
+   entry->pending = false;
+   shard.Link(entry);
+   shard.bytes += bytes;
+
+   shard.Trim(mBudget / kNumShards);
+
+   shard.lock.Unlock();
+
+   return len;
+}
+
+void BlockCache::Evict(BlockFile *f)
+{
+   Shard &shard = ShardFor(f);
+
+   shard.lock.Lock();
+
+   // One entry per sample format at most
+   EntryMap::iterator iter =
+      shard.entries.lower_bound(EntryKey(f, 0));
+   while (iter != shard.entries.end() && iter->first.first == f) {
+      Entry *entry = iter->second;
+      ++iter;
+      shard.Remove(entry);
+   }
+
+   shard.lock.Unlock();
+}
+
+void BlockCache::Clear()
+{
+   for (int i = 0; i < kNumShards; i++) {
+      Shard &shard = mShards[i];
+      shard.lock.Lock();
+      while (!shard.entries.empty())
+         shard.Remove(shard.entries.begin()->second);
+      shard.lock.Unlock();
+   }
+}
+
+void BlockCache::GetStats(BlockCacheStats &stats)
+{
+   stats = BlockCacheStats();
+
+   for (int i = 0; i < kNumShards; i++) {
+      Shard &shard = mShards[i];
+      shard.lock.Lock();
+      stats.hits += shard.hits;
+      stats.misses += shard.misses;
+      stats.evictions += shard.evictions;
+      stats.bytes += shard.bytes;
+      stats.entries += shard.entries.size();
+      shard.lock.Unlock();
+   }
+}
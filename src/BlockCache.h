@@ -0,0 +1,133 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BlockCache.h
+
+*******************************************************************//**
+
+\class BlockCache
+\brief A process-wide, size-bounded cache of decoded BlockFile sample
+   data, shared by all tracks and projects.
+
+  Entries are whole blocks, keyed by BlockFile and sample format, and
+  are evicted in least-recently-used order once the byte budget is
+  exceeded.  The cache is split into shards, each with its own lock,
+  so that the audio thread, on-demand workers and the GUI rarely wait
+  on one another; a lock is never held while reading from disk.
+
+  Block files rarely change their sample data once created, so entries
+  only need to be removed when their BlockFile is deleted, recovered or
+  pointed at another aliased file.
+
+  A miss puts a pending entry in place before it reads the block.
+  Evict() cancels pending entries along with the others, so that a read
+  that finishes after its BlockFile is gone never caches its data.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_BLOCK_CACHE__
+#define __AUDACITY_BLOCK_CACHE__
+
+#include <map>
+
+#include "SampleFormat.h"
+#include "ondemand/ODTaskThread.h"
+
+class BlockFile;
+
+class BlockCacheStats
+{
+ public:
+   BlockCacheStats();
+
+   long long hits;
+   long long misses;
+   long long evictions;
+   size_t bytes;
+   int entries;
+};
+
+class BlockCache
+{
+ public:
+   static BlockCache &Get();
+
+   /// Sets the byte budget; zero disables the cache.
+   void SetBudget(size_t bytes);
+   size_t GetBudget() const { return mBudget; }
+
+   /// Reads like f->ReadData(), but from the cache when possible.  On a
+   /// miss the whole block is read and kept for next time.
+   int ReadData(BlockFile *f, samplePtr data, sampleFormat format,
+                sampleCount start, sampleCount len);
+
+   /// Drops all entries for f.  Called when f is deleted or its data
+   /// changes.
+   void Evict(BlockFile *f);
+   /// Drops all entries.
+   void Clear();
+
+   /// Totals since the program started, for the benchmarks
+   void GetStats(BlockCacheStats &stats);
+
+ private:
+   BlockCache();
+   ~BlockCache();
+
+   class Entry
+   {
+    public:
+      BlockFile *file;
+      sampleFormat format;
+      samplePtr data;
+      sampleCount len;
+      size_t bytes;
+
+      // Not yet read, and not in the list.  It belongs to the reading
+      // thread, which deletes it itself if it has been cancelled.
+      bool pending;
+      bool cancelled;
+
+      // Least-recently-used list, most recent first
+      Entry *prev;
+      Entry *next;
+   };
+
+   typedef std::pair<BlockFile *, int> EntryKey;
+   typedef std::map<EntryKey, Entry *> EntryMap;
+
+   class Shard
+   {
+    public:
+      Shard();
+
+      void Link(Entry *entry);
+      void Unlink(Entry *entry);
+      void Remove(Entry *entry);
+      void Trim(size_t budget);
+
+      EntryMap entries;
+      Entry *head;
+      Entry *tail;
+      size_t bytes;
+
+      long long hits;
+      long long misses;
+      long long evictions;
+
+      ODLock lock;
+   };
+
+   enum { kNumShards = 16 };
+
+   Shard &ShardFor(BlockFile *f);
+   bool ShouldCache(BlockFile *f);
+
+   Shard mShards[kNumShards];
+   size_t mBudget;
+
+   static BlockCache sInstance;
+};
+
+#endif // __AUDACITY_BLOCK_CACHE__
@@ -52,6 +52,7 @@ out.
 #include <wx/math.h>
 
 #include "BlockFile.h"
+#include "BlockCache.h"
 #include "Internat.h"
 
 // msmeyer: Define this to add debug output via printf()
@@ -104,10 +105,13 @@ BlockFile::BlockFile(wxFileName fileName, sampleCount samples):
    mSummaryInfo(samples)
 {
    mSilentLog=FALSE;
+   mWriteFailed=false;
 }
 
 BlockFile::~BlockFile()
 {
+   BlockCache::Get().Evict(this);
+
    if (!IsLocked() && mFileName.HasName())
       wxRemoveFile(mFileName.GetFullPath());
 }
@@ -370,8 +374,37 @@ void BlockFile::FixSummary(void *data)
    }
 }
 
+// Reads samples [start, start + len) of f, folding them into min, max
+// and sumsq
+static void AccumulateSamples(BlockFile *f, sampleCount start, sampleCount len,
+                              float *min, float *max, double *sumsq)
+{
+   if (len <= 0)
+      return;
+
+   samplePtr blockData = NewSamples(len, floatSample);
+   f->ReadData(blockData, floatSample, start, len);
+
+   for( int i = 0; i < len; i++ )
+   {
+      float sample = ((float*)blockData)[i];
+
+      if( sample > *max )
+         *max = sample;
+      if( sample < *min )
+         *min = sample;
+      *sumsq += (sample*sample);
+   }
+
+   DeleteSamples(blockData);
+}
+
 /// Retrieves the minimum, maximum, and maximum RMS of the
-/// specified sample data in this block.
+/// specified sample data in this block.  The 256-sample summary
+/// frames that lie wholly within the region stand in for their
+/// samples, so only the partial frames at either end are read.
+/// A block whose summary is still being computed on demand has no
+/// real frames yet, so all of its samples are read instead.
 ///
 /// @param start The offset in this block where the region should begin
 /// @param len   The number of samples to include in the region
@@ -384,26 +417,43 @@ void BlockFile::FixSummary(void *data)
 void BlockFile::GetMinMax(sampleCount start, sampleCount len,
                   float *outMin, float *outMax, float *outRMS)
 {
-   // TODO: actually use summaries
-   samplePtr blockData = NewSamples(len, floatSample);
-   this->ReadData(blockData, floatSample, start, len);
-
    float min = FLT_MAX;
    float max = -FLT_MAX;
-   float sumsq = 0;
+   double sumsq = 0;
 
-   for( int i = 0; i < len; i++ )
-   {
-      float sample = ((float*)blockData)[i];
+   sampleCount end = start + len;
+
+   // The last frame of the block may be short; it is whole if the
+   // region reaches the end of the block.
+   sampleCount frame0 = (start + 255) / 256;
+   sampleCount frame1 = (end == mLen) ? (end + 255) / 256 : end / 256;
 
-      if( sample > max )
-         max = sample;
-      if( sample < min )
-         min = sample;
-      sumsq += (sample*sample);
+   if (frame1 <= frame0 || !IsSummaryAvailable()) {
+      AccumulateSamples(this, start, len, &min, &max, &sumsq);
    }
+   else {
+      AccumulateSamples(this, start, frame0 * 256 - start, &min, &max, &sumsq);
 
-   DeleteSamples(blockData);
+      float *summary = new float[(frame1 - frame0) * 3];
+      this->Read256(summary, frame0, frame1 - frame0);
+
+      for (sampleCount i = frame0; i < frame1; i++) {
+         float *frame = summary + (i - frame0) * 3;
+         sampleCount frameLen = wxMin((sampleCount)256, mLen - i * 256);
+
+         if (frame[0] < min)
+            min = frame[0];
+         if (frame[1] > max)
+            max = frame[1];
+         sumsq += (double)frame[2] * frame[2] * frameLen;
+      }
+
+      delete[] summary;
+
+      if (frame1 * 256 < end)
+         AccumulateSamples(this, frame1 * 256, end - frame1 * 256,
+                           &min, &max, &sumsq);
+   }
 
    *outMin = min;
    *outMax = max;
@@ -633,6 +683,9 @@ bool AliasBlockFile::ReadSummary(void *data)
 void AliasBlockFile::ChangeAliasedFileName(wxFileName newAliasedFile)
 {
    mAliasedFileName = newAliasedFile;
+
+   // The cached samples came from the old file
+   BlockCache::Get().Evict(this);
 }
 
 wxLongLong AliasBlockFile::GetSpaceUsage()
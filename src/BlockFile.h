@@ -55,6 +55,16 @@ class BlockFile {
    virtual int ReadData(samplePtr data, sampleFormat format,
                         sampleCount start, sampleCount len) = 0;
 
+   /// If the samples [start, start + len) can be used in place in the
+   /// given format, returns a pointer to them that stays valid until
+   /// ReleaseMappedData().  Otherwise returns NULL; use ReadData() then.
+   virtual const char *AcquireMappedData(sampleFormat WXUNUSED(format),
+                                         sampleCount WXUNUSED(start),
+                                         sampleCount WXUNUSED(len))
+   { return NULL; }
+   /// Releases data returned by AcquireMappedData()
+   virtual void ReleaseMappedData(const char * WXUNUSED(data)) {}
+
    // Other Properties
 
    // Write cache to disk, if it has any
@@ -97,6 +107,10 @@ class BlockFile {
    /// Returns TRUE if this block references another disk file
    virtual bool IsAlias() { return false; }
 
+   /// Returns TRUE if this block's data is in a PackedBlockStore rather
+   /// than in a file of its own
+   virtual bool IsPacked() { return false; }
+
    /// Returns TRUE if this block's complete summary has been computed and is ready (for OD)
    virtual bool IsSummaryAvailable(){return true;}
 
@@ -106,6 +120,9 @@ class BlockFile {
    /// Returns TRUE if the summary has not yet been written, but is actively being computed and written to disk
    virtual bool IsSummaryBeingComputed(){return false;}
 
+   /// Returns TRUE if the constructor could not write out the data it was given
+   bool IsWriteFailed(){return mWriteFailed;}
+
    /// Create a new BlockFile identical to this, using the given filename
    virtual BlockFile *Copy(wxFileName newFileName) = 0;
 
@@ -139,6 +156,8 @@ class BlockFile {
    friend class ODComputeSummaryTask;
    friend class ODDecodeTask;
    friend class ODPCMAliasBlockFile;
+   //needed for RefCount access.
+   friend class UndoManager;
 
    virtual void Ref();
    virtual bool Deref();
@@ -167,6 +186,7 @@ class BlockFile {
    SummaryInfo mSummaryInfo;
    float mMin, mMax, mRMS;
    bool mSilentLog;
+   bool mWriteFailed;
 };
 
 /// A BlockFile that refers to data in an existing file
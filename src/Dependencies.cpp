@@ -29,6 +29,8 @@
 #include <wx/progdlg.h>
 #include <wx/choice.h>
 
+#include <vector>
+
 #include "BlockFile.h"
 #include "Dependencies.h"
 #include "DirManager.h"
@@ -53,11 +55,11 @@ WX_DECLARE_HASH_MAP(BlockFile *, BlockFile *,
 WX_DECLARE_HASH_MAP(BlockFile *, bool,
                     wxPointerHash, wxPointerEqual, BoolBlockFileHash);
 
-// Given a project, returns a single array of all SeqBlocks
-// in the current set of tracks.  Enumerating that array allows
-// you to process all block files in the current set.
-static void GetAllSeqBlocks(AudacityProject *project,
-                            BlockArray *outBlocks)
+// Given a project, returns a single array of the block files of all
+// of the blocks in the current set of tracks.  Enumerating that array
+// allows you to process all block files in the current set.
+static void GetAllBlockFiles(AudacityProject *project,
+                             std::vector<BlockFile *> *outFiles)
 {
    TrackList *tracks = project->GetTracks();
    TrackListIterator iter(tracks);
@@ -68,11 +70,10 @@ static void GetAllSeqBlocks(AudacityProject *project,
          WaveClipList::compatibility_iterator node = waveTrack->GetClipIterator();
          while(node) {
             WaveClip *clip = node->GetData();
-            Sequence *sequence = clip->GetSequence();
-            BlockArray *blocks = sequence->GetBlockArray();
+            const BlockArray *blocks = clip->GetSequenceBlockArray();
             int i;
             for (i = 0; i < (int)blocks->GetCount(); i++)
-               outBlocks->Add(blocks->Item(i));
+               outFiles->push_back(blocks->Item(i).f);
             node = node->GetNext();
          }
       }
@@ -89,20 +90,48 @@ static void ReplaceBlockFiles(AudacityProject *project,
                               ReplacedBlockFileHash &hash)
 {
    DirManager *dirManager = project->GetDirManager();
-   BlockArray blocks;
-   GetAllSeqBlocks(project, &blocks);
-
-   int i;
-   for (i = 0; i < (int)blocks.GetCount(); i++) {
-      if (hash.count(blocks[i]->f) > 0) {
-         BlockFile *src = blocks[i]->f;
-         BlockFile *dst = hash[src];
+   TrackList *tracks = project->GetTracks();
+   TrackListIterator iter(tracks);
+   Track *t = iter.First();
+   while (t) {
+      if (t->GetKind() == Track::Wave) {
+         WaveTrack *waveTrack = (WaveTrack *)t;
+         WaveClipList::compatibility_iterator node = waveTrack->GetClipIterator();
+         while(node) {
+            WaveClip *clip = node->GetData();
+            const BlockArray *blocks = clip->GetSequenceBlockArray();
 
-         dirManager->Deref(src);
-         dirManager->Ref(dst);
+            // The span of blocks from the first to the last one replaced.
+            // Blocks in between that stay keep their own file, which
+            // is Ref'd once more since the Sequence Derefs what it drops.
+            std::vector<BlockFile *> files;
+            int first = -1;
+            int i;
+            for (i = 0; i < (int)blocks->GetCount(); i++) {
+               BlockFile *src = blocks->Item(i).f;
+               if (hash.count(src) > 0) {
+                  if (first < 0)
+                     first = i;
+                  while (first + (int)files.size() < i) {
+                     BlockFile *same = blocks->Item(first + files.size()).f;
+                     dirManager->Ref(same);
+                     files.push_back(same);
+                  }
+
+                  BlockFile *dst = hash[src];
+                  dirManager->Ref(dst);
+                  files.push_back(dst);
+               }
+            }
+
+            if (!files.empty())
+               clip->GetSequence()->ReplaceBlockFiles(first, &files[0],
+                                                      files.size());
 
-         blocks[i]->f = dst;
+            node = node->GetNext();
+         }
       }
+      t = iter.Next();
    }
 }
 
@@ -111,15 +140,15 @@ void FindDependencies(AudacityProject *project,
 {
    sampleFormat format = project->GetDefaultFormat();
 
-   BlockArray blocks;
-   GetAllSeqBlocks(project, &blocks);
+   std::vector<BlockFile *> blocks;
+   GetAllBlockFiles(project, &blocks);
 
    AliasedFileHash aliasedFileHash;
    BoolBlockFileHash blockFileHash;
 
    int i;
-   for (i = 0; i < (int)blocks.GetCount(); i++) {
-      BlockFile *f = blocks[i]->f;
+   for (i = 0; i < (int)blocks.size(); i++) {
+      BlockFile *f = blocks[i];
       if (f->IsAlias() && (blockFileHash.count(f) == 0))
       {
          // f is an alias block we have not yet counted.
@@ -178,14 +207,14 @@ static void RemoveDependencies(AudacityProject *project,
       aliasedFileHash[fileNameStr] = &aliasedFiles->Item(i);
    }
 
-   BlockArray blocks;
-   GetAllSeqBlocks(project, &blocks);
+   std::vector<BlockFile *> blocks;
+   GetAllBlockFiles(project, &blocks);
 
    const sampleFormat format = project->GetDefaultFormat();
    ReplacedBlockFileHash blockFileHash;
    wxLongLong completedBytes = 0;
-   for (i = 0; i < blocks.GetCount(); i++) {
-      BlockFile *f = blocks[i]->f;
+   for (i = 0; i < blocks.size(); i++) {
+      BlockFile *f = blocks[i];
       if (f->IsAlias() && (blockFileHash.count(f) == 0))
       {
          // f is an alias block we have not yet processed.
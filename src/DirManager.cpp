@@ -46,7 +46,7 @@
   The blockfile/directory scheme is rather complicated with two different schemes.
   The current scheme uses two levels of subdirectories - up to 256 'eXX' and up to
   256 'dYY' directories within each of the 'eXX' dirs, where XX and YY are hex chars.
-  In each of the dXX directories there are up to 256 audio files (e.g. .au or .auf).
+  In each of the dXX directories there are up to 256 audio files (e.g. .au, .auc or .auf).
   They have a filename scheme of 'eXXYYZZZZ', where XX and YY refers to the
   subdirectories as above.  The 'ZZZZ' component is generated randomly for some reason.
   The XX and YY components are sequential.
@@ -65,6 +65,9 @@
 
 #include <time.h> // to use time() for srand()
 
+#include <map>
+#include <set>
+
 #include <wx/defs.h>
 #include <wx/app.h>
 #include <wx/dir.h>
@@ -86,6 +89,7 @@
 #endif
 
 #include "AudacityApp.h"
+#include "BlockCache.h"
 #include "BlockFile.h"
 #include "blockfile/LegacyBlockFile.h"
 #include "blockfile/LegacyAliasBlockFile.h"
@@ -94,8 +98,12 @@
 #include "blockfile/PCMAliasBlockFile.h"
 #include "blockfile/ODPCMAliasBlockFile.h"
 #include "blockfile/ODDecodeBlockFile.h"
+#include "blockfile/PackedBlockFile.h"
+#include "blockfile/CompressedBlockFile.h"
+#include "blockfile/PackedBlockStore.h"
 #include "DirManager.h"
 #include "Internat.h"
+#include "MappedFileCache.h"
 #include "Project.h"
 #include "Prefs.h"
 #include "widgets/Warning.h"
@@ -317,6 +325,10 @@ static void RecursivelyRemove(wxArrayString& filePathArray, int count,
 wxString DirManager::globaltemp;
 int DirManager::numDirManagers = 0;
 bool DirManager::dontDeleteTempFiles = false;
+MappedFileCache *DirManager::sMappingCache = NULL;
+long DirManager::sMappingBudgetMB = 128;
+bool DirManager::sPackBlocks = false;
+bool DirManager::sCompressBlocks = false;
 
 
 DirManager::DirManager()
@@ -342,6 +354,9 @@ DirManager::DirManager()
                wxString::Format(wxT("project%d"), rand());
    } while (wxDirExists(mytemp));
 
+   if (numDirManagers == 0 && sMappingBudgetMB > 0)
+      sMappingCache = new MappedFileCache((size_t)sMappingBudgetMB << 20, 4096);
+
    numDirManagers++;
 
    projPath = wxT("");
@@ -350,6 +365,13 @@ DirManager::DirManager()
    mLoadingTarget = NULL;
    mMaxSamples = -1;
 
+   // Fixed here, since block files are also made on other threads
+   mPackBlocks = sPackBlocks;
+   mPackedStore = new PackedBlockStore(mytemp);
+   mNextPackedName = 0;
+
+   mCompressBlocks = sCompressBlocks && CompressedBlockFile::CanCompress();
+
    // toplevel pool hash is fully populated to begin
    {
       int i;
@@ -370,8 +392,13 @@ DirManager::~DirManager()
 {
    wxASSERT(mRef == 0); // MM: Otherwise, we shouldn't delete it
 
+   mPackedStore->Deref();
+
    numDirManagers--;
    if (numDirManagers == 0) {
+      delete sMappingCache;
+      sMappingCache = NULL;
+
       CleanTempDir();
       //::wxRmdir(temp);
    }
@@ -436,6 +463,25 @@ bool DirManager::SetProject(wxString& newProjPath, wxString& newProjName, const
          return false;
    }
 
+   /* Packed blocks have no files of their own.  The segment files they
+      are in are moved all together, or copied if any of the blocks is
+      locked. */
+   bool copySegments = false;
+   BlockHash::iterator packedIter = mBlockFileHash.begin();
+   while (packedIter != mBlockFileHash.end() && !copySegments)
+   {
+      BlockFile *b = packedIter->second;
+      copySegments = b->IsPacked() && b->IsLocked();
+      packedIter++;
+   }
+
+   if (!mPackedStore->MoveToDir(projFull, copySegments)) {
+      this->projFull = oldFull;
+      this->projPath = oldPath;
+      this->projName = oldName;
+      return false;
+   }
+
    /* Move all files into this new directory.  Files which are
       "locked" get copied instead of moved.  (This happens when
       we perform a Save As - the files which belonged to the last
@@ -476,6 +522,11 @@ bool DirManager::SetProject(wxString& newProjPath, wxString& newProjName, const
 
       projFull = oldLoc;
 
+      if (copySegments)
+         mPackedStore->SetDir(oldLoc);
+      else
+         mPackedStore->MoveToDir(oldLoc, false);
+
       BlockHash::iterator iter = mBlockFileHash.begin();
       while (iter != mBlockFileHash.end())
       {
@@ -563,6 +614,7 @@ wxString DirManager::GetDataFilesDir() const
 void DirManager::SetLocalTempDir(wxString path)
 {
    mytemp = path;
+   mPackedStore->SetDir(GetDataFilesDir());
 }
 
 wxFileName DirManager::MakeBlockFilePath(wxString value){
@@ -847,7 +899,8 @@ wxFileName DirManager::MakeBlockFileName()
 
       baseFileName.Printf(wxT("e%02x%02x%03x"),topnum,midnum,filenum);
 
-      if (mBlockFileHash.find(baseFileName) == mBlockFileHash.end()){
+      if (mBlockFileHash.find(baseFileName) == mBlockFileHash.end() &&
+          mReservedNames.find(baseFileName) == mReservedNames.end()){
          // not in the hash, good.
          if (!this->AssignFile(ret, baseFileName, true))
          {
@@ -869,22 +922,80 @@ wxFileName DirManager::MakeBlockFileName()
    return ret;
 }
 
+wxFileName DirManager::MakePackedBlockFileName()
+{
+   // Packed blocks are named only to tell them apart in the project
+   // file, so the names are simply counted
+   wxString baseFileName;
+   do {
+      baseFileName.Printf(wxT("p%08x"), mNextPackedName++);
+   } while (mBlockFileHash.find(baseFileName) != mBlockFileHash.end() ||
+            mReservedNames.find(baseFileName) != mReservedNames.end());
+
+   wxFileName ret;
+   this->AssignFile(ret, baseFileName, false);
+   return ret;
+}
+
 BlockFile *DirManager::NewSimpleBlockFile(
                                  samplePtr sampleData, sampleCount sampleLen,
                                  sampleFormat format,
                                  bool allowDeferredWrite)
 {
+   if (mPackBlocks) {
+      // The write cache is only for .au files
+      wxFileName fileName = MakePackedBlockFileName();
+
+      BlockFile *newBlockFile =
+          new PackedBlockFile(mPackedStore, fileName,
+                              sampleData, sampleLen, format);
+
+      mBlockFileHash[fileName.GetName()]=newBlockFile;
+
+      return newBlockFile;
+   }
+
    wxFileName fileName = MakeBlockFileName();
 
-   BlockFile *newBlockFile =
-       new SimpleBlockFile(fileName, sampleData, sampleLen, format,
-                           allowDeferredWrite);
+   // Nor is the write cache for .auc files
+   BlockFile *newBlockFile;
+   if (mCompressBlocks)
+      newBlockFile =
+          new CompressedBlockFile(fileName, sampleData, sampleLen, format);
+   else
+      newBlockFile =
+          new SimpleBlockFile(fileName, sampleData, sampleLen, format,
+                              allowDeferredWrite);
 
    mBlockFileHash[fileName.GetName()]=newBlockFile;
 
    return newBlockFile;
 }
 
+wxFileName DirManager::ReserveBlockFileName()
+{
+   wxFileName fileName =
+      mPackBlocks ? MakePackedBlockFileName() : MakeBlockFileName();
+
+   mReservedNames[fileName.GetName()] = NULL;
+
+   return fileName;
+}
+
+void DirManager::AddBlockFile(BlockFile *b)
+{
+   wxString name = b->GetFileName().GetName();
+
+   mReservedNames.erase(name);
+   mBlockFileHash[name] = b;
+}
+
+void DirManager::ReleaseBlockFileName(const wxFileName &fileName)
+{
+   mReservedNames.erase(fileName.GetName());
+   BalanceInfoDel(fileName.GetName());
+}
+
 BlockFile *DirManager::NewAliasBlockFile(
                                  wxString aliasedFile, sampleCount aliasStart,
                                  sampleCount aliasLen, int aliasChannel)
@@ -954,7 +1065,12 @@ bool DirManager::ContainsBlockFile(wxString filepath) const
 // the BlockFile.
 BlockFile *DirManager::CopyBlockFile(BlockFile *b)
 {
-   if (!b->IsLocked()) {
+   // Packed blocks are shared only within their own store, since each
+   // project moves and compacts its store without regard to the others
+   bool foreign = b->IsPacked() &&
+      ((PackedBlockFile *)b)->GetStore() != mPackedStore;
+
+   if (!b->IsLocked() && !foreign) {
       b->Ref();
       //mchinen:July 13 2009 - not sure about this, but it needs to be added to the hash to be able to save if not locked.
       //note that this shouldn't hurt mBlockFileHash's that already contain the filename, since it should just overwrite.
@@ -972,6 +1088,17 @@ BlockFile *DirManager::CopyBlockFile(BlockFile *b)
       // Block files with uninitialized filename (i.e. SilentBlockFile)
       // just need an in-memory copy.
       b2 = b->Copy(wxFileName());
+   else if (b->IsPacked())
+   {
+      wxFileName newFile = MakePackedBlockFileName();
+
+      b2 = ((PackedBlockFile *)b)->CopyTo(mPackedStore, newFile);
+
+      if (b2 == NULL)
+         return NULL;
+
+      mBlockFileHash[newFile.GetName()]=b2;
+   }
    else
    {
       wxFileName newFile = MakeBlockFileName();
@@ -1016,6 +1143,10 @@ bool DirManager::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
    }
    else if ( !wxStricmp(tag, wxT("simpleblockfile")) )
       pBlockFile = SimpleBlockFile::BuildFromXML(*this, attrs);
+   else if ( !wxStricmp(tag, wxT("packedblockfile")) )
+      pBlockFile = PackedBlockFile::BuildFromXML(*this, attrs);
+   else if ( !wxStricmp(tag, wxT("compressedblockfile")) )
+      pBlockFile = CompressedBlockFile::BuildFromXML(*this, attrs);
    else if( !wxStricmp(tag, wxT("pcmaliasblockfile")) )
       pBlockFile = PCMAliasBlockFile::BuildFromXML(*this, attrs);
    else if( !wxStricmp(tag, wxT("odpcmaliasblockfile")) )
@@ -1117,10 +1248,19 @@ bool DirManager::MoveOrCopyToNewProjectDirectory(BlockFile *f, bool copy)
    if (!this->AssignFile(newFileName, f->GetFileName().GetFullName(), false))
       return false;
 
+   // SetProject() has already moved the segment file a packed block is in
+   if (f->IsPacked()) {
+      f->SetFileName(newFileName);
+      return true;
+   }
+
    if (newFileName != f->GetFileName()) {
       //check to see that summary exists before we copy.
       bool summaryExisted = f->IsSummaryAvailable();
       if (summaryExisted) {
+         // Some platforms can't rename a file while it is mapped
+         if (!copy && sMappingCache)
+            sMappingCache->Forget(f);
          if(!copy && !wxRenameFile(f->GetFileName().GetFullPath(), newFileName.GetFullPath()))
             return false;
          if(copy && !wxCopyFile(f->GetFileName().GetFullPath(), newFileName.GetFullPath()))
@@ -1472,6 +1612,7 @@ _("Project check of \"%s\" folder \
                dummy.Clear();
                b->ChangeAliasedFileName(dummy);
                b->Recover();
+               BlockCache::Get().Evict(b);
                nResult = FSCKstatus_CHANGED | FSCKstatus_SAVE_AUP;
             }
             iter++;
@@ -1522,6 +1663,7 @@ _("Project check of \"%s\" folder \
             if(action==0){
                //regenerate from data
                b->Recover();
+               BlockCache::Get().Evict(b);
                nResult |= FSCKstatus_CHANGED;
             }else if (action==1){
                // Silence error logging for this block in this session.
@@ -1581,6 +1723,7 @@ _("Project check of \"%s\" folder \
             {
                //regenerate with zeroes
                b->Recover();
+               BlockCache::Get().Evict(b);
                nResult = FSCKstatus_CHANGED;
             }
             else if (action == 1)
@@ -1593,7 +1736,7 @@ _("Project check of \"%s\" folder \
    }
 
    //
-   // ORPHAN BLOCKFILES (.au and .auf files that are not in the project.)
+   // ORPHAN BLOCKFILES (.au, .auc and .auf files that are not in the project.)
    //
    wxArrayString orphanFilePathArray;     // orphan .au and .auf files
    this->FindOrphanBlockFiles(filePathArray, orphanFilePathArray);
@@ -1746,11 +1889,22 @@ void DirManager::FindMissingAUs(
    {
       wxString key = iter->first;
       BlockFile *b = iter->second;
-      if (!b->IsAlias())
+      if (b->IsPacked())
+      {
+         if (!((PackedBlockFile *)b)->Exists())
+         {
+            missingAUHash[key] = b;
+            wxLogWarning(_("Missing data of packed block: '%s'"),
+                           key.c_str());
+         }
+      }
+      else if (!b->IsAlias())
       {
          wxFileName fileName = MakeBlockFilePath(key);
          fileName.SetName(key);
-         fileName.SetExt(wxT("au"));
+         // .auc for a CompressedBlockFile
+         wxString ext = b->GetFileName().GetExt();
+         fileName.SetExt(ext.IsSameAs(wxT("auc")) ? ext : wxString(wxT("au")));
          if (!fileName.FileExists())
          {
             missingAUHash[key] = b;
@@ -1762,7 +1916,7 @@ void DirManager::FindMissingAUs(
    }
 }
 
-// Find .au and .auf files that are not in the project.
+// Find .au, .auc and .auf files, and segment files, that are not in the project.
 void DirManager::FindOrphanBlockFiles(
       const wxArrayString& filePathArray,       // input: all files in project directory
       wxArrayString& orphanFilePathArray)       // output: orphan files
@@ -1773,10 +1927,22 @@ void DirManager::FindOrphanBlockFiles(
    {
       wxFileName fullname = filePathArray[i];
       wxString basename = fullname.GetName();
+
+      // A segment file belongs to the project if its store knows of it,
+      // even if none of its blocks is used any more; compaction removes it
+      int segment;
+      if (PackedBlockStore::IsSegmentFileName(fullname.GetFullName(), &segment))
+      {
+         if (!mPackedStore->HasSegment(segment))
+            orphanFilePathArray.Add(fullname.GetFullPath());
+         continue;
+      }
+
       if ((mBlockFileHash.find(basename) == mBlockFileHash.end()) && // is orphan
             // Consider only Audacity data files.
             // Specifically, ignore <branding> JPG and <import> OGG ("Save Compressed Copy").
             (fullname.GetExt().IsSameAs(wxT("au")) ||
+               fullname.GetExt().IsSameAs(wxT("auc")) ||
                fullname.GetExt().IsSameAs(wxT("auf"))))
       {
          if (!clipboardDM) {
@@ -1822,6 +1988,84 @@ void DirManager::RemoveOrphanBlockfiles()
       wxRemoveFile(orphanFilePathArray[i]);
 }
 
+void DirManager::CompactPackedBlocks()
+{
+   // The bytes of each segment file that blocks still use
+   std::map<int, wxFileOffset> used;
+   BlockHash::iterator iter;
+   for (iter = mBlockFileHash.begin(); iter != mBlockFileHash.end(); iter++)
+   {
+      BlockFile *b = iter->second;
+      if (b && b->IsPacked() &&
+          ((PackedBlockFile *)b)->GetStore() == mPackedStore)
+         used[((PackedBlockFile *)b)->GetSegment()] +=
+            ((PackedBlockFile *)b)->GetBytes();
+   }
+
+   // Segment files less than half used are retired, and what they hold
+   // that is still used is copied to the newest one
+   std::map<int, wxFileOffset> sizes;
+   mPackedStore->GetSegmentSizes(sizes);
+
+   std::set<int> retired;
+   wxFileOffset total = 0;
+   std::map<int, wxFileOffset>::iterator sizeIter;
+   for (sizeIter = sizes.begin(); sizeIter != sizes.end(); sizeIter++)
+   {
+      wxFileOffset bytes = used.count(sizeIter->first) ?
+         used[sizeIter->first] : 0;
+      if (bytes * 2 < sizeIter->second) {
+         retired.insert(sizeIter->first);
+         total += bytes;
+      }
+   }
+
+   if (retired.empty())
+      return;
+
+   std::set<int>::iterator retiredIter;
+   for (retiredIter = retired.begin(); retiredIter != retired.end(); retiredIter++)
+      mPackedStore->Retire(*retiredIter);
+
+   if (total == 0)
+      return;
+
+   ProgressDialog *progress = new ProgressDialog(_("Progress"),
+                                                 _("Compacting project data files"));
+
+   wxFileOffset done = 0;
+   bool success = true;
+   for (iter = mBlockFileHash.begin();
+        iter != mBlockFileHash.end() && success; iter++)
+   {
+      BlockFile *b = iter->second;
+      if (!b || !b->IsPacked())
+         continue;
+
+      PackedBlockFile *pb = (PackedBlockFile *)b;
+      if (pb->GetStore() != mPackedStore || !retired.count(pb->GetSegment()))
+         continue;
+
+      done += pb->GetBytes();
+      success = pb->Relocate();
+      progress->Update((long long unsigned)done, (long long unsigned)total);
+   }
+
+   delete progress;
+
+   if (!success) {
+      // Each block is in either its old place or its new one, so nothing
+      // is lost; the segments that were not emptied are simply kept
+      mPackedStore->Unretire();
+      wxLogWarning(_("Could not compact the project's data files.  Perhaps the disk is full."));
+   }
+}
+
+void DirManager::RemoveRetiredSegments()
+{
+   mPackedStore->RemoveRetired();
+}
+
 void DirManager::FillBlockfilesCache()
 {
 #ifdef DEPRECATED_AUDIO_CACHE
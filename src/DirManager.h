@@ -20,6 +20,8 @@
 
 class wxHashTable;
 class BlockFile;
+class MappedFileCache;
+class PackedBlockStore;
 class SequenceTest;
 
 #define FSCKstatus_CLOSE_REQ 0x1
@@ -70,6 +72,36 @@ class DirManager: public XMLTagHandler {
    BlockFile *NewODDecodeBlockFile( wxString aliasedFile, sampleCount aliasStart,
                                  sampleCount aliasLen, int aliasChannel, int decodeType);
 
+   // For making block files on other threads, which must not call the
+   // DirManager.  ReserveBlockFileName() returns a name that no other block
+   // file will get; the block file made with it is then added with
+   // AddBlockFile(), or the name given back with ReleaseBlockFileName().
+   wxFileName ReserveBlockFileName();
+   void AddBlockFile(BlockFile *b);
+   void ReleaseBlockFileName(const wxFileName &fileName);
+
+   // True if new blocks go into the packed block store, rather than into
+   // files of their own; set by the "/Directories/PackBlockFiles" pref.
+   // The store also holds the packed blocks of loaded projects.
+   bool GetPackBlocks() const { return mPackBlocks; }
+   // Whether DirManagers made from now on pack their new blocks
+   static void SetPackBlocks(bool pack) { sPackBlocks = pack; }
+   PackedBlockStore *GetPackedStore() { return mPackedStore; }
+
+   // True if new blocks that are not packed are written losslessly
+   // compressed, to .auc files; set by the "/Directories/CompressBlockFiles"
+   // pref, in builds with libFLAC.
+   bool GetCompressBlocks() const { return mCompressBlocks; }
+   // Whether DirManagers made from now on compress their new blocks
+   static void SetCompressBlocks(bool compress) { sCompressBlocks = compress; }
+
+   // Copies the packed blocks out of segment files that are mostly unused,
+   // retiring those segments and any that are not used at all.  Call
+   // before the project file is written, and RemoveRetiredSegments() once
+   // it has been.
+   void CompactPackedBlocks();
+   void RemoveRetiredSegments();
+
    /// Returns true if the blockfile pointed to by b is contained by the DirManager
    bool ContainsBlockFile(BlockFile *b) const;
    /// Check for existing using filename using complete filename
@@ -127,7 +159,7 @@ class DirManager: public XMLTagHandler {
          BlockHash& missingAUFHash);               // output: missing (.auf) AliasBlockFiles
    void FindMissingAUs(
          BlockHash& missingAUHash);                // missing data (.au) blockfiles
-   // Find .au and .auf files that are not in the project.
+   // Find .au and .auf files, and segment files, that are not in the project.
    void FindOrphanBlockFiles(
          const wxArrayString& filePathArray,       // input: all files in project directory
          wxArrayString& orphanFilePathArray);      // output: orphan files
@@ -156,9 +188,18 @@ class DirManager: public XMLTagHandler {
    // Fill cache of blockfiles, if caching is enabled (otherwise do nothing)
    void FillBlockfilesCache();
 
+   // Read-only mappings of block files.  Shared by all DirManagers, since
+   // block files can be referenced from more than one project; NULL if
+   // mapping is disabled or no DirManager exists.
+   static MappedFileCache *GetMappingCache() { return sMappingCache; }
+   // Megabytes of block files to keep mapped; zero disables mapping.
+   // Takes effect when the first DirManager is made.
+   static void SetMappingBudget(long mb) { sMappingBudgetMB = mb; }
+
  private:
 
    wxFileName MakeBlockFileName();
+   wxFileName MakePackedBlockFileName();
    wxFileName MakeBlockFilePath(wxString value);
 
    bool MoveOrCopyToNewProjectDirectory(BlockFile *f, bool copy);
@@ -166,6 +207,7 @@ class DirManager: public XMLTagHandler {
    int mRef; // MM: Current refcount
 
    BlockHash mBlockFileHash; // repository for blockfiles
+   BlockHash mReservedNames; // names of blockfiles being made elsewhere
    DirHash   dirTopPool;    // available toplevel dirs
    DirHash   dirTopFull;    // full toplevel dirs
    DirHash   dirMidPool;    // available two-level dirs
@@ -190,10 +232,20 @@ class DirManager: public XMLTagHandler {
 
    sampleCount mMaxSamples; // max samples per block
 
+   PackedBlockStore *mPackedStore;
+   bool mPackBlocks;
+   unsigned int mNextPackedName;
+
+   bool mCompressBlocks;
+
    static wxString globaltemp;
    wxString mytemp;
    static int numDirManagers;
    static bool dontDeleteTempFiles;
+   static MappedFileCache *sMappingCache;
+   static long sMappingBudgetMB;
+   static bool sPackBlocks;
+   static bool sCompressBlocks;
 
    friend class SequenceTest;
 };
@@ -50,6 +50,7 @@ and get deterministic behaviour.
 #include <wx/defs.h>
 
 #include "Dither.h"
+#include "SampleKernels.h"
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -298,6 +299,12 @@ void Dither::Apply(enum DitherType ditherType,
         // No clipping should be necessary.
         float* d = (float*)dest;
 
+        if (destStride == 1 && sourceStride == 1 && sourceFormat == int16Sample)
+            SampleKernels::Int16ToFloat((short*)source, d, len);
+        else
+        if (destStride == 1 && sourceStride == 1 && sourceFormat == int24Sample)
+            SampleKernels::Int24ToFloat((int*)source, d, len);
+        else
         if (sourceFormat == int16Sample)
         {
             short* s = (short*)source;
@@ -321,6 +328,15 @@ void Dither::Apply(enum DitherType ditherType,
         for (i = 0; i < len; i++, d += destStride, s += sourceStride)
             *d = ((int)*s) << 8;
     } else
+    if (ditherType == none && destStride == 1 && sourceStride == 1 &&
+        sourceFormat == floatSample)
+    {
+        // Same as DITHER(NoDither, ...) below, but vectorized
+        if (destFormat == int16Sample)
+            SampleKernels::FloatToInt16((float*)source, (short*)dest, len);
+        else
+            SampleKernels::FloatToInt24((float*)source, (int*)dest, len);
+    } else
     {
         // We must do dithering
         switch (ditherType)
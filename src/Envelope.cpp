@@ -40,6 +40,7 @@ a draggable point type.
 #include "AColor.h"
 #include "Prefs.h"
 #include "DirManager.h"
+#include "SampleKernels.h"
 #include "TrackArtist.h"
 
 Envelope::Envelope()
@@ -1090,6 +1091,39 @@ double Envelope::GetInterpolationStartValueAtPoint( int iPoint ) const
       return log10(v);
 }
 
+// Returns the first of the samples [start, len), at times t0 + i * tstep,
+// that is not before t, or len if there is none.  A sample exactly at t
+// counts as before it if inclusive.
+static int FirstSampleNotBefore(double t0, double tstep, int start, int len,
+                                double t, bool inclusive)
+{
+   int i = start;
+
+   // Guess from the time, then correct for rounding
+   if (tstep > 0.0) {
+      double guess = (t - t0) / tstep;
+      if (guess >= len)
+         i = len;
+      else if (guess > start)
+         i = (int)guess;
+   }
+
+   while (i < len &&
+          (inclusive ? t0 + i * tstep <= t : t0 + i * tstep < t))
+      i++;
+   while (i > start &&
+          !(inclusive ? t0 + (i - 1) * tstep <= t : t0 + (i - 1) * tstep < t))
+      i--;
+
+   return i;
+}
+
+static void FillConstant(double *buffer, int len, double value)
+{
+   for (int i = 0; i < len; i++)
+      buffer[i] = value;
+}
+
 void Envelope::GetValues(double *buffer, int bufferLen,
                          double t0, double tstep) const
 {
@@ -1100,78 +1134,77 @@ void Envelope::GetValues(double *buffer, int bufferLen,
 
    int len = mEnv.Count();
 
-   double t = t0;
-   double tprev, vprev, tnext = 0, vnext, vstep = 0;
-
-   for (int b = 0; b < bufferLen; b++) {
+   // Get easiest cases out the way first...
+   // IF empty envelope THEN default value
+   if (len <= 0) {
+      FillConstant(buffer, bufferLen, mDefaultValue);
+      return;
+   }
 
-      // Get easiest cases out the way first...
-      // IF empty envelope THEN default value
-      if (len <= 0) {
-         buffer[b] = mDefaultValue;
-         t += tstep;
-         continue;
-      }
-      // IF before envelope THEN first value
-      if (t <= mEnv[0]->GetT()) {
-         buffer[b] = mEnv[0]->GetVal();
-         t += tstep;
-         continue;
+   // IF before envelope THEN first value
+   int first = FirstSampleNotBefore(t0, tstep, 0, bufferLen,
+                                    mEnv[0]->GetT(), true);
+   FillConstant(buffer, first, mEnv[0]->GetVal());
+
+   // IF after envelope THEN last value
+   int last = FirstSampleNotBefore(t0, tstep, first, bufferLen,
+                                   mEnv[len - 1]->GetT(), false);
+   FillConstant(buffer + last, bufferLen - last, mEnv[len - 1]->GetVal());
+
+   // Everything in between is covered one segment between two points at
+   // a time, each a ramp computed with no per-sample searching
+   int b = first;
+   int lo = 0, hi = 0;
+   while (b < last) {
+      double t = t0 + b * tstep;
+
+      // The next segment is usually the one after the last, but we might
+      // be zoomed far out and skip over a large number of points.
+      // That's why we binary search then.
+      if (b == first || !(t < mEnv[hi + 1]->GetT())) {
+         BinarySearchForTime( lo, hi, t );
       }
-      // IF after envelope THEN last value
-      if (t >= mEnv[len - 1]->GetT()) {
-         buffer[b] = mEnv[len - 1]->GetVal();
-         t += tstep;
-         continue;
+      else {
+         lo++;
+         hi++;
       }
 
-      if (b == 0 || t > tnext) {
-
-         // We're beyond our tnext, so find the next one.
-         // Don't just increment lo or hi because we might
-         // be zoomed far out and that could be a large number of
-         // points to move over.  That's why we binary search.
-
-         int lo,hi;
-         BinarySearchForTime( lo, hi, t );
-         tprev = mEnv[lo]->GetT();
-         tnext = mEnv[hi]->GetT();
-
-         vprev = GetInterpolationStartValueAtPoint( lo );
-         vnext = GetInterpolationStartValueAtPoint( hi );
-
-         // Interpolate, either linear or log depending on mDB.
-         double dt = (tnext - tprev);
-         double to = t - tprev;
-         double v;
-         if (dt > 0.0)
-         {
-            v = (vprev * (dt - to) + vnext * to) / dt;
-            vstep = (vnext - vprev) * tstep / dt;
-         }
-         else
-         {
-            v = vnext;
-            vstep = 0.0;
-         }
+      double tprev = mEnv[lo]->GetT();
+      double tnext = mEnv[hi]->GetT();
+      int end = FirstSampleNotBefore(t0, tstep, b, last, tnext, false);
+      if (end == b)
+         continue;
 
-         // An adjustment if logarithmic scale.
-         if( mDB )
-         {
-            v = pow(10.0, v);
-            vstep = pow( 10.0, vstep );
-         }
+      double vprev = GetInterpolationStartValueAtPoint( lo );
+      double vnext = GetInterpolationStartValueAtPoint( hi );
 
-         buffer[b] = v;
-      } else {
-         if (mDB){
-            buffer[b] = buffer[b - 1] * vstep;
-         }else{
-            buffer[b] = buffer[b - 1] + vstep;
-         }
+      // Interpolate, either linear or log depending on mDB.
+      double dt = (tnext - tprev);
+      double to = t - tprev;
+      double v;
+      double vstep;
+      if (dt > 0.0)
+      {
+         v = (vprev * (dt - to) + vnext * to) / dt;
+         vstep = (vnext - vprev) * tstep / dt;
       }
+      else
+      {
+         v = vnext;
+         vstep = 0.0;
+      }
+
+      // Flat segments, common in envelopes with few points, need no ramp
+      if (vprev == vnext)
+         FillConstant(buffer + b, end - b, mDB ? pow(10.0, vprev) : vprev);
+      // An adjustment if logarithmic scale.
+      else if( mDB )
+         SampleKernels::FillGeometric(buffer + b, end - b,
+                                      pow(10.0, v), pow(10.0, vstep));
+      else
+         SampleKernels::FillRamp(buffer + b, end - b, v, vstep);
 
-      t += tstep;
+      b = end;
    }
 }
 
@@ -0,0 +1,83 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LockFree.h
+
+  Loads with acquire ordering and stores with release ordering, for
+  data shared between one writing and one reading thread without
+  locks, such as RingBuffer and ControlQueue positions.
+
+**********************************************************************/
+
+#ifndef __AUDACITY_LOCK_FREE__
+#define __AUDACITY_LOCK_FREE__
+
+#if defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+
+static inline int LoadAcquire(const volatile int *p)
+{
+   return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void StoreRelease(volatile int *p, int value)
+{
+   __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+#elif defined(__APPLE__)
+
+#include <libkern/OSAtomic.h>
+
+static inline int LoadAcquire(const volatile int *p)
+{
+   int value = *p;
+   OSMemoryBarrier();
+   return value;
+}
+
+static inline void StoreRelease(volatile int *p, int value)
+{
+   OSMemoryBarrier();
+   *p = value;
+}
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+#pragma intrinsic(_ReadWriteBarrier)
+
+// x86 and x64 don't reorder loads with later accesses or stores with
+// earlier ones; it is enough to stop the compiler from doing so
+static inline int LoadAcquire(const volatile int *p)
+{
+   int value = *p;
+   _ReadWriteBarrier();
+   return value;
+}
+
+static inline void StoreRelease(volatile int *p, int value)
+{
+   _ReadWriteBarrier();
+   *p = value;
+}
+
+#else
+
+static inline int LoadAcquire(const volatile int *p)
+{
+   int value = *p;
+   __sync_synchronize();
+   return value;
+}
+
+static inline void StoreRelease(volatile int *p, int value)
+{
+   __sync_synchronize();
+   *p = value;
+}
+
+#endif
+
+#endif // __AUDACITY_LOCK_FREE__
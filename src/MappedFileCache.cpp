@@ -0,0 +1,268 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFileCache.cpp
+
+*******************************************************************//**
+
+\file MappedFileCache.cpp
+\brief Implements class MappedFileCache.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#ifdef _WIN32
+   #include <windows.h>
+   #include <wx/msw/winundef.h>
+#else
+   #include <sys/types.h>
+   #include <sys/stat.h>
+   #include <sys/mman.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+
+#include "MappedFileCache.h"
+
+static char *MapFile(const wxString &fullPath, size_t *size)
+{
+#ifdef _WIN32
+   HANDLE file = CreateFileW(fullPath.wc_str(), GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (file == INVALID_HANDLE_VALUE)
+      return NULL;
+
+   LARGE_INTEGER len;
+   if (!GetFileSizeEx(file, &len) || len.QuadPart <= 0 ||
+       (unsigned long long)len.QuadPart > (size_t)-1) {
+      CloseHandle(file);
+      return NULL;
+   }
+
+   // The view keeps the file open; the handles aren't needed after this
+   HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle(file);
+   if (!mapping)
+      return NULL;
+
+   void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle(mapping);
+   if (!view)
+      return NULL;
+
+   *size = (size_t)len.QuadPart;
+   return (char *)view;
+#else
+   int fd = open(fullPath.fn_str(), O_RDONLY);
+   if (fd < 0)
+      return NULL;
+
+   struct stat st;
+   if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      close(fd);
+      return NULL;
+   }
+
+   // The mapping keeps the file open; the descriptor isn't needed after this
+   void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (view == MAP_FAILED)
+      return NULL;
+
+   *size = (size_t)st.st_size;
+   return (char *)view;
+#endif
+}
+
+static void UnmapFile(char *data, size_t size)
+{
+#ifdef _WIN32
+   UnmapViewOfFile(data);
+#else
+   munmap(data, size);
+#endif
+}
+
+MappedFileCache::MappedFileCache(size_t maxBytes, int maxFiles)
+{
+   mMaxBytes = maxBytes;
+   mMaxFiles = maxFiles;
+   mHead = NULL;
+   mTail = NULL;
+   mBytes = 0;
+}
+
+MappedFileCache::~MappedFileCache()
+{
+   EntryHash::iterator iter;
+   for (iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+      Unmap(iter->second);
+
+   // A pinned orphan at this point means a read outlived its BlockFile's
+   // DirManager; better to leak the mapping than to pull it out from under it
+   for (size_t i = 0; i < mOrphans.size(); i++)
+      wxASSERT(mOrphans[i]->pins == 0);
+}
+
+void MappedFileCache::Link(Entry *entry)
+{
+   entry->prev = NULL;
+   entry->next = mHead;
+   if (mHead)
+      mHead->prev = entry;
+   mHead = entry;
+   if (!mTail)
+      mTail = entry;
+}
+
+void MappedFileCache::Unlink(Entry *entry)
+{
+   if (entry->prev)
+      entry->prev->next = entry->next;
+   else
+      mHead = entry->next;
+
+   if (entry->next)
+      entry->next->prev = entry->prev;
+   else
+      mTail = entry->prev;
+
+   entry->prev = NULL;
+   entry->next = NULL;
+}
+
+void MappedFileCache::Unmap(Entry *entry)
+{
+   UnmapFile(entry->data, entry->size);
+   delete entry;
+}
+
+void MappedFileCache::Trim()
+{
+   Entry *entry = mTail;
+   while (entry &&
+          (mBytes > mMaxBytes || (int)mEntries.size() > mMaxFiles)) {
+      Entry *prev = entry->prev;
+      if (entry->pins == 0) {
+         Unlink(entry);
+         mEntries.erase(entry->owner);
+         mBytes -= entry->size;
+         Unmap(entry);
+      }
+      entry = prev;
+   }
+}
+
+const char *MappedFileCache::Acquire(const void *owner,
+                                     const wxString &fullPath, size_t *size)
+{
+   mLock.Lock();
+
+   EntryHash::iterator iter = mEntries.find(owner);
+   if (iter != mEntries.end()) {
+      Entry *entry = iter->second;
+      entry->pins++;
+      Unlink(entry);
+      Link(entry);
+      *size = entry->size;
+      mLock.Unlock();
+      return entry->data;
+   }
+
+   mLock.Unlock();
+
+   // Map outside the lock; other readers needn't wait on the disk
+   size_t mappedSize = 0;
+   char *data = MapFile(fullPath, &mappedSize);
+   if (!data)
+      return NULL;
+
+   mLock.Lock();
+
+   iter = mEntries.find(owner);
+   if (iter != mEntries.end()) {
+      // Another thread mapped it meanwhile
+      Entry *entry = iter->second;
+      entry->pins++;
+      Unlink(entry);
+      Link(entry);
+      *size = entry->size;
+      mLock.Unlock();
+
+      UnmapFile(data, mappedSize);
+      return entry->data;
+   }
+
+   Entry *entry = new Entry;
+   entry->owner = owner;
+   entry->data = data;
+   entry->size = mappedSize;
+   entry->pins = 1;
+   Link(entry);
+   mEntries[owner] = entry;
+   mBytes += mappedSize;
+
+   Trim();
+
+   mLock.Unlock();
+
+   *size = mappedSize;
+   return data;
+}
+
+void MappedFileCache::Release(const void *owner, const char *data)
+{
+   mLock.Lock();
+
+   EntryHash::iterator iter = mEntries.find(owner);
+   if (iter != mEntries.end() && iter->second->Contains(data)) {
+      iter->second->pins--;
+      Trim();
+      mLock.Unlock();
+      return;
+   }
+
+   for (size_t i = 0; i < mOrphans.size(); i++) {
+      Entry *entry = mOrphans[i];
+      if (entry->owner == owner && entry->Contains(data)) {
+         if (--entry->pins == 0) {
+            mOrphans.erase(mOrphans.begin() + i);
+            Unmap(entry);
+         }
+         break;
+      }
+   }
+
+   mLock.Unlock();
+}
+
+void MappedFileCache::Forget(const void *owner)
+{
+   mLock.Lock();
+
+   EntryHash::iterator iter = mEntries.find(owner);
+   if (iter != mEntries.end()) {
+      Entry *entry = iter->second;
+      Unlink(entry);
+      mEntries.erase(iter);
+      mBytes -= entry->size;
+
+      if (entry->pins > 0)
+         mOrphans.push_back(entry);
+      else
+         Unmap(entry);
+   }
+
+   mLock.Unlock();
+}
+
+size_t MappedFileCache::GetMappedBytes()
+{
+   mLock.Lock();
+   size_t bytes = mBytes;
+   mLock.Unlock();
+   return bytes;
+}
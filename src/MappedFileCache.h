@@ -0,0 +1,95 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  MappedFileCache.h
+
+*******************************************************************//**
+
+\class MappedFileCache
+\brief Keeps a bounded number of files mapped read-only into memory,
+   so that repeated reads of the same block file need no open, seek,
+   read or close calls.
+
+  Each mapping belongs to one owner (a BlockFile), which pins it with
+  Acquire() for the duration of a read and unpins it with Release().
+  Unpinned mappings are kept in least-recently-used order and unmapped
+  when the cache exceeds its byte or file budget.
+
+  An owner must call Forget() before its file is rewritten, renamed or
+  removed.  A mapping that is still pinned at that point is unmapped by
+  the last Release().
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_MAPPED_FILE_CACHE__
+#define __AUDACITY_MAPPED_FILE_CACHE__
+
+#include <vector>
+
+#include <wx/string.h>
+#include <wx/hashmap.h>
+
+#include "ondemand/ODTaskThread.h"
+
+class MappedFileCache
+{
+ public:
+   MappedFileCache(size_t maxBytes, int maxFiles);
+   ~MappedFileCache();
+
+   /// Returns the contents of the file at fullPath, mapped for owner and
+   /// pinned until Release().  Returns NULL if the file can't be mapped.
+   const char *Acquire(const void *owner, const wxString &fullPath,
+                       size_t *size);
+   /// Unpins a mapping returned by Acquire(); data may point anywhere
+   /// inside it.
+   void Release(const void *owner, const char *data);
+   /// Drops owner's mapping, if any.
+   void Forget(const void *owner);
+
+   size_t GetMappedBytes();
+
+ private:
+
+   class Entry
+   {
+    public:
+      bool Contains(const char *p) const
+      {
+         return p >= data && p < data + size;
+      }
+
+      const void *owner;
+      char *data;
+      size_t size;
+      int pins;
+
+      // Least-recently-used list, most recent first
+      Entry *prev;
+      Entry *next;
+   };
+
+   WX_DECLARE_HASH_MAP(const void *, Entry *, wxPointerHash, wxPointerEqual,
+                       EntryHash);
+
+   void Link(Entry *entry);
+   void Unlink(Entry *entry);
+   void Unmap(Entry *entry);
+   void Trim();
+
+   size_t mMaxBytes;
+   int mMaxFiles;
+
+   EntryHash mEntries;
+   Entry *mHead;
+   Entry *mTail;
+   size_t mBytes;
+
+   // Forgotten while pinned; unmapped by their last Release()
+   std::vector<Entry *> mOrphans;
+
+   ODLock mLock;
+};
+
+#endif // __AUDACITY_MAPPED_FILE_CACHE__
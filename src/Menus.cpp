@@ -1172,6 +1172,8 @@ void AudacityProject::CreateMenusAndCommands()
    c->AddItem(wxT("DeviceInfo"), _("Au&dio Device Info..."), FN(OnAudioDeviceInfo),
               AudioIONotBusyFlag,
               AudioIONotBusyFlag);
+   // Useful while playing or recording, so always enabled
+   c->AddItem(wxT("AudioHealth"), _("Audio &Health..."), FN(OnAudioHealth));
 
    c->AddItem(wxT("Log"), _("Show &Log..."), FN(OnShowLog));
 
@@ -6437,6 +6439,16 @@ void AudacityProject::OnAudioDeviceInfo()
       350,450);
 }
 
+void AudacityProject::OnAudioHealth()
+{
+   wxString info = gAudioIO->GetHealthInfo();
+   HelpSystem::ShowInfoDialog( this,
+      _("Audio Health"),
+      wxT(""),
+      info,
+      350,450);
+}
+
 void AudacityProject::OnSeparator()
 {
 
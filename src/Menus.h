@@ -379,6 +379,7 @@ void OnHelpWelcome();
 void OnBenchmark();
 void OnScreenshot();
 void OnAudioDeviceInfo();
+void OnAudioHealth();
 
        //
 
@@ -38,8 +38,11 @@
 #include "Envelope.h"
 #include "Internat.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
 #include "Resample.h"
+#include "SampleKernels.h"
+#include "ThreadPool.h"
 #include "float_cast.h"
 
 //TODO-MB: wouldn't it make more sense to delete the time track after 'mix and render'?
@@ -303,6 +306,26 @@ Mixer::Mixer(int numInputTracks, WaveTrack **inputTracks,
    if (mQueueMaxLen > envLen)
       envLen = mQueueMaxLen;
    mEnvValues = new double[envLen];
+
+   mNumWorkers = 0;
+   mGroupSize = 0;
+   mTrackBuffer = NULL;
+   mTrackLen = NULL;
+   mWorkerEnvValues = NULL;
+   ThreadPool *pool = ThreadPool::Get();
+   if (pool && mNumInputTracks > 1) {
+      mNumWorkers = std::min(pool->GetNumThreads(), mNumInputTracks - 1);
+      // Enough tracks per group to keep everyone busy, but not so many
+      // that a session with hundreds of tracks needs a buffer for each
+      mGroupSize = std::min(2 * (mNumWorkers + 1), mNumInputTracks);
+      mTrackBuffer = new float *[mGroupSize];
+      mTrackLen = new sampleCount[mGroupSize];
+      for (i = 0; i < mGroupSize; i++)
+         mTrackBuffer[i] = new float[mInterleavedBufferSize];
+      mWorkerEnvValues = new double *[mNumWorkers];
+      for (i = 0; i < mNumWorkers; i++)
+         mWorkerEnvValues[i] = new double[envLen];
+   }
 }
 
 Mixer::~Mixer()
@@ -329,6 +352,14 @@ Mixer::~Mixer()
    delete[] mSampleQueue;
    delete[] mQueueStart;
    delete[] mQueueLen;
+
+   for (i = 0; i < mGroupSize; i++)
+      delete[] mTrackBuffer[i];
+   delete[] mTrackBuffer;
+   delete[] mTrackLen;
+   for (i = 0; i < mNumWorkers; i++)
+      delete[] mWorkerEnvValues[i];
+   delete[] mWorkerEnvValues;
 }
 
 void Mixer::ApplyTrackGains(bool apply)
@@ -347,6 +378,13 @@ void MixBuffers(int numChannels, int *channelFlags, float *gains,
                 samplePtr src, samplePtr *dests,
                 int len, bool interleaved)
 {
+   // Both channels of interleaved stereo in one pass
+   if (interleaved && numChannels == 2 && channelFlags[0] && channelFlags[1]) {
+      SampleKernels::AddScaledStereo((float *)dests[0], (float *)src,
+                                     gains[0], gains[1], len);
+      return;
+   }
+
    for (int c = 0; c < numChannels; c++) {
       if (!channelFlags[c])
          continue;
@@ -362,20 +400,17 @@ void MixBuffers(int numChannels, int *channelFlags, float *gains,
          skip = 1;
       }
 
-      float gain = gains[c];
-      float *dest = (float *)destPtr;
-      float *temp = (float *)src;
-      for (int j = 0; j < len; j++) {
-         *dest += temp[j] * gain;   // the actual mixing process
-         dest += skip;
-      }
+      // the actual mixing process
+      SampleKernels::AddScaled((float *)destPtr, skip,
+                               (float *)src, gains[c], len);
    }
 }
 
-sampleCount Mixer::MixVariableRates(int *channelFlags, WaveTrack *track,
+sampleCount Mixer::MixVariableRates(WaveTrack *track,
                                     sampleCount *pos, float *queue,
                                     int *queueStart, int *queueLen,
-                                    Resample * pResample)
+                                    Resample * pResample,
+                                    float *floatBuffer, double *envValues)
 {
    double trackRate = track->GetRate();
    double initialWarp = mRate / trackRate;
@@ -425,14 +460,12 @@ sampleCount Mixer::MixVariableRates(int *channelFlags, WaveTrack *track,
                        *pos,
                        getLen);
 
-            track->GetEnvelopeValues(mEnvValues,
+            track->GetEnvelopeValues(envValues,
                                      getLen,
                                      (*pos) / trackRate,
                                      tstep);
 
-            for (int i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
-            }
+            SampleKernels::ApplyEnvelope(&queue[*queueLen], envValues, getLen);
 
             *queueLen += getLen;
             *pos += getLen;
@@ -462,7 +495,7 @@ sampleCount Mixer::MixVariableRates(int *channelFlags, WaveTrack *track,
                                       thisProcessLen,
                                       last,
                                       &input_used,
-                                      &mFloatBuffer[out],
+                                      &floatBuffer[out],
                                       mMaxOut - out);
 
       if (outgen < 0) {
@@ -479,31 +512,13 @@ sampleCount Mixer::MixVariableRates(int *channelFlags, WaveTrack *track,
       }
    }
 
-   for (int c = 0; c < mNumChannels; c++) {
-      if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
-      }
-      else {
-         mGains[c] = 1.0;
-      }
-   }
-
-   MixBuffers(mNumChannels,
-              channelFlags,
-              mGains,
-              (samplePtr)mFloatBuffer,
-              mTemp,
-              out,
-              mInterleaved);
-
    return out;
 }
 
-sampleCount Mixer::MixSameRate(int *channelFlags, WaveTrack *track,
-                               sampleCount *pos)
+sampleCount Mixer::MixSameRate(WaveTrack *track, sampleCount *pos,
+                               float *floatBuffer, double *envValues)
 {
    int slen = mMaxOut;
-   int c;
    double t = *pos / track->GetRate();
    double trackEndTime = track->GetEndTime();
    double tEnd = trackEndTime > mT1 ? mT1 : trackEndTime;
@@ -518,27 +533,198 @@ sampleCount Mixer::MixSameRate(int *channelFlags, WaveTrack *track,
    if (slen > mMaxOut)
       slen = mMaxOut;
 
-   track->Get((samplePtr)mFloatBuffer, floatSample, *pos, slen);
-   track->GetEnvelopeValues(mEnvValues, slen, t, 1.0 / mRate);
-   for(int i=0; i<slen; i++)
-      mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+   track->Get((samplePtr)floatBuffer, floatSample, *pos, slen);
+   track->GetEnvelopeValues(envValues, slen, t, 1.0 / mRate);
+   // Track gain control will go here?
+   SampleKernels::ApplyEnvelope(floatBuffer, envValues, slen);
+
+   *pos += slen;
+
+   return slen;
+}
+
+sampleCount Mixer::FetchTrack(int i, float *floatBuffer, double *envValues)
+{
+   WaveTrack *track = mInputTrack[i];
+
+   if (mTimeTrack || track->GetRate() != mRate)
+      return MixVariableRates(track,
+                              &mSamplePos[i], mSampleQueue[i],
+                              &mQueueStart[i], &mQueueLen[i], mResample[i],
+                              floatBuffer, envValues);
+   else
+      return MixSameRate(track, &mSamplePos[i], floatBuffer, envValues);
+}
+
+void Mixer::AddTrack(int i, float *floatBuffer, sampleCount len,
+                     int *channelFlags)
+{
+   WaveTrack *track = mInputTrack[i];
+   int j;
+
+   for(j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for( j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
 
-   for(c=0; c<mNumChannels; c++)
+   for(j=0; j<mNumChannels; j++)
       if (mApplyTrackGains)
-         mGains[c] = track->GetChannelGain(c);
+         mGains[j] = track->GetChannelGain(j);
       else
-         mGains[c] = 1.0;
+         mGains[j] = 1.0;
 
    MixBuffers(mNumChannels, channelFlags, mGains,
-              (samplePtr)mFloatBuffer, mTemp, slen, mInterleaved);
+              (samplePtr)floatBuffer, mTemp, len, mInterleaved);
+}
 
-   *pos += slen;
+/// The tracks of one call to Mixer::FetchTracks(), handed out one at a
+/// time to the calling thread and to as many MixerJobs as are free.
+/// The last of them to finish deletes it, since jobs may start only
+/// after the caller has moved on.  Jobs that start after Close() leave
+/// without touching the Mixer, which may be gone by then.
+class MixerBatch
+{
+ public:
+   MixerBatch(Mixer *mixer, int first, int count, int refs)
+   {
+      mMixer = mixer;
+      mFirst = first;
+      mCount = count;
+      mNext = 0;
+      mNextWorker = 0;
+      mWorking = 0;
+      mClosed = false;
+      mRemaining = count;
+      mRefs = refs;
+      mDoneCondition = new ODCondition(&mLock);
+   }
 
-   return slen;
+   ~MixerBatch()
+   {
+      delete mDoneCondition;
+   }
+
+   /// Fetches tracks until there are none left to start.  The calling
+   /// thread uses the Mixer's own envelope buffer, and each job one of
+   /// the Mixer's worker buffers.
+   void Work(bool caller)
+   {
+      mLock.Lock();
+      if (mClosed || mNext >= mCount) {
+         mLock.Unlock();
+         return;
+      }
+      mWorking++;
+      double *envValues =
+         caller ? mMixer->mEnvValues : mMixer->mWorkerEnvValues[mNextWorker++];
+      while (mNext < mCount) {
+         int i = mNext++;
+         mLock.Unlock();
+
+         mMixer->mTrackLen[i] =
+            mMixer->FetchTrack(mFirst + i, mMixer->mTrackBuffer[i], envValues);
+
+         mLock.Lock();
+         if (--mRemaining == 0)
+            mDoneCondition->Broadcast();
+      }
+      if (--mWorking == 0)
+         mDoneCondition->Broadcast();
+      mLock.Unlock();
+   }
+
+   /// Waits for every track to be fetched and for every job that started
+   /// to leave Work(), then stops jobs that have yet to start from
+   /// touching the Mixer.
+   void Close()
+   {
+      mLock.Lock();
+      while (mRemaining > 0 || mWorking > 0)
+         mDoneCondition->Wait();
+      mClosed = true;
+      mLock.Unlock();
+   }
+
+   void Release()
+   {
+      mLock.Lock();
+      bool last = (--mRefs == 0);
+      mLock.Unlock();
+      if (last)
+         delete this;
+   }
+
+ private:
+   Mixer *mMixer;
+   int mFirst;
+   int mCount;
+   int mNext;
+   int mNextWorker;
+   int mWorking;   // Threads now in Work() that use the Mixer
+   bool mClosed;
+   int mRemaining;
+   int mRefs;
+   ODLock mLock;
+   ODCondition *mDoneCondition;
+};
+
+class MixerJob : public ThreadPoolJob
+{
+ public:
+   MixerJob(MixerBatch *batch) { mBatch = batch; }
+
+   virtual void Run()
+   {
+      mBatch->Work(false);
+      mBatch->Release();
+   }
+
+ private:
+   MixerBatch *mBatch;
+};
+
+void Mixer::FetchTracks(int first, int count)
+{
+   int numJobs = std::min(mNumWorkers, count - 1);
+   MixerBatch *batch = new MixerBatch(this, first, count, numJobs + 1);
+
+   ThreadPool *pool = ThreadPool::Get();
+   for (int i = 0; i < numJobs; i++)
+      pool->Add(new MixerJob(batch));
+
+   // Rather than sit idle, fetch tracks here too; if the pool is busy
+   // with other work, this may end up fetching all of them
+   batch->Work(true);
+   batch->Close();
+   batch->Release();
 }
 
 sampleCount Mixer::Process(sampleCount maxToProcess)
 {
+   PROFILE_ZONE("Mixer::Process");
+
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
    // it here. It's also unnecessary I think.
    //if (mT >= mT1)
@@ -552,49 +738,39 @@ sampleCount Mixer::Process(sampleCount maxToProcess)
    mMaxOut = maxToProcess;
 
    Clear();
-   for(i=0; i<mNumInputTracks; i++) {
-      WaveTrack *track = mInputTrack[i];
-      for(j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
-
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for( j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
-      }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
+   if (mNumWorkers > 0 && ThreadPool::Get()) {
+      for(i=0; i<mNumInputTracks; i+=mGroupSize) {
+         int count = std::min(mGroupSize, mNumInputTracks - i);
+         FetchTracks(i, count);
+
+         for(j=0; j<count; j++) {
+            out = mTrackLen[j];
+            AddTrack(i + j, mTrackBuffer[j], out, channelFlags);
+
+            if (out > maxOut)
+               maxOut = out;
+
+            WaveTrack *track = mInputTrack[i + j];
+            double t = (double)mSamplePos[i + j] / (double)track->GetRate();
+            if(t > mTime)
+               mTime = std::min(t, mT1);
          }
       }
+   }
+   else {
+      for(i=0; i<mNumInputTracks; i++) {
+         WaveTrack *track = mInputTrack[i];
 
-      if (mTimeTrack || track->GetRate() != mRate)
-         out = MixVariableRates(channelFlags, track,
-                                &mSamplePos[i], mSampleQueue[i],
-                                &mQueueStart[i], &mQueueLen[i], mResample[i]);
-      else
-         out = MixSameRate(channelFlags, track, &mSamplePos[i]);
-
-      if (out > maxOut)
-         maxOut = out;
+         out = FetchTrack(i, mFloatBuffer, mEnvValues);
+         AddTrack(i, mFloatBuffer, out, channelFlags);
 
-      double t = (double)mSamplePos[i] / (double)track->GetRate();
-      if(t > mTime)
-         mTime = std::min(t, mT1);
+         if (out > maxOut)
+            maxOut = out;
 
+         double t = (double)mSamplePos[i] / (double)track->GetRate();
+         if(t > mTime)
+            mTime = std::min(t, mT1);
+      }
    }
    if(mInterleaved) {
       for(int c=0; c<mNumChannels; c++) {
@@ -20,6 +20,7 @@
 #include "Resample.h"
 
 class DirManager;
+class MixerBatch;
 
 /** @brief Mixes together all input tracks, applying any envelopes, amplitude
  * gain, panning, and real-time effects in the process.
@@ -117,13 +118,27 @@ class AUDACITY_DLL_API Mixer {
  private:
 
    void Clear();
-   sampleCount MixSameRate(int *channelFlags, WaveTrack *src,
-                           sampleCount *pos);
+   sampleCount MixSameRate(WaveTrack *src, sampleCount *pos,
+                           float *floatBuffer, double *envValues);
 
-   sampleCount MixVariableRates(int *channelFlags, WaveTrack *track,
+   sampleCount MixVariableRates(WaveTrack *track,
                                 sampleCount *pos, float *queue,
                                 int *queueStart, int *queueLen,
-                                Resample * pResample);
+                                Resample * pResample,
+                                float *floatBuffer, double *envValues);
+
+   /// Reads, applies the envelope to and resamples the next samples of
+   /// one input track into floatBuffer.  Touches nothing shared with
+   /// the other tracks, so tracks may be fetched on different threads.
+   sampleCount FetchTrack(int track, float *floatBuffer, double *envValues);
+   /// Adds fetched samples of one track into the output, with its gains.
+   void AddTrack(int track, float *floatBuffer, sampleCount len,
+                 int *channelFlags);
+
+   /// Fetches tracks [first, first + count) on the ThreadPool.
+   void FetchTracks(int first, int count);
+
+   friend class MixerBatch;
 
  private:
    // Input
@@ -145,6 +160,16 @@ class AUDACITY_DLL_API Mixer {
    int              mProcessLen;
    MixerSpec        *mMixerSpec;
 
+   // Parallel fetching, when there is a ThreadPool and more than one
+   // track.  The tracks are fetched a group at a time and then added
+   // into the output one after another, in the same order as when
+   // fetching serially, so the results are identical.
+   int              mNumWorkers;    // Pool threads helping, or 0
+   int              mGroupSize;     // Tracks fetched at once
+   float          **mTrackBuffer;   // mGroupSize fetched tracks
+   sampleCount     *mTrackLen;
+   double         **mWorkerEnvValues; // One per pool thread
+
    // Output
    int              mMaxOut;
    int              mNumChannels;
@@ -11,159 +11,240 @@
 ******************************************************************//**
 
 \class Profiler
-\brief A simple profiler to measure the average time lengths that a
-particular task/function takes.  Currently not thread-safe and not thread-smart,
-but it will probably work fine if you use it on a high level.
-
-\class TaskProfile
-\brief a simple class to keep track of one task that may be called multiple times.
+\brief Records when zones of code begin and end on each thread, and writes
+them as a Chrome trace.
 
 *//*******************************************************************/
 
+#include "Audacity.h"
 #include "Profiler.h"
+
 #include <stdio.h>
 #include <string.h>
 
-///write to a profile at the end of the test.
-Profiler::~Profiler()
-{
-   if(mTasks.size())
-   {
-      //print everything out.  append to a log.
-      FILE* log = fopen("AudacityProfilerLog.txt", "a");
-      time_t now;
-
-      time(&now);
-      fprintf(log,"Audacity Profiler Run, Ended at ");
-      fprintf(log,"%s",ctime(&now));
-      fprintf(log,"****************************************\n");
-      //print out the tasks
-      for(int i=0;i<(int)mTasks.size();i++)
-      {
-         if(mTasks[i]->mNumHits>0)
-         {
-            fprintf(log,"Task: %s\n(begins at line %d in %s)\n\n",mTasks[i]->mDescription,mTasks[i]->mLine,mTasks[i]->mFileName);
-            fprintf(log,"Number of times run: %d\n",mTasks[i]->mNumHits);
-            fprintf(log,"Total run time (seconds): %f\n", (double)mTasks[i]->mCumTime/CLOCKS_PER_SEC);
-            fprintf(log,"Average run time (seconds): %f\n",mTasks[i]->ComputeAverageRunTime());
-
-            if(i < ((int)mTasks.size()) -1)
-               fprintf(log,"----------------------------\n");
-         }
-      }
-      fprintf(log,"\n****************************************\n\n\n");
+#include <wx/ffile.h>
 
-      fclose(log);
+#if defined(__WXMSW__)
+#include <windows.h>
+#elif defined(__WXMAC__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
 
-      //delete everything.
-      for(int i=0;i<(int)mTasks.size();i++)
-         delete mTasks[i];
-   }
-}
+#include "ondemand/ODTaskThread.h"
+
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
 
-///start the task timer.
-void Profiler::Begin(char* fileName, int lineNum, char* taskDescription)
+// Zones kept for each thread; the oldest are overwritten
+#define kProfilerEvents 16384
+
+struct ProfilerEvent
 {
-   mTasksMutex.Lock();
-   GetOrCreateTaskProfile(fileName,lineNum)->Begin(fileName,lineNum,taskDescription);
-   mTasksMutex.Unlock();
-}
+   const char *name;
+   wxLongLong_t begin;
+   wxLongLong_t end;
+};
 
-///end the task timer.
-void Profiler::End(char* fileName, int lineNum, char* taskDescription)
+/// The zones one thread has recorded.  Only that thread writes them.
+struct ProfilerThread
 {
-   mTasksMutex.Lock();
-   TaskProfile* tp;
-   tp=GetTaskProfileByDescription(taskDescription);
-   if(tp)
-      tp->End(fileName,lineNum,taskDescription);
-   mTasksMutex.Unlock();
+   int id;
+   const char *name;
+   ProfilerEvent events[kProfilerEvents];
+   volatile int count;        // events written, modulo kProfilerEvents
+   int written;               // events written since Start(), up to the limit
+   ProfilerThread *next;
+};
+
+volatile int Profiler::sRecording = 0;
+
+// The threads are kept until Audacity quits, since each keeps a pointer to
+// its own, so none is freed while it might still write
+static ProfilerThread *sThreads = NULL;
+static int sNumThreads = 0;
+static ODLock sThreadsLock;
+static wxString sFileName;
+
+static PROFILER_THREAD_LOCAL ProfilerThread *sThisThread = NULL;
+// Kept apart, so that naming a thread when not recording does not
+// allocate its events
+static PROFILER_THREAD_LOCAL const char *sThisThreadName = NULL;
+
+// Gives the calling thread its events.  Zones never call this, so they
+// never allocate or lock; it is done when a thread starts the recording
+// or is named during it.
+static ProfilerThread *AddThisThread()
+{
+   if (!sThisThread) {
+      ProfilerThread *thread = new ProfilerThread;
+      thread->name = sThisThreadName;
+      thread->count = 0;
+      thread->written = 0;
+
+      sThreadsLock.Lock();
+      thread->id = ++sNumThreads;
+      thread->next = sThreads;
+      sThreads = thread;
+      sThreadsLock.Unlock();
+
+      sThisThread = thread;
+   }
+
+   return sThisThread;
 }
 
-///Gets the singleton instance
-Profiler* Profiler::Instance()
+// static
+void Profiler::Start(const wxString &fileName)
 {
-   static Profiler* pro=NULL;
-   //this isn't 100% threadsafe but I think Okay for this purpose.
+   if (IsRecording())
+      return;
 
-   if(!pro)
-      pro = new Profiler();
+   AddThisThread();
 
-   return pro;
+   sThreadsLock.Lock();
+   sFileName = fileName;
+   for (ProfilerThread *thread = sThreads; thread; thread = thread->next) {
+      thread->written = 0;
+   }
+   sThreadsLock.Unlock();
 
+   StoreRelease(&sRecording, 1);
 }
 
-///find a taskProfile for the given task, otherwise create
-TaskProfile* Profiler::GetOrCreateTaskProfile(char* fileName, int lineNum)
+// static
+void Profiler::SetThreadName(const char *name)
 {
-   for(int i=0;i<(int)mTasks.size();i++)
-   {
-      if(strcmp(fileName,mTasks[i]->mFileName)==0 && lineNum == mTasks[i]->mLine)
-         return mTasks[i];
-   }
-
-   TaskProfile* tp = new TaskProfile();
-   mTasks.push_back(tp);
-   return tp;
+   sThisThreadName = name;
+   if (sThisThread)
+      sThisThread->name = name;
+   else if (IsRecording())
+      AddThisThread();
 }
 
-TaskProfile* Profiler::GetTaskProfileByDescription(char* description)
+// static
+wxLongLong_t Profiler::Now()
 {
-   for(int i=0;i<(int)mTasks.size();i++)
-   {
-      if(strcmp(description,mTasks[i]->mDescription)==0)
-         return mTasks[i];
-   }
-
-   return NULL;
-
+#if defined(__WXMSW__)
+   static LARGE_INTEGER frequency;
+   if (frequency.QuadPart == 0)
+      QueryPerformanceFrequency(&frequency);
+   LARGE_INTEGER count;
+   QueryPerformanceCounter(&count);
+   return (wxLongLong_t)((double)count.QuadPart * 1000000.0 / frequency.QuadPart);
+#elif defined(__WXMAC__)
+   static mach_timebase_info_data_t timebase;
+   if (timebase.denom == 0)
+      mach_timebase_info(&timebase);
+   return (wxLongLong_t)(mach_absolute_time() * timebase.numer / timebase.denom / 1000);
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (wxLongLong_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
 }
 
-
-///Task Profile
-TaskProfile::TaskProfile()
+// static
+void Profiler::Record(const char *name, wxLongLong_t begin, wxLongLong_t end)
 {
-   mFileName = NULL;
-   mCumTime=0;
-   mNumHits=0;
+   // A thread given no events by Start() or SetThreadName() drops the zone
+   ProfilerThread *thread = sThisThread;
+   if (!thread)
+      return;
+
+   int count = thread->count;
+   ProfilerEvent &event = thread->events[count];
+   event.name = name;
+   event.begin = begin;
+   event.end = end;
+   StoreRelease(&thread->count, (count + 1) % kProfilerEvents);
+
+   if (thread->written < kProfilerEvents)
+      thread->written++;
 }
 
-TaskProfile::~TaskProfile()
+// Writes s as a JSON string
+static void WriteJSONString(wxFFile &f, const char *s)
 {
-   if(mFileName)
-   {
-      delete [] mFileName;
-      delete [] mDescription;
+   f.Write("\"", 1);
+   for (; *s; s++) {
+      if (*s == '"' || *s == '\\')
+         f.Write("\\", 1);
+      if ((unsigned char)*s >= ' ')
+         f.Write(s, 1);
    }
+   f.Write("\"", 1);
 }
 
-///start the task timer.
-void TaskProfile::Begin(char* fileName, int lineNum, char* taskDescription)
+// static
+bool Profiler::Stop()
 {
-   if(!mFileName)
-   {
-      mFileName = new char[strlen(fileName)+1];
-      strcpy(mFileName,fileName);
-      mDescription = new char[strlen(taskDescription)+1];
-      strcpy(mDescription,taskDescription);
-      mLine = lineNum;
+   if (!IsRecording())
+      return true;
+
+   StoreRelease(&sRecording, 0);
+
+   wxFFile f;
+   if (!f.Open(sFileName, wxT("w")))
+      return false;
+
+   // Times are written relative to the earliest event
+   wxLongLong_t origin = 0;
+   bool first = true;
+
+   sThreadsLock.Lock();
+
+   ProfilerThread *thread;
+   for (thread = sThreads; thread; thread = thread->next) {
+      int count = LoadAcquire(&thread->count);
+      for (int i = 0; i < thread->written; i++) {
+         int index = (count - 1 - i + kProfilerEvents) % kProfilerEvents;
+         if (first || thread->events[index].begin < origin)
+            origin = thread->events[index].begin;
+         first = false;
+      }
    }
 
-   mLastTime = clock();
+   f.Write(wxT("{\"traceEvents\":[\n"));
+
+   bool comma = false;
+   char buffer[200];
+   for (thread = sThreads; thread; thread = thread->next) {
+      if (thread->name) {
+         sprintf(buffer, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                 comma ? ",\n" : "", thread->id);
+         f.Write(buffer, strlen(buffer));
+         WriteJSONString(f, thread->name);
+         f.Write("}}", 2);
+         comma = true;
+      }
 
-}
+      // Oldest first
+      int count = LoadAcquire(&thread->count);
+      for (int i = thread->written - 1; i >= 0; i--) {
+         ProfilerEvent &event =
+            thread->events[(count - 1 - i + kProfilerEvents) % kProfilerEvents];
+
+         if (comma)
+            f.Write(",\n", 2);
+         f.Write("{\"name\":", 8);
+         WriteJSONString(f, event.name);
+         sprintf(buffer, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.0f,\"dur\":%.0f}",
+                 thread->id,
+                 (double)(event.begin - origin),
+                 (double)(event.end - event.begin));
+         f.Write(buffer, strlen(buffer));
+         comma = true;
+      }
+   }
 
-///end the task timer.
-void TaskProfile::End(char* WXUNUSED(fileName), int WXUNUSED(lineNum), char* WXUNUSED(taskDescription))
-{
-   mCumTime += clock() - mLastTime;
-   mNumHits++;
-}
+   sThreadsLock.Unlock();
 
-double TaskProfile::ComputeAverageRunTime()
-{
-   if(mNumHits)
-      return (double) ((double)mCumTime/CLOCKS_PER_SEC)/mNumHits;
-   else
-      return 0.0;
+   f.Write(wxT("\n],\"displayTimeUnit\":\"ms\"}\n"));
+
+   return f.Close();
 }
@@ -11,81 +11,89 @@
 ******************************************************************//**
 
 \class Profiler
-\brief A simple profiler to measure the average time lengths that a
-particular task/function takes.  Currently not thread-safe and not thread-smart,
-but it will probably work fine if you use it on a high level.
+\brief Records when zones of code begin and end on each thread, and writes
+them as a Chrome trace (chrome://tracing, or ui.perfetto.dev).
 
-\class TaskProfile
-\brief a simple class to keep track of one task that may be called multiple times.
-
-*//*******************************************************************/
+  Mark a zone by putting PROFILE_ZONE("name") at the top of a block; the
+  zone lasts until the block ends.  Zones nest, so a trace shows which
+  callers a slow call was made for.  The name must be a string literal.
 
+  When not recording, a zone costs one load and a branch.  When recording,
+  each thread writes into a ring buffer of its own without locking, which
+  keeps the most recent events, so the audio thread can be traced too.
+  The buffer is allocated when a thread starts the recording or is named
+  during it; zones on any other thread are not recorded.
 
+  Start recording with "audacity --trace trace.json"; the trace is written
+  when Audacity quits.
 
+\class ProfilerZone
+\brief Records one zone for the Profiler, from its construction to its
+destruction.
 
+*//*******************************************************************/
 
 #ifndef __AUDACITY_PROFILER__
 #define __AUDACITY_PROFILER__
-#include <vector>
-#include <time.h>
-#include "ondemand/ODTaskThread.h"
 
+#include <wx/defs.h>
+#include <wx/string.h>
+
+#include "LockFree.h"
 
-#define BEGIN_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->Begin(__FILE__,__LINE__,TASK_DESCRIPTION)
-#define END_TASK_PROFILING(TASK_DESCRIPTION) Profiler::Instance()->End(__FILE__,__LINE__,TASK_DESCRIPTION)
+#define PROFILER_CONCAT2(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
+
+/// Records the rest of the enclosing block as a zone called NAME
+#define PROFILE_ZONE(NAME) \
+   ProfilerZone PROFILER_CONCAT(profilerZone, __LINE__)(NAME)
 
-class TaskProfile;
 class Profiler
 {
  public:
+   /// Starts recording, throwing away anything recorded before
+   static void Start(const wxString &fileName);
+   /// Stops recording and writes the trace to the file given to Start().
+   /// Returns false if it could not be written.
+   static bool Stop();
 
-   ///write to a profile at the end of the test.
-   virtual ~Profiler();
-
-   ///start the task timer.
-   void Begin(char* fileName, int lineNum, char* taskDescription);
-   ///end the task timer.
-   void End(char* fileName, int lineNum, char* taskDescription);
+   static bool IsRecording() { return LoadAcquire(&sRecording) != 0; }
 
-   ///Gets the singleton instance
-   static Profiler* Instance();
+   /// Names the calling thread in the trace, and when recording, allocates
+   /// the buffer its zones are recorded in.  name must be a literal.
+   static void SetThreadName(const char *name);
 
-  protected:
-   ///private constructor - Singleton.
-   Profiler(){};
+   /// Microseconds from a steady clock
+   static wxLongLong_t Now();
 
-   ///find a taskProfile for the given task, otherwise create
-   TaskProfile* GetOrCreateTaskProfile(char* fileName, int lineNum);
-   TaskProfile* GetTaskProfileByDescription(char* description);
-
-   //List of current Task to do.
-   std::vector<TaskProfile*> mTasks;
-   //mutex for above variable
-   ODLock mTasksMutex;
+   /// Records a zone on the calling thread
+   static void Record(const char *name, wxLongLong_t begin, wxLongLong_t end);
 
+ private:
+   static volatile int sRecording;
 };
 
- class TaskProfile
+class ProfilerZone
+{
+ public:
+   ProfilerZone(const char *name)
    {
-   public:
-      TaskProfile();
-      virtual ~TaskProfile();
-
-      ///start the task timer.
-      void Begin(char* fileName, int lineNum, char* taskDescription);
-      ///end the task timer.
-      void End(char* fileName, int lineNum, char* taskDescription);
-
-      double ComputeAverageRunTime();
-
-      char* mFileName;
-      int mLine;
-      char* mDescription;
-      int mNumHits;
-      clock_t mCumTime;
-      clock_t mLastTime;
-   };
+      mName = name;
+      mRecording = Profiler::IsRecording();
+      if (mRecording)
+         mBegin = Profiler::Now();
+   }
 
+   ~ProfilerZone()
+   {
+      if (mRecording)
+         Profiler::Record(mName, mBegin, Profiler::Now());
+   }
+
+ private:
+   const char *mName;
+   bool mRecording;
+   wxLongLong_t mBegin;
+};
 
 #endif
-
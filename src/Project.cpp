@@ -122,6 +122,7 @@ scroll information.  It also has some status flags.
 #include "widgets/Meter.h"
 #include "widgets/Ruler.h"
 #include "widgets/Warning.h"
+#include "xml/XMLBinaryFile.h"
 #include "xml/XMLFileReader.h"
 #include "PlatformCompatibility.h"
 #include "Experimental.h"
@@ -2493,6 +2494,7 @@ void AudacityProject::OpenFile(wxString fileName, bool addtohistory)
    delete ff;
 
    wxString temp = LAT1CTOWX(buf);
+   bool binary = XMLBinaryFileReader::IsBinaryFile(buf, numRead);
 
    if (temp == wxT("AudacityProject")) {
       // It's an Audacity 1.0 (or earlier) project file.
@@ -2513,7 +2515,7 @@ void AudacityProject::OpenFile(wxString fileName, bool addtohistory)
    }
 
    //FIXME: //v Surely we could be smarter about this, like checking much earlier that this is a .aup file.
-   if (temp.Mid(0, 6) != wxT("<?xml ")) {
+   if (!binary && temp.Mid(0, 6) != wxT("<?xml ")) {
       // If it's not XML, try opening it as any other form of audio
       Import(fileName);
       return;
@@ -2566,9 +2568,19 @@ void AudacityProject::OpenFile(wxString fileName, bool addtohistory)
       }
    }
 
-   XMLFileReader xmlFile;
+   bool bParseSuccess;
+   wxString parseError;
+   if (binary) {
+      XMLBinaryFileReader binaryFile;
+      bParseSuccess = binaryFile.Parse(this, fileName);
+      parseError = binaryFile.GetErrorStr();
+   }
+   else {
+      XMLFileReader xmlFile;
+      bParseSuccess = xmlFile.Parse(this, fileName);
+      parseError = xmlFile.GetErrorStr();
+   }
 
-   bool bParseSuccess = xmlFile.Parse(this, fileName);
    if (bParseSuccess) {
       // By making a duplicate set of pointers to the existing blocks
       // on disk, we add one to their reference count, guaranteeing
@@ -2720,8 +2732,8 @@ void AudacityProject::OpenFile(wxString fileName, bool addtohistory)
       mFileName = wxT("");
       SetProjectTitle();
 
-      wxLogError(wxT("Could not parse file \"%s\". \nError: %s"), fileName.c_str(), xmlFile.GetErrorStr().c_str());
-      wxMessageBox(xmlFile.GetErrorStr(),
+      wxLogError(wxT("Could not parse file \"%s\". \nError: %s"), fileName.c_str(), parseError.c_str());
+      wxMessageBox(parseError,
                    _("Error Opening Project"),
                    wxOK | wxCENTRE, this);
    }
@@ -3320,8 +3332,19 @@ bool AudacityProject::Save(bool overwrite /* = true */ ,
       }
    }
 
-   // Write the AUP file.
-   XMLFileWriter saveFile;
+   // Packed blocks are copied out of mostly unused segment files, which
+   // are removed once the new AUP file no longer refers to them
+   if (!bWantSaveCompressed)
+      mDirManager->CompactPackedBlocks();
+
+   // Write the AUP file.  Compressed projects are meant to be opened by
+   // any version of Audacity, so they are always XML.
+   bool binary = false;
+   gPrefs->Read(wxT("/FileFormats/SaveProjectBinary"), &binary, false);
+   XMLFileWriter xmlSaveFile;
+   XMLBinaryFileWriter binarySaveFile;
+   XMLFileWriter &saveFile =
+      (binary && !bWantSaveCompressed) ? binarySaveFile : xmlSaveFile;
 
    try
    {
@@ -3367,6 +3390,8 @@ bool AudacityProject::Save(bool overwrite /* = true */ ,
       // Now that we have saved the file, we can delete the auto-saved version
       DeleteCurrentAutoSaveFile();
 
+      mDirManager->RemoveRetiredSegments();
+
       if (mIsRecovered)
       {
          // This was a recovered file, that is, we have just overwritten the
@@ -3553,10 +3578,9 @@ void AudacityProject::AddImportedTracks(wxString fileName,
       if (newTracks[i]->GetKind() == WaveTrack::Wave)
       {
          WaveClip* clip = ((WaveTrack*)newTracks[i])->GetClipByIndex(0);
-         if (clip && clip->GetSequence()->GetBlockArray()->GetCount())
+         if (clip && clip->GetSequenceBlockArray()->GetCount())
          {
-            SeqBlock* block = clip->GetSequence()->GetBlockArray()->Item(0);
-            if (block->f->IsAlias())
+            if (clip->GetSequenceBlockArray()->Item(0).f->IsAlias())
             {
                mImportedDependencies = true;
             }
@@ -4201,12 +4225,49 @@ void AudacityProject::SetStop(bool bStopped)
    mTrackPanel->SetStop(bStopped);
 }
 
+// Tells the ODManager which of our tracks are needed first: those that are
+// playing, near the playhead, then those on screen, in the visible time range.
+void AudacityProject::UpdateODPriorities()
+{
+   bool playing = GetAudioIOToken() > 0 &&
+                  gAudioIO->IsStreamActive(GetAudioIOToken());
+   double playPos = playing ? gAudioIO->GetStreamTime() : 0.0;
+   // The OD tasks should stay this far ahead of the playhead
+   const double playAhead = 10.0;
+
+   int width, height;
+   mTrackPanel->GetTracksUsableArea(&width, &height);
+   double h1 = mViewInfo.h + mViewInfo.screen;
+
+   ODManager *manager = ODManager::Instance();
+   TrackListIterator iter(mTracks);
+   for (Track *t = iter.First(); t; t = iter.Next()) {
+      if (t->GetKind() != Track::Wave)
+         continue;
+      WaveTrack *wt = (WaveTrack *)t;
+
+      if (playing)
+         manager->SetTrackPriority(wt, ODTask::ePriorityPlayback,
+                                   playPos, playPos + playAhead);
+      else if (t->GetY() + t->GetHeight() > mViewInfo.vpos &&
+               t->GetY() < mViewInfo.vpos + height)
+         manager->SetTrackPriority(wt, ODTask::ePriorityVisible,
+                                   mViewInfo.h, h1);
+      else
+         manager->SetTrackPriority(wt, ODTask::ePriorityBackground, 0.0, 0.0);
+   }
+}
+
 void AudacityProject::OnTimer(wxTimerEvent& WXUNUSED(event))
 {
    MixerToolBar *mixerToolBar = GetMixerToolBar();
    if( mixerToolBar )
       mixerToolBar->UpdateControls();
 
+   if (ODManager::IsInstanceCreated() &&
+       ODManager::Instance()->GetTotalNumTasks())
+      UpdateODPriorities();
+
    if (::wxGetUTCTime() - mLastStatusUpdateTime < 3)
       return;
 
@@ -455,6 +455,7 @@ class AUDACITY_DLL_API AudacityProject:  public wxFrame,
 
    void UpdateLyrics();
    void UpdateMixerBoard();
+   void UpdateODPriorities();
 
    void GetRegionsByLabel( Regions &regions );
 
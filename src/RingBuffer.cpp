@@ -16,21 +16,34 @@
   need to read, or both need to write, they need to lock this
   class from outside using their own mutex.
 
+  Samples are stored as frames with all channels interleaved, so
+  that one Commit() or Discard() covers every channel and the
+  channels can never get out of step.  The writer may fill frames
+  in place with Reserve() and publish them with Commit(); the
+  positions are published with release ordering and read with
+  acquire ordering, so no locks are needed.
+
   AvailForPut and AvailForGet may underestimate but will never
   overestimate.
 
 *//*******************************************************************/
 
+#include "Audacity.h"
+
+#include <string.h>
 
+#include "LockFree.h"
 #include "RingBuffer.h"
 
-RingBuffer::RingBuffer(sampleFormat format, int size)
+RingBuffer::RingBuffer(sampleFormat format, int size, int channels)
 {
    mFormat = format;
+   mChannels = channels;
    mBufferSize = (size > 64? size: 64);
+   mFrameSize = SAMPLE_SIZE(mFormat) * mChannels;
    mStart = 0;
    mEnd = 0;
-   mBuffer = NewSamples(mBufferSize, mFormat);
+   mBuffer = NewSamples(mBufferSize * mChannels, mFormat);
 }
 
 RingBuffer::~RingBuffer()
@@ -38,9 +51,33 @@ RingBuffer::~RingBuffer()
    DeleteSamples(mBuffer);
 }
 
-int RingBuffer::Len()
+int RingBuffer::Filled(int start, int end)
+{
+   return (end + mBufferSize - start) % mBufferSize;
+}
+
+void RingBuffer::CopyChannel(bool toBuffer, int channel, int pos,
+                             samplePtr buffer, sampleFormat format,
+                             int frames)
 {
-   return (mEnd + mBufferSize - mStart) % mBufferSize;
+   while (frames > 0) {
+      int block = frames;
+      if (block > mBufferSize - pos)
+         block = mBufferSize - pos;
+
+      samplePtr ring = mBuffer + pos * mFrameSize +
+                       channel * SAMPLE_SIZE(mFormat);
+      if (toBuffer)
+         CopySamples(ring, mFormat, buffer, format, block,
+                     true, mChannels, 1);
+      else
+         CopySamples(buffer, format, ring, mFormat, block,
+                     true, 1, mChannels);
+
+      buffer += block * SAMPLE_SIZE(format);
+      pos = (pos + block) % mBufferSize;
+      frames -= block;
+   }
 }
 
 //
@@ -49,43 +86,67 @@ int RingBuffer::Len()
 
 int RingBuffer::AvailForPut()
 {
-   return (mBufferSize-4) - Len();
+   // Keep one frame free so that a full buffer isn't mistaken for
+   // an empty one
+   return (mBufferSize - 1) - Filled(LoadAcquire(&mStart), mEnd);
 }
 
-int RingBuffer::Put(samplePtr buffer, sampleFormat format,
-                    int samplesToCopy)
+int RingBuffer::Reserve(int frames, samplePtr *first, int *firstFrames,
+                        samplePtr *second)
 {
-   samplePtr src;
-   int block;
-   int copied;
-   int pos;
-   int len = Len();
+   int avail = AvailForPut();
+   if (frames > avail)
+      frames = avail;
 
-   if (samplesToCopy > (mBufferSize-4) - len)
-      samplesToCopy = (mBufferSize-4) - len;
+   int end = mEnd;
+   int block = frames;
+   if (block > mBufferSize - end)
+      block = mBufferSize - end;
 
-   src = buffer;
-   copied = 0;
-   pos = mEnd;
+   *first = mBuffer + end * mFrameSize;
+   *firstFrames = block;
+   *second = mBuffer;
 
-   while(samplesToCopy) {
-      block = samplesToCopy;
-      if (block > mBufferSize - pos)
-         block = mBufferSize - pos;
+   return frames;
+}
 
-      CopySamples(src, format,
-                  mBuffer + pos * SAMPLE_SIZE(mFormat), mFormat,
-                  block);
+int RingBuffer::WriteChannel(int channel, int offset,
+                             samplePtr buffer, sampleFormat format,
+                             int frames)
+{
+   int avail = AvailForPut() - offset;
+   if (frames > avail)
+      frames = avail;
+   if (frames <= 0)
+      return 0;
 
-      src += block * SAMPLE_SIZE(format);
-      pos = (pos + block) % mBufferSize;
-      samplesToCopy -= block;
-      copied += block;
-   }
+   CopyChannel(false, channel, (mEnd + offset) % mBufferSize,
+               buffer, format, frames);
 
-   mEnd = pos;
+   return frames;
+}
 
-   return copied;
+void RingBuffer::Commit(int frames)
+{
+   StoreRelease(&mEnd, (mEnd + frames) % mBufferSize);
+}
+
+int RingBuffer::Put(samplePtr buffer, sampleFormat format, int frames)
+{
+   samplePtr first, second;
+   int firstFrames;
+
+   frames = Reserve(frames, &first, &firstFrames, &second);
+
+   CopySamples(buffer, format, first, mFormat, firstFrames * mChannels);
+   if (frames > firstFrames)
+      CopySamples(buffer + firstFrames * mChannels * SAMPLE_SIZE(format),
+                  format, second, mFormat,
+                  (frames - firstFrames) * mChannels);
+
+   Commit(frames);
+
+   return frames;
 }
 
 //
@@ -94,49 +155,56 @@ int RingBuffer::Put(samplePtr buffer, sampleFormat format,
 
 int RingBuffer::AvailForGet()
 {
-   return Len();
+   return Filled(mStart, LoadAcquire(&mEnd));
 }
 
-int RingBuffer::Get(samplePtr buffer, sampleFormat format,
-                    int samplesToCopy)
+int RingBuffer::ReadChannel(int channel, int offset,
+                            samplePtr buffer, sampleFormat format,
+                            int frames)
 {
-   samplePtr dest;
-   int block;
-   int copied;
-   int len = Len();
-
-   if (samplesToCopy > len)
-      samplesToCopy = len;
-
-   dest = buffer;
-   copied = 0;
-
-   while(samplesToCopy) {
-      block = samplesToCopy;
-      if (block > mBufferSize - mStart)
-         block = mBufferSize - mStart;
-
-      CopySamples(mBuffer + mStart * SAMPLE_SIZE(mFormat), mFormat,
-                  dest, format,
-                  block);
-
-      dest += block * SAMPLE_SIZE(format);
-      mStart = (mStart + block) % mBufferSize;
-      samplesToCopy -= block;
-      copied += block;
-   }
+   int avail = AvailForGet() - offset;
+   if (frames > avail)
+      frames = avail;
+   if (frames <= 0)
+      return 0;
 
-   return copied;
+   CopyChannel(true, channel, (mStart + offset) % mBufferSize,
+               buffer, format, frames);
+
+   return frames;
+}
+
+int RingBuffer::Discard(int frames)
+{
+   int avail = AvailForGet();
+
+   if (frames > avail)
+      frames = avail;
+
+   StoreRelease(&mStart, (mStart + frames) % mBufferSize);
+
+   return frames;
 }
 
-int RingBuffer::Discard(int samplesToDiscard)
+int RingBuffer::Get(samplePtr buffer, sampleFormat format, int frames)
 {
-   int len = Len();
+   int avail = AvailForGet();
+   if (frames > avail)
+      frames = avail;
+
+   int start = mStart;
+   int block = frames;
+   if (block > mBufferSize - start)
+      block = mBufferSize - start;
 
-   if (samplesToDiscard > len)
-      samplesToDiscard = len;
+   CopySamples(mBuffer + start * mFrameSize, mFormat,
+               buffer, format, block * mChannels);
+   if (frames > block)
+      CopySamples(mBuffer, mFormat,
+                  buffer + block * mChannels * SAMPLE_SIZE(format), format,
+                  (frames - block) * mChannels);
 
-   mStart = (mStart + samplesToDiscard) % mBufferSize;
+   StoreRelease(&mStart, (start + frames) % mBufferSize);
 
-   return samplesToDiscard;
+   return frames;
 }
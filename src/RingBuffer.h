@@ -15,32 +15,72 @@
 
 class RingBuffer {
  public:
-   RingBuffer(sampleFormat format, int size);
+   RingBuffer(sampleFormat format, int size, int channels = 1);
    ~RingBuffer();
 
+   sampleFormat GetFormat() const { return mFormat; }
+   int GetChannels() const { return mChannels; }
+
    //
    // For the writer only:
    //
 
    int AvailForPut();
-   int Put(samplePtr buffer, sampleFormat format, int samples);
+
+   // Gives direct access to up to frames free frames, in the buffer's
+   // own format with channels interleaved.  They come in at most two
+   // runs because of wrap-around: *firstFrames frames at *first, then
+   // the rest at *second.  Returns the number of frames available,
+   // which become visible to the reader only when committed.
+   int Reserve(int frames, samplePtr *first, int *firstFrames,
+               samplePtr *second);
+   // Converts frames samples of one channel into the free space,
+   // starting offset frames past the last committed frame.
+   int WriteChannel(int channel, int offset,
+                    samplePtr buffer, sampleFormat format, int frames);
+   // Makes the next frames frames, of every channel, visible to the
+   // reader at once.
+   void Commit(int frames);
+
+   // Converts and commits interleaved frames of every channel.
+   int Put(samplePtr buffer, sampleFormat format, int frames);
 
    //
    // For the reader only:
    //
 
    int AvailForGet();
-   int Get(samplePtr buffer, sampleFormat format, int samples);
-   int Discard(int samples);
+
+   // Converts frames samples of one channel, starting offset frames
+   // into what is available, without consuming them.
+   int ReadChannel(int channel, int offset,
+                   samplePtr buffer, sampleFormat format, int frames);
+   // Consumes frames frames of every channel.
+   int Discard(int frames);
+
+   // Converts and consumes interleaved frames of every channel.
+   int Get(samplePtr buffer, sampleFormat format, int frames);
 
  private:
-   int Len();
+   enum { kCacheLineSize = 64 };
+
+   int Filled(int start, int end);
+   void CopyChannel(bool toBuffer, int channel, int pos,
+                    samplePtr buffer, sampleFormat format, int frames);
 
    sampleFormat  mFormat;
-   int           mStart;
-   int           mEnd;
+   int           mChannels;
    int           mBufferSize;
+   int           mFrameSize;
    samplePtr     mBuffer;
+
+   // The reader and writer each update one position, and each position
+   // has a cache line to itself so that they don't slow each other down
+   char          mPad0[kCacheLineSize];
+   volatile int  mStart;
+   char          mPad1[kCacheLineSize - sizeof(int)];
+   volatile int  mEnd;
+   char          mPad2[kCacheLineSize - sizeof(int)];
 };
 
 #endif /*  __AUDACITY_RING_BUFFER__ */
@@ -0,0 +1,598 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleKernels.cpp
+
+*******************************************************************//**
+
+\file SampleKernels.cpp
+\brief Implements class SampleKernels.
+
+  The scalar loops for mixing and conversion are the ones Mix.cpp and
+  Dither.cpp used before; the vector versions of every loop must keep
+  giving the same bits as the scalar ones.  That holds
+  where the compiler does float arithmetic in SSE registers, as it
+  does on x64, rather than in the x87's wider ones.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+// Erik de Castro Lopo's header file that
+// makes sure that we have lrint and lrintf
+#include "float_cast.h"
+
+#include "SampleKernels.h"
+
+// The vector kernels need intrinsics for instruction sets beyond what
+// the rest of the program is compiled for, enabled per function
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+
+#define SAMPLE_KERNELS_X86
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+static void CPUID(int info[4], int function)
+{
+   __cpuid_count(function, 0, info[0], info[1], info[2], info[3]);
+}
+
+static unsigned int XGETBV()
+{
+   unsigned int eax, edx;
+   __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+   return eax;
+}
+
+#elif defined(_MSC_VER) && (_MSC_VER >= 1700) && \
+      (defined(_M_IX86) || defined(_M_X64))
+
+#define SAMPLE_KERNELS_X86
+#define TARGET_SSE2
+#define TARGET_AVX2
+
+#include <intrin.h>
+#include <immintrin.h>
+
+static void CPUID(int info[4], int function)
+{
+   __cpuidex(info, function, 0);
+}
+
+static unsigned int XGETBV()
+{
+   return (unsigned int)_xgetbv(0);
+}
+
+#endif
+
+static SampleKernels::Level DetectLevel()
+{
+#if defined(SAMPLE_KERNELS_X86)
+   int info[4];
+   CPUID(info, 0);
+   int nIds = info[0];
+
+   if (nIds < 1)
+      return SampleKernels::Scalar;
+
+   CPUID(info, 0x00000001);
+   bool sse2    = (info[3] & ((int)1 << 26)) != 0;
+   bool osxsave = (info[2] & ((int)1 << 27)) != 0;
+   bool avx     = (info[2] & ((int)1 << 28)) != 0;
+
+   if (!sse2)
+      return SampleKernels::Scalar;
+
+   // AVX2 needs the operating system to save the YMM registers too
+   if (nIds >= 7 && osxsave && avx && (XGETBV() & 6) == 6) {
+      CPUID(info, 0x00000007);
+      if (info[1] & ((int)1 << 5))
+         return SampleKernels::AVX2;
+   }
+
+   return SampleKernels::SSE2;
+#else
+   return SampleKernels::Scalar;
+#endif
+}
+
+static SampleKernels::Level sSupportedLevel = DetectLevel();
+static SampleKernels::Level sLevel = sSupportedLevel;
+
+// static
+SampleKernels::Level SampleKernels::GetSupportedLevel()
+{
+   return sSupportedLevel;
+}
+
+// static
+SampleKernels::Level SampleKernels::GetLevel()
+{
+   return sLevel;
+}
+
+// static
+void SampleKernels::SetLevel(Level level)
+{
+   sLevel = (level < sSupportedLevel ? level : sSupportedLevel);
+}
+
+//
+// Scalar
+//
+
+static void AddScaledScalar(float *dest, int destStride,
+                            const float *src, float gain, int len)
+{
+   for (int i = 0; i < len; i++) {
+      *dest += src[i] * gain;
+      dest += destStride;
+   }
+}
+
+static void AddScaledStereoScalar(float *dest, const float *src,
+                                  float leftGain, float rightGain, int len)
+{
+   for (int i = 0; i < len; i++) {
+      dest[2 * i] += src[i] * leftGain;
+      dest[2 * i + 1] += src[i] * rightGain;
+   }
+}
+
+static void ApplyEnvelopeScalar(float *buffer, const double *env, int len)
+{
+   for (int i = 0; i < len; i++)
+      buffer[i] *= env[i];
+}
+
+static void Int16ToFloatScalar(const short *src, float *dest, int len)
+{
+   for (int i = 0; i < len; i++)
+      dest[i] = src[i] / float(1 << 15);
+}
+
+static void Int24ToFloatScalar(const int *src, float *dest, int len)
+{
+   for (int i = 0; i < len; i++)
+      dest[i] = src[i] / float(1 << 23);
+}
+
+static void FloatToInt16Scalar(const float *src, short *dest, int len)
+{
+   for (int i = 0; i < len; i++) {
+      float sample = src[i] > 1.0 ? 1.0 : src[i] < -1.0 ? -1.0 : src[i];
+      int x = lrintf(sample * float(1 << 15));
+      dest[i] = (short)(x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+   }
+}
+
+static void FloatToInt24Scalar(const float *src, int *dest, int len)
+{
+   for (int i = 0; i < len; i++) {
+      float sample = src[i] > 1.0 ? 1.0 : src[i] < -1.0 ? -1.0 : src[i];
+      int x = lrintf(sample * float(1 << 23));
+      dest[i] = (x > 8388607 ? 8388607 : x < -8388608 ? -8388608 : x);
+   }
+}
+
+static void FillRampScalar(double *buffer, int start, int len,
+                           double first, double step)
+{
+   for (int i = start; i < len; i++)
+      buffer[i] = first + i * step;
+}
+
+// products holds the next value of each of the four running products
+static void FillGeometricScalar(double *buffer, int start, int len,
+                                double products[4], double ratio4)
+{
+   for (int i = start; i < len; i++) {
+      buffer[i] = products[i & 3];
+      products[i & 3] *= ratio4;
+   }
+}
+
+#if defined(SAMPLE_KERNELS_X86)
+
+//
+// SSE2
+//
+// Each function does as many samples as fill whole vectors and
+// returns how many, leaving the rest to the scalar version.
+//
+// The clipping relies on maxps returning its second operand when the
+// first is NaN, so that NaN becomes -1.0 here, just as lrintf()
+// turning it into the most negative int does in the scalar versions.
+//
+
+TARGET_SSE2
+static int AddScaledSSE2(float *dest, const float *src, float gain, int len)
+{
+   __m128 g = _mm_set1_ps(gain);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      __m128 product = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+      _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), product));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int AddScaledStereoSSE2(float *dest, const float *src,
+                               float leftGain, float rightGain, int len)
+{
+   __m128 g = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      __m128 s = _mm_loadu_ps(src + i);
+      __m128 lo = _mm_mul_ps(_mm_unpacklo_ps(s, s), g);
+      __m128 hi = _mm_mul_ps(_mm_unpackhi_ps(s, s), g);
+      float *d = dest + 2 * i;
+      _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), lo));
+      _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), hi));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int ApplyEnvelopeSSE2(float *buffer, const double *env, int len)
+{
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      __m128 b = _mm_loadu_ps(buffer + i);
+      __m128d lo = _mm_mul_pd(_mm_cvtps_pd(b), _mm_loadu_pd(env + i));
+      __m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(b, b)),
+                              _mm_loadu_pd(env + i + 2));
+      _mm_storeu_ps(buffer + i,
+                    _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int Int16ToFloatSSE2(const short *src, float *dest, int len)
+{
+   __m128 scale = _mm_set1_ps(1.0f / float(1 << 15));
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+      // Sign-extend by putting each sample in the upper half
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+      _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int Int24ToFloatSSE2(const int *src, float *dest, int len)
+{
+   __m128 scale = _mm_set1_ps(1.0f / float(1 << 23));
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+      _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int FloatToInt16SSE2(const float *src, short *dest, int len)
+{
+   __m128 minusOne = _mm_set1_ps(-1.0f);
+   __m128 one = _mm_set1_ps(1.0f);
+   __m128 scale = _mm_set1_ps(float(1 << 15));
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), minusOne), one);
+      __m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), minusOne), one);
+      // Rounds to nearest; packing saturates 32768 to 32767
+      __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(lo, scale)),
+                                       _mm_cvtps_epi32(_mm_mul_ps(hi, scale)));
+      _mm_storeu_si128((__m128i *)(dest + i), packed);
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int FloatToInt24SSE2(const float *src, int *dest, int len)
+{
+   __m128 minusOne = _mm_set1_ps(-1.0f);
+   __m128 one = _mm_set1_ps(1.0f);
+   __m128 scale = _mm_set1_ps(float(1 << 23));
+   __m128 max = _mm_set1_ps(8388607.0f);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      __m128 s = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), minusOne), one);
+      // Anything that would round above the largest value clips to it
+      s = _mm_min_ps(_mm_mul_ps(s, scale), max);
+      _mm_storeu_si128((__m128i *)(dest + i), _mm_cvtps_epi32(s));
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int FillRampSSE2(double *buffer, int len, double first, double step)
+{
+   __m128d f = _mm_set1_pd(first);
+   __m128d s = _mm_set1_pd(step);
+   __m128d index = _mm_setr_pd(0.0, 1.0);
+   __m128d two = _mm_set1_pd(2.0);
+   int i;
+   for (i = 0; i + 2 <= len; i += 2) {
+      _mm_storeu_pd(buffer + i, _mm_add_pd(f, _mm_mul_pd(index, s)));
+      index = _mm_add_pd(index, two);
+   }
+   return i;
+}
+
+TARGET_SSE2
+static int FillGeometricSSE2(double *buffer, int len,
+                             double products[4], double ratio4)
+{
+   __m128d lo = _mm_loadu_pd(products);
+   __m128d hi = _mm_loadu_pd(products + 2);
+   __m128d r = _mm_set1_pd(ratio4);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      _mm_storeu_pd(buffer + i, lo);
+      _mm_storeu_pd(buffer + i + 2, hi);
+      lo = _mm_mul_pd(lo, r);
+      hi = _mm_mul_pd(hi, r);
+   }
+   _mm_storeu_pd(products, lo);
+   _mm_storeu_pd(products + 2, hi);
+   return i;
+}
+
+//
+// AVX2
+//
+
+TARGET_AVX2
+static int AddScaledAVX2(float *dest, const float *src, float gain, int len)
+{
+   __m256 g = _mm256_set1_ps(gain);
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m256 product = _mm256_mul_ps(_mm256_loadu_ps(src + i), g);
+      _mm256_storeu_ps(dest + i,
+                       _mm256_add_ps(_mm256_loadu_ps(dest + i), product));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int AddScaledStereoAVX2(float *dest, const float *src,
+                               float leftGain, float rightGain, int len)
+{
+   __m256 g = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain,
+                             leftGain, rightGain, leftGain, rightGain);
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m128 s0 = _mm_loadu_ps(src + i);
+      __m128 s1 = _mm_loadu_ps(src + i + 4);
+      __m256 lo = _mm256_insertf128_ps(
+         _mm256_castps128_ps256(_mm_unpacklo_ps(s0, s0)),
+         _mm_unpackhi_ps(s0, s0), 1);
+      __m256 hi = _mm256_insertf128_ps(
+         _mm256_castps128_ps256(_mm_unpacklo_ps(s1, s1)),
+         _mm_unpackhi_ps(s1, s1), 1);
+      float *d = dest + 2 * i;
+      _mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d),
+                                        _mm256_mul_ps(lo, g)));
+      _mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8),
+                                            _mm256_mul_ps(hi, g)));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int ApplyEnvelopeAVX2(float *buffer, const double *env, int len)
+{
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m256d lo = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(buffer + i)),
+                                 _mm256_loadu_pd(env + i));
+      __m256d hi = _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(buffer + i + 4)),
+                                 _mm256_loadu_pd(env + i + 4));
+      _mm_storeu_ps(buffer + i, _mm256_cvtpd_ps(lo));
+      _mm_storeu_ps(buffer + i + 4, _mm256_cvtpd_ps(hi));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int Int16ToFloatAVX2(const short *src, float *dest, int len)
+{
+   __m256 scale = _mm256_set1_ps(1.0f / float(1 << 15));
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m256i s = _mm256_cvtepi16_epi32(
+         _mm_loadu_si128((const __m128i *)(src + i)));
+      _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int Int24ToFloatAVX2(const int *src, float *dest, int len)
+{
+   __m256 scale = _mm256_set1_ps(1.0f / float(1 << 23));
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+      _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int FloatToInt16AVX2(const float *src, short *dest, int len)
+{
+   __m256 minusOne = _mm256_set1_ps(-1.0f);
+   __m256 one = _mm256_set1_ps(1.0f);
+   __m256 scale = _mm256_set1_ps(float(1 << 15));
+   int i;
+   for (i = 0; i + 16 <= len; i += 16) {
+      __m256 lo = _mm256_min_ps(
+         _mm256_max_ps(_mm256_loadu_ps(src + i), minusOne), one);
+      __m256 hi = _mm256_min_ps(
+         _mm256_max_ps(_mm256_loadu_ps(src + i + 8), minusOne), one);
+      __m256i packed = _mm256_packs_epi32(
+         _mm256_cvtps_epi32(_mm256_mul_ps(lo, scale)),
+         _mm256_cvtps_epi32(_mm256_mul_ps(hi, scale)));
+      // Packing works within each 128-bit lane; put the halves in order
+      packed = _mm256_permute4x64_epi64(packed, 0xD8);
+      _mm256_storeu_si256((__m256i *)(dest + i), packed);
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int FloatToInt24AVX2(const float *src, int *dest, int len)
+{
+   __m256 minusOne = _mm256_set1_ps(-1.0f);
+   __m256 one = _mm256_set1_ps(1.0f);
+   __m256 scale = _mm256_set1_ps(float(1 << 23));
+   __m256 max = _mm256_set1_ps(8388607.0f);
+   int i;
+   for (i = 0; i + 8 <= len; i += 8) {
+      __m256 s = _mm256_min_ps(
+         _mm256_max_ps(_mm256_loadu_ps(src + i), minusOne), one);
+      s = _mm256_min_ps(_mm256_mul_ps(s, scale), max);
+      _mm256_storeu_si256((__m256i *)(dest + i), _mm256_cvtps_epi32(s));
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int FillRampAVX2(double *buffer, int len, double first, double step)
+{
+   __m256d f = _mm256_set1_pd(first);
+   __m256d s = _mm256_set1_pd(step);
+   __m256d index = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+   __m256d four = _mm256_set1_pd(4.0);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      _mm256_storeu_pd(buffer + i, _mm256_add_pd(f, _mm256_mul_pd(index, s)));
+      index = _mm256_add_pd(index, four);
+   }
+   return i;
+}
+
+TARGET_AVX2
+static int FillGeometricAVX2(double *buffer, int len,
+                             double products[4], double ratio4)
+{
+   __m256d p = _mm256_loadu_pd(products);
+   __m256d r = _mm256_set1_pd(ratio4);
+   int i;
+   for (i = 0; i + 4 <= len; i += 4) {
+      _mm256_storeu_pd(buffer + i, p);
+      p = _mm256_mul_pd(p, r);
+   }
+   _mm256_storeu_pd(products, p);
+   return i;
+}
+
+#endif // SAMPLE_KERNELS_X86
+
+//
+// Dispatch
+//
+
+#if defined(SAMPLE_KERNELS_X86)
+#define DISPATCH(name, args) \
+   (sLevel == AVX2 ? name##AVX2 args : \
+    sLevel == SSE2 ? name##SSE2 args : 0)
+#else
+#define DISPATCH(name, args) 0
+#endif
+
+// static
+void SampleKernels::AddScaled(float *dest, int destStride,
+                              const float *src, float gain, int len)
+{
+   int done = 0;
+   if (destStride == 1)
+      done = DISPATCH(AddScaled, (dest, src, gain, len));
+   AddScaledScalar(dest + done * destStride, destStride,
+                   src + done, gain, len - done);
+}
+
+// static
+void SampleKernels::AddScaledStereo(float *dest, const float *src,
+                                    float leftGain, float rightGain, int len)
+{
+   int done = DISPATCH(AddScaledStereo, (dest, src, leftGain, rightGain, len));
+   AddScaledStereoScalar(dest + 2 * done, src + done,
+                         leftGain, rightGain, len - done);
+}
+
+// static
+void SampleKernels::ApplyEnvelope(float *buffer, const double *env, int len)
+{
+   int done = DISPATCH(ApplyEnvelope, (buffer, env, len));
+   ApplyEnvelopeScalar(buffer + done, env + done, len - done);
+}
+
+// static
+void SampleKernels::Int16ToFloat(const short *src, float *dest, int len)
+{
+   int done = DISPATCH(Int16ToFloat, (src, dest, len));
+   Int16ToFloatScalar(src + done, dest + done, len - done);
+}
+
+// static
+void SampleKernels::Int24ToFloat(const int *src, float *dest, int len)
+{
+   int done = DISPATCH(Int24ToFloat, (src, dest, len));
+   Int24ToFloatScalar(src + done, dest + done, len - done);
+}
+
+// static
+void SampleKernels::FloatToInt16(const float *src, short *dest, int len)
+{
+   int done = DISPATCH(FloatToInt16, (src, dest, len));
+   FloatToInt16Scalar(src + done, dest + done, len - done);
+}
+
+// static
+void SampleKernels::FloatToInt24(const float *src, int *dest, int len)
+{
+   int done = DISPATCH(FloatToInt24, (src, dest, len));
+   FloatToInt24Scalar(src + done, dest + done, len - done);
+}
+
+// static
+void SampleKernels::FillRamp(double *buffer, int len,
+                             double start, double step)
+{
+   int done = DISPATCH(FillRamp, (buffer, len, start, step));
+   FillRampScalar(buffer, done, len, start, step);
+}
+
+// static
+void SampleKernels::FillGeometric(double *buffer, int len,
+                                  double start, double ratio)
+{
+   double products[4];
+   products[0] = start;
+   products[1] = products[0] * ratio;
+   products[2] = products[1] * ratio;
+   products[3] = products[2] * ratio;
+   double ratio4 = (ratio * ratio) * (ratio * ratio);
+
+   int done = DISPATCH(FillGeometric, (buffer, len, products, ratio4));
+   FillGeometricScalar(buffer, done, len, products, ratio4);
+}
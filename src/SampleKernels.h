@@ -0,0 +1,68 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleKernels.h
+
+*******************************************************************//**
+
+\class SampleKernels
+\brief The innermost loops of mixing, envelopes and sample format
+   conversion, with SSE2 and AVX2 versions chosen at run time.
+
+  Each kernel gives exactly the same results as the plain C++ loop it
+  replaces, whatever instruction set is used: the vector versions do
+  the same operations in the same order, never fuse a multiply with
+  an add, and round the same way.  They only differ in speed.
+
+  The instruction set is detected with cpuid when the program starts,
+  the way EffectEqualization48x::GetMathCaps() does it.  SetLevel()
+  lets tests and benchmarks force a lower one.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_KERNELS__
+#define __AUDACITY_SAMPLE_KERNELS__
+
+class SampleKernels
+{
+ public:
+   enum Level {
+      Scalar,
+      SSE2,
+      AVX2
+   };
+
+   /// The best level this processor and build support.
+   static Level GetSupportedLevel();
+   /// The level the kernels use now.
+   static Level GetLevel();
+   /// Uses the given level, or the supported one if that is lower.
+   static void SetLevel(Level level);
+
+   /// dest[i * destStride] += src[i] * gain
+   static void AddScaled(float *dest, int destStride,
+                         const float *src, float gain, int len);
+   /// dest[2 * i] += src[i] * leftGain, dest[2 * i + 1] += src[i] * rightGain
+   static void AddScaledStereo(float *dest, const float *src,
+                               float leftGain, float rightGain, int len);
+   /// buffer[i] *= env[i], in double precision like the loops it replaces
+   static void ApplyEnvelope(float *buffer, const double *env, int len);
+
+   /// The conversions Dither does without dithering, for contiguous
+   /// samples.  Floats are clipped to -1.0...1.0 before conversion to
+   /// integers, and rounded to nearest.
+   static void Int16ToFloat(const short *src, float *dest, int len);
+   static void Int24ToFloat(const int *src, float *dest, int len);
+   static void FloatToInt16(const float *src, short *dest, int len);
+   static void FloatToInt24(const float *src, int *dest, int len);
+
+   /// buffer[i] = start + i * step
+   static void FillRamp(double *buffer, int len, double start, double step);
+   /// buffer[i] = start * ratio^i, computed as four interleaved running
+   /// products, each multiplied by ratio^4 every fourth sample
+   static void FillGeometric(double *buffer, int len,
+                             double start, double ratio);
+};
+
+#endif // __AUDACITY_SAMPLE_KERNELS__
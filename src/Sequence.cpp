@@ -8,7 +8,7 @@
 
 *******************************************************************//**
 \file Sequence.cpp
-\brief Implements classes Sequence and SeqBlock.
+\brief Implements class Sequence.
 
 *//****************************************************************//**
 
@@ -19,12 +19,6 @@
    the audio BlockFiles on disk.
    Contrast with RingBuffer.
 
-*//****************************************************************//**
-
-\class SeqBlock
-\brief Data structure containing pointer to a BlockFile and
-   a start time. Element of a BlockArray.
-
 *//*******************************************************************/
 
 
@@ -42,14 +36,32 @@
 #include "Sequence.h"
 
 #include "BlockFile.h"
+#include "BlockCache.h"
 #include "blockfile/ODDecodeBlockFile.h"
 #include "DirManager.h"
+#include "Profiler.h"
+#include "SummaryPyramid.h"
 
 #include "blockfile/SimpleBlockFile.h"
 #include "blockfile/SilentBlockFile.h"
 
 int Sequence::sMaxDiskBlockSize = 1048576;
 
+// The blocks of a Sequence and their summary pyramid.  Copies of a
+// Sequence within one project share these, so that an undo state costs
+// nothing for the clips an edit did not touch.  The SeqBlocks hold one
+// reference to each BlockFile however many Sequences share them.
+class SharedBlockArray
+{
+ public:
+   BlockArray *blocks;
+   SummaryPyramid *pyramid;
+   int refCount;
+};
+
+// Guards SharedBlockArray::refCount
+static ODLock sSharedBlocksLock;
+
 // Sequence methods
 Sequence::Sequence(DirManager * projDirManager, sampleFormat format)
 {
@@ -57,7 +69,11 @@ Sequence::Sequence(DirManager * projDirManager, sampleFormat format)
    mDirManager->Ref();
    mNumSamples = 0;
    mSampleFormat = format;
-   mBlock = new BlockArray();
+
+   mShared = new SharedBlockArray();
+   mShared->blocks = mBlock = new BlockArray();
+   mShared->pyramid = mPyramid = new SummaryPyramid();
+   mShared->refCount = 1;
 
    mMinSamples = sMaxDiskBlockSize / SAMPLE_SIZE(mSampleFormat) / 2;
    mMaxSamples = mMinSamples * 2;
@@ -78,7 +94,22 @@ Sequence::Sequence(const Sequence &orig, DirManager *projDirManager)
    mMinSamples = orig.mMinSamples;
    mErrorOpening = false;
 
-   mBlock = new BlockArray();
+   if (projDirManager == orig.mDirManager) {
+      sSharedBlocksLock.Lock();
+      mShared = orig.mShared;
+      mShared->refCount++;
+      sSharedBlocksLock.Unlock();
+
+      mBlock = mShared->blocks;
+      mPyramid = mShared->pyramid;
+      mNumSamples = orig.mNumSamples;
+      return;
+   }
+
+   mShared = new SharedBlockArray();
+   mShared->blocks = mBlock = new BlockArray();
+   mShared->pyramid = mPyramid = new SummaryPyramid();
+   mShared->refCount = 1;
 
    bool bResult = Paste(0, &orig);
    wxASSERT(bResult); // TO DO: Actually handle this.
@@ -87,14 +118,69 @@ Sequence::Sequence(const Sequence &orig, DirManager *projDirManager)
 
 Sequence::~Sequence()
 {
+   // Blocks of a project file that did not finish loading
+   for (unsigned int i = 0; i < mLoadingBlocks.GetCount(); i++) {
+      if (mLoadingBlocks[i]->f)
+         mDirManager->Deref(mLoadingBlocks[i]->f);
+      delete mLoadingBlocks[i];
+   }
+
+   ReleaseBlocks();
+   mDirManager->Deref();
+}
+
+void Sequence::ReleaseBlocks()
+{
+   sSharedBlocksLock.Lock();
+   bool last = (--mShared->refCount == 0);
+   sSharedBlocksLock.Unlock();
+
+   if (last) {
+      for (unsigned int i = 0; i < mBlock->GetCount(); i++)
+         mDirManager->Deref(mBlock->Item(i).f);
+
+      delete mBlock;
+      delete mPyramid;
+      delete mShared;
+   }
+
+   mShared = NULL;
+   mBlock = NULL;
+   mPyramid = NULL;
+}
+
+void Sequence::MakeBlocksUnique()
+{
+   sSharedBlocksLock.Lock();
+   bool shared = (mShared->refCount > 1);
+   sSharedBlocksLock.Unlock();
+
+   if (!shared)
+      return;
+
+   // Give this sequence an array of its own, referring to the same
+   // BlockFiles; the summaries stay valid, since the blocks are the same
+   SharedBlockArray *unique = new SharedBlockArray();
+   unique->blocks = new BlockArray();
    for (unsigned int i = 0; i < mBlock->GetCount(); i++) {
-      if (mBlock->Item(i)->f)
-         mDirManager->Deref(mBlock->Item(i)->f);
-      delete mBlock->Item(i);
+      BlockFile *f = mBlock->Item(i).f;
+      mDirManager->Ref(f);
+      unique->blocks->Add(f);
    }
+   unique->pyramid = mPyramid->Duplicate();
+   unique->refCount = 1;
+
+   ReleaseBlocks();
 
+   mShared = unique;
+   mBlock = mShared->blocks;
+   mPyramid = mShared->pyramid;
+}
+
+void Sequence::SetBlockArray(BlockArray *newBlock)
+{
    delete mBlock;
-   mDirManager->Deref();
+   mShared->blocks = mBlock = newBlock;
 }
 
 sampleCount Sequence::GetMaxBlockSize() const
@@ -110,7 +196,7 @@ sampleCount Sequence::GetIdealBlockSize() const
 bool Sequence::Lock()
 {
    for (unsigned int i = 0; i < mBlock->GetCount(); i++)
-      mBlock->Item(i)->f->Lock();
+      mBlock->Item(i).f->Lock();
 
    return true;
 }
@@ -118,7 +204,7 @@ bool Sequence::Lock()
 bool Sequence::CloseLock()
 {
    for (unsigned int i = 0; i < mBlock->GetCount(); i++)
-      mBlock->Item(i)->f->CloseLock();
+      mBlock->Item(i).f->CloseLock();
 
    return true;
 }
@@ -126,7 +212,7 @@ bool Sequence::CloseLock()
 bool Sequence::Unlock()
 {
    for (unsigned int i = 0; i < mBlock->GetCount(); i++)
-      mBlock->Item(i)->f->Unlock();
+      mBlock->Item(i).f->Unlock();
 
    return true;
 }
@@ -147,6 +233,8 @@ bool Sequence::SetSampleFormat(sampleFormat format)
 
 bool Sequence::ConvertToSampleFormat(sampleFormat format, bool* pbChanged)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    wxASSERT(pbChanged);
    *pbChanged = false;
 
@@ -161,6 +249,8 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format, bool* pbChanged)
       return true;
    }
 
+   MakeBlocksUnique();
+
    sampleFormat oldFormat = mSampleFormat;
    mSampleFormat = format;
 
@@ -170,16 +260,13 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format, bool* pbChanged)
    mMaxSamples = mMinSamples * 2;
 
    BlockArray* pNewBlockArray = new BlockArray();
-   // Use the ratio of old to new mMaxSamples to make a reasonable guess at allocation.
-   pNewBlockArray->Alloc(mBlock->GetCount() * ((float)oldMaxSamples / (float)mMaxSamples));
 
    bool bSuccess = true;
    for (size_t i = 0; (i < mBlock->GetCount() && bSuccess); i++)
    {
-      SeqBlock* pOldSeqBlock = mBlock->Item(i);
-      BlockFile* pOldBlockFile = pOldSeqBlock->f;
+      BlockFile* pOldBlockFile = mBlock->Item(i).f;
 
-      sampleCount len = pOldSeqBlock->f->GetLength();
+      sampleCount len = pOldBlockFile->GetLength();
       samplePtr bufferOld = NewSamples(len, oldFormat);
       samplePtr bufferNew = NewSamples(len, mSampleFormat);
 
@@ -207,11 +294,7 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format, bool* pbChanged)
       bSuccess = (pSplitBlockArray->GetCount() > 0);
       if (bSuccess)
       {
-         for (size_t j = 0; j < pSplitBlockArray->GetCount(); j++)
-         {
-            pSplitBlockArray->Item(j)->start += mBlock->Item(i)->start;
-            pNewBlockArray->Add(pSplitBlockArray->Item(j));
-         }
+         pNewBlockArray->InsertArray(pNewBlockArray->GetCount(), *pSplitBlockArray);
          *pbChanged = true;
       }
       delete pSplitBlockArray;
@@ -225,15 +308,11 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format, bool* pbChanged)
       // Invalidate all the old, non-aliased block files.
       // Aliased files will be converted at save, per comment above.
       for (size_t i = 0; (i < mBlock->GetCount() && bSuccess); i++)
-      {
-         SeqBlock* pOldSeqBlock = mBlock->Item(i);
-         mDirManager->Deref(pOldSeqBlock->f);
-         pOldSeqBlock->f = NULL; //vvv ...so we don't delete the file when we delete mBlock, next. ANSWER-ME: Right, or delete?
-      }
-      delete mBlock;
+         mDirManager->Deref(mBlock->Item(i).f);
 
       // Replace with new blocks.
-      mBlock = pNewBlockArray;
+      SetBlockArray(pNewBlockArray);
+      mPyramid->Clear();
    }
    else
    {
@@ -279,7 +358,7 @@ bool Sequence::GetMinMax(sampleCount start, sampleCount len,
 
    for (b = block0 + 1; b < block1; b++) {
       float blockMin, blockMax, blockRMS;
-      mBlock->Item(b)->f->GetMinMax(&blockMin, &blockMax, &blockRMS);
+      mBlock->Item(b).f->GetMinMax(&blockMin, &blockMax, &blockRMS);
 
       if (blockMin < min)
          min = blockMin;
@@ -292,18 +371,18 @@ bool Sequence::GetMinMax(sampleCount start, sampleCount len,
    // of either of these blocks is within min...max, then we can ignore them.
    // If not, we need read some samples and summaries from disk.
    float block0Min, block0Max, block0RMS;
-   mBlock->Item(block0)->f->GetMinMax(&block0Min, &block0Max, &block0RMS);
+   mBlock->Item(block0).f->GetMinMax(&block0Min, &block0Max, &block0RMS);
 
    if (block0Min < min || block0Max > max) {
-      s0 = start - mBlock->Item(block0)->start;
+      s0 = start - mBlock->Item(block0).start;
       l0 = len;
-      maxl0 = mBlock->Item(block0)->start + mBlock->Item(block0)->f->GetLength() - start;
+      maxl0 = mBlock->Item(block0).start + mBlock->Item(block0).f->GetLength() - start;
       wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
       if (l0 > maxl0)
          l0 = maxl0;
 
       float partialMin, partialMax, partialRMS;
-      mBlock->Item(block0)->f->GetMinMax(s0, l0,
+      mBlock->Item(block0).f->GetMinMax(s0, l0,
                                          &partialMin, &partialMax, &partialRMS);
       if (partialMin < min)
          min = partialMin;
@@ -312,17 +391,17 @@ bool Sequence::GetMinMax(sampleCount start, sampleCount len,
    }
 
    float block1Min, block1Max, block1RMS;
-   mBlock->Item(block1)->f->GetMinMax(&block1Min, &block1Max, &block1RMS);
+   mBlock->Item(block1).f->GetMinMax(&block1Min, &block1Max, &block1RMS);
 
    if (block1 > block0 &&
        (block1Min < min || block1Max > max)) {
 
       s0 = 0;
-      l0 = (start + len) - mBlock->Item(block1)->start;
+      l0 = (start + len) - mBlock->Item(block1).start;
       wxASSERT(l0 <= mMaxSamples); // Vaughan, 2011-10-19
 
       float partialMin, partialMax, partialRMS;
-      mBlock->Item(block1)->f->GetMinMax(s0, l0,
+      mBlock->Item(block1).f->GetMinMax(s0, l0,
                                          &partialMin, &partialMax, &partialRMS);
       if (partialMin < min)
          min = partialMin;
@@ -361,33 +440,33 @@ bool Sequence::GetRMS(sampleCount start, sampleCount len,
 
    for (b = block0 + 1; b < block1; b++) {
       float blockMin, blockMax, blockRMS;
-      mBlock->Item(b)->f->GetMinMax(&blockMin, &blockMax, &blockRMS);
+      mBlock->Item(b).f->GetMinMax(&blockMin, &blockMax, &blockRMS);
 
-      sumsq += blockRMS * blockRMS * mBlock->Item(block0)->f->GetLength();
-      length += mBlock->Item(block0)->f->GetLength();
+      sumsq += blockRMS * blockRMS * mBlock->Item(b).f->GetLength();
+      length += mBlock->Item(b).f->GetLength();
    }
 
    // Now we take the first and last blocks into account, noting that the
    // selection may only partly overlap these blocks.
    // If not, we need read some samples and summaries from disk.
-   s0 = start - mBlock->Item(block0)->start;
+   s0 = start - mBlock->Item(block0).start;
    l0 = len;
-   maxl0 = mBlock->Item(block0)->start + mBlock->Item(block0)->f->GetLength() - start;
+   maxl0 = mBlock->Item(block0).start + mBlock->Item(block0).f->GetLength() - start;
    wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
    if (l0 > maxl0)
       l0 = maxl0;
 
    float partialMin, partialMax, partialRMS;
-   mBlock->Item(block0)->f->GetMinMax(s0, l0, &partialMin, &partialMax, &partialRMS);
+   mBlock->Item(block0).f->GetMinMax(s0, l0, &partialMin, &partialMax, &partialRMS);
 
    sumsq += partialRMS * partialRMS * l0;
    length += l0;
 
    if (block1 > block0) {
       s0 = 0;
-      l0 = (start + len) - mBlock->Item(block1)->start;
+      l0 = (start + len) - mBlock->Item(block1).start;
 
-      mBlock->Item(block1)->f->GetMinMax(s0, l0,
+      mBlock->Item(block1).f->GetMinMax(s0, l0,
                                          &partialMin, &partialMax, &partialRMS);
       sumsq += partialRMS * partialRMS * l0;
       length += l0;
@@ -398,6 +477,298 @@ bool Sequence::GetRMS(sampleCount start, sampleCount len,
    return true;
 }
 
+// Whether every sample of f lies below level in absolute value, going
+// by its summary.  Blocks whose summaries are still being computed on
+// demand report made-up values, so they never count as quiet.
+static bool BlockIsQuiet(BlockFile *f, float level)
+{
+   if (!f->IsSummaryAvailable())
+      return false;
+
+   float min, max, rms;
+   f->GetMinMax(&min, &max, &rms);
+   return min > -level && max < level;
+}
+
+// Whether every sample of a 256-sample summary frame lies below level
+static bool FrameIsQuiet(const float *frame, float level)
+{
+   return frame[0] > -level && frame[1] < level;
+}
+
+// The 256-sample summary frames of f covering [s0, s1), starting with
+// frame s0 / 256; or NULL if f has no summary yet
+static float *ReadFrames(BlockFile *f, sampleCount s0, sampleCount s1)
+{
+   if (!f->IsSummaryAvailable())
+      return NULL;
+
+   sampleCount frame0 = s0 / 256;
+   sampleCount frame1 = (s1 + 255) / 256;
+   float *summary = new float[(frame1 - frame0) * 3];
+   f->Read256(summary, frame0, frame1 - frame0);
+   return summary;
+}
+
+// The samples [s0, s1) of one block, read only as they are needed.  With
+// a summary to pick out the frames worth reading they are read a frame
+// at a time; without one, all at once.
+class BlockSamples
+{
+ public:
+   BlockSamples(BlockFile *f, sampleCount s0, sampleCount s1, bool byFrame)
+   {
+      mFile = f;
+      mStart = s0;
+      mEnd = s1;
+      mByFrame = byFrame;
+      mBuffer = NULL;
+      mBufferStart = 0;
+      mBufferLen = 0;
+   }
+
+   ~BlockSamples()
+   {
+      delete[] mBuffer;
+   }
+
+   // Samples a to z - 1 of the block, which lie within one frame
+   const float *Get(sampleCount a, sampleCount z)
+   {
+      if (!mBuffer || a < mBufferStart || z > mBufferStart + mBufferLen) {
+         if (mByFrame) {
+            if (!mBuffer)
+               mBuffer = new float[256];
+            mBufferStart = a;
+            mBufferLen = z - a;
+         }
+         else {
+            mBuffer = new float[mEnd - mStart];
+            mBufferStart = mStart;
+            mBufferLen = mEnd - mStart;
+         }
+         mFile->ReadData((samplePtr)mBuffer, floatSample,
+                         mBufferStart, mBufferLen);
+      }
+      return mBuffer + (a - mBufferStart);
+   }
+
+ private:
+   BlockFile *mFile;
+   sampleCount mStart;
+   sampleCount mEnd;
+   bool mByFrame;
+
+   float *mBuffer;
+   sampleCount mBufferStart;
+   sampleCount mBufferLen;
+};
+
+// The quiet run that Sequence::FindQuiet() is in, if any.  A loud frame
+// may be passed over without reading it; the run after it then begins
+// somewhere after the first sample of that frame, and start is only
+// the earliest it could be.  The frame is read to settle where the run
+// really begins only if the run turns out to be long enough to matter.
+class QuietRun
+{
+ public:
+   QuietRun(float level)
+   {
+      start = -1;
+      mLevel = level;
+      mFrameFile = NULL;
+   }
+
+   sampleCount start;   // in the Sequence, or -1 if not in a run
+
+   void Continue(sampleCount pos)
+   {
+      if (start < 0)
+         start = pos;
+   }
+
+   void End()
+   {
+      start = -1;
+      mFrameFile = NULL;
+   }
+
+   // The loud frame [frameStart, frameStart + len) of the Sequence, which
+   // is [offset, offset + len) of f, has been passed over unread
+   void SkipLoudFrame(BlockFile *f, sampleCount frameStart,
+                      sampleCount offset, sampleCount len)
+   {
+      start = frameStart + 1;
+      mFrameFile = f;
+      mFrameStart = frameStart;
+      mFrameOffset = offset;
+      mFrameLen = len;
+   }
+
+   // Whether the run is at least minLen samples long by pos
+   bool Reaches(sampleCount pos, sampleCount minLen)
+   {
+      if (start < 0 || pos - start < minLen)
+         return false;
+      Settle();
+      return pos - start >= minLen;
+   }
+
+   // Makes start exact, by finding the last loud sample of the frame
+   // that was passed over
+   void Settle()
+   {
+      if (!mFrameFile)
+         return;
+
+      float *buffer = new float[mFrameLen];
+      mFrameFile->ReadData((samplePtr)buffer, floatSample,
+                           mFrameOffset, mFrameLen);
+
+      sampleCount i = mFrameLen;
+      while (i > 0 && fabs(buffer[i - 1]) < mLevel)
+         i--;
+      start = mFrameStart + i;
+
+      delete[] buffer;
+      mFrameFile = NULL;
+   }
+
+ private:
+   float mLevel;
+
+   BlockFile *mFrameFile;
+   sampleCount mFrameStart;
+   sampleCount mFrameOffset;
+   sampleCount mFrameLen;
+};
+
+sampleCount Sequence::FindAbove(sampleCount start, sampleCount len,
+                                float level) const
+{
+   wxASSERT(start >= 0 && start + len <= mNumSamples);
+
+   sampleCount end = start + len;
+   sampleCount pos = start;
+
+   while (pos < end) {
+      SeqBlock sb = mBlock->Item(FindBlock(pos));
+      BlockFile *f = sb.f;
+      sampleCount s0 = pos - sb.start;
+      sampleCount s1 = wxMin(end - sb.start, f->GetLength());
+      pos = sb.start + s1;
+
+      if (BlockIsQuiet(f, level))
+         continue;
+
+      float *summary = ReadFrames(f, s0, s1);
+      BlockSamples samples(f, s0, s1, summary != NULL);
+      sampleCount found = -1;
+
+      for (sampleCount i = s0 / 256; found < 0 && i * 256 < s1; i++) {
+         if (summary && FrameIsQuiet(summary + (i - s0 / 256) * 3, level))
+            continue;
+
+         sampleCount a = wxMax(i * 256, s0);
+         sampleCount z = wxMin(i * 256 + 256, s1);
+         const float *data = samples.Get(a, z);
+
+         for (sampleCount j = a; j < z; j++) {
+            if (fabs(data[j - a]) >= level) {
+               found = sb.start + j;
+               break;
+            }
+         }
+      }
+
+      delete[] summary;
+
+      if (found >= 0)
+         return found;
+   }
+
+   return end;
+}
+
+sampleCount Sequence::FindQuiet(sampleCount start, sampleCount len,
+                                float level, sampleCount minLen) const
+{
+   wxASSERT(start >= 0 && start + len <= mNumSamples);
+
+   sampleCount end = start + len;
+   sampleCount pos = start;
+   QuietRun run(level);
+
+   while (pos < end) {
+      SeqBlock sb = mBlock->Item(FindBlock(pos));
+      BlockFile *f = sb.f;
+      sampleCount blockLen = f->GetLength();
+      sampleCount s0 = pos - sb.start;
+      sampleCount s1 = wxMin(end - sb.start, blockLen);
+      pos = sb.start + s1;
+
+      if (BlockIsQuiet(f, level)) {
+         run.Continue(sb.start + s0);
+         if (run.Reaches(pos, minLen))
+            return run.start;
+         continue;
+      }
+
+      float *summary = ReadFrames(f, s0, s1);
+      BlockSamples samples(f, s0, s1, summary != NULL);
+      sampleCount found = -1;
+
+      for (sampleCount i = s0 / 256; found < 0 && i * 256 < s1; i++) {
+         sampleCount a = wxMax(i * 256, s0);
+         sampleCount z = wxMin(i * 256 + 256, s1);
+         const float *frame = summary ? summary + (i - s0 / 256) * 3 : NULL;
+
+         if (frame && FrameIsQuiet(frame, level)) {
+            run.Continue(sb.start + a);
+            if (run.Reaches(sb.start + z, minLen))
+               found = run.start;
+            continue;
+         }
+
+         // A frame the summary says is loud, and that lies wholly in
+         // the range, need not be read unless a run long enough to
+         // matter could end or lie within it.
+         bool whole = (a == i * 256 && z == wxMin(i * 256 + 256, blockLen));
+         if (frame && whole && z - a <= minLen &&
+             (run.start < 0 || sb.start + z - 1 - run.start < minLen)) {
+            run.SkipLoudFrame(f, sb.start + a, a, z - a);
+            continue;
+         }
+
+         const float *data = samples.Get(a, z);
+
+         for (sampleCount j = a; j < z; j++) {
+            if (fabs(data[j - a]) < level) {
+               run.Continue(sb.start + j);
+               if (run.Reaches(sb.start + j + 1, minLen)) {
+                  found = run.start;
+                  break;
+               }
+            }
+            else
+               run.End();
+         }
+      }
+
+      delete[] summary;
+
+      if (found >= 0)
+         return found;
+   }
+
+   if (run.start >= 0) {
+      run.Settle();
+      return run.start;
+   }
+
+   return end;
+}
+
 bool Sequence::Copy(sampleCount s0, sampleCount s1, Sequence **dest)
 {
    *dest = 0;
@@ -420,18 +791,18 @@ bool Sequence::Copy(sampleCount s0, sampleCount s1, Sequence **dest)
 
    // Do the first block
 
-   if (b0 >= 0 && b0 < numBlocks && s0 != mBlock->Item(b0)->start) {
+   if (b0 >= 0 && b0 < numBlocks && s0 != mBlock->Item(b0).start) {
 
-      blocklen = (mBlock->Item(b0)->start + mBlock->Item(b0)->f->GetLength() - s0);
+      blocklen = (mBlock->Item(b0).start + mBlock->Item(b0).f->GetLength() - s0);
       if (blocklen > (s1 - s0))
          blocklen = s1 - s0;
-      wxASSERT(mBlock->Item(b0)->f->IsAlias() || (blocklen <= mMaxSamples)); // Vaughan, 2012-02-29
+      wxASSERT(mBlock->Item(b0).f->IsAlias() || (blocklen <= mMaxSamples)); // Vaughan, 2012-02-29
       Get(buffer, mSampleFormat, s0, blocklen);
 
       (*dest)->Append(buffer, mSampleFormat, blocklen);
    }
 
-   if (b0 >= 0 && b0 < numBlocks && s0 == mBlock->Item(b0)->start) {
+   if (b0 >= 0 && b0 < numBlocks && s0 == mBlock->Item(b0).start) {
       b0--;
    }
    // If there are blocks in the middle, copy the blockfiles directly
@@ -440,9 +811,9 @@ bool Sequence::Copy(sampleCount s0, sampleCount s1, Sequence **dest)
 
    // Do the last block
    if (b1 > b0 && b1 < numBlocks) {
-      blocklen = (s1 - mBlock->Item(b1)->start);
-      wxASSERT(mBlock->Item(b1)->f->IsAlias() || (blocklen <= mMaxSamples)); // Vaughan, 2012-02-29
-      Get(buffer, mSampleFormat, mBlock->Item(b1)->start, blocklen);
+      blocklen = (s1 - mBlock->Item(b1).start);
+      wxASSERT(mBlock->Item(b1).f->IsAlias() || (blocklen <= mMaxSamples)); // Vaughan, 2012-02-29
+      Get(buffer, mSampleFormat, mBlock->Item(b1).start, blocklen);
       (*dest)->Append(buffer, mSampleFormat, blocklen);
    }
 
@@ -453,6 +824,8 @@ bool Sequence::Copy(sampleCount s0, sampleCount s1, Sequence **dest)
 
 bool Sequence::Paste(sampleCount s, const Sequence *src)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    if ((s < 0) || (s > mNumSamples))
    {
       wxLogError(
@@ -483,6 +856,8 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
       return false;
    }
 
+   MakeBlocksUnique();
+
    BlockArray *srcBlock = src->mBlock;
    sampleCount addedLen = src->mNumSamples;
    unsigned int srcNumBlocks = srcBlock->GetCount();
@@ -495,7 +870,7 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
    size_t numBlocks = mBlock->GetCount();
 
    if (numBlocks == 0 ||
-       (s == mNumSamples && mBlock->Item(numBlocks-1)->f->GetLength() >= mMinSamples)) {
+       (s == mNumSamples && mBlock->Item(numBlocks-1).f->GetLength() >= mMinSamples)) {
       // Special case: this track is currently empty, or it's safe to append
       // onto the end because the current last block is longer than the
       // minimum size
@@ -507,23 +882,21 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
    }
 
    if ((b >= 0 ) && (b < (int)numBlocks)
-       && ((mBlock->Item(b)->f->GetLength() + addedLen) < mMaxSamples)) {
+       && ((mBlock->Item(b).f->GetLength() + addedLen) < mMaxSamples)) {
       // Special case: we can fit all of the new samples inside of
       // one block!
 
       samplePtr buffer = NewSamples(mMaxSamples, mSampleFormat);
 
-      int splitPoint = s - mBlock->Item(b)->start;
+      int splitPoint = s - mBlock->Item(b).start;
       Read(buffer, mSampleFormat, mBlock->Item(b), 0, splitPoint);
       src->Get(buffer + splitPoint*sampleSize,
                mSampleFormat, 0, addedLen);
       Read(buffer + (splitPoint + addedLen)*sampleSize,
            mSampleFormat, mBlock->Item(b),
-           splitPoint, mBlock->Item(b)->f->GetLength() - splitPoint);
+           splitPoint, mBlock->Item(b).f->GetLength() - splitPoint);
 
-      SeqBlock *largerBlock = new SeqBlock();
-      largerBlock->start = mBlock->Item(b)->start;
-      sampleCount largerBlockLen = mBlock->Item(b)->f->GetLength() + addedLen;
+      sampleCount largerBlockLen = mBlock->Item(b).f->GetLength() + addedLen;
       if (largerBlockLen > mMaxSamples)
       {
          wxLogError(
@@ -532,17 +905,14 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
             Internat::ToString(((wxLongLong)mMaxSamples).ToDouble(), 0).c_str());
          largerBlockLen = mMaxSamples; // Prevent overruns, per NGS report for UmixIt.
       }
-      largerBlock->f =
+      BlockFile *largerBlock =
          mDirManager->NewSimpleBlockFile(buffer, largerBlockLen, mSampleFormat);
 
-      mDirManager->Deref(mBlock->Item(b)->f);
-      delete mBlock->Item(b);
-      mBlock->Item(b) = largerBlock;
-
-      for (unsigned int i = b + 1; i < numBlocks; i++)
-         mBlock->Item(i)->start += addedLen;
+      mDirManager->Deref(mBlock->Item(b).f);
+      mBlock->Replace(b, largerBlock);
 
       mNumSamples += addedLen;
+      mPyramid->Splice(b, 1, 1);
 
       DeleteSamples(buffer);
 
@@ -552,19 +922,14 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
    // Case two: if we are inserting four or fewer blocks,
    // it's simplest to just lump all the data together
    // into one big block along with the split block,
-   // then resplit it all
+   // then resplit it all.
+   // The new blocks are gathered in an array of their own,
+   // which then takes the place of the split block.
    BlockArray *newBlock = new BlockArray();
-   newBlock->Alloc(numBlocks + srcNumBlocks + 2);
-   int newNumBlocks = 0;
 
-   for (int i = 0; i < b; i++) {
-      newBlock->Add(mBlock->Item(i));
-      newNumBlocks++;
-   }
-
-   SeqBlock *splitBlock = mBlock->Item(b);
-   sampleCount splitLen = mBlock->Item(b)->f->GetLength();
-   int splitPoint = s - splitBlock->start;
+   SeqBlock splitBlock = mBlock->Item(b);
+   sampleCount splitLen = splitBlock.f->GetLength();
+   int splitPoint = s - splitBlock.start;
 
    unsigned int i;
    if (srcNumBlocks <= 4) {
@@ -578,14 +943,10 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
                0, addedLen);
       Read(sumBuffer + (splitPoint + addedLen) * sampleSize, mSampleFormat,
            splitBlock, splitPoint,
-           splitBlock->f->GetLength() - splitPoint);
+           splitBlock.f->GetLength() - splitPoint);
 
       BlockArray *split = Blockify(sumBuffer, sum);
-      for (i = 0; i < split->GetCount(); i++) {
-         split->Item(i)->start += splitBlock->start;
-         newBlock->Add(split->Item(i));
-         newNumBlocks++;
-      }
+      newBlock->InsertArray(newBlock->GetCount(), *split);
       delete split;
       DeleteSamples(sumBuffer);
    } else {
@@ -597,7 +958,7 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
       // half of the split block.
 
       sampleCount srcFirstTwoLen =
-          srcBlock->Item(0)->f->GetLength() + srcBlock->Item(1)->f->GetLength();
+          srcBlock->Item(0).f->GetLength() + srcBlock->Item(1).f->GetLength();
       sampleCount leftLen = splitPoint + srcFirstTwoLen;
 
       samplePtr leftBuffer = NewSamples(leftLen, mSampleFormat);
@@ -606,71 +967,53 @@ bool Sequence::Paste(sampleCount s, const Sequence *src)
                mSampleFormat, 0, srcFirstTwoLen);
 
       BlockArray *split = Blockify(leftBuffer, leftLen);
-      for (i = 0; i < split->GetCount(); i++) {
-         split->Item(i)->start += splitBlock->start;
-         newBlock->Add(split->Item(i));
-         newNumBlocks++;
-      }
+      newBlock->InsertArray(newBlock->GetCount(), *split);
       delete split;
       DeleteSamples(leftBuffer);
 
       for (i = 2; i < srcNumBlocks - 2; i++) {
-         SeqBlock *insertBlock = new SeqBlock();
-         insertBlock->start = srcBlock->Item(i)->start + s;
-
-         insertBlock->f = mDirManager->CopyBlockFile(srcBlock->Item(i)->f);
-         if (!insertBlock->f) {
+         BlockFile *insertBlock =
+            mDirManager->CopyBlockFile(srcBlock->Item(i).f);
+         if (!insertBlock) {
             wxASSERT(false); // TODO: Handle this better, alert the user of failure.
-            delete insertBlock;
             newBlock->Clear();
             delete newBlock;
             return false;
          }
 
          newBlock->Add(insertBlock);
-         newNumBlocks++;
       }
 
       sampleCount srcLastTwoLen =
-         srcBlock->Item(srcNumBlocks - 2)->f->GetLength() +
-         srcBlock->Item(srcNumBlocks - 1)->f->GetLength();
-      sampleCount rightSplit = splitBlock->f->GetLength() - splitPoint;
+         srcBlock->Item(srcNumBlocks - 2).f->GetLength() +
+         srcBlock->Item(srcNumBlocks - 1).f->GetLength();
+      sampleCount rightSplit = splitBlock.f->GetLength() - splitPoint;
       sampleCount rightLen = rightSplit + srcLastTwoLen;
 
       samplePtr rightBuffer = NewSamples(rightLen, mSampleFormat);
-      sampleCount lastStart = srcBlock->Item(srcNumBlocks - 2)->start;
+      sampleCount lastStart = srcBlock->Item(srcNumBlocks - 2).start;
       src->Get(rightBuffer, mSampleFormat,
                lastStart, srcLastTwoLen);
       Read(rightBuffer + srcLastTwoLen * sampleSize, mSampleFormat,
            splitBlock, splitPoint, rightSplit);
 
-      sampleCount pos = s + lastStart;
-
       split = Blockify(rightBuffer, rightLen);
-      for (i = 0; i < split->Count(); i++) {
-         split->Item(i)->start += pos;
-         newBlock->Add(split->Item(i));
-         newNumBlocks++;
-      }
+      newBlock->InsertArray(newBlock->GetCount(), *split);
       delete split;
       DeleteSamples(rightBuffer);
    }
 
-   mDirManager->Deref(splitBlock->f);
-   delete splitBlock;
+   mDirManager->Deref(splitBlock.f);
 
-   // Copy remaining blocks to new block array and
-   // swap the new block array in for the old
-   for (i = b + 1; i < numBlocks; i++) {
-      mBlock->Item(i)->start += addedLen;
-      newBlock->Add(mBlock->Item(i));
-      newNumBlocks++;
-   }
-
-   delete mBlock;
-   mBlock = newBlock;
+   // Put the new blocks in place of the split block; the blocks
+   // after them move along without being touched
+   int numNew = newBlock->GetCount();
+   mBlock->RemoveAt(b);
+   mBlock->InsertArray(b, *newBlock);
+   delete newBlock;
 
    mNumSamples += addedLen;
+   mPyramid->Splice(b, 1, numNew);
 
    return ConsistencyCheck(wxT("Paste branch three"));
 }
@@ -700,11 +1043,7 @@ bool Sequence::InsertSilence(sampleCount s0, sampleCount len)
    while (len) {
       sampleCount l = (len > idealSamples ? idealSamples : len);
 
-      SeqBlock *w = new SeqBlock();
-      w->start = pos;
-      w->f = new SilentBlockFile(l);
-
-      sTrack->mBlock->Add(w);
+      sTrack->mBlock->Add(new SilentBlockFile(l));
 
       pos += l;
       len -= l;
@@ -724,18 +1063,19 @@ bool Sequence::AppendAlias(wxString fullPath,
                            sampleCount start,
                            sampleCount len, int channel,bool useOD)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    // Quick check to make sure that it doesn't overflow
    if (((double)mNumSamples) + ((double)len) > wxLL(9223372036854775807))
       return false;
 
-   SeqBlock *newBlock = new SeqBlock();
+   MakeBlocksUnique();
 
-   newBlock->start = mNumSamples;
-   newBlock->f = useOD?
+   BlockFile *newBlock = useOD?
       mDirManager->NewODAliasBlockFile(fullPath, start, len, channel):
       mDirManager->NewAliasBlockFile(fullPath, start, len, channel);
    mBlock->Add(newBlock);
-   mNumSamples += newBlock->f->GetLength();
+   mNumSamples += newBlock->GetLength();
 
    return true;
 }
@@ -743,41 +1083,40 @@ bool Sequence::AppendAlias(wxString fullPath,
 bool Sequence::AppendCoded(wxString fName, sampleCount start,
                             sampleCount len, int channel, int decodeType)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    // Quick check to make sure that it doesn't overflow
    if (((double)mNumSamples) + ((double)len) > wxLL(9223372036854775807))
       return false;
 
-   SeqBlock *newBlock = new SeqBlock();
+   MakeBlocksUnique();
 
-   newBlock->start = mNumSamples;
-   newBlock->f = mDirManager->NewODDecodeBlockFile(fName, start, len, channel, decodeType);
+   BlockFile *newBlock =
+      mDirManager->NewODDecodeBlockFile(fName, start, len, channel, decodeType);
    mBlock->Add(newBlock);
-   mNumSamples += newBlock->f->GetLength();
+   mNumSamples += newBlock->GetLength();
 
    return true;
 }
 
-bool Sequence::AppendBlock(SeqBlock * b)
+bool Sequence::AppendBlock(const SeqBlock &b)
 {
    // Quick check to make sure that it doesn't overflow
-   if (((double)mNumSamples) + ((double)b->f->GetLength()) > wxLL(9223372036854775807))
+   if (((double)mNumSamples) + ((double)b.f->GetLength()) > wxLL(9223372036854775807))
       return false;
 
-   SeqBlock *newBlock = new SeqBlock();
-   newBlock->start = mNumSamples;
-   newBlock->f = mDirManager->CopyBlockFile(b->f);
-   if (!newBlock->f) {
+   BlockFile *newBlock = mDirManager->CopyBlockFile(b.f);
+   if (!newBlock) {
       /// \todo Error Could not paste!  (Out of disk space?)
       wxASSERT(false); // TODO: Handle this better, alert the user of failure.
-      delete newBlock;
       return false;
    }
 
    //Don't need to Ref because it was done by CopyBlockFile, above...
-   //mDirManager->Ref(newBlock->f);
+   //mDirManager->Ref(newBlock);
 
    mBlock->Add(newBlock);
-   mNumSamples += newBlock->f->GetLength();
+   mNumSamples += newBlock->GetLength();
 
    // Don't do a consistency check here because this
    // function gets called in an inner loop
@@ -790,9 +1129,9 @@ unsigned int Sequence::GetODFlags()
 {
    unsigned int ret = 0;
    for (unsigned int i = 0; i < mBlock->GetCount(); i++){
-      if(!mBlock->Item(i)->f->IsDataAvailable())
-         ret = ret|((ODDecodeBlockFile*)mBlock->Item(i)->f)->GetDecodeType();
-      else if(!mBlock->Item(i)->f->IsSummaryAvailable())
+      if(!mBlock->Item(i).f->IsDataAvailable())
+         ret = ret|((ODDecodeBlockFile*)mBlock->Item(i).f)->GetDecodeType();
+      else if(!mBlock->Item(i).f->IsSummaryAvailable())
          ret = ret|ODTask::eODPCMSummary;
    }
    return ret;
@@ -807,12 +1146,12 @@ sampleCount Sequence::GetBestBlockSize(sampleCount start) const
    int b = FindBlock(start);
    int numBlocks = mBlock->GetCount();
 
-   sampleCount result = (mBlock->Item(b)->start + mBlock->Item(b)->f->GetLength() - start);
+   sampleCount result = (mBlock->Item(b).start + mBlock->Item(b).f->GetLength() - start);
 
    while(result < mMinSamples && b+1<numBlocks &&
-         (mBlock->Item(b+1)->f->GetLength()+result) <= mMaxSamples) {
+         (mBlock->Item(b+1).f->GetLength()+result) <= mMaxSamples) {
       b++;
-      result += mBlock->Item(b)->f->GetLength();
+      result += mBlock->Item(b).f->GetLength();
    }
 
    wxASSERT(result > 0 && result <= mMaxSamples);
@@ -876,7 +1215,7 @@ bool Sequence::HandleXMLTag(const wxChar *tag, const wxChar **attrs)
          }
       } // while
 
-      mBlock->Add(wb);
+      mLoadingBlocks.Add(wb);
       mDirManager->SetLoadingTarget(&wb->f);
 
       return true;
@@ -958,14 +1297,14 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
    // Make sure that the sequence is valid.
    // First, replace missing blockfiles with SilentBlockFiles
    unsigned int b;
-   for (b = 0; b < mBlock->GetCount(); b++) {
-      if (!mBlock->Item(b)->f) {
+   for (b = 0; b < mLoadingBlocks.GetCount(); b++) {
+      if (!mLoadingBlocks.Item(b)->f) {
          sampleCount len;
 
-         if (b < mBlock->GetCount()-1)
-            len = mBlock->Item(b+1)->start - mBlock->Item(b)->start;
+         if (b < mLoadingBlocks.GetCount()-1)
+            len = mLoadingBlocks.Item(b+1)->start - mLoadingBlocks.Item(b)->start;
          else
-            len = mNumSamples - mBlock->Item(b)->start;
+            len = mNumSamples - mLoadingBlocks.Item(b)->start;
 
          if (len > mMaxSamples)
          {
@@ -977,7 +1316,7 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
                Internat::ToString(((wxLongLong)mMaxSamples).ToDouble(), 0).c_str());
             len = mMaxSamples;
          }
-         mBlock->Item(b)->f = new SilentBlockFile(len);
+         mLoadingBlocks.Item(b)->f = new SilentBlockFile(len);
          wxLogWarning(
             wxT("Gap detected in project file. Replacing missing block file with silence."));
          mErrorOpening = true;
@@ -986,22 +1325,22 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
 
    // Next, make sure that start times and lengths are consistent
    sampleCount numSamples = 0;
-   for (b = 0; b < mBlock->GetCount(); b++) {
-      if (mBlock->Item(b)->start != numSamples) {
-         wxString sFileAndExtension = mBlock->Item(b)->f->GetFileName().GetFullName();
+   for (b = 0; b < mLoadingBlocks.GetCount(); b++) {
+      if (mLoadingBlocks.Item(b)->start != numSamples) {
+         wxString sFileAndExtension = mLoadingBlocks.Item(b)->f->GetFileName().GetFullName();
          if (sFileAndExtension.IsEmpty())
             sFileAndExtension = wxT("(replaced with silence)");
          else
             sFileAndExtension = wxT("\"") + sFileAndExtension + wxT("\"");
          wxLogWarning(
             wxT("Gap detected in project file.\n   Start (%s) for block file %s is more than one sample past end of previous block (%s).\n   Moving start back so blocks are contiguous."),
-            Internat::ToString(((wxLongLong)(mBlock->Item(b)->start)).ToDouble(), 0).c_str(),
+            Internat::ToString(((wxLongLong)(mLoadingBlocks.Item(b)->start)).ToDouble(), 0).c_str(),
             sFileAndExtension.c_str(),
             Internat::ToString(((wxLongLong)(numSamples)).ToDouble(), 0).c_str());
-         mBlock->Item(b)->start = numSamples;
+         mLoadingBlocks.Item(b)->start = numSamples;
          mErrorOpening = true;
       }
-      numSamples += mBlock->Item(b)->f->GetLength();
+      numSamples += mLoadingBlocks.Item(b)->f->GetLength();
    }
    if (mNumSamples != numSamples) {
       wxLogWarning(
@@ -1011,6 +1350,16 @@ void Sequence::HandleXMLEndTag(const wxChar *tag)
       mNumSamples = numSamples;
       mErrorOpening = true;
    }
+
+   // Every block has its BlockFile now, so they can go in the array
+   MakeBlocksUnique();
+   for (b = 0; b < mLoadingBlocks.GetCount(); b++) {
+      mBlock->Add(mLoadingBlocks.Item(b)->f);
+      delete mLoadingBlocks.Item(b);
+   }
+   mLoadingBlocks.Clear();
+
+   mPyramid->Clear();
 }
 
 XMLTagHandler *Sequence::HandleXMLChild(const wxChar *tag)
@@ -1027,35 +1376,48 @@ void Sequence::WriteXML(XMLWriter &xmlFile)
 {
    unsigned int b;
 
-   xmlFile.StartTag(wxT("sequence"));
-
-   xmlFile.WriteAttr(wxT("maxsamples"), mMaxSamples);
-   xmlFile.WriteAttr(wxT("sampleformat"), mSampleFormat);
-   xmlFile.WriteAttr(wxT("numsamples"), mNumSamples);
-
    for (b = 0; b < mBlock->GetCount(); b++) {
-      SeqBlock *bb = mBlock->Item(b);
+      BlockFile *f = mBlock->Item(b).f;
 
       // See http://bugzilla.audacityteam.org/show_bug.cgi?id=451.
       // Also, don't check against mMaxSamples for AliasBlockFiles, because if you convert sample format,
       // mMaxSample gets changed to match the format, but the number of samples in the aliased file
       // has not changed (because sample format conversion was not actually done in the aliased file.
-      if (!bb->f->IsAlias() && (bb->f->GetLength() > mMaxSamples))
+      if (!f->IsAlias() && (f->GetLength() > mMaxSamples))
       {
          wxString sMsg =
             wxString::Format(
                _("Sequence has block file with length %s > mMaxSamples %s.\nTruncating to mMaxSamples."),
-               Internat::ToString(((wxLongLong)(bb->f->GetLength())).ToDouble(), 0).c_str(),
+               Internat::ToString(((wxLongLong)(f->GetLength())).ToDouble(), 0).c_str(),
                Internat::ToString(((wxLongLong)mMaxSamples).ToDouble(), 0).c_str());
          wxMessageBox(sMsg, _("Warning - Length in Writing Sequence"), wxICON_EXCLAMATION | wxOK);
          wxLogWarning(sMsg);
-         bb->f->SetLength(mMaxSamples);
+
+         // The tree caches the length of each block, so the shortened
+         // block goes back in through it, and the starts written below
+         // and the sample count follow
+         ODLocker locker(mDeleteUpdateMutex);
+         MakeBlocksUnique();
+         mNumSamples -= f->GetLength() - mMaxSamples;
+         f->SetLength(mMaxSamples);
+         mBlock->Replace(b, f);
+         mPyramid->Splice(b, 1, 1);
       }
+   }
+
+   xmlFile.StartTag(wxT("sequence"));
+
+   xmlFile.WriteAttr(wxT("maxsamples"), mMaxSamples);
+   xmlFile.WriteAttr(wxT("sampleformat"), mSampleFormat);
+   xmlFile.WriteAttr(wxT("numsamples"), mNumSamples);
+
+   for (b = 0; b < mBlock->GetCount(); b++) {
+      SeqBlock bb = mBlock->Item(b);
 
       xmlFile.StartTag(wxT("waveblock"));
-      xmlFile.WriteAttr(wxT("start"), bb->start);
+      xmlFile.WriteAttr(wxT("start"), bb.start);
 
-      bb->f->SaveXML(xmlFile);
+      bb.f->SaveXML(xmlFile);
 
       xmlFile.EndTag(wxT("waveblock"));
    }
@@ -1063,25 +1425,6 @@ void Sequence::WriteXML(XMLWriter &xmlFile)
    xmlFile.EndTag(wxT("sequence"));
 }
 
-int Sequence::FindBlock(sampleCount pos, sampleCount lo,
-                        sampleCount guess, sampleCount hi) const
-{
-   wxASSERT(mBlock->Item(guess)->f->GetLength() > 0);
-   wxASSERT(lo <= guess && guess <= hi && lo <= hi);
-
-   if (pos >= mBlock->Item(guess)->start &&
-       pos < mBlock->Item(guess)->start + mBlock->Item(guess)->f->GetLength())
-      return guess;
-
-   //this is a binary search, but we probably could benefit by something more like
-   //dictionary search where we guess something smarter than the binary division
-   //of the unsearched area, since samples are usually proportional to block file number.
-   if (pos < mBlock->Item(guess)->start)
-      return FindBlock(pos, lo, (lo + guess) / 2, guess);
-   else
-      return FindBlock(pos, guess + 1, (guess + 1 + hi) / 2, hi);
-}
-
 int Sequence::FindBlock(sampleCount pos) const
 {
    wxASSERT(pos >= 0 && pos <= mNumSamples);
@@ -1094,25 +1437,27 @@ int Sequence::FindBlock(sampleCount pos) const
    if (pos == mNumSamples)
       return (numBlocks - 1);
 
-   int rval = FindBlock(pos, 0, numBlocks / 2, numBlocks);
+   int rval = mBlock->FindBlock(pos);
 
    wxASSERT(rval >= 0 && rval < numBlocks &&
-            pos >= mBlock->Item(rval)->start &&
-            pos < mBlock->Item(rval)->start + mBlock->Item(rval)->f->GetLength());
+            pos >= mBlock->Item(rval).start &&
+            pos < mBlock->Item(rval).start + mBlock->Item(rval).f->GetLength());
 
    return rval;
 }
 
 bool Sequence::Read(samplePtr buffer, sampleFormat format,
-                    SeqBlock * b, sampleCount start, sampleCount len) const
+                    const SeqBlock &b, sampleCount start, sampleCount len) const
 {
-   wxASSERT(b);
+   PROFILE_ZONE("Sequence::Read");
+
+   wxASSERT(b.f);
    wxASSERT(start >= 0);
-   wxASSERT(start + len <= b->f->GetLength());
+   wxASSERT(start + len <= b.f->GetLength());
 
-   BlockFile *f = b->f;
+   BlockFile *f = b.f;
 
-   int result = f->ReadData(buffer, format, start, len);
+   int result = BlockCache::Get().ReadData(f, buffer, format, start, len);
 
    if (result != len)
    {
@@ -1125,28 +1470,30 @@ bool Sequence::Read(samplePtr buffer, sampleFormat format,
    return true;
 }
 
-bool Sequence::CopyWrite(samplePtr buffer, SeqBlock *b,
+bool Sequence::CopyWrite(samplePtr buffer, int b,
                          sampleCount start, sampleCount len)
 {
    // We don't ever write to an existing block; to support Undo,
    // we copy the old block entirely into memory, dereference it,
    // make the change, and then write the new block to disk.
 
-   wxASSERT(b);
-   wxASSERT(b->f->GetLength() <= mMaxSamples);
-   wxASSERT(start + len <= b->f->GetLength());
+   SeqBlock sb = mBlock->Item(b);
+   sampleCount blockLen = sb.f->GetLength();
+
+   wxASSERT(blockLen <= mMaxSamples);
+   wxASSERT(start + len <= blockLen);
 
    int sampleSize = SAMPLE_SIZE(mSampleFormat);
    samplePtr newBuffer = NewSamples(mMaxSamples, mSampleFormat);
    wxASSERT(newBuffer);
 
-   Read(newBuffer, mSampleFormat, b, 0, b->f->GetLength());
+   Read(newBuffer, mSampleFormat, sb, 0, blockLen);
    memcpy(newBuffer + start*sampleSize, buffer, len*sampleSize);
 
-   BlockFile *oldBlockFile = b->f;
-   b->f = mDirManager->NewSimpleBlockFile(newBuffer, b->f->GetLength(), mSampleFormat);
+   mBlock->SetFile(b, mDirManager->NewSimpleBlockFile(newBuffer, blockLen,
+                                                      mSampleFormat));
 
-   mDirManager->Deref(oldBlockFile);
+   mDirManager->Deref(sb.f);
 
    DeleteSamples(newBuffer);
 
@@ -1163,10 +1510,10 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
 
    while (len) {
       sampleCount blen =
-          mBlock->Item(b)->start + mBlock->Item(b)->f->GetLength() - start;
+          mBlock->Item(b).start + mBlock->Item(b).f->GetLength() - start;
       if (blen > len)
          blen = len;
-      sampleCount bstart = (start - (mBlock->Item(b)->start));
+      sampleCount bstart = (start - (mBlock->Item(b).start));
 
       Read(buffer, format, mBlock->Item(b), bstart, blen);
 
@@ -1183,10 +1530,14 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
 bool Sequence::Set(samplePtr buffer, sampleFormat format,
                    sampleCount start, sampleCount len)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    if (start < 0 || start > mNumSamples ||
        start+len > mNumSamples)
       return false;
 
+   MakeBlocksUnique();
+
    samplePtr temp = NULL;
    if (format != mSampleFormat) {
       temp = NewSamples(mMaxSamples, mSampleFormat);
@@ -1201,35 +1552,36 @@ bool Sequence::Set(samplePtr buffer, sampleFormat format,
    }
 
    int b = FindBlock(start);
+   int firstBlock = b;
 
    while (len) {
-      int blen = mBlock->Item(b)->start + mBlock->Item(b)->f->GetLength() - start;
+      int blen = mBlock->Item(b).start + mBlock->Item(b).f->GetLength() - start;
       if (blen > len)
          blen = len;
 
       if (buffer) {
          if (format == mSampleFormat)
-            CopyWrite(buffer, mBlock->Item(b), start - mBlock->Item(b)->start,
+            CopyWrite(buffer, b, start - mBlock->Item(b).start,
                       blen);
          else {
             CopySamples(buffer, format, temp, mSampleFormat, blen);
-            CopyWrite(temp, mBlock->Item(b), start - mBlock->Item(b)->start,
+            CopyWrite(temp, b, start - mBlock->Item(b).start,
                       blen);
          }
          buffer += (blen * SAMPLE_SIZE(format));
       }
       else {
          // If it's a full block of silence
-         if (start == mBlock->Item(b)->start &&
-             blen == mBlock->Item(b)->f->GetLength()) {
+         if (start == mBlock->Item(b).start &&
+             blen == mBlock->Item(b).f->GetLength()) {
 
-            mDirManager->Deref(mBlock->Item(b)->f);
-            mBlock->Item(b)->f = new SilentBlockFile(blen);
+            mDirManager->Deref(mBlock->Item(b).f);
+            mBlock->SetFile(b, new SilentBlockFile(blen));
          }
          else {
             // Otherwise write silence just to the portion of the block
-            CopyWrite(silence, mBlock->Item(b),
-                      start - mBlock->Item(b)->start, blen);
+            CopyWrite(silence, b,
+                      start - mBlock->Item(b).start, blen);
          }
       }
 
@@ -1244,6 +1596,8 @@ bool Sequence::Set(samplePtr buffer, sampleFormat format,
    if (format != mSampleFormat)
       DeleteSamples(temp);
 
+   mPyramid->InvalidateBlocks(firstBlock, b);
+
    return ConsistencyCheck(wxT("Set"));
 }
 
@@ -1269,6 +1623,9 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
    if (s1 > mNumSamples)
       s1 = mNumSamples;
 
+   if (divisor == 65536)
+      return GetWaveDisplayFromPyramid(min, max, rms, bl, len, where);
+
    sampleCount srcX = s0;
 
    unsigned int block0 = FindBlock(s0);
@@ -1286,9 +1643,11 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
    while (srcX < s1) {
       // Get more samples
       sampleCount num;
+      const float *samples = temp;
+      const char *mapped = NULL;
 
-      num = ((mBlock->Item(b)->f->GetLength() -
-              (srcX - mBlock->Item(b)->start)) + divisor - 1)
+      num = ((mBlock->Item(b).f->GetLength() -
+              (srcX - mBlock->Item(b).start)) + divisor - 1)
          / divisor;
 
       if (num > (s1 - srcX + divisor - 1) / divisor)
@@ -1297,17 +1656,23 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
       switch (divisor) {
       default:
       case 1:
-         Read((samplePtr)temp, floatSample, mBlock->Item(b),
-              srcX - mBlock->Item(b)->start, num);
+         // Use the block file's samples in place if we can
+         mapped = mBlock->Item(b).f->AcquireMappedData(floatSample,
+                     srcX - mBlock->Item(b).start, num);
+         if (mapped)
+            samples = (const float *)mapped;
+         else
+            Read((samplePtr)temp, floatSample, mBlock->Item(b),
+                 srcX - mBlock->Item(b).start, num);
 
          blockStatus=b;
          break;
       case 256:
          //check to see if summary data has been computed
-         if(mBlock->Item(b)->f->IsSummaryAvailable())
+         if(mBlock->Item(b).f->IsSummaryAvailable())
          {
-            mBlock->Item(b)->f->Read256(temp,
-                 (srcX - mBlock->Item(b)->start) / divisor, num);
+            mBlock->Item(b).f->Read256(temp,
+                 (srcX - mBlock->Item(b).start) / divisor, num);
             blockStatus=b;
          }
          else
@@ -1318,10 +1683,10 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
          break;
       case 65536:
          //check to see if summary data has been computed
-         if(mBlock->Item(b)->f->IsSummaryAvailable())
+         if(mBlock->Item(b).f->IsSummaryAvailable())
          {
-            mBlock->Item(b)->f->Read64K(temp,
-                 (srcX - mBlock->Item(b)->start) / divisor, num);
+            mBlock->Item(b).f->Read64K(temp,
+                 (srcX - mBlock->Item(b).start) / divisor, num);
             blockStatus=b;
          }
          else
@@ -1340,8 +1705,8 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
             theMax = temp[1];
          }
          else {
-            theMin = temp[0];
-            theMax = temp[0];
+            theMin = samples[0];
+            theMax = samples[0];
          }
          sumsq = float(0.0);
          jcount = 0;
@@ -1379,11 +1744,11 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
          default:
          case 1:
             while (x < stop) {
-               if (temp[x] < theMin)
-                  theMin = temp[x];
-               if (temp[x] > theMax)
-                  theMax = temp[x];
-               sumsq += ((float)temp[x]) * ((float)temp[x]);
+               if (samples[x] < theMin)
+                  theMin = samples[x];
+               if (samples[x] > theMax)
+                  theMax = samples[x];
+               sumsq += ((float)samples[x]) * ((float)samples[x]);
                x++;
                jcount++;
             }
@@ -1404,6 +1769,9 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
          }
       }
 
+      if (mapped)
+         mBlock->Item(b).f->ReleaseMappedData(mapped);
+
       b++;
 
       srcX += num * divisor;
@@ -1411,7 +1779,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
       if (b >= mBlock->GetCount())
          break;
 
-      srcX = mBlock->Item(b)->start;
+      srcX = mBlock->Item(b).start;
 
    }
 
@@ -1441,6 +1809,38 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms,int* bl,
    return true;
 }
 
+bool Sequence::GetWaveDisplayFromPyramid(float *min, float *max, float *rms,
+                                         int* bl, int len, sampleCount *where)
+{
+   // Each pixel spans at least one 64K summary frame, so it can be
+   // answered from the pyramid without walking the blocks in between.
+   float theMin = 0.0;
+   float theMax = 0.0;
+   float theRMS = 0.0;
+   int blockStatus = 1;
+
+   for (int pixel = 0; pixel < len; pixel++) {
+      sampleCount p0 = where[pixel];
+      sampleCount p1 = where[pixel + 1];
+      if (p0 < 0)
+         p0 = 0;
+      if (p1 > mNumSamples)
+         p1 = mNumSamples;
+
+      // Pixels past the end repeat the last values, as the block walk does
+      if (p1 > p0)
+         mPyramid->GetSummary(*mBlock, p0, p1,
+                              &theMin, &theMax, &theRMS, &blockStatus);
+
+      min[pixel] = theMin;
+      max[pixel] = theMax;
+      rms[pixel] = theRMS;
+      bl[pixel] = blockStatus;
+   }
+
+   return true;
+}
+
 sampleCount Sequence::GetIdealAppendLen()
 {
    int numBlocks = mBlock->GetCount();
@@ -1450,7 +1850,7 @@ sampleCount Sequence::GetIdealAppendLen()
    if (numBlocks == 0)
       return max;
 
-   lastBlockLen = mBlock->Item(numBlocks-1)->f->GetLength();
+   lastBlockLen = mBlock->Item(numBlocks-1).f->GetLength();
    if (lastBlockLen == max)
       return max;
    else
@@ -1460,45 +1860,46 @@ sampleCount Sequence::GetIdealAppendLen()
 bool Sequence::Append(samplePtr buffer, sampleFormat format,
                       sampleCount len, XMLWriter* blockFileLog /*=NULL*/)
 {
+   ODLocker locker(mDeleteUpdateMutex);
+
    // Quick check to make sure that it doesn't overflow
    if (((double)mNumSamples) + ((double)len) > wxLL(9223372036854775807))
       return false;
 
+   MakeBlocksUnique();
+
    // If the last block is not full, we need to add samples to it
    int numBlocks = mBlock->GetCount();
-   if (numBlocks > 0 && mBlock->Item(numBlocks - 1)->f->GetLength() < mMinSamples) {
-      SeqBlock *lastBlock = mBlock->Item(numBlocks - 1);
+   if (numBlocks > 0 && mBlock->Item(numBlocks - 1).f->GetLength() < mMinSamples) {
+      SeqBlock lastBlock = mBlock->Item(numBlocks - 1);
       sampleCount addLen;
-      if (lastBlock->f->GetLength() + len < mMaxSamples)
+      if (lastBlock.f->GetLength() + len < mMaxSamples)
          addLen = len;
       else
-         addLen = GetIdealBlockSize() - lastBlock->f->GetLength();
-
-      SeqBlock *newLastBlock = new SeqBlock();
+         addLen = GetIdealBlockSize() - lastBlock.f->GetLength();
 
-      samplePtr buffer2 = NewSamples((lastBlock->f->GetLength() + addLen), mSampleFormat);
-      Read(buffer2, mSampleFormat, lastBlock, 0, lastBlock->f->GetLength());
+      samplePtr buffer2 = NewSamples((lastBlock.f->GetLength() + addLen), mSampleFormat);
+      Read(buffer2, mSampleFormat, lastBlock, 0, lastBlock.f->GetLength());
 
       CopySamples(buffer,
                   format,
-                  buffer2 + lastBlock->f->GetLength() * SAMPLE_SIZE(mSampleFormat),
+                  buffer2 + lastBlock.f->GetLength() * SAMPLE_SIZE(mSampleFormat),
                   mSampleFormat,
                   addLen);
 
-      newLastBlock->start = lastBlock->start;
-      int newLastBlockLen = lastBlock->f->GetLength() + addLen;
+      int newLastBlockLen = lastBlock.f->GetLength() + addLen;
 
-      newLastBlock->f =
+      BlockFile *newLastBlock =
          mDirManager->NewSimpleBlockFile(buffer2, newLastBlockLen, mSampleFormat,
                                          blockFileLog != NULL);
       if (blockFileLog)
-         ((SimpleBlockFile*)newLastBlock->f)->SaveXML(*blockFileLog);
+         ((SimpleBlockFile*)newLastBlock)->SaveXML(*blockFileLog);
 
       DeleteSamples(buffer2);
 
-      mDirManager->Deref(lastBlock->f);
-      delete lastBlock;
-      mBlock->Item(numBlocks - 1) = newLastBlock;
+      mDirManager->Deref(lastBlock.f);
+      mBlock->Replace(numBlocks - 1, newLastBlock);
+      mPyramid->Splice(numBlocks - 1, 1, 1);
 
       len -= addLen;
       mNumSamples += addLen;
@@ -1523,21 +1924,20 @@ bool Sequence::Append(samplePtr buffer, sampleFormat format,
    while (len) {
       sampleCount idealSamples = GetIdealBlockSize();
       sampleCount l = (len > idealSamples ? idealSamples : len);
-      SeqBlock *w = new SeqBlock();
-      w->start = mNumSamples;
+      BlockFile *w;
 
       if (format == mSampleFormat) {
-         w->f = mDirManager->NewSimpleBlockFile(buffer, l, mSampleFormat,
-                                                blockFileLog != NULL);
+         w = mDirManager->NewSimpleBlockFile(buffer, l, mSampleFormat,
+                                             blockFileLog != NULL);
       }
       else {
          CopySamples(buffer, format, temp, mSampleFormat, l);
-         w->f = mDirManager->NewSimpleBlockFile(temp, l, mSampleFormat,
-                                                blockFileLog != NULL);
+         w = mDirManager->NewSimpleBlockFile(temp, l, mSampleFormat,
+                                             blockFileLog != NULL);
       }
 
       if (blockFileLog)
-         ((SimpleBlockFile*)w->f)->SaveXML(*blockFileLog);
+         ((SimpleBlockFile*)w)->SaveXML(*blockFileLog);
 
       mBlock->Add(w);
 
@@ -1564,20 +1964,14 @@ BlockArray *Sequence::Blockify(samplePtr buffer, sampleCount len)
    if (len <= 0)
       return list;
 
-   list->Alloc(10);
-
    int num = (len + (mMaxSamples - 1)) / mMaxSamples;
 
    for (int i = 0; i < num; i++) {
-      SeqBlock *b = new SeqBlock();
-
-      b->start = i * len / num;
-      int newLen = ((i + 1) * len / num) - b->start;
-      samplePtr bufStart = buffer + (b->start * SAMPLE_SIZE(mSampleFormat));
+      sampleCount start = i * len / num;
+      int newLen = ((i + 1) * len / num) - start;
+      samplePtr bufStart = buffer + (start * SAMPLE_SIZE(mSampleFormat));
 
-      b->f = mDirManager->NewSimpleBlockFile(bufStart, newLen, mSampleFormat);
-
-      list->Add(b);
+      list->Add(mDirManager->NewSimpleBlockFile(bufStart, newLen, mSampleFormat));
    }
 
    return list;
@@ -1597,8 +1991,9 @@ bool Sequence::Delete(sampleCount start, sampleCount len)
    //both functions,
    LockDeleteUpdateMutex();
 
+   MakeBlocksUnique();
+
    unsigned int numBlocks = mBlock->GetCount();
-   unsigned int newNumBlocks = 0;
 
    unsigned int b0 = FindBlock(start);
    unsigned int b1 = FindBlock(start + len - 1);
@@ -1608,10 +2003,10 @@ bool Sequence::Delete(sampleCount start, sampleCount len)
    // Special case: if the samples to delete are all within a single
    // block and the resulting length is not too small, perform the
    // deletion within this block:
-   if (b0 == b1 && mBlock->Item(b0)->f->GetLength() - len >= mMinSamples) {
-      SeqBlock *b = mBlock->Item(b0);
-      sampleCount pos = start - b->start;
-      sampleCount newLen = b->f->GetLength() - len;
+   if (b0 == b1 && mBlock->Item(b0).f->GetLength() - len >= mMinSamples) {
+      SeqBlock b = mBlock->Item(b0);
+      sampleCount pos = start - b.start;
+      sampleCount newLen = b.f->GetLength() - len;
 
       samplePtr buffer = NewSamples(newLen, mSampleFormat);
 
@@ -1619,68 +2014,51 @@ bool Sequence::Delete(sampleCount start, sampleCount len)
       Read(buffer + (pos * sampleSize), mSampleFormat,
            b, pos + len, newLen - pos);
 
-      SeqBlock *newBlock = new SeqBlock();
-      newBlock->start = b->start;
-      newBlock->f =
+      BlockFile *newBlock =
          mDirManager->NewSimpleBlockFile(buffer, newLen, mSampleFormat);
 
-      mBlock->Item(b0) = newBlock;
-
-      for (unsigned int j = b0 + 1; j < numBlocks; j++)
-         mBlock->Item(j)->start -= len;
+      mBlock->Replace(b0, newBlock);
 
       DeleteSamples(buffer);
 
-      mDirManager->Deref(b->f);
-      delete b;
+      mDirManager->Deref(b.f);
 
       mNumSamples -= len;
+      mPyramid->Splice(b0, 1, 1);
       UnlockDeleteUpdateMutex();
 
       return ConsistencyCheck(wxT("Delete - branch one"));
    }
 
-   // Create a new array of blocks
+   // Gather the blocks that take the place of blocks b0 through b1
+   // in a new array.  The blocks before and after those stay where
+   // they are.
    BlockArray *newBlock = new BlockArray();
-   newBlock->Alloc(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the new array
+   unsigned int first = b0;
    unsigned int i;
-   for (i = 0; i < b0; i++) {
-      newBlock->Add(mBlock->Item(i));
-      newNumBlocks++;
-   }
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
    // or if this would be the first block in the array, write it out.
    // Otherwise combine it with the previous block (splitting them
    // 50/50 if necessary).
-   SeqBlock *preBlock = mBlock->Item(b0);
-   sampleCount preBufferLen = start - preBlock->start;
+   SeqBlock preBlock = mBlock->Item(b0);
+   sampleCount preBufferLen = start - preBlock.start;
    if (preBufferLen) {
       if (preBufferLen >= mMinSamples || b0 == 0) {
-         SeqBlock *insBlock = new SeqBlock();
-
-         insBlock->start = preBlock->start;
-
          samplePtr preBuffer = NewSamples(preBufferLen, mSampleFormat);
          Read(preBuffer, mSampleFormat, preBlock, 0, preBufferLen);
-         insBlock->f =
+         BlockFile *insBlock =
             mDirManager->NewSimpleBlockFile(preBuffer, preBufferLen, mSampleFormat);
          DeleteSamples(preBuffer);
 
          newBlock->Add(insBlock);
-         newNumBlocks++;
 
-         if (b0 != b1) {
-            mDirManager->Deref(preBlock->f);
-            delete preBlock;
-         }
+         if (b0 != b1)
+            mDirManager->Deref(preBlock.f);
       } else {
-         SeqBlock *prepreBlock = mBlock->Item(b0 - 1);
-         sampleCount prepreLen = prepreBlock->f->GetLength();
+         SeqBlock prepreBlock = mBlock->Item(b0 - 1);
+         sampleCount prepreLen = prepreBlock.f->GetLength();
          sampleCount sum = prepreLen + preBufferLen;
 
          samplePtr sumBuffer = NewSamples(sum, mSampleFormat);
@@ -1689,115 +2067,87 @@ bool Sequence::Delete(sampleCount start, sampleCount len)
          Read(sumBuffer + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen);
 
+         // These replace the previous block too
          BlockArray *split = Blockify(sumBuffer, sum);
-         split->Item(0)->start += prepreBlock->start;
-         newBlock->Item(b0 - 1) = split->Item(0);
-         for (i = 1; i < split->GetCount(); i++) {
-            split->Item(i)->start += prepreBlock->start;
-            newBlock->Add(split->Item(i));
-            newNumBlocks++;
-         }
+         newBlock->InsertArray(newBlock->GetCount(), *split);
          delete split;
+         first = b0 - 1;
 
          DeleteSamples(sumBuffer);
 
-         mDirManager->Deref(prepreBlock->f);
-         delete prepreBlock;
+         mDirManager->Deref(prepreBlock.f);
 
-         if (b0 != b1) {
-            mDirManager->Deref(preBlock->f);
-            delete preBlock;
-         }
+         if (b0 != b1)
+            mDirManager->Deref(preBlock.f);
       }
    } else {
       // The sample where we begin deletion happens to fall
       // right on the beginning of a block.
-      if (b0 != b1) {
-         mDirManager->Deref(mBlock->Item(b0)->f);
-         delete mBlock->Item(b0);
-      }
+      if (b0 != b1)
+         mDirManager->Deref(mBlock->Item(b0).f);
    }
 
    // Next, delete blocks strictly between b0 and b1
-   for (i = b0 + 1; i < b1; i++) {
-      mDirManager->Deref(mBlock->Item(i)->f);
-      delete mBlock->Item(i);
-   }
+   for (i = b0 + 1; i < b1; i++)
+      mDirManager->Deref(mBlock->Item(i).f);
 
    // Now, symmetrically, grab the samples in block b1 after the
    // deletion point into postBuffer.  If this is enough samples
    // for its own block, or if this would be the last block in
    // the array, write it out.  Otherwise combine it with the
    // subsequent block (splitting them 50/50 if necessary).
-   SeqBlock *postBlock = mBlock->Item(b1);
+   SeqBlock postBlock = mBlock->Item(b1);
    sampleCount postBufferLen =
-       (postBlock->start + postBlock->f->GetLength()) - (start + len);
+       (postBlock.start + postBlock.f->GetLength()) - (start + len);
    if (postBufferLen) {
       if (postBufferLen >= mMinSamples || b1 == numBlocks - 1) {
-         SeqBlock *insBlock = new SeqBlock();
-
-         insBlock->start = start;
-
          samplePtr postBuffer = NewSamples(postBufferLen, mSampleFormat);
-         sampleCount pos = (start + len) - postBlock->start;
+         sampleCount pos = (start + len) - postBlock.start;
          Read(postBuffer, mSampleFormat, postBlock, pos, postBufferLen);
-         insBlock->f =
+         BlockFile *insBlock =
             mDirManager->NewSimpleBlockFile(postBuffer, postBufferLen, mSampleFormat);
 
          DeleteSamples(postBuffer);
 
          newBlock->Add(insBlock);
-         newNumBlocks++;
 
-         mDirManager->Deref(postBlock->f);
-         delete postBlock;
+         mDirManager->Deref(postBlock.f);
       } else {
-         SeqBlock *postpostBlock = mBlock->Item(b1 + 1);
-         sampleCount postpostLen = postpostBlock->f->GetLength();
+         SeqBlock postpostBlock = mBlock->Item(b1 + 1);
+         sampleCount postpostLen = postpostBlock.f->GetLength();
          sampleCount sum = postpostLen + postBufferLen;
 
          samplePtr sumBuffer = NewSamples(sum, mSampleFormat);
-         sampleCount pos = (start + len) - postBlock->start;
+         sampleCount pos = (start + len) - postBlock.start;
          Read(sumBuffer, mSampleFormat, postBlock, pos, postBufferLen);
          Read(sumBuffer + (postBufferLen * sampleSize), mSampleFormat,
               postpostBlock, 0, postpostLen);
 
          BlockArray *split = Blockify(sumBuffer, sum);
-         for (i = 0; i < split->GetCount(); i++) {
-            split->Item(i)->start += start;
-            newBlock->Add(split->Item(i));
-            newNumBlocks++;
-         }
+         newBlock->InsertArray(newBlock->GetCount(), *split);
          delete split;
          b1++;
 
          DeleteSamples(sumBuffer);
 
-         mDirManager->Deref(postpostBlock->f);
-         delete postpostBlock;
-         mDirManager->Deref(postBlock->f);
-         delete postBlock;
+         mDirManager->Deref(postpostBlock.f);
+         mDirManager->Deref(postBlock.f);
       }
    } else {
       // The sample where we begin deletion happens to fall
       // right on the end of a block.
-      mDirManager->Deref(mBlock->Item(b1)->f);
-      delete mBlock->Item(b1);
-   }
-
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++) {
-      mBlock->Item(i)->start -= len;
-      newBlock->Add(mBlock->Item(i));
-      newNumBlocks++;
+      mDirManager->Deref(mBlock->Item(b1).f);
    }
 
-   // Substitute our new array for the old one
-   delete mBlock;
-   mBlock = newBlock;
+   // Substitute the new blocks for the old ones
+   int numNew = newBlock->GetCount();
+   mBlock->RemoveAt(first, b1 - first + 1);
+   mBlock->InsertArray(first, *newBlock);
+   delete newBlock;
 
    // Update total number of samples and do a consistency check.
    mNumSamples -= len;
+   mPyramid->Splice(first, b1 - first + 1, numNew);
 
    UnlockDeleteUpdateMutex();
    return ConsistencyCheck(wxT("Delete - branch two"));
@@ -1805,23 +2155,15 @@ bool Sequence::Delete(sampleCount start, sampleCount len)
 
 bool Sequence::ConsistencyCheck(const wxChar *whereStr)
 {
-   unsigned int i;
-   sampleCount pos = 0;
-   unsigned int numBlocks = mBlock->GetCount();
-   bool bError = false;
-
-   for (i = 0; i < numBlocks; i++) {
-      SeqBlock* pSeqBlock = mBlock->Item(i);
-      if (pos != pSeqBlock->start)
-         bError = true;
+   // The tree keeps the starts of the blocks in step with their lengths,
+   // so its total is all there is to check after each edit
+   bool bError = (mBlock->GetNumSamples() != mNumSamples);
 
-      if (pSeqBlock->f)
-         pos += mBlock->Item(i)->f->GetLength();
-      else
-         bError = true;
-   }
-   if (pos != mNumSamples)
+#ifdef __WXDEBUG__
+   // Only debug builds walk the whole tree, which costs O(n) per edit
+   if (!mBlock->IsConsistent())
       bError = true;
+#endif
 
    if (bError)
    {
@@ -1841,26 +2183,26 @@ void Sequence::DebugPrintf(wxString *dest)
    int pos = 0;
 
    for (i = 0; i < mBlock->GetCount(); i++) {
-      SeqBlock* pSeqBlock = mBlock->Item(i);
+      SeqBlock seqBlock = mBlock->Item(i);
       *dest += wxString::Format
          (wxT("   Block %3u: start %8lld, len %8lld, refs %d, "),
           i,
-          (long long) pSeqBlock->start,
-          pSeqBlock->f ? (long long) pSeqBlock->f->GetLength() : 0,
-          pSeqBlock->f ? mDirManager->GetRefCount(pSeqBlock->f) : 0);
+          (long long) seqBlock.start,
+          seqBlock.f ? (long long) seqBlock.f->GetLength() : 0,
+          seqBlock.f ? mDirManager->GetRefCount(seqBlock.f) : 0);
 
-      if (pSeqBlock->f)
-         *dest += pSeqBlock->f->GetFileName().GetFullName();
+      if (seqBlock.f)
+         *dest += seqBlock.f->GetFileName().GetFullName();
       else
          *dest += wxT("<missing block file>");
 
-      if ((pos != pSeqBlock->start) || !pSeqBlock->f)
+      if ((pos != seqBlock.start) || !seqBlock.f)
          *dest += wxT("      ERROR\n");
       else
          *dest += wxT("\n");
 
-      if (pSeqBlock->f)
-         pos += pSeqBlock->f->GetLength();
+      if (seqBlock.f)
+         pos += seqBlock.f->GetLength();
    }
    if (pos != mNumSamples)
       *dest += wxString::Format
@@ -1880,13 +2222,38 @@ int Sequence::GetMaxDiskBlockSize()
 
 void Sequence::AppendBlockFile(BlockFile* blockFile)
 {
-   SeqBlock *w = new SeqBlock();
-   w->start = mNumSamples;
-   w->f = blockFile;
-   mBlock->Add(w);
+   // The display workers read mBlock under this lock
+   ODLocker locker(mDeleteUpdateMutex);
+
+   MakeBlocksUnique();
+
+   mBlock->Add(blockFile);
    mNumSamples += blockFile->GetLength();
 
 #ifdef VERY_SLOW_CHECKING
    ConsistencyCheck(wxT("AppendBlockFile"));
 #endif
 }
+
+bool Sequence::ReplaceBlockFiles(int first, BlockFile **files, int count)
+{
+   ODLocker locker(mDeleteUpdateMutex);
+
+   if (first < 0 || first + count > (int)mBlock->GetCount()) {
+      for (int i = 0; i < count; i++)
+         mDirManager->Deref(files[i]);
+      return false;
+   }
+
+   MakeBlocksUnique();
+
+   for (int i = 0; i < count; i++) {
+      BlockFile *oldBlockFile = mBlock->Item(first + i).f;
+      mBlock->SetFile(first + i, files[i]);
+      mDirManager->Deref(oldBlockFile);
+   }
+
+   mPyramid->InvalidateBlocks(first, first + count);
+
+   return ConsistencyCheck(wxT("ReplaceBlockFiles"));
+}
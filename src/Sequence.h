@@ -14,6 +14,7 @@
 #include <wx/string.h>
 #include <wx/dynarray.h>
 
+#include "BlockArray.h"
 #include "SampleFormat.h"
 #include "xml/XMLTagHandler.h"
 #include "xml/XMLWriter.h"
@@ -29,15 +30,8 @@ typedef wxLongLong_t sampleCount; /** < A native 64-bit integer type, because
 
 class BlockFile;
 class DirManager;
-
-// This is an internal data structure!  For advanced use only.
-class SeqBlock {
- public:
-   BlockFile * f;
-   ///the sample in the global wavetrack that this block starts at.
-   sampleCount start;
-};
-WX_DEFINE_ARRAY(SeqBlock *, BlockArray);
+class SummaryPyramid;
+class SharedBlockArray;
 
 class Sequence: public XMLTagHandler {
  public:
@@ -61,6 +55,8 @@ class Sequence: public XMLTagHandler {
    // The copy constructor and duplicate operators take a
    // DirManager as a parameter, because you might be copying
    // from one project to another...
+   // A copy within the same project shares the block array of the
+   // original until either of them changes it, so it is cheap to make.
    Sequence(const Sequence &orig, DirManager *projDirManager);
    Sequence *Duplicate(DirManager *projDirManager) const {
       return new Sequence(*this, projDirManager);
@@ -108,6 +104,15 @@ class Sequence: public XMLTagHandler {
    // loaded from an XML file via DirManager::HandleXMLTag
    void AppendBlockFile(BlockFile* blockFile);
 
+   // Put the count BlockFiles in files in place of those of blocks first,
+   // first + 1, ..., releasing the old ones.  Each must be the same length
+   // as the one it replaces and, as for AppendBlockFile(), already be
+   // registered within the dir manager.  The sequence takes over the
+   // reference to each of them, and Derefs them if it returns false
+   // without using them.  WaveTrackWriter uses this to swap in the
+   // blocks it made on other threads all at once.
+   bool ReplaceBlockFiles(int first, BlockFile **files, int count);
+
    bool SetSilence(sampleCount s0, sampleCount len);
    bool InsertSilence(sampleCount s0, sampleCount len);
 
@@ -152,6 +157,20 @@ class Sequence: public XMLTagHandler {
    bool GetRMS(sampleCount start, sampleCount len,
                   float * outRMS) const;
 
+   /// The first sample in [start, start + len) whose absolute value is
+   /// at least level, or start + len if there is none.  Blocks and
+   /// 256-sample frames whose summaries show they are quieter than
+   /// level are passed over without reading them.
+   sampleCount FindAbove(sampleCount start, sampleCount len,
+                         float level) const;
+   /// The start of the first run of samples in [start, start + len)
+   /// whose absolute values are all below level, and which is at least
+   /// minLen long or reaches start + len; or start + len if there is
+   /// none.  When minLen is more than two frames long, only the frames
+   /// where such a run could begin or end are read.
+   sampleCount FindQuiet(sampleCount start, sampleCount len,
+                         float level, sampleCount minLen) const;
+
    //
    // Getting block size information
    //
@@ -165,7 +184,13 @@ class Sequence: public XMLTagHandler {
    // you're doing!
    //
 
-   BlockArray *GetBlockArray() {return mBlock;}
+   // The array returned by GetBlockArray() belongs to this sequence
+   // alone and may be changed; GetBlocks() may return an array that
+   // other copies of the sequence share, and the same pointer for all
+   // of them.
+
+   BlockArray *GetBlockArray() { MakeBlocksUnique(); return mBlock; }
+   const BlockArray *GetBlocks() const { return mBlock; }
 
    ///
    void LockDeleteUpdateMutex(){mDeleteUpdateMutex.Lock();}
@@ -185,7 +210,14 @@ class Sequence: public XMLTagHandler {
 
    DirManager   *mDirManager;
 
+   ///The block array and summary pyramid, possibly shared with copies
+   ///of this sequence; mBlock and mPyramid point into it
+   SharedBlockArray *mShared;
+
    BlockArray   *mBlock;
+   ///Blocks read from a project file, which go into mBlock once they
+   ///all have their BlockFiles
+   SeqBlockList  mLoadingBlocks;
    sampleFormat  mSampleFormat;
    sampleCount   mNumSamples;
 
@@ -194,7 +226,12 @@ class Sequence: public XMLTagHandler {
 
    bool          mErrorOpening;
 
-   ///To block the Delete() method against the ODCalcSummaryTask::Update() method
+   ///Min/max/RMS summaries spanning blocks, for zoomed-out display
+   SummaryPyramid *mPyramid;
+
+   ///To block Delete() and the other methods that change the block array
+   ///against readers on other threads, such as ODCalcSummaryTask::Update()
+   ///and the waveform tile renderer
    ODLock   mDeleteUpdateMutex;
 
    //
@@ -203,19 +240,30 @@ class Sequence: public XMLTagHandler {
 
    void CalcSummaryInfo();
 
+   // Call before changing mBlock, so that copies sharing it are not
+   // changed too
+   void MakeBlocksUnique();
+   void ReleaseBlocks();
+   // Replaces the array, but does not Deref its files, which the
+   // caller manages
+   void SetBlockArray(BlockArray *newBlock);
+
    int FindBlock(sampleCount pos) const;
-   int FindBlock(sampleCount pos, sampleCount lo,
-                 sampleCount guess, sampleCount hi) const;
 
-   bool AppendBlock(SeqBlock *b);
+   bool AppendBlock(const SeqBlock &b);
 
    bool Read(samplePtr buffer, sampleFormat format,
-             SeqBlock * b,
+             const SeqBlock &b,
              sampleCount start, sampleCount len) const;
 
+   // GetWaveDisplay for pixels spanning at least one 64K summary frame
+   bool GetWaveDisplayFromPyramid(float *min, float *max, float *rms, int* bl,
+                                  int len, sampleCount *where);
+
    // These are the two ways to write data to a block
    bool FirstWrite(samplePtr buffer, SeqBlock * b, sampleCount len);
-   bool CopyWrite(samplePtr buffer, SeqBlock * b,
+   // Replaces the file of block b
+   bool CopyWrite(samplePtr buffer, int b,
                   sampleCount start, sampleCount len);
 
    // Both block-writing methods and AppendAlias call this
@@ -0,0 +1,566 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramCache.cpp
+
+*******************************************************************//**
+
+\file SpectrogramCache.cpp
+\brief Implements class SpectrogramCache.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "SpectrogramCache.h"
+#include "FFT.h"
+#include "Prefs.h"
+#include "Project.h"
+#include "Sequence.h"
+#include "Spectrum.h"
+#include "ThreadPool.h"
+#include "WaveClip.h"
+#include "ondemand/ODManager.h"
+
+// Bytes of columns to keep
+static const size_t kBudget = 64 << 20;
+
+// Requests beyond this many are dropped, oldest first; they are made
+// again by the next repaint if the columns are still on screen
+static const size_t kMaxRequests = 256;
+
+// Ask for a repaint after this many chunks even if more are queued
+static const int kChunksPerRepaint = 8;
+
+// Drawn as the bottom of the colour scale
+static const float kBlankValue = -1000.0;
+
+SpectrogramCache SpectrogramCache::sInstance;
+
+class SpectrogramJob : public ThreadPoolJob
+{
+ public:
+   virtual void Run()
+   {
+      SpectrogramCache::Get().RenderNext();
+   }
+};
+
+SpectrogramCache::Analysis::Analysis(int size, int type)
+{
+   windowSize = size;
+   windowType = type;
+   hFFT = InitializeFFT(windowSize);
+
+   // Scale the window function to give 0dB spectrum for 0dB sine tone,
+   // as WaveClip::GetSpectrogram() does
+   window = new float[windowSize];
+   int i;
+   for (i = 0; i < windowSize; i++)
+      window[i] = 1.0;
+   WindowFunc(windowType, windowSize, window);
+   double ws = 0;
+   for (i = 0; i < windowSize; i++)
+      ws += window[i];
+   if (ws > 0) {
+      ws = 2.0 / ws;
+      for (i = 0; i < windowSize; i++)
+         window[i] *= ws;
+   }
+}
+
+SpectrogramCache::Analysis::~Analysis()
+{
+   EndFFT(hFFT);
+   delete[] window;
+}
+
+bool SpectrogramCache::ChunkKey::operator<(const ChunkKey &other) const
+{
+   if (clip != other.clip)
+      return clip < other.clip;
+   if (windowSize != other.windowSize)
+      return windowSize < other.windowSize;
+   if (windowType != other.windowType)
+      return windowType < other.windowType;
+   if (level != other.level)
+      return level < other.level;
+   return index < other.index;
+}
+
+SpectrogramCache &SpectrogramCache::Get()
+{
+   return sInstance;
+}
+
+SpectrogramCache::SpectrogramCache()
+{
+   mHead = NULL;
+   mTail = NULL;
+   mBytes = 0;
+   mGeneration = 0;
+   mRenderedSinceRepaint = 0;
+   mRenderedCondition = new ODCondition(&mLock);
+}
+
+SpectrogramCache::~SpectrogramCache()
+{
+   while (mHead)
+      Remove(mHead);
+
+   AnalysisMap::iterator iter;
+   for (iter = mAnalyses.begin(); iter != mAnalyses.end(); ++iter)
+      delete iter->second;
+
+   delete mRenderedCondition;
+}
+
+bool SpectrogramCache::GetSpectrogram(WaveClip *clip,
+                                      float *freq, sampleCount *where,
+                                      int numPixels, double t0,
+                                      double pixelsPerSecond,
+                                      bool autocorrelation)
+{
+   bool useClip = !ThreadPool::Get() || autocorrelation;
+#ifdef EXPERIMENTAL_FFT_SKIP_POINTS
+   if (gPrefs->Read(wxT("/Spectrum/FFTSkipPoints"), 0L) != 0)
+      useClip = true;
+#endif //EXPERIMENTAL_FFT_SKIP_POINTS
+   if (useClip)
+      return clip->GetSpectrogram(freq, where, numPixels,
+                                  t0, pixelsPerSecond, autocorrelation);
+
+   int minFreq = gPrefs->Read(wxT("/Spectrum/MinFreq"), 0L);
+   int maxFreq = gPrefs->Read(wxT("/Spectrum/MaxFreq"), 8000L);
+   int range = gPrefs->Read(wxT("/Spectrum/Range"), 80L);
+   int gain = gPrefs->Read(wxT("/Spectrum/Gain"), 20L);
+   int frequencyGain = gPrefs->Read(wxT("/Spectrum/FrequencyGain"), 0L);
+   int windowType;
+   int windowSize = gPrefs->Read(wxT("/Spectrum/FFTSize"), 256);
+   gPrefs->Read(wxT("/Spectrum/WindowType"), &windowType, 3);
+   int half = windowSize / 2;
+
+   double rate = clip->GetRate();
+   int x;
+
+   // Purposely offset the display 1/2 bin to the left, as
+   // WaveClip::GetSpectrogram() does
+   for (x = 0; x < numPixels + 1; x++)
+      where[x] = (sampleCount)floor(t0 * rate + x * rate / pixelsPerSecond + 1.);
+
+   double samplesPerPixel = rate / pixelsPerSecond;
+   int level = 0;
+   while (level < 30 && (double)(2 << level) <= samplesPerPixel)
+      level++;
+
+   float *gainFactor = NULL;
+   if (frequencyGain > 0) {
+      // Scaled such that 1000 Hz gets a gain of 0dB
+      double factor = 0.001 * rate / windowSize;
+      gainFactor = new float[half];
+      for (int i = 0; i < half; i++)
+         gainFactor[i] = frequencyGain * log10(factor * i);
+   }
+
+   int dirty = clip->GetDirty();
+   bool complete = true;
+
+   mLock.Lock();
+
+   Analysis *analysis = GetAnalysis(windowSize, windowType);
+
+   ChunkKey key;
+   key.clip = clip;
+   key.windowSize = windowSize;
+   key.windowType = windowType;
+   key.level = level;
+   key.index = -1;
+   Chunk *chunk = NULL;
+
+   for (x = 0; x < numPixels; x++) {
+      sampleCount column = (where[x] + ((1 << level) >> 1)) >> level;
+      sampleCount index = column / kChunkColumns;
+      int offset = (int)(column % kChunkColumns);
+
+      // Neighbouring pixels usually share a chunk
+      if (index != key.index) {
+         key.index = index;
+         chunk = Find(key);
+         if (!chunk || chunk->dirty != dirty)
+            chunk = Request(key, analysis, dirty);
+         Unlink(chunk);
+         Link(chunk);
+      }
+
+      const float *src = NULL;
+      if (chunk->freq) {
+         src = chunk->freq + offset * half;
+         if (chunk->dirty != dirty)
+            complete = false;
+      }
+      else {
+         complete = false;
+
+         ChunkKey standInKey = key;
+         for (int l = level + 1; l <= level + kStandInLevels && !src; l++) {
+            sampleCount c = (where[x] + ((1 << l) >> 1)) >> l;
+            standInKey.level = l;
+            standInKey.index = c / kChunkColumns;
+            Chunk *standIn = Find(standInKey);
+            if (standIn && standIn->freq)
+               src = standIn->freq + (c % kChunkColumns) * half;
+         }
+      }
+
+      float *dst = &freq[half * x];
+      if (src) {
+         memcpy(dst, src, half * sizeof(float));
+         if (gainFactor)
+            for (int i = 0; i < half; i++)
+               dst[i] += gainFactor[i];
+      }
+      else {
+         for (int i = 0; i < half; i++)
+            dst[i] = kBlankValue;
+      }
+   }
+
+   Trim();
+
+   LastRequest request;
+   request.t0 = t0;
+   request.pixelsPerSecond = pixelsPerSecond;
+   request.numPixels = numPixels;
+   request.windowSize = windowSize;
+   request.windowType = windowType;
+   request.minFreq = minFreq;
+   request.maxFreq = maxFreq;
+   request.range = range;
+   request.gain = gain;
+   request.frequencyGain = frequencyGain;
+   request.generation = mGeneration;
+   request.complete = complete;
+
+   bool updated = true;
+   LastRequestMap::iterator iter = mLastRequests.find(clip);
+   if (iter != mLastRequests.end()) {
+      const LastRequest &last = iter->second;
+      updated = !(last.complete && complete &&
+                  last.generation == mGeneration &&
+                  last.t0 == t0 &&
+                  last.pixelsPerSecond == pixelsPerSecond &&
+                  last.numPixels == numPixels &&
+                  last.windowSize == windowSize &&
+                  last.windowType == windowType &&
+                  last.minFreq == minFreq &&
+                  last.maxFreq == maxFreq &&
+                  last.range == range &&
+                  last.gain == gain &&
+                  last.frequencyGain == frequencyGain);
+   }
+   mLastRequests[clip] = request;
+
+   mLock.Unlock();
+
+   delete[] gainFactor;
+
+   return updated;
+}
+
+void SpectrogramCache::Invalidate(WaveClip *clip,
+                                  sampleCount start, sampleCount end)
+{
+   mLock.Lock();
+
+   ChunkKey first;
+   first.clip = clip;
+   first.windowSize = 0;
+   first.windowType = 0;
+   first.level = 0;
+   first.index = 0;
+
+   ChunkMap::iterator iter = mChunks.lower_bound(first);
+   for (; iter != mChunks.end() && iter->first.clip == clip; ++iter) {
+      const ChunkKey &key = iter->first;
+      sampleCount column = key.index * kChunkColumns;
+      sampleCount s0 = (column << key.level) - key.windowSize / 2;
+      sampleCount s1 = ((column + kChunkColumns - 1) << key.level) +
+                       key.windowSize / 2;
+      if (s0 < end && s1 > start)
+         iter->second->dirty = -1;
+   }
+
+   mGeneration++;
+
+   mLock.Unlock();
+}
+
+void SpectrogramCache::Forget(WaveClip *clip)
+{
+   mLock.Lock();
+
+   ChunkKey first;
+   first.clip = clip;
+   first.windowSize = 0;
+   first.windowType = 0;
+   first.level = 0;
+   first.index = 0;
+
+   for (;;) {
+      bool rendering = false;
+
+      ChunkMap::iterator iter = mChunks.lower_bound(first);
+      while (iter != mChunks.end() && iter->first.clip == clip) {
+         Chunk *chunk = iter->second;
+         ++iter;
+         if (chunk->rendering)
+            rendering = true;
+         else
+            Remove(chunk);
+      }
+
+      if (!rendering)
+         break;
+
+      mRenderedCondition->Wait();
+   }
+
+   mLastRequests.erase(clip);
+
+   mLock.Unlock();
+}
+
+// Call with mLock held
+SpectrogramCache::Analysis *SpectrogramCache::GetAnalysis(int windowSize,
+                                                          int windowType)
+{
+   std::pair<int, int> key(windowSize, windowType);
+   AnalysisMap::iterator iter = mAnalyses.find(key);
+   if (iter != mAnalyses.end())
+      return iter->second;
+
+   Analysis *analysis = new Analysis(windowSize, windowType);
+   mAnalyses[key] = analysis;
+   return analysis;
+}
+
+// Call with mLock held
+SpectrogramCache::Chunk *SpectrogramCache::Find(const ChunkKey &key)
+{
+   ChunkMap::iterator iter = mChunks.find(key);
+   if (iter == mChunks.end())
+      return NULL;
+   return iter->second;
+}
+
+// Call with mLock held
+SpectrogramCache::Chunk *SpectrogramCache::Request(const ChunkKey &key,
+                                                   Analysis *analysis,
+                                                   int dirty)
+{
+   Chunk *chunk = Find(key);
+   if (!chunk) {
+      chunk = new Chunk;
+      chunk->key = key;
+      chunk->analysis = analysis;
+      chunk->dirty = -1;
+      chunk->requestedDirty = -1;
+      chunk->queued = false;
+      chunk->rendering = false;
+      chunk->freq = NULL;
+      Link(chunk);
+      mChunks[key] = chunk;
+   }
+
+   // A chunk being computed is looked at again by the repaint that
+   // follows, which requests it anew if it is still out of date
+   if (chunk->rendering)
+      return chunk;
+
+   chunk->requestedDirty = dirty;
+
+   if (chunk->queued) {
+      // Move it to the front of the line
+      mRequests.erase(std::find(mRequests.begin(), mRequests.end(), chunk));
+      mRequests.push_back(chunk);
+      return chunk;
+   }
+
+   chunk->queued = true;
+   mRequests.push_back(chunk);
+
+   if (mRequests.size() > kMaxRequests) {
+      mRequests.front()->queued = false;
+      mRequests.erase(mRequests.begin());
+   }
+
+   ThreadPool::Get()->Add(new SpectrogramJob());
+
+   return chunk;
+}
+
+void SpectrogramCache::RenderNext()
+{
+   mLock.Lock();
+
+   if (mRequests.empty()) {
+      mLock.Unlock();
+      return;
+   }
+
+   Chunk *chunk = mRequests.back();
+   mRequests.pop_back();
+   chunk->queued = false;
+   chunk->rendering = true;
+
+   ChunkKey key = chunk->key;
+   Analysis *analysis = chunk->analysis;
+   int dirty = chunk->requestedDirty;
+
+   mLock.Unlock();
+
+   // Forget() waits for us, so the clip stays alive until we are done
+   Sequence *sequence = key.clip->GetSequence();
+   int windowSize = key.windowSize;
+   int half = windowSize / 2;
+
+   float *freq = new float[kChunkColumns * half];
+   float *buffer = new float[windowSize];
+
+   for (int i = 0; i < kChunkColumns; i++) {
+      sampleCount start = (key.index * kChunkColumns + i) << key.level;
+      sampleCount len = windowSize;
+      float *out = &freq[half * i];
+
+      // Keep Delete() and the other editing methods out while we read
+      sequence->LockDeleteUpdateMutex();
+
+      sampleCount numSamples = sequence->GetNumSamples();
+      if (start <= 0 || start >= numSamples) {
+         sequence->UnlockDeleteUpdateMutex();
+         for (int j = 0; j < half; j++)
+            out[j] = 0;
+         continue;
+      }
+
+      float *adj = buffer;
+      start -= windowSize >> 1;
+
+      if (start < 0) {
+         for (sampleCount j = start; j < 0; j++)
+            *adj++ = 0;
+         len += start;
+         start = 0;
+      }
+      if (start + len > numSamples) {
+         sampleCount newLen = numSamples - start;
+         for (sampleCount j = newLen; j < len; j++)
+            adj[j] = 0;
+         len = newLen;
+      }
+
+      if (len > 0)
+         sequence->Get((samplePtr)adj, floatSample, start, len);
+
+      sequence->UnlockDeleteUpdateMutex();
+
+      ComputeSpectrumUsingRealFFTf(buffer, analysis->hFFT, analysis->window,
+                                   windowSize, out);
+   }
+
+   delete[] buffer;
+
+   mLock.Lock();
+
+   if (chunk->freq)
+      delete[] chunk->freq;
+   else
+      mBytes += kChunkColumns * half * sizeof(float);
+   chunk->freq = freq;
+   chunk->dirty = dirty;
+   chunk->rendering = false;
+   mGeneration++;
+   mRenderedCondition->Broadcast();
+
+   bool repaint = false;
+   mRenderedSinceRepaint++;
+   if (mRequests.empty() || mRenderedSinceRepaint >= kChunksPerRepaint) {
+      mRenderedSinceRepaint = 0;
+      repaint = true;
+   }
+
+   mLock.Unlock();
+
+   if (repaint)
+      RequestRepaint();
+}
+
+// Call with mLock held
+void SpectrogramCache::Link(Chunk *chunk)
+{
+   chunk->prev = NULL;
+   chunk->next = mHead;
+   if (mHead)
+      mHead->prev = chunk;
+   mHead = chunk;
+   if (!mTail)
+      mTail = chunk;
+}
+
+// Call with mLock held
+void SpectrogramCache::Unlink(Chunk *chunk)
+{
+   if (chunk->prev)
+      chunk->prev->next = chunk->next;
+   else
+      mHead = chunk->next;
+
+   if (chunk->next)
+      chunk->next->prev = chunk->prev;
+   else
+      mTail = chunk->prev;
+}
+
+// Call with mLock held; the chunk must not be rendering
+void SpectrogramCache::Remove(Chunk *chunk)
+{
+   if (chunk->queued)
+      mRequests.erase(std::find(mRequests.begin(), mRequests.end(), chunk));
+
+   if (chunk->freq) {
+      mBytes -= kChunkColumns * (chunk->key.windowSize / 2) * sizeof(float);
+      delete[] chunk->freq;
+   }
+
+   Unlink(chunk);
+   mChunks.erase(chunk->key);
+   delete chunk;
+}
+
+// Call with mLock held
+void SpectrogramCache::Trim()
+{
+   Chunk *chunk = mTail;
+   while (chunk && mBytes > kBudget) {
+      Chunk *prev = chunk->prev;
+      if (!chunk->queued && !chunk->rendering)
+         Remove(chunk);
+      chunk = prev;
+   }
+}
+
+void SpectrogramCache::RequestRepaint()
+{
+   // Same as ODManager does when on-demand tasks make progress
+   wxCommandEvent event(EVT_ODTASK_UPDATE);
+   AudacityProject::AllProjectsDeleteLock();
+   AudacityProject *proj = GetActiveProject();
+   if (proj)
+      proj->GetEventHandler()->AddPendingEvent(event);
+   AudacityProject::AllProjectsDeleteUnlock();
+}
@@ -0,0 +1,178 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrogramCache.h
+
+*******************************************************************//**
+
+\class SpectrogramCache
+\brief Computes spectrogram columns on the ThreadPool and keeps them
+   for reuse across scrolling, zooming and display preference changes.
+
+  Columns are computed at sample positions that are multiples of a hop
+  size, a power of two no larger than the number of samples per pixel,
+  rather than at the exact position of each pixel.  The columns for one
+  hop size therefore serve every zoom level up to twice as far out and
+  any scroll position.  Columns are grouped in chunks, keyed by clip,
+  FFT window, hop size and position, and are evicted least recently
+  used first.
+
+  The cache holds the spectrum in dB before the frequency gain, so only
+  changes to the window size or type need new columns; range, gain,
+  frequency gain and the frequency limits apply to what is kept.
+
+  GetSpectrogram() fills in what is ready and queues the rest.  Until a
+  column is ready, one at a larger hop size is shown if there is one,
+  so that zooming in sharpens the picture progressively; otherwise the
+  column is blank.  When the queue drains the projects are asked to
+  repaint.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SPECTROGRAM_CACHE__
+#define __AUDACITY_SPECTROGRAM_CACHE__
+
+#include <map>
+#include <vector>
+
+#include "RealFFTf.h"
+#include "SampleFormat.h"
+#include "ondemand/ODTaskThread.h"
+
+class WaveClip;
+
+class SpectrogramCache
+{
+ public:
+   static SpectrogramCache &Get();
+
+   /// Same contract as WaveClip::GetSpectrogram(): returns false if the
+   /// results are the same as last time for this clip.  Falls back to
+   /// WaveClip::GetSpectrogram() when there is no ThreadPool, and for
+   /// autocorrelation.
+   bool GetSpectrogram(WaveClip *clip, float *freq, sampleCount *where,
+                       int numPixels, double t0, double pixelsPerSecond,
+                       bool autocorrelation);
+
+   /// Samples [start, end) of the clip changed without a change to its
+   /// dirty count, as when on-demand loading completes.
+   void Invalidate(WaveClip *clip, sampleCount start, sampleCount end);
+
+   /// Drops all columns of the clip, waiting for any being computed.
+   /// Must be called before the clip is deleted.
+   void Forget(WaveClip *clip);
+
+ private:
+   SpectrogramCache();
+   ~SpectrogramCache();
+
+   enum {
+      kChunkColumns = 32,
+      // How many larger hop sizes to look at for a stand-in column
+      kStandInLevels = 4,
+   };
+
+   // The FFT tables and window function for one window size and type,
+   // shared read-only by the worker threads
+   class Analysis
+   {
+    public:
+      Analysis(int windowSize, int windowType);
+      ~Analysis();
+
+      int windowSize;
+      int windowType;
+      HFFT hFFT;
+      float *window;
+   };
+
+   class ChunkKey
+   {
+    public:
+      bool operator<(const ChunkKey &other) const;
+
+      WaveClip *clip;
+      int windowSize;
+      int windowType;
+      // The hop size is 1 << level samples
+      int level;
+      sampleCount index;
+   };
+
+   class Chunk
+   {
+    public:
+      ChunkKey key;
+      Analysis *analysis;
+
+      // Dirty count of the clip when the data was requested, or -1
+      int dirty;
+      int requestedDirty;
+      bool queued;
+      bool rendering;
+
+      // kChunkColumns columns of windowSize / 2 values, or NULL
+      float *freq;
+
+      // Least-recently-used list, most recent first
+      Chunk *prev;
+      Chunk *next;
+   };
+
+   // What was asked for last time, to tell whether anything changed
+   class LastRequest
+   {
+    public:
+      double t0;
+      double pixelsPerSecond;
+      int numPixels;
+      int windowSize;
+      int windowType;
+      int minFreq;
+      int maxFreq;
+      int range;
+      int gain;
+      int frequencyGain;
+      int generation;
+      bool complete;
+   };
+
+   typedef std::map<ChunkKey, Chunk *> ChunkMap;
+   typedef std::map<std::pair<int, int>, Analysis *> AnalysisMap;
+   typedef std::map<WaveClip *, LastRequest> LastRequestMap;
+
+   friend class SpectrogramJob;
+
+   Analysis *GetAnalysis(int windowSize, int windowType);
+   Chunk *Find(const ChunkKey &key);
+   Chunk *Request(const ChunkKey &key, Analysis *analysis, int dirty);
+   void RenderNext();
+   void Link(Chunk *chunk);
+   void Unlink(Chunk *chunk);
+   void Remove(Chunk *chunk);
+   void Trim();
+   void RequestRepaint();
+
+   ChunkMap mChunks;
+   Chunk *mHead;
+   Chunk *mTail;
+   size_t mBytes;
+
+   AnalysisMap mAnalyses;
+   LastRequestMap mLastRequests;
+
+   // Changes whenever any column is computed or invalidated
+   int mGeneration;
+
+   // Most recent requests last; they are served first
+   std::vector<Chunk *> mRequests;
+   int mRenderedSinceRepaint;
+
+   ODLock mLock;
+   ODCondition *mRenderedCondition;
+
+   static SpectrogramCache sInstance;
+};
+
+#endif // __AUDACITY_SPECTROGRAM_CACHE__
@@ -136,3 +136,28 @@ bool ComputeSpectrum(float * data, int width,
    return true;
 }
 
+void ComputeSpectrumUsingRealFFTf(float *buffer, HFFT hFFT, float *window, int len, float *out)
+{
+   int i;
+   if(len > hFFT->Points*2)
+      len = hFFT->Points*2;
+   for(i=0; i<len; i++)
+      buffer[i] *= window[i];
+   for( ; i<(hFFT->Points*2); i++)
+      buffer[i]=0; // zero pad as needed
+   RealFFTf(buffer, hFFT);
+   // Handle the (real-only) DC
+   float power = buffer[0]*buffer[0];
+   if(power <= 0)
+      out[0] = -160.0;
+   else
+      out[0] = 10.0*log10(power);
+   for(i=1;i<hFFT->Points;i++) {
+      power = (buffer[hFFT->BitReversed[i]  ]*buffer[hFFT->BitReversed[i]  ])
+            + (buffer[hFFT->BitReversed[i]+1]*buffer[hFFT->BitReversed[i]+1]);
+      if(power <= 0)
+         out[i] = -160.0;
+      else
+         out[i] = 10.0*log10f(power);
+   }
+}
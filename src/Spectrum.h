@@ -12,6 +12,7 @@
 #define __AUDACITY_SPECTRUM__
 
 #include "WaveTrack.h"
+#include "RealFFTf.h"
 
 /*
   This function computes the power (mean square amplitude) as
@@ -24,4 +25,14 @@
 bool ComputeSpectrum(float * data, int width, int windowSize,
                      double rate, float *out, bool autocorrelation, int windowFunc=3);
 
+/*
+  Computes the power spectrum in dB of one window of len samples using
+  the tables in hFFT, as the spectrogram display does.  buffer is
+  overwritten; window holds the (scaled) window function.  Safe to call
+  from several threads at once with the same hFFT and window.
+*/
+
+void ComputeSpectrumUsingRealFFTf(float *buffer, HFFT hFFT, float *window,
+                                  int len, float *out);
+
 #endif
@@ -0,0 +1,418 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SummaryPyramid.cpp
+
+*******************************************************************//**
+
+\file SummaryPyramid.cpp
+\brief Implements class SummaryPyramid.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "SummaryPyramid.h"
+#include "BlockFile.h"
+
+// Samples per summary frame at the coarsest on-disk level.
+static const sampleCount kFrameSize = 65536;
+
+// Indices [first, first + numRemoved) go away and those after them
+// move along by numInserted - numRemoved
+static void SpliceIndices(std::vector<int> &indices,
+                          int first, int numRemoved, int numInserted)
+{
+   size_t kept = 0;
+   for (size_t i = 0; i < indices.size(); i++) {
+      int index = indices[i];
+      if (index >= first + numRemoved)
+         indices[kept++] = index + numInserted - numRemoved;
+      else if (index < first)
+         indices[kept++] = index;
+   }
+   indices.resize(kept);
+}
+
+SummaryPyramid::Accumulator::Accumulator()
+{
+   min = FLT_MAX;
+   max = -FLT_MAX;
+   sumsq = 0.0;
+   len = 0;
+   lastBlock = -1;
+   missingBlock = -1;
+}
+
+void SummaryPyramid::Accumulator::Add(float nMin, float nMax,
+                                      double nSumsq, sampleCount nLen)
+{
+   if (nMin < min)
+      min = nMin;
+   if (nMax > max)
+      max = nMax;
+   sumsq += nSumsq;
+   len += nLen;
+}
+
+SummaryPyramid::SummaryPyramid()
+{
+   mFirstMoved = 0;
+}
+
+SummaryPyramid::~SummaryPyramid()
+{
+}
+
+SummaryPyramid *SummaryPyramid::Duplicate()
+{
+   SummaryPyramid *result = new SummaryPyramid();
+
+   mLock.Lock();
+   result->mLeaves = mLeaves;
+   result->mLevels = mLevels;
+   result->mDirty = mDirty;
+   result->mFirstMoved = mFirstMoved;
+   result->mPending = mPending;
+   mLock.Unlock();
+
+   return result;
+}
+
+void SummaryPyramid::Splice(int firstBlock, int numRemoved, int numInserted)
+{
+   mLock.Lock();
+
+   // Blocks past the known leaves are built when they are first queried
+   int numLeaves = mLeaves.size();
+   if (firstBlock < numLeaves) {
+      if (firstBlock + numRemoved > numLeaves)
+         numRemoved = numLeaves - firstBlock;
+
+      std::vector<Node> &nodes = mLevels[0];
+      mLeaves.erase(mLeaves.begin() + firstBlock,
+                    mLeaves.begin() + firstBlock + numRemoved);
+      mLeaves.insert(mLeaves.begin() + firstBlock, numInserted, Leaf());
+      nodes.erase(nodes.begin() + firstBlock,
+                  nodes.begin() + firstBlock + numRemoved);
+      nodes.insert(nodes.begin() + firstBlock, numInserted, Node());
+
+      SpliceIndices(mDirty, firstBlock, numRemoved, numInserted);
+      SpliceIndices(mPending, firstBlock, numRemoved, numInserted);
+      for (int b = firstBlock; b < firstBlock + numInserted; b++)
+         mDirty.push_back(b);
+
+      if (firstBlock < mFirstMoved)
+         mFirstMoved = firstBlock;
+   }
+
+   mLock.Unlock();
+}
+
+void SummaryPyramid::InvalidateBlocks(int block0, int block1)
+{
+   mLock.Lock();
+
+   for (int b = block0; b < block1 && b < (int)mLeaves.size(); b++)
+      mDirty.push_back(b);
+
+   mLock.Unlock();
+}
+
+void SummaryPyramid::Clear()
+{
+   mLock.Lock();
+
+   mLeaves.clear();
+   mLevels.clear();
+   mDirty.clear();
+   mPending.clear();
+   mFirstMoved = 0;
+
+   mLock.Unlock();
+}
+
+void SummaryPyramid::BuildLeaf(const BlockArray &blocks, int b)
+{
+   SeqBlock sb = blocks.Item(b);
+   Leaf &leaf = mLeaves[b];
+   Node &node = mLevels[0][b];
+
+   leaf.start = sb.start;
+   leaf.len = sb.f->GetLength();
+   node.len = leaf.len;
+
+   if (!sb.f->IsSummaryAvailable()) {
+      // Check again on the next query; on-demand tasks are still busy
+      leaf.frames.clear();
+      node.min = 0.0f;
+      node.max = 0.0f;
+      node.sumsq = 0.0;
+      node.available = false;
+      mPending.push_back(b);
+      return;
+   }
+
+   float min, max, rms;
+   sb.f->GetMinMax(&min, &max, &rms);
+   node.min = min;
+   node.max = max;
+   node.sumsq = (double)rms * rms * leaf.len;
+   node.available = true;
+
+   sampleCount numFrames = (leaf.len + kFrameSize - 1) / kFrameSize;
+   leaf.frames.resize(numFrames * 3);
+   if (numFrames > 0 && !sb.f->Read64K(&leaf.frames[0], 0, numFrames)) {
+      // Not worth failing the display for; use the whole-block values
+      for (sampleCount i = 0; i < numFrames; i++) {
+         leaf.frames[3 * i] = min;
+         leaf.frames[3 * i + 1] = max;
+         leaf.frames[3 * i + 2] = rms;
+      }
+   }
+}
+
+void SummaryPyramid::BuildNode(int level, int index)
+{
+   std::vector<Node> &below = mLevels[level - 1];
+   Node &node = mLevels[level][index];
+
+   const Node &left = below[2 * index];
+   node = left;
+
+   if (2 * index + 1 < (int)below.size()) {
+      const Node &right = below[2 * index + 1];
+      if (right.min < node.min)
+         node.min = right.min;
+      if (right.max > node.max)
+         node.max = right.max;
+      node.sumsq += right.sumsq;
+      node.len += right.len;
+      node.available = node.available && right.available;
+   }
+}
+
+void SummaryPyramid::Update(const BlockArray &blocks)
+{
+   int numBlocks = blocks.GetCount();
+   int numLeaves = mLeaves.size();
+
+   // Leaves that were waiting for on-demand summaries
+   for (size_t i = 0; i < mPending.size(); ) {
+      int b = mPending[i];
+      if (b < numBlocks && blocks.Item(b).f->IsSummaryAvailable()) {
+         mDirty.push_back(b);
+         mPending.erase(mPending.begin() + i);
+      }
+      else
+         i++;
+   }
+
+   if (numLeaves == numBlocks && mFirstMoved >= numBlocks && mDirty.empty())
+      return;
+
+   if (numLeaves > numBlocks) {
+      // Blocks went away without a Splice(); forget their leaves
+      SpliceIndices(mDirty, numBlocks, numLeaves - numBlocks, 0);
+      SpliceIndices(mPending, numBlocks, numLeaves - numBlocks, 0);
+      numLeaves = numBlocks;
+   }
+
+   // Blocks appended since the last query
+   for (int b = numLeaves; b < numBlocks; b++)
+      mDirty.push_back(b);
+   if (numLeaves < mFirstMoved)
+      mFirstMoved = numLeaves;
+
+   mLeaves.resize(numBlocks);
+
+   int numLevels = 1;
+   while ((1 << (numLevels - 1)) < numBlocks)
+      numLevels++;
+   mLevels.resize(numLevels);
+   for (int level = 0; level < numLevels; level++)
+      mLevels[level].resize(((numBlocks - 1) >> level) + 1);
+
+   std::sort(mDirty.begin(), mDirty.end());
+   mDirty.erase(std::unique(mDirty.begin(), mDirty.end()), mDirty.end());
+   for (size_t i = 0; i < mDirty.size(); i++)
+      BuildLeaf(blocks, mDirty[i]);
+
+   std::sort(mPending.begin(), mPending.end());
+   mPending.erase(std::unique(mPending.begin(), mPending.end()),
+                  mPending.end());
+
+   // Leaves that moved keep their summaries but not their starts
+   for (int b = mFirstMoved; b < numBlocks; b++)
+      mLeaves[b].start =
+         (b == 0 ? 0 : mLeaves[b - 1].start + mLeaves[b - 1].len);
+
+   // Ancestors of leaves changed in place, then everything above
+   // the leaves that moved
+   std::vector<int> dirty = mDirty;
+   mDirty.clear();
+   for (int level = 1; level < numLevels; level++) {
+      int size = mLevels[level].size();
+      int firstMoved = mFirstMoved >> level;
+      for (size_t i = 0; i < dirty.size(); i++) {
+         dirty[i] >>= 1;
+         if (dirty[i] < firstMoved &&
+             (i == 0 || dirty[i] != dirty[i - 1]))
+            BuildNode(level, dirty[i]);
+      }
+      for (int n = firstMoved; n < size; n++)
+         BuildNode(level, n);
+   }
+
+   mFirstMoved = numBlocks;
+}
+
+int SummaryPyramid::FindLeaf(sampleCount pos) const
+{
+   // The last leaf starting at or before pos
+   int lo = 0;
+   int hi = mLeaves.size();
+   while (hi - lo > 1) {
+      int mid = (lo + hi) / 2;
+      if (mLeaves[mid].start <= pos)
+         lo = mid;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+void SummaryPyramid::AddFrames(int b, sampleCount s0, sampleCount s1,
+                               Accumulator &acc) const
+{
+   const Leaf &leaf = mLeaves[b];
+   const Node &node = mLevels[0][b];
+
+   if (!node.available) {
+      acc.missingBlock = b;
+      return;
+   }
+
+   // s0 and s1 are relative to the block start; take the frames
+   // that begin within [s0, s1)
+   sampleCount f0 = (s0 + kFrameSize - 1) / kFrameSize;
+   sampleCount f1 = (s1 + kFrameSize - 1) / kFrameSize;
+   sampleCount numFrames = leaf.frames.size() / 3;
+   if (f1 > numFrames)
+      f1 = numFrames;
+
+   for (sampleCount f = f0; f < f1; f++) {
+      sampleCount frameLen = kFrameSize;
+      if (f == numFrames - 1)
+         frameLen = leaf.len - f * kFrameSize;
+      float rms = leaf.frames[3 * f + 2];
+      acc.Add(leaf.frames[3 * f], leaf.frames[3 * f + 1],
+              (double)rms * rms * frameLen, frameLen);
+   }
+   acc.lastBlock = b;
+}
+
+void SummaryPyramid::AddBlocks(int level, int index, int lo, int hi,
+                               Accumulator &acc) const
+{
+   int first = index << level;
+   int last = (index + 1) << level;
+   if (last > (int)mLeaves.size())
+      last = mLeaves.size();
+
+   if (last <= lo || first >= hi)
+      return;
+
+   const Node &node = mLevels[level][index];
+   if (first >= lo && last <= hi && node.available) {
+      acc.Add(node.min, node.max, node.sumsq, node.len);
+      acc.lastBlock = last - 1;
+      return;
+   }
+
+   if (level == 0) {
+      // A single block without its summary yet
+      acc.missingBlock = index;
+      return;
+   }
+
+   AddBlocks(level - 1, 2 * index, lo, hi, acc);
+   if (2 * index + 1 < (int)mLevels[level - 1].size())
+      AddBlocks(level - 1, 2 * index + 1, lo, hi, acc);
+}
+
+bool SummaryPyramid::GetSummary(const BlockArray &blocks,
+                                sampleCount start, sampleCount end,
+                                float *outMin, float *outMax, float *outRMS,
+                                int *blockStatus)
+{
+   mLock.Lock();
+
+   Update(blocks);
+
+   if (mLeaves.empty() || end <= start) {
+      mLock.Unlock();
+      return false;
+   }
+
+   Accumulator acc;
+
+   int b0 = FindLeaf(start);
+   int b1 = FindLeaf(end - 1);
+
+   const Leaf &first = mLeaves[b0];
+   if (b0 == b1) {
+      AddFrames(b0, start - first.start, end - first.start, acc);
+   }
+   else {
+      int wholeFrom = b0;
+      if (start > first.start) {
+         AddFrames(b0, start - first.start, first.len, acc);
+         wholeFrom = b0 + 1;
+      }
+
+      const Leaf &last = mLeaves[b1];
+      int wholeTo = b1;
+      if (end >= last.start + last.len)
+         wholeTo = b1 + 1;
+
+      if (wholeTo > wholeFrom)
+         AddBlocks(mLevels.size() - 1, 0, wholeFrom, wholeTo, acc);
+
+      if (wholeTo == b1)
+         AddFrames(b1, 0, end - last.start, acc);
+   }
+
+   if (acc.len == 0 && acc.missingBlock < 0) {
+      // The range lies inside one summary frame that begins before it;
+      // use that frame so that very narrow ranges still show something
+      sampleCount rel = start - first.start;
+      sampleCount f = rel / kFrameSize;
+      AddFrames(b0, f * kFrameSize, f * kFrameSize + 1, acc);
+   }
+
+   mLock.Unlock();
+
+   if (acc.missingBlock >= 0) {
+      *outMin = 0.0f;
+      *outMax = 0.0f;
+      *outRMS = 0.0f;
+      *blockStatus = -1 - acc.missingBlock;
+      return true;
+   }
+
+   if (acc.len == 0)
+      return false;
+
+   *outMin = acc.min;
+   *outMax = acc.max;
+   *outRMS = (float)sqrt(acc.sumsq / acc.len);
+   *blockStatus = acc.lastBlock;
+   return true;
+}
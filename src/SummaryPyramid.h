@@ -0,0 +1,131 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SummaryPyramid.h
+
+*******************************************************************//**
+
+\class SummaryPyramid
+\brief A hierarchy of min/max/RMS summaries over the blocks of a
+   Sequence, used to answer display queries without reading every
+   block's summary data.
+
+  Level 0 holds, for each block, the block's overall min/max/RMS and
+  its 64K-sample summary frames, which are read from disk only once.
+  Each higher level combines pairs of nodes of the level below, so
+  that any run of whole blocks can be summarized from O(log n) nodes.
+
+  The Sequence tells the pyramid which blocks changed; the pyramid
+  rebuilds the affected leaves and their ancestors the next time it is
+  queried.  Blocks that only moved, because blocks before them were
+  inserted or removed, keep their leaves.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_PYRAMID__
+#define __AUDACITY_SUMMARY_PYRAMID__
+
+#include <vector>
+
+#include "Sequence.h"
+#include "ondemand/ODTaskThread.h"
+
+class SummaryPyramid
+{
+ public:
+   SummaryPyramid();
+   ~SummaryPyramid();
+
+   /// A new pyramid with the same contents, for a copy of the blocks
+   /// this one describes
+   SummaryPyramid *Duplicate();
+
+   /// The blocks [firstBlock, firstBlock + numRemoved) were replaced by
+   /// numInserted new blocks.  The blocks after them move along with
+   /// their leaves intact.  Blocks appended past the end need no call.
+   void Splice(int firstBlock, int numRemoved, int numInserted);
+
+   /// The BlockFiles of blocks [block0, block1) were replaced in place,
+   /// without changing any block start or length.
+   void InvalidateBlocks(int block0, int block1);
+
+   /// Forget everything.
+   void Clear();
+
+   /// Summarizes the samples [start, end) of the sequence whose blocks
+   /// are given.  Whole blocks come from the pyramid; partial blocks at
+   /// either end come from their cached 64K summary frames.  Frames are
+   /// attributed to the range containing their first sample, so that
+   /// adjacent ranges never count the same frame twice.
+   ///
+   /// blockStatus receives the index of the last block used, or
+   /// -1-b if block b does not yet have summary data (on-demand loading).
+   ///
+   /// Returns false if nothing could be summarized.
+   bool GetSummary(const BlockArray &blocks,
+                   sampleCount start, sampleCount end,
+                   float *outMin, float *outMax, float *outRMS,
+                   int *blockStatus);
+
+ private:
+
+   class Leaf
+   {
+    public:
+      sampleCount start;
+      sampleCount len;
+      std::vector<float> frames; // min, max, rms per 64K samples
+   };
+
+   class Node
+   {
+    public:
+      float min;
+      float max;
+      double sumsq;
+      sampleCount len;
+      bool available;
+   };
+
+   class Accumulator
+   {
+    public:
+      Accumulator();
+      void Add(float min, float max, double sumsq, sampleCount len);
+
+      float min;
+      float max;
+      double sumsq;
+      sampleCount len;
+      int lastBlock;
+      int missingBlock;
+   };
+
+   void Update(const BlockArray &blocks);
+   void BuildLeaf(const BlockArray &blocks, int b);
+   void BuildNode(int level, int index);
+
+   int FindLeaf(sampleCount pos) const;
+
+   void AddFrames(int b, sampleCount s0, sampleCount s1,
+                  Accumulator &acc) const;
+   void AddBlocks(int level, int index, int lo, int hi,
+                  Accumulator &acc) const;
+
+   // mLeaves[b] and mLevels[0][b] describe block b
+   std::vector<Leaf> mLeaves;
+   std::vector< std::vector<Node> > mLevels;
+
+   // Leaves in mDirty must be rebuilt.  From mFirstMoved on, leaf
+   // starts and the nodes above level 0 must be recomputed.
+   std::vector<int> mDirty;
+   int mFirstMoved;
+
+   // Leaves whose blocks are still waiting for on-demand summaries
+   std::vector<int> mPending;
+
+   ODLock mLock;
+};
+
+#endif // __AUDACITY_SUMMARY_PYRAMID__
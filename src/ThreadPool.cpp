@@ -0,0 +1,167 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.cpp
+
+*******************************************************************//**
+
+\file ThreadPool.cpp
+\brief Implements ThreadPool and its worker threads.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <wx/thread.h>
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+ThreadPool *ThreadPool::sInstance = NULL;
+
+#ifdef __WXMAC__
+
+// As with ODTaskThread, use pthreads rather than wxThread on Mac OS X.
+class ThreadPoolThread
+{
+ public:
+   ThreadPoolThread(ThreadPool *pool) : mPool(pool) {}
+
+   void Start()
+   {
+      pthread_create(&mThread, NULL, callback, this);
+   }
+
+   void Join()
+   {
+      pthread_join(mThread, NULL);
+   }
+
+ private:
+   static void *callback(void *p)
+   {
+      ((ThreadPoolThread *)p)->mPool->Work();
+      return NULL;
+   }
+
+   pthread_t mThread;
+   ThreadPool *mPool;
+};
+
+#else
+
+class ThreadPoolThread : public wxThread
+{
+ public:
+   ThreadPoolThread(ThreadPool *pool)
+      : wxThread(wxTHREAD_JOINABLE), mPool(pool) {}
+
+   void Start()
+   {
+      Create();
+      Run();
+   }
+
+   void Join()
+   {
+      Wait();
+   }
+
+ protected:
+   virtual ExitCode Entry()
+   {
+      mPool->Work();
+      return 0;
+   }
+
+ private:
+   ThreadPool *mPool;
+};
+
+#endif // __WXMAC__
+
+// static
+void ThreadPool::Init(int numThreads)
+{
+   if (sInstance)
+      return;
+
+   if (numThreads <= 0) {
+      numThreads = wxThread::GetCPUCount() - 1;
+      if (numThreads < 1)
+         numThreads = 1;
+   }
+
+   sInstance = new ThreadPool(numThreads);
+}
+
+// static
+void ThreadPool::Deinit()
+{
+   delete sInstance;
+   sInstance = NULL;
+}
+
+ThreadPool::ThreadPool(int numThreads)
+{
+   mStopping = false;
+   mJobsCondition = new ODCondition(&mJobsMutex);
+
+   for (int i = 0; i < numThreads; i++) {
+      ThreadPoolThread *thread = new ThreadPoolThread(this);
+      mThreads.push_back(thread);
+      thread->Start();
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   mJobsMutex.Lock();
+   mStopping = true;
+   mJobsCondition->Broadcast();
+   mJobsMutex.Unlock();
+
+   for (size_t i = 0; i < mThreads.size(); i++) {
+      mThreads[i]->Join();
+      delete mThreads[i];
+   }
+
+   for (size_t i = 0; i < mJobs.size(); i++)
+      delete mJobs[i];
+
+   delete mJobsCondition;
+}
+
+void ThreadPool::Add(ThreadPoolJob *job)
+{
+   mJobsMutex.Lock();
+   mJobs.push_back(job);
+   mJobsCondition->Signal();
+   mJobsMutex.Unlock();
+}
+
+void ThreadPool::Work()
+{
+   Profiler::SetThreadName("Thread pool worker");
+
+   mJobsMutex.Lock();
+
+   while (true) {
+      while (mJobs.empty() && !mStopping)
+         mJobsCondition->Wait();
+
+      if (mStopping)
+         break;
+
+      ThreadPoolJob *job = mJobs.front();
+      mJobs.pop_front();
+
+      mJobsMutex.Unlock();
+      job->Run();
+      delete job;
+      mJobsMutex.Lock();
+   }
+
+   mJobsMutex.Unlock();
+}
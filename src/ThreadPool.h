@@ -0,0 +1,78 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ThreadPool.h
+
+*******************************************************************//**
+
+\class ThreadPool
+\brief A fixed set of worker threads that run ThreadPoolJobs in the
+   order they were added.
+
+  The application creates one pool at startup, sized to the number of
+  processors, for background work that must not hold up the GUI or the
+  audio thread.  Jobs are owned by the pool once added and are deleted
+  after they run; jobs still queued when the pool shuts down are
+  deleted without running.
+
+*//****************************************************************//**
+
+\class ThreadPoolJob
+\brief One unit of work for a ThreadPool.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_THREAD_POOL__
+#define __AUDACITY_THREAD_POOL__
+
+#include <deque>
+#include <vector>
+
+#include "ondemand/ODTaskThread.h"
+
+class ThreadPoolThread;
+
+class ThreadPoolJob
+{
+ public:
+   virtual ~ThreadPoolJob() {}
+   virtual void Run() = 0;
+};
+
+class ThreadPool
+{
+ public:
+   /// Creates the application's pool.  numThreads <= 0 means one thread
+   /// per processor, less one for the GUI.
+   static void Init(int numThreads = 0);
+   /// Stops the application's pool, waiting for running jobs to finish.
+   static void Deinit();
+   /// The application's pool; only valid between Init() and Deinit().
+   static ThreadPool *Get() { return sInstance; }
+
+   ThreadPool(int numThreads);
+   ~ThreadPool();
+
+   /// Queues a job.  The pool takes ownership of it.
+   void Add(ThreadPoolJob *job);
+
+   int GetNumThreads() const { return (int)mThreads.size(); }
+
+ private:
+   friend class ThreadPoolThread;
+
+   /// Called by each worker thread; returns when the pool shuts down.
+   void Work();
+
+   std::vector<ThreadPoolThread *> mThreads;
+
+   std::deque<ThreadPoolJob *> mJobs;
+   bool mStopping;
+   ODLock mJobsMutex;
+   ODCondition *mJobsCondition;
+
+   static ThreadPool *sInstance;
+};
+
+#endif // __AUDACITY_THREAD_POOL__
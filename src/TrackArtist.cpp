@@ -174,8 +174,10 @@ audio tracks.
 #include "TimeTrack.h"
 #include "Prefs.h"
 #include "Sequence.h"
+#include "SpectrogramCache.h"
 #include "Spectrum.h"
 #include "ViewInfo.h"
+#include "WaveTileCache.h"
 #include "widgets/Ruler.h"
 #include "Theme.h"
 #include "AllThemeResources.h"
@@ -1574,8 +1576,18 @@ void TrackArtist::DrawClipWaveform(WaveTrack *track,
    // of the waveform.  The only way GetWaveDisplay will fail is if
    // there's a serious error, like some of the waveform data can't
    // be loaded.  So if the function returns false, we can just exit.
-   if (!clip->GetWaveDisplay(min, max, rms, bl, where,
-                             mid.width, t0, pps, isLoadingOD)) {
+   // When zoomed out, the shape is computed in tiles in the background
+   // instead, so that scrolling and zooming never wait on the disk;
+   // columns not ready yet are drawn like on-demand placeholders.
+   bool gotDisplay;
+   if (showIndividualSamples)
+      gotDisplay = clip->GetWaveDisplay(min, max, rms, bl, where,
+                                        mid.width, t0, pps, isLoadingOD);
+   else
+      gotDisplay = WaveTileCache::Get().GetWaveDisplay(clip, min, max, rms,
+                                                       bl, where, mid.width,
+                                                       t0, pps, isLoadingOD);
+   if (!gotDisplay) {
       delete[] min;
       delete[] max;
       delete[] rms;
@@ -1937,8 +1949,10 @@ void TrackArtist::DrawClipSpectrum(WaveTrack *track,
    float *freq = new float[mid.width * half];
    sampleCount *where = new sampleCount[mid.width+1];
 
-   bool updated = clip->GetSpectrogram(freq, where, mid.width,
-                              t0, pps, autocorrelation);
+   // Columns are computed in the background and may fill in over
+   // several repaints
+   bool updated = SpectrogramCache::Get().GetSpectrogram(clip, freq, where,
+                              mid.width, t0, pps, autocorrelation);
    int ifreq = lrint(rate/2);
 
    int maxFreq;
@@ -202,6 +202,7 @@ is time to refresh some aspect of the screen.
 
 #include "NoteTrack.h"
 #include "Prefs.h"
+#include "Profiler.h"
 #include "Project.h"
 #include "Snap.h"
 #include "Theme.h"
@@ -1385,6 +1386,8 @@ void TrackPanel::OnErase(wxEraseEvent & /* event */)
 ///  completing a repaint operation.
 void TrackPanel::OnPaint(wxPaintEvent & /* event */)
 {
+   PROFILE_ZONE("TrackPanel::OnPaint");
+
 #if DEBUG_DRAW_TIMING
    wxStopWatch sw;
 #endif
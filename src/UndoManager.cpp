@@ -22,6 +22,9 @@ UndoManager
 
 #include "Audacity.h"
 
+#include <vector>
+
+#include <wx/hashmap.h>
 #include <wx/hashset.h>
 
 #include "BlockFile.h"
@@ -33,7 +36,8 @@ UndoManager
 
 #include "UndoManager.h"
 
-WX_DECLARE_HASH_SET(BlockFile *, wxPointerHash, wxPointerEqual, Set );
+WX_DECLARE_HASH_MAP(BlockFile *, int, wxPointerHash, wxPointerEqual, FileCounts );
+WX_DECLARE_HASH_SET(const BlockArray *, wxPointerHash, wxPointerEqual, ArraySet );
 
 UndoManager::UndoManager()
 {
@@ -48,60 +52,104 @@ UndoManager::~UndoManager()
    ClearStates();
 }
 
-void UndoManager::CalculateSpaceUsage()
+// The block arrays of all clips of the wave tracks of a state
+static void GetBlockArrays(TrackList *tracks,
+                           std::vector<const BlockArray *> &arrays)
 {
    TrackListOfKindIterator iter(Track::Wave);
 
-   space.Clear();
-   space.Add(0, stack.GetCount());
+   WaveTrack *wt = (WaveTrack *) iter.First(tracks);
+   while (wt)
+   {
+      WaveClipList::compatibility_iterator it = wt->GetClipIterator();
+      while (it)
+      {
+         arrays.push_back(it->GetData()->GetSequenceBlockArray());
+         it = it->GetNext();
+      }
 
-   Set *prev = new Set;
-   Set *cur = new Set;
+      wt = (WaveTrack *) iter.Next();
+   }
+}
 
+void UndoManager::CalculateSpaceUsage()
+{
    for (size_t i = 0, cnt = stack.GetCount(); i < cnt; i++)
    {
-      // Swap map pointers
-      Set *swap = prev;
-      prev = cur;
-      cur = swap;
+      if (!stack[i]->spaceKnown)
+         CalculateSpaceUsage(i);
+   }
+}
+
+void UndoManager::CalculateSpaceUsage(size_t n)
+{
+   std::vector<const BlockArray *> cur;
+   std::vector<const BlockArray *> prev;
+
+   GetBlockArrays(stack[n]->tracks, cur);
+   if (n > 0)
+      GetBlockArrays(stack[n - 1]->tracks, prev);
+
+   ArraySet prevArrays;
+   for (size_t a = 0; a < prev.size(); a++)
+      prevArrays.insert(prev[a]);
+
+   ArraySet curArrays;
+   for (size_t a = 0; a < cur.size(); a++)
+      curArrays.insert(cur[a]);
+
+   // Only the arrays this state changed can hold new files; count how
+   // many times each of their files occurs in them
+   FileCounts newFiles;
+   for (size_t a = 0; a < cur.size(); a++)
+   {
+      if (prevArrays.count(cur[a]))
+         continue;
+
+      for (size_t b = 0, cnt = cur[a]->GetCount(); b < cnt; b++)
+         newFiles[cur[a]->Item(b).f]++;
+   }
+
+   // Files that the changed arrays of the previous state held are old
+   for (size_t a = 0; a < prev.size() && !newFiles.empty(); a++)
+   {
+      if (curArrays.count(prev[a]))
+         continue;
 
-      // And clean out the new current map
-      cur->clear();
+      for (size_t b = 0, cnt = prev[a]->GetCount(); b < cnt; b++)
+         newFiles.erase(prev[a]->Item(b).f);
+   }
 
-      // Scan all tracks at current level
-      WaveTrack *wt = (WaveTrack *) iter.First(stack[i]->tracks);
-      while (wt)
+   // Every array Refs its files, so a file with no more references than
+   // occurrences in the changed arrays is in none of the shared ones.
+   // Only otherwise is it worth looking through those.
+   bool checkShared = false;
+   for (FileCounts::iterator it = newFiles.begin(); it != newFiles.end(); ++it)
+   {
+      if (it->first->RefCount() > it->second)
       {
-         // Scan all clips within current track
-         WaveClipList::compatibility_iterator it = wt->GetClipIterator();
-         while (it)
-         {
-            // Scan all blockfiles within current clip
-            BlockArray *blocks = it->GetData()->GetSequenceBlockArray();
-            for (size_t b = 0, cnt = blocks->GetCount(); b < cnt; b++)
-            {
-               BlockFile *file = blocks->Item(b)->f;
-
-               // Accumulate space used by the file if the file didn't exist
-               // in the previous level
-               if (!prev->count(file))
-               {
-                  space[i] += file->GetSpaceUsage().GetValue();
-               }
-               
-               // Add file to current set
-               cur->insert(file);
-            }
-            
-            it = it->GetNext();
-         }
-
-         wt = (WaveTrack *) iter.Next();
+         checkShared = true;
+         break;
       }
    }
 
-   delete cur;
-   delete prev;
+   for (size_t a = 0; a < cur.size() && checkShared; a++)
+   {
+      if (!prevArrays.count(cur[a]))
+         continue;
+
+      for (size_t b = 0, cnt = cur[a]->GetCount(); b < cnt; b++)
+         newFiles.erase(cur[a]->Item(b).f);
+   }
+
+   // Accumulate space used by the files that didn't exist in the
+   // previous level
+   size_t space = 0;
+   for (FileCounts::iterator it = newFiles.begin(); it != newFiles.end(); ++it)
+      space += it->first->GetSpaceUsage().GetValue();
+
+   stack[n]->spaceUsage = space;
+   stack[n]->spaceKnown = true;
 }
 
 void UndoManager::GetLongDescription(unsigned int n, wxString *desc,
@@ -110,11 +158,11 @@ void UndoManager::GetLongDescription(unsigned int n, wxString *desc,
    n -= 1; // 1 based to zero based
 
    wxASSERT(n < stack.Count());
-   wxASSERT(space.Count() == stack.Count());
+   wxASSERT(stack[n]->spaceKnown);
 
    *desc = stack[n]->description;
 
-   *size = Internat::FormatSize(space[n]);
+   *size = Internat::FormatSize(stack[n]->spaceUsage);
 }
 
 void UndoManager::GetShortDescription(unsigned int n, wxString *desc)
@@ -143,6 +191,10 @@ void UndoManager::RemoveStateAt(int n)
    UndoStackElem *tmpStackElem = stack[n];
    stack.RemoveAt(n);
    delete tmpStackElem;
+
+   // The state that followed the removed one now follows another
+   if (n < (int)stack.Count())
+      stack[n]->spaceKnown = false;
 }
 
 
@@ -205,6 +257,9 @@ void UndoManager::ModifyState(TrackList * l,
    // Replace
    stack[current]->tracks = tracksCopy;
    stack[current]->selectedRegion = selectedRegion;
+   stack[current]->spaceKnown = false;
+   if (current + 1 < (int)stack.Count())
+      stack[current + 1]->spaceKnown = false;
    SonifyEndModifyState();
 }
 
@@ -249,6 +304,8 @@ void UndoManager::PushState(TrackList * l,
    push->selectedRegion = selectedRegion;
    push->description = longDescription;
    push->shortDescription = shortDescription;
+   push->spaceUsage = 0;
+   push->spaceKnown = false;
 
    stack.Add(push);
    current++;
@@ -11,6 +11,9 @@
   of every single track using its Duplicate method, which should
   increment reference counts.  If we were not at the top of
   the stack when this is called, delete above first.
+  The duplicates of wave tracks share their block arrays with the
+  originals until one of them changes, so a state costs little more
+  than the clips and envelopes of its tracks.
 
   If a minor change is made, for example changing the visual
   display of a track or changing the selection, you can call
@@ -61,10 +64,13 @@ struct UndoStackElem {
    wxString description;
    wxString shortDescription;
    SelectedRegion selectedRegion;
+   // Bytes of the blocks of this state that the state before it
+   // does not use; stale once either of the two states changes
+   size_t spaceUsage;
+   bool spaceKnown;
 };
 
 WX_DEFINE_USER_EXPORTED_ARRAY(UndoStackElem *, UndoStack, class AUDACITY_DLL_API);
-WX_DEFINE_USER_EXPORTED_ARRAY_SIZE_T(size_t, SpaceArray, class AUDACITY_DLL_API);
 
 // These flags control what extra to do on a PushState
 // Default is PUSH_AUTOSAVE
@@ -104,6 +110,8 @@ class AUDACITY_DLL_API UndoManager {
    bool UnsavedChanges();
    void StateSaved();
 
+   // Updates the space usage of the states that changed since the
+   // last call
    void CalculateSpaceUsage();
 
    // void Debug(); // currently unused
@@ -114,6 +122,8 @@ class AUDACITY_DLL_API UndoManager {
    void ResetODChangesFlag();
 
  private:
+   void CalculateSpaceUsage(size_t n);
+
    int current;
    int saved;
    UndoStack stack;
@@ -121,8 +131,6 @@ class AUDACITY_DLL_API UndoManager {
    wxString lastAction;
    int consolidationCount;
 
-   SpaceArray space;
-
    bool mODChanges;
    ODLock mODChangesMutex;//mODChanges is accessed from many threads.
 
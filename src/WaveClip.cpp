@@ -35,6 +35,8 @@ drawing).  Cache's the Spectrogram frequency samples.
 #include "Envelope.h"
 #include "Resample.h"
 #include "Project.h"
+#include "SpectrogramCache.h"
+#include "WaveTileCache.h"
 
 #include <wx/listimpl.cpp>
 WX_DEFINE_LIST(WaveClipList);
@@ -263,31 +265,6 @@ public:
 
 #ifdef EXPERIMENTAL_USE_REALFFTF
 #include "FFT.h"
-static void ComputeSpectrumUsingRealFFTf(float *buffer, HFFT hFFT, float *window, int len, float *out)
-{
-   int i;
-   if(len > hFFT->Points*2)
-      len = hFFT->Points*2;
-   for(i=0; i<len; i++)
-      buffer[i] *= window[i];
-   for( ; i<(hFFT->Points*2); i++)
-      buffer[i]=0; // zero pad as needed
-   RealFFTf(buffer, hFFT);
-   // Handle the (real-only) DC
-   float power = buffer[0]*buffer[0];
-   if(power <= 0)
-      out[0] = -160.0;
-   else
-      out[0] = 10.0*log10(power);
-   for(i=1;i<hFFT->Points;i++) {
-      power = (buffer[hFFT->BitReversed[i]  ]*buffer[hFFT->BitReversed[i]  ])
-            + (buffer[hFFT->BitReversed[i]+1]*buffer[hFFT->BitReversed[i]+1]);
-      if(power <= 0)
-         out[i] = -160.0;
-      else
-         out[i] = 10.0*log10f(power);
-   }
-}
 #endif // EXPERIMENTAL_USE_REALFFTF
 
 WaveClip::WaveClip(DirManager *projDirManager, sampleFormat format, int rate)
@@ -345,6 +322,9 @@ WaveClip::WaveClip(WaveClip& orig, DirManager *projDirManager)
 
 WaveClip::~WaveClip()
 {
+   WaveTileCache::Get().Forget(this);
+   SpectrogramCache::Get().Forget(this);
+
    delete mSequence;
 
    delete mEnvelope;
@@ -440,6 +420,9 @@ void WaveClip::DeleteWaveCache()
       delete mWaveCache;
    mWaveCache = new WaveCache(1);
    mWaveCacheMutex.Unlock();
+
+   WaveTileCache::Get().Invalidate(this, 0, mSequence->GetNumSamples());
+   SpectrogramCache::Get().Invalidate(this, 0, mSequence->GetNumSamples());
 }
 
 ///Adds an invalid region to the wavecache so it redraws that portion only.
@@ -449,6 +432,9 @@ void WaveClip::AddInvalidRegion(long startSample, long endSample)
    if(mWaveCache!=NULL)
       mWaveCache->AddInvalidRegion(startSample,endSample);
    mWaveCacheMutex.Unlock();
+
+   WaveTileCache::Get().Invalidate(this, startSample, endSample);
+   SpectrogramCache::Get().Invalidate(this, startSample, endSample);
 }
 
 //
@@ -994,6 +980,18 @@ bool WaveClip::GetRMS(float *rms, double t0,
    return mSequence->GetRMS(s0, s1-s0, rms);
 }
 
+sampleCount WaveClip::FindAbove(sampleCount start, sampleCount len,
+                                float level) const
+{
+   return mSequence->FindAbove(start, len, level);
+}
+
+sampleCount WaveClip::FindQuiet(sampleCount start, sampleCount len,
+                                float level, sampleCount minLen) const
+{
+   return mSequence->FindQuiet(start, len, level, minLen);
+}
+
 void WaveClip::ConvertToSampleFormat(sampleFormat format)
 {
    bool bChanged;
@@ -1203,6 +1201,9 @@ bool WaveClip::CreateFromCopy(double t0, double t1, WaveClip* other)
    other->TimeToSamplesClip(t0, &s0);
    other->TimeToSamplesClip(t1, &s1);
 
+   WaveTileCache::Get().Forget(this);
+   SpectrogramCache::Get().Forget(this);
+
    Sequence* oldSequence = mSequence;
    mSequence = NULL;
    if (!other->mSequence->Copy(s0, s1, &mSequence))
@@ -1597,6 +1598,9 @@ bool WaveClip::Resample(int rate, ProgressDialog *progress)
       delete newSequence;
    } else
    {
+      WaveTileCache::Get().Forget(this);
+      SpectrogramCache::Get().Forget(this);
+
       delete mSequence;
       mSequence = newSequence;
       mRate = rate;
@@ -121,7 +121,7 @@ public:
                    sampleCount start, sampleCount len);
 
    Envelope* GetEnvelope() { return mEnvelope; }
-   BlockArray* GetSequenceBlockArray() { return mSequence->GetBlockArray(); }
+   const BlockArray* GetSequenceBlockArray() const { return mSequence->GetBlocks(); }
 
    // Get low-level access to the sequence. Whenever possible, don't use this,
    // but use more high-level functions inside WaveClip (or add them if you
@@ -132,6 +132,11 @@ public:
     * called automatically when WaveClip has a chance to know that something
     * has changed, like when member functions SetSamples() etc. are called. */
    void MarkChanged() { mDirty++; }
+   /// Changes each time MarkChanged() is called
+   int GetDirty() const { return mDirty; }
+
+   /// Number of samples appended but not yet flushed to the Sequence
+   sampleCount GetAppendBufferLen() const { return mAppendBufferLen; }
 
    /// Create clip from copy, discarding previous information in the clip
    bool CreateFromCopy(double t0, double t1, WaveClip* other);
@@ -147,6 +152,14 @@ public:
    bool GetMinMax(float *min, float *max, double t0, double t1);
    bool GetRMS(float *rms, double t0, double t1);
 
+   /// Searches of the clip's samples that go by the block summaries
+   /// where they can; start is relative to the clip, as for GetSamples().
+   /// See Sequence::FindAbove() and Sequence::FindQuiet().
+   sampleCount FindAbove(sampleCount start, sampleCount len,
+                         float level) const;
+   sampleCount FindQuiet(sampleCount start, sampleCount len,
+                         float level, sampleCount minLen) const;
+
    // Set/clear/get rectangle that this WaveClip fills on screen. This is
    // called by TrackArtist while actually drawing the tracks and clips.
    void ClearDisplayRect();
@@ -0,0 +1,412 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveTileCache.cpp
+
+*******************************************************************//**
+
+\file WaveTileCache.cpp
+\brief Implements class WaveTileCache.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "WaveTileCache.h"
+#include "Project.h"
+#include "Sequence.h"
+#include "ThreadPool.h"
+#include "WaveClip.h"
+#include "ondemand/ODManager.h"
+
+// Requests beyond this many are dropped, oldest first; they are made
+// again by the next repaint if the tiles are still on screen
+static const size_t kMaxRequests = 256;
+
+// Ask for a repaint after this many tiles even if more are queued
+static const int kTilesPerRepaint = 16;
+
+WaveTileCache WaveTileCache::sInstance;
+
+class WaveTileJob : public ThreadPoolJob
+{
+ public:
+   virtual void Run()
+   {
+      WaveTileCache::Get().RenderNext();
+   }
+};
+
+bool WaveTileCache::TileKey::operator<(const TileKey &other) const
+{
+   if (clip != other.clip)
+      return clip < other.clip;
+   if (pixelsPerSecond != other.pixelsPerSecond)
+      return pixelsPerSecond < other.pixelsPerSecond;
+   if (phase != other.phase)
+      return phase < other.phase;
+   return index < other.index;
+}
+
+WaveTileCache &WaveTileCache::Get()
+{
+   return sInstance;
+}
+
+WaveTileCache::WaveTileCache()
+{
+   mHead = NULL;
+   mTail = NULL;
+   mRenderedSinceRepaint = 0;
+   mRenderedCondition = new ODCondition(&mLock);
+}
+
+WaveTileCache::~WaveTileCache()
+{
+   while (mHead)
+      Remove(mHead);
+
+   delete mRenderedCondition;
+}
+
+// static
+sampleCount WaveTileCache::ColumnStart(double samplesPerPixel, int phase,
+                                       sampleCount column)
+{
+   return (sampleCount)floor((column + (double)phase / kPhaseSteps) *
+                             samplesPerPixel + 0.5);
+}
+
+bool WaveTileCache::GetWaveDisplay(WaveClip *clip,
+                                   float *min, float *max, float *rms,
+                                   int *bl, sampleCount *where, int numPixels,
+                                   double t0, double pixelsPerSecond,
+                                   bool &isLoading)
+{
+   // Samples still in the append buffer are only visible to the clip
+   if (!ThreadPool::Get() || clip->GetAppendBufferLen() > 0)
+      return clip->GetWaveDisplay(min, max, rms, bl, where, numPixels,
+                                  t0, pixelsPerSecond, isLoading);
+
+   double samplesPerPixel = clip->GetRate() / pixelsPerSecond;
+   double pos = t0 * pixelsPerSecond;
+   sampleCount base = (sampleCount)floor(pos);
+   int phase = (int)floor((pos - base) * kPhaseSteps + 0.5);
+   if (phase == kPhaseSteps) {
+      base++;
+      phase = 0;
+   }
+
+   int dirty = clip->GetDirty();
+   isLoading = false;
+
+   int x;
+   for (x = 0; x <= numPixels; x++)
+      where[x] = ColumnStart(samplesPerPixel, phase, base + x);
+
+   mLock.Lock();
+
+   x = 0;
+   while (x < numPixels) {
+      sampleCount column = base + x;
+      int offset = (int)(column % kTileWidth);
+      int count = kTileWidth - offset;
+      if (count > numPixels - x)
+         count = numPixels - x;
+
+      TileKey key;
+      key.clip = clip;
+      key.pixelsPerSecond = pixelsPerSecond;
+      key.phase = phase;
+      key.index = (int)(column / kTileWidth);
+
+      Tile *tile;
+      TileMap::iterator iter = mTiles.find(key);
+      if (iter == mTiles.end() || iter->second->dirty != dirty)
+         tile = Request(key, dirty);
+      else
+         tile = iter->second;
+
+      if (tile->ready) {
+         // Possibly out of date, but better than nothing
+         memcpy(&min[x], &tile->min[offset], count * sizeof(float));
+         memcpy(&max[x], &tile->max[offset], count * sizeof(float));
+         memcpy(&rms[x], &tile->rms[offset], count * sizeof(float));
+         memcpy(&bl[x], &tile->bl[offset], count * sizeof(int));
+
+         if (tile->dirty != dirty)
+            isLoading = true;
+         for (int i = 0; i < count && !isLoading; i++)
+            if (bl[x + i] < 0)
+               isLoading = true;
+      }
+      else {
+         for (int i = x; i < x + count; i++) {
+            min[i] = max[i] = rms[i] = 0.0;
+            bl[i] = -1;
+         }
+         isLoading = true;
+      }
+
+      Unlink(tile);
+      Link(tile);
+
+      x += count;
+   }
+
+   Trim();
+
+   mLock.Unlock();
+
+   return true;
+}
+
+void WaveTileCache::Invalidate(WaveClip *clip,
+                               sampleCount start, sampleCount end)
+{
+   double rate = clip->GetRate();
+
+   mLock.Lock();
+
+   TileKey first;
+   first.clip = clip;
+   first.pixelsPerSecond = 0.0;
+   first.phase = 0;
+   first.index = 0;
+
+   TileMap::iterator iter = mTiles.lower_bound(first);
+   for (; iter != mTiles.end() && iter->first.clip == clip; ++iter) {
+      const TileKey &key = iter->first;
+      double samplesPerPixel = rate / key.pixelsPerSecond;
+      sampleCount column = (sampleCount)key.index * kTileWidth;
+      sampleCount s0 = ColumnStart(samplesPerPixel, key.phase, column);
+      sampleCount s1 =
+         ColumnStart(samplesPerPixel, key.phase, column + kTileWidth);
+      if (s0 < end && s1 > start)
+         iter->second->dirty = -1;
+   }
+
+   mLock.Unlock();
+}
+
+void WaveTileCache::Forget(WaveClip *clip)
+{
+   mLock.Lock();
+
+   TileKey first;
+   first.clip = clip;
+   first.pixelsPerSecond = 0.0;
+   first.phase = 0;
+   first.index = 0;
+
+   for (;;) {
+      bool rendering = false;
+
+      TileMap::iterator iter = mTiles.lower_bound(first);
+      while (iter != mTiles.end() && iter->first.clip == clip) {
+         Tile *tile = iter->second;
+         ++iter;
+         if (tile->rendering)
+            rendering = true;
+         else
+            Remove(tile);
+      }
+
+      if (!rendering)
+         break;
+
+      mRenderedCondition->Wait();
+   }
+
+   mLock.Unlock();
+}
+
+// Call with mLock held
+WaveTileCache::Tile *WaveTileCache::Request(const TileKey &key, int dirty)
+{
+   Tile *tile;
+   TileMap::iterator iter = mTiles.find(key);
+   if (iter != mTiles.end())
+      tile = iter->second;
+   else {
+      tile = new Tile;
+      tile->key = key;
+      tile->dirty = -1;
+      tile->requestedDirty = -1;
+      tile->ready = false;
+      tile->queued = false;
+      tile->rendering = false;
+      Link(tile);
+      mTiles[key] = tile;
+   }
+
+   // A tile being rendered is looked at again by the repaint that
+   // follows, which requests it anew if it is still out of date
+   if (tile->rendering)
+      return tile;
+
+   tile->requestedDirty = dirty;
+
+   if (tile->queued) {
+      // Move it to the front of the line
+      mRequests.erase(std::find(mRequests.begin(), mRequests.end(), tile));
+      mRequests.push_back(tile);
+      return tile;
+   }
+
+   tile->queued = true;
+   mRequests.push_back(tile);
+
+   if (mRequests.size() > kMaxRequests) {
+      mRequests.front()->queued = false;
+      mRequests.erase(mRequests.begin());
+   }
+
+   ThreadPool::Get()->Add(new WaveTileJob());
+
+   return tile;
+}
+
+void WaveTileCache::RenderNext()
+{
+   mLock.Lock();
+
+   if (mRequests.empty()) {
+      mLock.Unlock();
+      return;
+   }
+
+   Tile *tile = mRequests.back();
+   mRequests.pop_back();
+   tile->queued = false;
+   tile->rendering = true;
+
+   TileKey key = tile->key;
+   int dirty = tile->requestedDirty;
+
+   mLock.Unlock();
+
+   // Forget() waits for us, so the clip stays alive until we are done
+   WaveClip *clip = key.clip;
+   Sequence *sequence = clip->GetSequence();
+   double samplesPerPixel = clip->GetRate() / key.pixelsPerSecond;
+
+   float min[kTileWidth];
+   float max[kTileWidth];
+   float rms[kTileWidth];
+   int bl[kTileWidth];
+   sampleCount where[kTileWidth + 1];
+
+   sampleCount column = (sampleCount)key.index * kTileWidth;
+   for (int x = 0; x <= kTileWidth; x++)
+      where[x] = ColumnStart(samplesPerPixel, key.phase, column + x);
+
+   // Keep Delete() and the other editing methods out while we read
+   sequence->LockDeleteUpdateMutex();
+
+   sampleCount numSamples = sequence->GetNumSamples();
+   int len = 0;
+   while (len < kTileWidth && where[len] < numSamples)
+      len++;
+
+   if (len > 0 &&
+       !sequence->GetWaveDisplay(min, max, rms, bl, len, where,
+                                 samplesPerPixel))
+      len = 0;
+
+   sequence->UnlockDeleteUpdateMutex();
+
+   // Past the end of the clip
+   for (int x = len; x < kTileWidth; x++) {
+      min[x] = max[x] = rms[x] = 0.0;
+      bl[x] = 1;
+   }
+
+   mLock.Lock();
+
+   memcpy(tile->min, min, sizeof(min));
+   memcpy(tile->max, max, sizeof(max));
+   memcpy(tile->rms, rms, sizeof(rms));
+   memcpy(tile->bl, bl, sizeof(bl));
+   tile->dirty = dirty;
+   tile->ready = true;
+   tile->rendering = false;
+   mRenderedCondition->Broadcast();
+
+   bool repaint = false;
+   mRenderedSinceRepaint++;
+   if (mRequests.empty() || mRenderedSinceRepaint >= kTilesPerRepaint) {
+      mRenderedSinceRepaint = 0;
+      repaint = true;
+   }
+
+   mLock.Unlock();
+
+   if (repaint)
+      RequestRepaint();
+}
+
+// Call with mLock held
+void WaveTileCache::Link(Tile *tile)
+{
+   tile->prev = NULL;
+   tile->next = mHead;
+   if (mHead)
+      mHead->prev = tile;
+   mHead = tile;
+   if (!mTail)
+      mTail = tile;
+}
+
+// Call with mLock held
+void WaveTileCache::Unlink(Tile *tile)
+{
+   if (tile->prev)
+      tile->prev->next = tile->next;
+   else
+      mHead = tile->next;
+
+   if (tile->next)
+      tile->next->prev = tile->prev;
+   else
+      mTail = tile->prev;
+}
+
+// Call with mLock held; the tile must not be rendering
+void WaveTileCache::Remove(Tile *tile)
+{
+   if (tile->queued)
+      mRequests.erase(std::find(mRequests.begin(), mRequests.end(), tile));
+
+   Unlink(tile);
+   mTiles.erase(tile->key);
+   delete tile;
+}
+
+// Call with mLock held
+void WaveTileCache::Trim()
+{
+   Tile *tile = mTail;
+   while (tile && mTiles.size() > kMaxTiles) {
+      Tile *prev = tile->prev;
+      if (!tile->queued && !tile->rendering)
+         Remove(tile);
+      tile = prev;
+   }
+}
+
+void WaveTileCache::RequestRepaint()
+{
+   // Same as ODManager does when on-demand tasks make progress
+   wxCommandEvent event(EVT_ODTASK_UPDATE);
+   AudacityProject::AllProjectsDeleteLock();
+   AudacityProject *proj = GetActiveProject();
+   if (proj)
+      proj->GetEventHandler()->AddPendingEvent(event);
+   AudacityProject::AllProjectsDeleteUnlock();
+}
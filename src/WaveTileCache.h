@@ -0,0 +1,132 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveTileCache.h
+
+*******************************************************************//**
+
+\class WaveTileCache
+\brief Computes the min/max/RMS shape of waveforms in fixed-width tiles
+   on the ThreadPool, so that drawing never waits for block reads.
+
+  A tile holds kTileWidth pixel columns of one WaveClip at one zoom
+  level.  Tiles sit on a pixel grid anchored at the start of the clip,
+  so scrolling reuses them; only the sub-pixel phase of the grid, which
+  depends on the clip's offset, is part of the key along with the zoom.
+
+  GetWaveDisplay() fills in what is ready and queues the rest.  Columns
+  of missing tiles come back with a negative block status, which
+  TrackArtist already draws as a placeholder; tiles that are out of
+  date after an edit are shown until their replacement is ready.  When
+  the queue drains the projects are asked to repaint.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_WAVE_TILE_CACHE__
+#define __AUDACITY_WAVE_TILE_CACHE__
+
+#include <map>
+#include <vector>
+
+#include "SampleFormat.h"
+#include "ondemand/ODTaskThread.h"
+
+class WaveClip;
+
+class WaveTileCache
+{
+ public:
+   static WaveTileCache &Get();
+
+   /// Same contract as WaveClip::GetWaveDisplay(), except that the
+   /// results may be placeholders or out of date; isLoading is set if
+   /// any column is not ready yet.  Falls back to
+   /// WaveClip::GetWaveDisplay() when there is no ThreadPool, or while
+   /// the clip has samples that haven't reached its Sequence.
+   bool GetWaveDisplay(WaveClip *clip,
+                       float *min, float *max, float *rms, int *bl,
+                       sampleCount *where, int numPixels,
+                       double t0, double pixelsPerSecond, bool &isLoading);
+
+   /// Samples [start, end) of the clip changed without a change to its
+   /// dirty count, as when on-demand loading completes.
+   void Invalidate(WaveClip *clip, sampleCount start, sampleCount end);
+
+   /// Drops all tiles of the clip, waiting for any being computed.
+   /// Must be called before the clip is deleted.
+   void Forget(WaveClip *clip);
+
+ private:
+   WaveTileCache();
+   ~WaveTileCache();
+
+   enum {
+      kTileWidth = 256,
+      kPhaseSteps = 64,
+      kMaxTiles = 2048,
+   };
+
+   class TileKey
+   {
+    public:
+      bool operator<(const TileKey &other) const;
+
+      WaveClip *clip;
+      double pixelsPerSecond;
+      int phase;
+      int index;
+   };
+
+   class Tile
+   {
+    public:
+      TileKey key;
+
+      // Dirty count of the clip when the data was requested, or -1
+      int dirty;
+      int requestedDirty;
+      bool ready;
+      bool queued;
+      bool rendering;
+
+      float min[kTileWidth];
+      float max[kTileWidth];
+      float rms[kTileWidth];
+      int bl[kTileWidth];
+
+      // Least-recently-used list, most recent first
+      Tile *prev;
+      Tile *next;
+   };
+
+   typedef std::map<TileKey, Tile *> TileMap;
+
+   friend class WaveTileJob;
+
+   static sampleCount ColumnStart(double samplesPerPixel, int phase,
+                                  sampleCount column);
+
+   Tile *Request(const TileKey &key, int dirty);
+   void RenderNext();
+   void Link(Tile *tile);
+   void Unlink(Tile *tile);
+   void Remove(Tile *tile);
+   void Trim();
+   void RequestRepaint();
+
+   TileMap mTiles;
+   Tile *mHead;
+   Tile *mTail;
+
+   // Most recent requests last; they are served first
+   std::vector<Tile *> mRequests;
+   int mRenderedSinceRepaint;
+
+   ODLock mLock;
+   ODCondition *mRenderedCondition;
+
+   static WaveTileCache sInstance;
+};
+
+#endif // __AUDACITY_WAVE_TILE_CACHE__
@@ -1734,6 +1734,78 @@ bool WaveTrack::GetRMS(float *rms, double t0, double t1)
    return result;
 }
 
+sampleCount WaveTrack::FindAbove(sampleCount start, sampleCount len,
+                                 float level)
+{
+   sampleCount found = start + len;
+
+   for (WaveClipList::compatibility_iterator it=GetClipIterator(); it; it=it->GetNext())
+   {
+      WaveClip *clip = it->GetData();
+
+      sampleCount clipStart = clip->GetStartSample();
+      sampleCount s0 = wxMax(start, clipStart);
+      sampleCount s1 = wxMin(found, clipStart + clip->GetNumSamples());
+
+      // Only the part of the clip before anything already found matters
+      if (s0 < s1)
+         found = clip->FindAbove(s0 - clipStart, s1 - s0, level) + clipStart;
+   }
+
+   return found;
+}
+
+sampleCount WaveTrack::FindQuiet(sampleCount start, sampleCount len,
+                                 float level, sampleCount minLen)
+{
+   sampleCount end = start + len;
+   sampleCount pos = start;
+
+   while (pos < end) {
+      // Find the clip holding pos, or else where the gap it is in ends
+      WaveClip *holder = NULL;
+      sampleCount segEnd = end;
+
+      for (WaveClipList::compatibility_iterator it=GetClipIterator(); it; it=it->GetNext())
+      {
+         WaveClip *clip = it->GetData();
+         sampleCount clipStart = clip->GetStartSample();
+         sampleCount clipEnd = clipStart + clip->GetNumSamples();
+
+         if (clipStart <= pos && pos < clipEnd) {
+            holder = clip;
+            segEnd = wxMin(clipEnd, end);
+            break;
+         }
+         if (clipStart > pos && clipStart < segEnd)
+            segEnd = clipStart;
+      }
+
+      sampleCount runStart = pos;
+      if (holder) {
+         sampleCount clipStart = holder->GetStartSample();
+         runStart = holder->FindQuiet(pos - clipStart, segEnd - pos,
+                                      level, minLen) + clipStart;
+      }
+
+      if (runStart == segEnd) {
+         pos = segEnd;
+         continue;
+      }
+
+      // A run begins here, but it may only have reached the end of the
+      // clip or gap, so see whether it goes on long enough after it
+      sampleCount want = wxMin(runStart + minLen, end);
+      sampleCount loud = FindAbove(runStart, want - runStart, level);
+      if (loud == want)
+         return runStart;
+
+      pos = loud + 1;
+   }
+
+   return end;
+}
+
 bool WaveTrack::Get(samplePtr buffer, sampleFormat format,
                     sampleCount start, sampleCount len, fillFormat fill )
 {
@@ -240,6 +240,18 @@ class AUDACITY_DLL_API WaveTrack: public Track {
                   double t0, double t1);
    bool GetRMS(float *rms, double t0, double t1);
 
+   /// The first sample in [start, start + len) whose absolute value is
+   /// at least level, or start + len if there is none.  This goes by
+   /// the block summaries where it can, so it is much faster than
+   /// reading the samples with Get().  level must be above zero.
+   sampleCount FindAbove(sampleCount start, sampleCount len, float level);
+   /// The start of the first run of samples in [start, start + len)
+   /// quieter than level, which is at least minLen long or reaches
+   /// start + len; or start + len if there is none.  Space between
+   /// clips counts as quiet, as it does for Get().
+   sampleCount FindQuiet(sampleCount start, sampleCount len,
+                         float level, sampleCount minLen);
+
    //
    // MM: We now have more than one sequence and envelope per track, so
    // instead of GetSequence() and GetEnvelope() we have the following
@@ -0,0 +1,300 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveTrackWriter.cpp
+
+*******************************************************************//**
+
+\file WaveTrackWriter.cpp
+\brief Implements WaveTrackWriter.
+
+*//*******************************************************************/
+
+#include "Audacity.h"
+
+#include <wx/filename.h>
+
+#include "WaveTrackWriter.h"
+
+#include "blockfile/CompressedBlockFile.h"
+#include "blockfile/PackedBlockFile.h"
+#include "blockfile/SimpleBlockFile.h"
+#include "DirManager.h"
+#include "Sequence.h"
+#include "ThreadPool.h"
+#include "WaveClip.h"
+#include "WaveTrack.h"
+
+// The number of blocks per ThreadPool thread that may be gathered but
+// not yet written.  This bounds the memory used.
+#define kBlocksInFlightPerThread 2
+
+/// One block of the track, as it will be once written
+struct WaveTrackWriterBlock
+{
+   WaveClip *clip;
+   /// Of the block in the clip's sequence
+   int index;
+   /// In the track
+   sampleCount start;
+   sampleCount len;
+   sampleFormat format;
+   /// Freed once the block file is made
+   samplePtr data;
+   /// Full path of the reserved block file name, copied so that the job
+   /// shares no string with the main thread
+   wxString name;
+   BlockFile *file;
+   /// The block file could not be written
+   bool failed;
+   bool done;
+};
+
+class WaveTrackWriterJob : public ThreadPoolJob
+{
+ public:
+   WaveTrackWriterJob(WaveTrackWriter *writer, WaveTrackWriterBlock *block)
+   {
+      mWriter = writer;
+      mBlock = block;
+   }
+
+   virtual void Run()
+   {
+      mWriter->Work(mBlock);
+   }
+
+ private:
+   WaveTrackWriter *mWriter;
+   WaveTrackWriterBlock *mBlock;
+};
+
+WaveTrackWriter::WaveTrackWriter(WaveTrack *track, sampleCount start)
+{
+   mTrack = track;
+   mDirManager = track->GetDirManager();
+   mStore = mDirManager->GetPackBlocks() ? mDirManager->GetPackedStore() : NULL;
+   mCompress = mDirManager->GetCompressBlocks();
+
+   mPos = start;
+   mCurrent = NULL;
+
+   ThreadPool *pool = ThreadPool::Get();
+   mWaited = 0;
+   mMaxInFlight = pool ? pool->GetNumThreads() * kBlocksInFlightPerThread : 0;
+   mDoneCondition = new ODCondition(&mLock);
+}
+
+WaveTrackWriter::~WaveTrackWriter()
+{
+   Discard();
+   delete mDoneCondition;
+}
+
+void WaveTrackWriter::Write(samplePtr buffer, sampleFormat format,
+                            sampleCount len)
+{
+   while (len > 0) {
+      if (!mCurrent) {
+         sampleCount gapLen;
+         if (!StartBlock(len, &gapLen)) {
+            buffer += gapLen * SAMPLE_SIZE(format);
+            mPos += gapLen;
+            len -= gapLen;
+            continue;
+         }
+      }
+
+      WaveTrackWriterBlock *b = mCurrent;
+      sampleCount n = b->start + b->len - mPos;
+      if (n > len)
+         n = len;
+
+      CopySamples(buffer, format,
+                  b->data + (mPos - b->start) * SAMPLE_SIZE(b->format),
+                  b->format, n);
+
+      buffer += n * SAMPLE_SIZE(format);
+      mPos += n;
+      len -= n;
+
+      if (mPos == b->start + b->len)
+         FinishBlock();
+   }
+}
+
+bool WaveTrackWriter::Commit()
+{
+   if (mCurrent) {
+      WaveTrackWriterBlock *b = mCurrent;
+      sampleCount end = b->start + b->len;
+      if (mPos < end)
+         b->clip->GetSequence()->Get(b->data +
+                                        (mPos - b->start) * SAMPLE_SIZE(b->format),
+                                     b->format,
+                                     mPos - b->clip->GetStartSample(),
+                                     end - mPos);
+      FinishBlock();
+   }
+
+   while (mWaited < mBlocks.size())
+      WaitUntilDone(mBlocks[mWaited++]);
+
+   // Leave the track as it was rather than put in a broken block
+   size_t i;
+   for (i = 0; i < mBlocks.size(); i++) {
+      if (mBlocks[i]->failed) {
+         Discard();
+         return false;
+      }
+   }
+
+   // The blocks of each clip are together, and in the order of the
+   // clip's blocks, so each clip takes its blocks in one go.
+   bool result = true;
+   i = 0;
+   while (i < mBlocks.size()) {
+      WaveClip *clip = mBlocks[i]->clip;
+      std::vector<BlockFile *> files;
+
+      size_t j;
+      for (j = i; j < mBlocks.size() && mBlocks[j]->clip == clip; j++) {
+         wxASSERT(mBlocks[j]->index == mBlocks[i]->index + (int)(j - i));
+         mDirManager->AddBlockFile(mBlocks[j]->file);
+         files.push_back(mBlocks[j]->file);
+         mBlocks[j]->file = NULL;
+      }
+
+      // The sequence Derefs the files if it cannot take them
+      if (!clip->GetSequence()->ReplaceBlockFiles(mBlocks[i]->index,
+                                                  &files[0], files.size()))
+         result = false;
+      clip->MarkChanged();
+
+      i = j;
+   }
+
+   for (i = 0; i < mBlocks.size(); i++)
+      delete mBlocks[i];
+   mBlocks.clear();
+   mWaited = 0;
+
+   return result;
+}
+
+bool WaveTrackWriter::StartBlock(sampleCount len, sampleCount *gapLen)
+{
+   sampleCount gapEnd = mPos + len;
+
+   for (WaveClipList::compatibility_iterator it=mTrack->GetClipIterator(); it; it=it->GetNext())
+   {
+      WaveClip *clip = it->GetData();
+      sampleCount clipStart = clip->GetStartSample();
+
+      if (clipStart <= mPos && mPos < clipStart + clip->GetNumSamples()) {
+         Sequence *seq = clip->GetSequence();
+         int index = seq->GetBlocks()->FindBlock(mPos - clipStart);
+         SeqBlock sb = seq->GetBlocks()->Item(index);
+
+         WaveTrackWriterBlock *b = new WaveTrackWriterBlock;
+         b->clip = clip;
+         b->index = index;
+         b->start = clipStart + sb.start;
+         b->len = sb.f->GetLength();
+         b->format = seq->GetSampleFormat();
+         b->data = NewSamples(b->len, b->format);
+         b->file = NULL;
+         b->failed = false;
+         b->done = false;
+
+         // The writes may begin part way into the block
+         if (b->start < mPos)
+            seq->Get(b->data, b->format, sb.start, mPos - b->start);
+
+         mCurrent = b;
+         return true;
+      }
+
+      if (clipStart > mPos && clipStart < gapEnd)
+         gapEnd = clipStart;
+   }
+
+   *gapLen = gapEnd - mPos;
+   return false;
+}
+
+void WaveTrackWriter::FinishBlock()
+{
+   WaveTrackWriterBlock *b = mCurrent;
+   mCurrent = NULL;
+
+   wxFileName name = mDirManager->ReserveBlockFileName();
+   b->name = wxString(name.GetFullPath().c_str());
+   mBlocks.push_back(b);
+
+   ThreadPool *pool = ThreadPool::Get();
+   if (!pool || mMaxInFlight == 0) {
+      Work(b);
+      mWaited = mBlocks.size();
+      return;
+   }
+
+   while (mBlocks.size() - mWaited > mMaxInFlight)
+      WaitUntilDone(mBlocks[mWaited++]);
+
+   pool->Add(new WaveTrackWriterJob(this, b));
+}
+
+void WaveTrackWriter::Work(WaveTrackWriterBlock *b)
+{
+   wxFileName name(b->name);
+   BlockFile *file;
+
+   if (mStore)
+      file = new PackedBlockFile(mStore, name, b->data, b->len, b->format);
+   else if (mCompress)
+      file = new CompressedBlockFile(name, b->data, b->len, b->format);
+   else
+      file = new SimpleBlockFile(name, b->data, b->len, b->format);
+
+   DeleteSamples(b->data);
+   b->data = NULL;
+
+   mLock.Lock();
+   b->file = file;
+   b->failed = file->IsWriteFailed();
+   b->done = true;
+   mDoneCondition->Broadcast();
+   mLock.Unlock();
+}
+
+void WaveTrackWriter::WaitUntilDone(WaveTrackWriterBlock *b)
+{
+   mLock.Lock();
+   while (!b->done)
+      mDoneCondition->Wait();
+   mLock.Unlock();
+}
+
+void WaveTrackWriter::Discard()
+{
+   if (mCurrent) {
+      DeleteSamples(mCurrent->data);
+      delete mCurrent;
+      mCurrent = NULL;
+   }
+
+   // The jobs still running use the blocks, and the block files they
+   // made belong to no track
+   for (size_t i = 0; i < mBlocks.size(); i++) {
+      WaveTrackWriterBlock *b = mBlocks[i];
+      if (i >= mWaited)
+         WaitUntilDone(b);
+      mDirManager->AddBlockFile(b->file);
+      mDirManager->Deref(b->file);
+      delete b;
+   }
+   mBlocks.clear();
+   mWaited = 0;
+}
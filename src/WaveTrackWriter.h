@@ -0,0 +1,91 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  WaveTrackWriter.h
+
+*******************************************************************//**
+
+\class WaveTrackWriter
+\brief Writes a stretch of a WaveTrack in place, a block at a time,
+  making the new block files on the ThreadPool.
+
+  It takes the place of a series of WaveTrack::Set() calls over
+  consecutive samples, as in-place effects make.  Set() rewrites a
+  block file, summaries and all, before it returns; here each block is
+  gathered as the samples come, then handed to the ThreadPool to write
+  while the caller goes on reading and processing.  The track is not
+  changed until Commit(), which puts all of the new blocks in at once.
+
+  So the track must not be changed any other way until Commit(), and
+  reads of it in the meantime see the old samples.  The writes must not
+  overlap the places the caller has still to read, as holds for
+  effects that read a buffer, process it and write it back.  Samples
+  that fall between clips are dropped, as by Set().
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_WAVE_TRACK_WRITER__
+#define __AUDACITY_WAVE_TRACK_WRITER__
+
+#include <vector>
+
+#include "SampleFormat.h"
+#include "ondemand/ODTaskThread.h"
+
+class DirManager;
+class PackedBlockStore;
+class WaveClip;
+class WaveTrack;
+struct WaveTrackWriterBlock;
+
+class WaveTrackWriter
+{
+ public:
+   /// Writes track from sample start on
+   WaveTrackWriter(WaveTrack *track, sampleCount start);
+   /// Throws away anything not yet committed
+   ~WaveTrackWriter();
+
+   /// Writes the next len samples
+   void Write(samplePtr buffer, sampleFormat format, sampleCount len);
+
+   /// Waits for the new blocks and puts them in the track.  The rest of
+   /// the block the writes ended in keeps its old samples.  If any block
+   /// could not be written, returns false and leaves the track alone.
+   bool Commit();
+
+ private:
+   friend class WaveTrackWriterJob;
+
+   /// Starts gathering the block holding mPos.  Returns false if mPos
+   /// falls between clips, setting *gapLen to how many of the next len
+   /// samples come before the next clip.
+   bool StartBlock(sampleCount len, sampleCount *gapLen);
+   /// Hands the full mCurrent to the ThreadPool
+   void FinishBlock();
+   /// Makes the block file of a block; run on a ThreadPool thread
+   void Work(WaveTrackWriterBlock *block);
+   void WaitUntilDone(WaveTrackWriterBlock *block);
+   /// Waits for the blocks and removes those not committed
+   void Discard();
+
+   WaveTrack *mTrack;
+   DirManager *mDirManager;
+   PackedBlockStore *mStore;
+   bool mCompress;
+
+   sampleCount mPos;
+   WaveTrackWriterBlock *mCurrent;
+
+   /// In the order they were written
+   std::vector<WaveTrackWriterBlock *> mBlocks;
+   /// Those before this have been waited for
+   size_t mWaited;
+   size_t mMaxInFlight;
+
+   ODLock mLock;
+   ODCondition *mDoneCondition;
+};
+
+#endif // __AUDACITY_WAVE_TRACK_WRITER__
@@ -0,0 +1,591 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressedBlockFile.cpp
+
+*******************************************************************//**
+
+\class CompressedBlockFile
+\brief A BlockFile that stores its samples losslessly compressed, in an
+.auc file.
+
+The file holds an aucHeader, the summary, and then the samples.  The
+summary is never compressed, so that drawing the waveform costs no more
+than for a SimpleBlockFile.
+
+16 and 24 bit samples are stored as a FLAC stream.  Float samples are
+too, if each one is exactly a 24 bit sample scaled into [-1, 1), as
+they are after importing or recording integer audio into a 32-bit float
+project; otherwise, as for audio that has been processed, they are
+stored as they are in memory.  Samples are also stored as they are if
+FLAC would not make them smaller, or if Audacity was built without
+libFLAC.
+
+Each block is decoded on its own, by whichever thread reads it, and the
+whole block is decoded on a BlockCache miss, so that later reads of it
+cost nothing.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+
+#include <string.h>
+#include <vector>
+
+#include <wx/wx.h>
+#include <wx/ffile.h>
+#include <wx/log.h>
+
+#include "CompressedBlockFile.h"
+#include "../Internat.h"
+#include "../Profiler.h"
+
+#ifdef USE_LIBFLAC
+#include "FLAC++/encoder.h"
+#include "FLAC++/decoder.h"
+#endif
+
+// Samples are stored as they are in memory, so each file records the
+// byte order of the machine that wrote it
+static const char kAucMagic[12] = "AudacityBlk";
+static const wxUint32 kAucByteOrderMark = 0x01020304;
+
+#ifdef USE_LIBFLAC
+
+// libFLAC's default; higher levels barely shrink audio further
+enum { kFlacCompressionLevel = 5 };
+
+/// Finds integers that give back the samples exactly, and how many bits
+/// they need.  Returns false if there are none, as for most float data
+/// that has been processed.
+static bool SamplesToInts(samplePtr sampleData, sampleCount len,
+                          sampleFormat format, FLAC__int32 *ints,
+                          unsigned *bits, unsigned *scaleBits)
+{
+   sampleCount i;
+
+   *scaleBits = 0;
+
+   if (format == int16Sample) {
+      const short *shorts = (const short *)sampleData;
+      for (i = 0; i < len; i++)
+         ints[i] = shorts[i];
+      *bits = 16;
+      return true;
+   }
+
+   if (format == int24Sample) {
+      const int *values = (const int *)sampleData;
+      for (i = 0; i < len; i++) {
+         if (values[i] < -0x800000 || values[i] > 0x7fffff)
+            return false;
+         ints[i] = values[i];
+      }
+      *bits = 24;
+      return true;
+   }
+
+   // Powers of two scale floats exactly, so comparing the bits of the
+   // sample that would be read back is enough.  That also turns away
+   // -0.0, NaNs and samples outside [-1, 1).
+   const float *floats = (const float *)sampleData;
+   bool fitsIn16 = true;
+   for (i = 0; i < len; i++) {
+      float scaled = floats[i] * 8388608.0f;
+      if (!(scaled >= -8388608.0f && scaled <= 8388607.0f))
+         return false;
+
+      int value = (int)scaled;
+      float back = (float)value * (1.0f / 8388608.0f);
+      if (memcmp(&back, &floats[i], sizeof(float)))
+         return false;
+
+      ints[i] = value;
+      if (value & 0xff)
+         fitsIn16 = false;
+   }
+
+   if (fitsIn16) {
+      // Such as 16 bit audio imported into a float project
+      for (i = 0; i < len; i++)
+         ints[i] >>= 8;
+      *bits = 16;
+      *scaleBits = 15;
+   }
+   else {
+      *bits = 24;
+      *scaleBits = 23;
+   }
+
+   return true;
+}
+
+class BlockFlacEncoder : public FLAC::Encoder::Stream
+{
+ public:
+   BlockFlacEncoder(std::vector<char> *out)
+   {
+      mOut = out;
+   }
+
+ protected:
+   virtual ::FLAC__StreamEncoderWriteStatus write_callback(
+      const FLAC__byte buffer[], size_t bytes,
+      unsigned WXUNUSED(samples), unsigned WXUNUSED(current_frame))
+   {
+      mOut->insert(mOut->end(), (const char *)buffer,
+                   (const char *)buffer + bytes);
+      return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+   }
+
+ private:
+   std::vector<char> *mOut;
+};
+
+static bool EncodeFlac(const FLAC__int32 *ints, sampleCount len,
+                       unsigned bits, std::vector<char> &out)
+{
+   BlockFlacEncoder encoder(&out);
+
+   // Block files are always mono, and the rate only goes in the header
+   encoder.set_channels(1);
+   encoder.set_bits_per_sample(bits);
+   encoder.set_sample_rate(44100);
+   encoder.set_compression_level(kFlacCompressionLevel);
+   encoder.set_total_samples_estimate(len);
+
+   if (encoder.init() != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+      return false;
+
+   bool success = encoder.process(&ints, len);
+   return encoder.finish() && success;
+}
+
+class BlockFlacDecoder : public FLAC::Decoder::Stream
+{
+ public:
+   /// Decodes the first wanted samples of the stream in data into ints
+   BlockFlacDecoder(const char *data, size_t bytes,
+                    FLAC__int32 *ints, sampleCount wanted)
+   {
+      mData = data;
+      mBytes = bytes;
+      mPos = 0;
+      mInts = ints;
+      mWanted = wanted;
+      mDecoded = 0;
+      mError = false;
+   }
+
+   bool Succeeded() { return mDecoded == mWanted && !mError; }
+
+ protected:
+   virtual ::FLAC__StreamDecoderReadStatus read_callback(FLAC__byte buffer[],
+                                                         size_t *bytes)
+   {
+      size_t left = mBytes - mPos;
+      if (left == 0) {
+         *bytes = 0;
+         return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+      }
+
+      if (*bytes > left)
+         *bytes = left;
+      memcpy(buffer, mData + mPos, *bytes);
+      mPos += *bytes;
+      return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+   }
+
+   virtual ::FLAC__StreamDecoderWriteStatus write_callback(
+      const ::FLAC__Frame *frame, const FLAC__int32 * const buffer[])
+   {
+      sampleCount count = frame->header.blocksize;
+      if (count > mWanted - mDecoded)
+         count = mWanted - mDecoded;
+      memcpy(mInts + mDecoded, buffer[0], count * sizeof(FLAC__int32));
+      mDecoded += count;
+
+      // Frames after the wanted samples are not decoded
+      return (mDecoded < mWanted) ?
+         FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE :
+         FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+   }
+
+   virtual void error_callback(::FLAC__StreamDecoderErrorStatus WXUNUSED(status))
+   {
+      mError = true;
+   }
+
+ private:
+   const char *mData;
+   size_t mBytes;
+   size_t mPos;
+   FLAC__int32 *mInts;
+   sampleCount mWanted;
+   sampleCount mDecoded;
+   bool mError;
+};
+
+static bool DecodeFlac(const char *data, size_t bytes,
+                       FLAC__int32 *ints, sampleCount wanted)
+{
+   BlockFlacDecoder decoder(data, bytes, ints, wanted);
+
+   if (decoder.init() != FLAC__STREAM_DECODER_INIT_STATUS_OK)
+      return false;
+
+   // This returns false when the decoder stops after the wanted samples
+   decoder.process_until_end_of_stream();
+   decoder.finish();
+
+   return decoder.Succeeded();
+}
+
+#endif // USE_LIBFLAC
+
+/// Create a disk file and write summary and sample data to it
+///
+/// @param baseFileName The filename to use, but without an extension.
+///                     This constructor will add the appropriate
+///                     extension (.auc in this case).
+CompressedBlockFile::CompressedBlockFile(wxFileName baseFileName,
+                                         samplePtr sampleData,
+                                         sampleCount sampleLen,
+                                         sampleFormat format):
+   BlockFile(wxFileName(baseFileName.GetFullPath() + wxT(".auc")), sampleLen)
+{
+   mFileBytes = -1;
+
+   bool bSuccess = WriteCompressedBlockFile(sampleData, sampleLen, format);
+   wxASSERT(bSuccess); // TODO: Handle failure here by alert to user and undo partial op.
+   mWriteFailed = !bSuccess;
+}
+
+/// Construct a CompressedBlockFile memory structure that will point to an
+/// existing block file.
+CompressedBlockFile::CompressedBlockFile(wxFileName existingFile,
+                                         sampleCount len,
+                                         float min, float max, float rms):
+   BlockFile(existingFile, len)
+{
+   mMin = min;
+   mMax = max;
+   mRMS = rms;
+
+   mFileBytes = -1;
+}
+
+CompressedBlockFile::~CompressedBlockFile()
+{
+}
+
+bool CompressedBlockFile::WriteCompressedBlockFile(samplePtr sampleData,
+                                                   sampleCount sampleLen,
+                                                   sampleFormat format)
+{
+   PROFILE_ZONE("CompressedBlockFile::WriteCompressedBlockFile");
+
+   aucHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, kAucMagic, sizeof(kAucMagic));
+   header.byteOrder = kAucByteOrderMark;
+   header.coding = AUC_CODING_RAW;
+   header.format = format;
+   header.scaleBits = 0;
+   header.dataSize = sampleLen * SAMPLE_SIZE(format);
+
+   const char *data = sampleData;
+
+#ifdef USE_LIBFLAC
+   std::vector<char> flac;
+   FLAC__int32 *ints = new FLAC__int32[sampleLen];
+   unsigned bits, scaleBits;
+
+   if (SamplesToInts(sampleData, sampleLen, format, ints, &bits, &scaleBits) &&
+       EncodeFlac(ints, sampleLen, bits, flac) &&
+       flac.size() < header.dataSize) {
+      header.coding = AUC_CODING_FLAC;
+      header.scaleBits = scaleBits;
+      header.dataSize = flac.size();
+      data = &flac[0];
+   }
+
+   delete[] ints;
+#endif
+
+   void *summaryData = CalcSummary(sampleData, sampleLen, format);
+
+   wxFFile file(mFileName.GetFullPath(), wxT("wb"));
+   if (!file.IsOpened())
+      return false;
+
+   size_t summaryBytes = mSummaryInfo.totalSummaryBytes;
+   if (file.Write(&header, sizeof(header)) != sizeof(header) ||
+       file.Write(summaryData, summaryBytes) != summaryBytes ||
+       file.Write(data, header.dataSize) != header.dataSize)
+   {
+      wxLogDebug(wxT("Could not write block file %s."),
+                 mFileName.GetFullPath().c_str());
+      return false;
+   }
+
+   mFileBytes = sizeof(header) + summaryBytes + header.dataSize;
+   return true;
+}
+
+/// Reads and checks the header.  Files from a machine of the other byte
+/// order are not read, as for packed blocks.
+bool CompressedBlockFile::ReadHeader(wxFFile &file, aucHeader *header)
+{
+   if (!file.IsOpened() ||
+       file.Read(header, sizeof(aucHeader)) != sizeof(aucHeader))
+      return false;
+
+   if (memcmp(header->magic, kAucMagic, sizeof(kAucMagic)) ||
+       header->byteOrder != kAucByteOrderMark ||
+       !XMLValueChecker::IsValidSampleFormat(header->format))
+      return false;
+
+   if (header->coding == AUC_CODING_RAW)
+      return header->dataSize ==
+         (wxUint32)(mLen * SAMPLE_SIZE((sampleFormat)header->format));
+
+   return header->coding == AUC_CODING_FLAC && header->scaleBits <= 23;
+}
+
+/// Read the summary of this block file from disk.  The summary is stored
+/// uncompressed, just after the header.
+///
+/// @param *data The buffer to write the data to.  It must be at least
+/// mSummaryinfo.totalSummaryBytes long.
+bool CompressedBlockFile::ReadSummary(void *data)
+{
+   PROFILE_ZONE("CompressedBlockFile::ReadSummary");
+
+   wxLogNull *silence=0;
+   if(mSilentLog)silence= new wxLogNull();
+
+   wxFFile file(mFileName.GetFullPath(), wxT("rb"));
+
+   if(!file.IsOpened() ){
+
+      memset(data,0,(size_t)mSummaryInfo.totalSummaryBytes);
+
+      if(silence) delete silence;
+      mSilentLog=TRUE;
+
+      return true;
+   }
+
+   if(silence) delete silence;
+   mSilentLog=FALSE;
+
+   if( !file.Seek(sizeof(aucHeader)) )
+      return false;
+
+   int read = (int)file.Read(data, (size_t)mSummaryInfo.totalSummaryBytes);
+
+   FixSummary(data);
+
+   return (read == mSummaryInfo.totalSummaryBytes);
+}
+
+/// Read and decode the data portion of the block file.  Convert it to the
+/// given format if it is not already.  Samples that can't be read are
+/// silence.
+///
+/// @param data   The buffer where the data will be stored
+/// @param format The format the data will be stored in
+/// @param start  The offset in this block file
+/// @param len    The number of samples to read
+int CompressedBlockFile::ReadData(samplePtr data, sampleFormat format,
+                                  sampleCount start, sampleCount len)
+{
+   PROFILE_ZONE("CompressedBlockFile::ReadData");
+
+   if (len > mLen - start)
+      len = mLen - start;
+   if (len <= 0)
+      return 0;
+
+   wxLogNull *silence=0;
+   if(mSilentLog)silence= new wxLogNull();
+
+   wxFFile file(mFileName.GetFullPath(), wxT("rb"));
+   aucHeader header;
+   memset(&header, 0, sizeof(header));
+   bool success = ReadHeader(file, &header);
+
+   if(silence) delete silence;
+
+   sampleFormat diskFormat = (sampleFormat)header.format;
+   samplePtr buffer = NULL;
+
+   if (success && header.coding == AUC_CODING_RAW) {
+      // Only the samples wanted are read
+      buffer = (diskFormat == format) ? data : NewSamples(len, diskFormat);
+      size_t bytes = len * SAMPLE_SIZE(diskFormat);
+      success = file.Seek(sizeof(aucHeader) + mSummaryInfo.totalSummaryBytes +
+                          start * SAMPLE_SIZE(diskFormat)) &&
+         file.Read(buffer, bytes) == bytes;
+   }
+#ifdef USE_LIBFLAC
+   else if (success && header.coding == AUC_CODING_FLAC) {
+      // The stream is decoded from its start up to the last sample wanted
+      char *flac = new char[header.dataSize];
+      FLAC__int32 *ints = new FLAC__int32[start + len];
+
+      success = file.Seek(sizeof(aucHeader) + mSummaryInfo.totalSummaryBytes) &&
+         file.Read(flac, header.dataSize) == header.dataSize &&
+         DecodeFlac(flac, header.dataSize, ints, start + len);
+
+      if (success) {
+         buffer = (diskFormat == format) ? data : NewSamples(len, diskFormat);
+
+         const FLAC__int32 *src = ints + start;
+         sampleCount i;
+         if (diskFormat == int16Sample) {
+            short *shorts = (short *)buffer;
+            for (i = 0; i < len; i++)
+               shorts[i] = (short)src[i];
+         }
+         else if (diskFormat == int24Sample) {
+            int *values = (int *)buffer;
+            for (i = 0; i < len; i++)
+               values[i] = src[i];
+         }
+         else {
+            // A power of two, so this gives back the samples exactly
+            float scale = 1.0f / (float)(1 << header.scaleBits);
+            float *floats = (float *)buffer;
+            for (i = 0; i < len; i++)
+               floats[i] = (float)src[i] * scale;
+         }
+      }
+
+      delete[] ints;
+      delete[] flac;
+   }
+#endif
+   else
+      success = false;
+
+   if (success) {
+      if (buffer != data)
+         CopySamples(buffer, diskFormat, data, format, len);
+      mSilentLog = FALSE;
+   }
+   else {
+      memset(data, 0, len * SAMPLE_SIZE(format));
+      if (!mSilentLog && file.IsOpened())
+         wxLogWarning(_("Could not read the audio data of block file '%s'; it is replaced with silence."),
+                      mFileName.GetFullPath().c_str());
+      mSilentLog = TRUE;
+   }
+
+   if (buffer && buffer != data)
+      DeleteSamples(buffer);
+
+   return len;
+}
+
+void CompressedBlockFile::SaveXML(XMLWriter &xmlFile)
+{
+   xmlFile.StartTag(wxT("compressedblockfile"));
+
+   xmlFile.WriteAttr(wxT("filename"), mFileName.GetFullName());
+   xmlFile.WriteAttr(wxT("len"), mLen);
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("compressedblockfile"));
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to nonexistent file),
+// as testing will be done in DirManager::ProjectFSCK().
+/// static
+BlockFile *CompressedBlockFile::BuildFromXML(DirManager &dm, const wxChar **attrs)
+{
+   wxFileName fileName;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   sampleCount len = 0;
+   double dblValue;
+   long nValue;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStricmp(attr, wxT("filename")) &&
+            XMLValueChecker::IsGoodFileString(strValue) &&
+            (strValue.Length() + 1 + dm.GetProjectDataDir().Length() <= PLATFORM_MAX_PATH))
+      {
+         if (!dm.AssignFile(fileName, strValue, false))
+            fileName.Clear();
+      }
+      else if (!wxStrcmp(attr, wxT("len")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         len = nValue;
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   return new CompressedBlockFile(fileName, len, min, max, rms);
+}
+
+/// Create a copy of this BlockFile, but using a different disk file.
+/// DirManager has already copied the file.
+///
+/// @param newFileName The name of the new file to use.
+BlockFile *CompressedBlockFile::Copy(wxFileName newFileName)
+{
+   return new CompressedBlockFile(newFileName, mLen, mMin, mMax, mRMS);
+}
+
+wxLongLong CompressedBlockFile::GetSpaceUsage()
+{
+   // Unlike for .au files, this can't be worked out from the length
+   if (mFileBytes < 0) {
+      wxFFile file(mFileName.GetFullPath());
+      if (file.IsOpened())
+         mFileBytes = file.Length();
+   }
+
+   return (mFileBytes < 0) ? 0 : mFileBytes;
+}
+
+/// Replaces the file with one of silence.
+void CompressedBlockFile::Recover()
+{
+   samplePtr zeros = NewSamples(mLen, int16Sample);
+   memset(zeros, 0, mLen * SAMPLE_SIZE(int16Sample));
+
+   WriteCompressedBlockFile(zeros, mLen, int16Sample);
+
+   DeleteSamples(zeros);
+}
+
+/// static
+bool CompressedBlockFile::CanCompress()
+{
+#ifdef USE_LIBFLAC
+   return true;
+#else
+   return false;
+#endif
+}
@@ -0,0 +1,80 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  CompressedBlockFile.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_COMPRESSED_BLOCKFILE__
+#define __AUDACITY_COMPRESSED_BLOCKFILE__
+
+#include <wx/string.h>
+#include <wx/filename.h>
+
+#include "../BlockFile.h"
+#include "../DirManager.h"
+#include "../xml/XMLWriter.h"
+
+// How the samples of an .auc file are stored
+enum {
+   AUC_CODING_RAW = 0,  // as they are in memory
+   AUC_CODING_FLAC = 1, // as a FLAC stream of integers
+};
+
+typedef struct {
+   char     magic[12];  // "AudacityBlk"
+   wxUint32 byteOrder;  // 0x01020304, in the writer's byte order
+   wxUint32 coding;     // AUC_CODING_RAW or AUC_CODING_FLAC
+   wxUint32 format;     // sampleFormat of the block
+   wxUint32 scaleBits;  // for FLAC-coded float samples, the integers are
+                        // the samples times 2^scaleBits; otherwise 0
+   wxUint32 dataSize;   // bytes of sample data after the summary
+} aucHeader;
+
+class CompressedBlockFile : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// Create a disk file and write summary and compressed sample data to it
+   CompressedBlockFile(wxFileName baseFileName,
+                       samplePtr sampleData, sampleCount sampleLen,
+                       sampleFormat format);
+   /// Create the memory structure to refer to the given block file
+   CompressedBlockFile(wxFileName existingFile, sampleCount len,
+                       float min, float max, float rms);
+
+   virtual ~CompressedBlockFile();
+
+   // Reading
+
+   /// Read the summary section of the disk file
+   virtual bool ReadSummary(void *data);
+   /// Read and decode the data section of the disk file
+   virtual int ReadData(samplePtr data, sampleFormat format,
+                        sampleCount start, sampleCount len);
+
+   /// Create a new block file identical to this one
+   virtual BlockFile *Copy(wxFileName newFileName);
+   /// Write an XML representation of this file
+   virtual void SaveXML(XMLWriter &xmlFile);
+
+   virtual wxLongLong GetSpaceUsage();
+   virtual void Recover();
+
+   static BlockFile *BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   /// True if this build can write FLAC-coded blocks
+   static bool CanCompress();
+
+ private:
+   bool WriteCompressedBlockFile(samplePtr sampleData, sampleCount sampleLen,
+                                 sampleFormat format);
+   bool ReadHeader(wxFFile &file, aucHeader *header);
+
+   // Size of the file on disk, or -1 if not yet known
+   wxLongLong mFileBytes;
+};
+
+#endif
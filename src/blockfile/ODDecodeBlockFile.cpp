@@ -27,6 +27,7 @@ The summary is eventually computed and written to a file in a background thread.
 
 #include "../FileFormats.h"
 #include "../Internat.h"
+#include "../Profiler.h"
 
 const int bheaderTagLen = 20;
 char bheaderTag[bheaderTagLen + 1] = "AudacityBlockFile112";
@@ -527,6 +528,8 @@ void *ODDecodeBlockFile::CalcSummary(samplePtr buffer, sampleCount len,
 int ODDecodeBlockFile::ReadData(samplePtr data, sampleFormat format,
                                 sampleCount start, sampleCount len)
 {
+   PROFILE_ZONE("ODDecodeBlockFile::ReadData");
+
    int ret;
    LockRead();
    if(IsSummaryAvailable())
@@ -30,6 +30,7 @@ The summary is eventually computed and written to a file in a background thread.
 #include "PCMAliasBlockFile.h"
 #include "../FileFormats.h"
 #include "../Internat.h"
+#include "../Profiler.h"
 
 #include "../ondemand/ODManager.h"
 #include "../AudioIO.h"
@@ -595,6 +596,8 @@ void *ODPCMAliasBlockFile::CalcSummary(samplePtr buffer, sampleCount len,
 int ODPCMAliasBlockFile::ReadData(samplePtr data, sampleFormat format,
                                 sampleCount start, sampleCount len)
 {
+   PROFILE_ZONE("ODPCMAliasBlockFile::ReadData");
+
 
    LockRead();
 
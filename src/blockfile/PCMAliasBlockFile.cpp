@@ -18,6 +18,7 @@
 #include "PCMAliasBlockFile.h"
 #include "../FileFormats.h"
 #include "../Internat.h"
+#include "../Profiler.h"
 
 #include "../ondemand/ODManager.h"
 #include "../AudioIO.h"
@@ -73,6 +74,8 @@ PCMAliasBlockFile::~PCMAliasBlockFile()
 int PCMAliasBlockFile::ReadData(samplePtr data, sampleFormat format,
                                 sampleCount start, sampleCount len)
 {
+   PROFILE_ZONE("PCMAliasBlockFile::ReadData");
+
    SF_INFO info;
 
    if(!mAliasedFileName.IsOk()){ // intentionally silenced
@@ -0,0 +1,264 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.cpp
+
+*******************************************************************//**
+
+\class PackedBlockFile
+\brief A BlockFile whose summary and sample data are kept, uncompressed,
+in a segment file of a PackedBlockStore rather than in a file of its own.
+
+The data is the summary followed by the samples, in the format they were
+given in and in native byte order, as they are in memory.  The block's
+name is used only to tell it apart in the project file; no file has it.
+
+When the last reference to the block goes, its bytes are left where they
+are, and reclaimed when the DirManager next compacts the store.
+
+*//*******************************************************************/
+
+#include <wx/wx.h>
+#include <wx/log.h>
+
+#include "PackedBlockFile.h"
+#include "../Internat.h"
+#include "../Profiler.h"
+
+PackedBlockFile::PackedBlockFile(PackedBlockStore *store,
+                                 wxFileName baseFileName,
+                                 samplePtr sampleData, sampleCount sampleLen,
+                                 sampleFormat format):
+   BlockFile(baseFileName, sampleLen),
+   mStore(store),
+   mFormat(format)
+{
+   PROFILE_ZONE("PackedBlockFile::PackedBlockFile");
+
+   mStore->Ref();
+
+   void *summaryData = CalcSummary(sampleData, sampleLen, format);
+   size_t summaryBytes = mSummaryInfo.totalSummaryBytes;
+   size_t sampleBytes = sampleLen * SAMPLE_SIZE(format);
+
+   // One append, so that the block is in one piece even when other
+   // threads are appending too
+   char *buffer = new char[summaryBytes + sampleBytes];
+   memcpy(buffer, summaryData, summaryBytes);
+   memcpy(buffer + summaryBytes, sampleData, sampleBytes);
+
+   mExtent.segment = -1;
+   mExtent.offset = 0;
+   mExtent.bytes = 0;
+   bool bSuccess = mStore->Append(buffer, summaryBytes + sampleBytes, &mExtent);
+   wxASSERT(bSuccess); // TODO: Handle failure here by alert to user and undo partial op.
+   mWriteFailed = !bSuccess;
+
+   delete[] buffer;
+}
+
+PackedBlockFile::PackedBlockFile(PackedBlockStore *store,
+                                 wxFileName baseFileName,
+                                 const PackedExtent &extent, sampleCount len,
+                                 sampleFormat format,
+                                 float min, float max, float rms):
+   BlockFile(baseFileName, len),
+   mStore(store),
+   mExtent(extent),
+   mFormat(format)
+{
+   mStore->Ref();
+
+   mMin = min;
+   mMax = max;
+   mRMS = rms;
+}
+
+PackedBlockFile::~PackedBlockFile()
+{
+   // There is no file of its own for ~BlockFile() to remove
+   Lock();
+
+   mStore->Deref();
+}
+
+bool PackedBlockFile::ReadSummary(void *data)
+{
+   PROFILE_ZONE("PackedBlockFile::ReadSummary");
+
+   if (!mStore->Read(mExtent, 0, data, mSummaryInfo.totalSummaryBytes)) {
+      // As for a missing .au file: the summary reads as silence
+      memset(data, 0, (size_t)mSummaryInfo.totalSummaryBytes);
+      mSilentLog = TRUE;
+      return true;
+   }
+
+   FixSummary(data);
+   return true;
+}
+
+int PackedBlockFile::ReadData(samplePtr data, sampleFormat format,
+                              sampleCount start, sampleCount len)
+{
+   PROFILE_ZONE("PackedBlockFile::ReadData");
+
+   if (len > mLen - start)
+      len = mLen - start;
+   if (len <= 0)
+      return 0;
+
+   samplePtr buffer = (format == mFormat) ? data : NewSamples(len, mFormat);
+   size_t pos = mSummaryInfo.totalSummaryBytes + start * SAMPLE_SIZE(mFormat);
+
+   if (mStore->Read(mExtent, pos, buffer, len * SAMPLE_SIZE(mFormat))) {
+      if (buffer != data)
+         CopySamples(buffer, mFormat, data, format, len);
+      mSilentLog = FALSE;
+   }
+   else {
+      memset(data, 0, len * SAMPLE_SIZE(format));
+      if (!mSilentLog)
+         wxLogWarning(_("Could not read the audio data of block '%s'; it is replaced with silence."),
+                      mFileName.GetName().c_str());
+      mSilentLog = TRUE;
+   }
+
+   if (buffer != data)
+      DeleteSamples(buffer);
+
+   return len;
+}
+
+BlockFile *PackedBlockFile::Copy(wxFileName newFileName)
+{
+   return CopyTo(mStore, newFileName);
+}
+
+/// Copy this block's data to the end of the given store, which may be
+/// that of another project.  Returns NULL if it can't be read or written.
+BlockFile *PackedBlockFile::CopyTo(PackedBlockStore *store,
+                                   wxFileName newFileName)
+{
+   char *buffer = new char[mExtent.bytes];
+   PackedExtent extent;
+
+   bool success = mStore->Read(mExtent, 0, buffer, mExtent.bytes) &&
+      store->Append(buffer, mExtent.bytes, &extent);
+   delete[] buffer;
+
+   if (!success)
+      return NULL;
+
+   return new PackedBlockFile(store, newFileName, extent, mLen, mFormat,
+                              mMin, mMax, mRMS);
+}
+
+void PackedBlockFile::SaveXML(XMLWriter &xmlFile)
+{
+   xmlFile.StartTag(wxT("packedblockfile"));
+
+   xmlFile.WriteAttr(wxT("filename"), mFileName.GetFullName());
+   xmlFile.WriteAttr(wxT("segment"), mExtent.segment);
+   xmlFile.WriteAttr(wxT("offset"), (long long)mExtent.offset);
+   xmlFile.WriteAttr(wxT("bytes"), mExtent.bytes);
+   xmlFile.WriteAttr(wxT("len"), mLen);
+   xmlFile.WriteAttr(wxT("format"), (int)mFormat);
+   xmlFile.WriteAttr(wxT("min"), mMin);
+   xmlFile.WriteAttr(wxT("max"), mMax);
+   xmlFile.WriteAttr(wxT("rms"), mRMS);
+
+   xmlFile.EndTag(wxT("packedblockfile"));
+}
+
+// BuildFromXML methods should always return a BlockFile, not NULL,
+// even if the result is flawed (e.g., refers to nonexistent data),
+// as testing will be done in DirManager::ProjectFSCK().
+/// static
+BlockFile *PackedBlockFile::BuildFromXML(DirManager &dm, const wxChar **attrs)
+{
+   wxFileName fileName;
+   PackedExtent extent;
+   float min = 0.0f, max = 0.0f, rms = 0.0f;
+   sampleCount len = 0;
+   sampleFormat format = floatSample;
+   double dblValue;
+   long nValue;
+   wxLongLong_t llValue;
+
+   extent.segment = -1;
+   extent.offset = 0;
+   extent.bytes = 0;
+
+   while(*attrs)
+   {
+      const wxChar *attr =  *attrs++;
+      const wxChar *value = *attrs++;
+      if (!value)
+         break;
+
+      const wxString strValue = value;
+      if (!wxStricmp(attr, wxT("filename")) &&
+            XMLValueChecker::IsGoodFileString(strValue) &&
+            (strValue.Length() + 1 + dm.GetProjectDataDir().Length() <= PLATFORM_MAX_PATH))
+      {
+         if (!dm.AssignFile(fileName, strValue, false))
+            fileName.Clear();
+      }
+      else if (!wxStrcmp(attr, wxT("segment")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue >= 0)
+         extent.segment = nValue;
+      else if (!wxStrcmp(attr, wxT("offset")) &&
+               XMLValueChecker::IsGoodInt64(strValue) && strValue.ToLongLong(&llValue) &&
+               llValue >= 0)
+         extent.offset = llValue;
+      else if (!wxStrcmp(attr, wxT("bytes")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         extent.bytes = nValue;
+      else if (!wxStrcmp(attr, wxT("len")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               nValue > 0)
+         len = nValue;
+      else if (!wxStrcmp(attr, wxT("format")) &&
+               XMLValueChecker::IsGoodInt(strValue) && strValue.ToLong(&nValue) &&
+               XMLValueChecker::IsValidSampleFormat(nValue))
+         format = (sampleFormat)nValue;
+      else if (XMLValueChecker::IsGoodString(strValue) && Internat::CompatibleToDouble(strValue, &dblValue))
+      {  // double parameters
+         if (!wxStricmp(attr, wxT("min")))
+            min = dblValue;
+         else if (!wxStricmp(attr, wxT("max")))
+            max = dblValue;
+         else if (!wxStricmp(attr, wxT("rms")) && (dblValue >= 0.0))
+            rms = dblValue;
+      }
+   }
+
+   PackedBlockStore *store = dm.GetPackedStore();
+   if (extent.segment >= 0)
+      store->NoteSegment(extent.segment);
+
+   return new PackedBlockFile(store, fileName, extent, len, format,
+                              min, max, rms);
+}
+
+wxLongLong PackedBlockFile::GetSpaceUsage()
+{
+   return mExtent.bytes;
+}
+
+/// Replaces the data with silence, at the end of the store.
+void PackedBlockFile::Recover()
+{
+   size_t bytes = mSummaryInfo.totalSummaryBytes + mLen * SAMPLE_SIZE(mFormat);
+   char *zeros = new char[bytes];
+   memset(zeros, 0, bytes);
+
+   PackedExtent extent;
+   if (mStore->Append(zeros, bytes, &extent))
+      mExtent = extent;
+
+   delete[] zeros;
+}
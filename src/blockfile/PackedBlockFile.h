@@ -0,0 +1,73 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockFile.h
+
+**********************************************************************/
+
+#ifndef __AUDACITY_PACKED_BLOCKFILE__
+#define __AUDACITY_PACKED_BLOCKFILE__
+
+#include <wx/string.h>
+#include <wx/filename.h>
+
+#include "../BlockFile.h"
+#include "../DirManager.h"
+#include "../xml/XMLWriter.h"
+#include "PackedBlockStore.h"
+
+class PackedBlockFile : public BlockFile {
+ public:
+
+   // Constructor / Destructor
+
+   /// Append summary and sample data to the store
+   PackedBlockFile(PackedBlockStore *store, wxFileName baseFileName,
+                   samplePtr sampleData, sampleCount sampleLen,
+                   sampleFormat format);
+   /// Create the memory structure to refer to data already in the store
+   PackedBlockFile(PackedBlockStore *store, wxFileName baseFileName,
+                   const PackedExtent &extent, sampleCount len,
+                   sampleFormat format, float min, float max, float rms);
+
+   virtual ~PackedBlockFile();
+
+   // Reading
+
+   /// Read the summary section of the block
+   virtual bool ReadSummary(void *data);
+   /// Read the data section of the block
+   virtual int ReadData(samplePtr data, sampleFormat format,
+                        sampleCount start, sampleCount len);
+
+   /// Create a new block file identical to this one, in the same store
+   virtual BlockFile *Copy(wxFileName newFileName);
+   /// Create a new block file identical to this one, in the given store
+   BlockFile *CopyTo(PackedBlockStore *store, wxFileName newFileName);
+   /// Write an XML representation of this file
+   virtual void SaveXML(XMLWriter &xmlFile);
+
+   virtual wxLongLong GetSpaceUsage();
+   virtual void Recover();
+
+   virtual bool IsPacked() { return true; }
+
+   static BlockFile *BuildFromXML(DirManager &dm, const wxChar **attrs);
+
+   PackedBlockStore *GetStore() { return mStore; }
+   int GetSegment() { return mExtent.segment; }
+   size_t GetBytes() { return mExtent.bytes; }
+
+   /// True if the block's data is on disk
+   bool Exists() { return mStore->Exists(mExtent); }
+   /// Copies the block's data to the end of its store, for compaction
+   bool Relocate() { return mStore->Relocate(&mExtent); }
+
+ private:
+   PackedBlockStore *mStore;
+   PackedExtent mExtent;
+   sampleFormat mFormat;
+};
+
+#endif
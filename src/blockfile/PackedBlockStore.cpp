@@ -0,0 +1,529 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockStore.cpp
+
+*******************************************************************//**
+
+\class PackedBlockStore
+\brief Keeps the data of many PackedBlockFiles in a few large segment
+  files.
+
+  A segment file is named "sXXXXXXXX.aus", XXXXXXXX being its number in
+  hexadecimal, and lives in the project's data directory.  It begins
+  with a short header, and the rest is block data, one block after
+  another.  Which bytes belong to which block is recorded only in the
+  project file.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include "PackedBlockStore.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+   #include <windows.h>
+   #include <io.h>
+   #include <wx/msw/winundef.h>
+#else
+   #include <unistd.h>
+#endif
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/intl.h>
+#include <wx/log.h>
+
+// Block data is stored as it is in memory, so each segment file records
+// the byte order of the machine that wrote it
+static const char kSegmentMagic[12] = "AudacitySeg";
+static const wxUint32 kByteOrderMark = 0x01020304;
+enum { kHeaderBytes = 16 };
+
+// No more is appended to a segment file once it is this long
+static const wxFileOffset kSegmentBytes = 256 * 1024 * 1024;
+
+// Segment files kept open for reading
+enum { kMaxReadFiles = 32 };
+
+static wxString SegmentPath(const wxString &dir, int segment)
+{
+   return dir + wxFILE_SEP_PATH +
+      wxString::Format(wxT("s%08x.aus"), (unsigned int)segment);
+}
+
+// Reads len bytes at offset without using the file position, so that
+// any number of threads may read the same file at once
+static bool ReadAt(wxFile &file, wxFileOffset offset, void *data, size_t len)
+{
+#ifdef _WIN32
+   OVERLAPPED overlapped;
+   memset(&overlapped, 0, sizeof(overlapped));
+   overlapped.Offset = (DWORD)offset;
+   overlapped.OffsetHigh = (DWORD)((unsigned long long)offset >> 32);
+
+   DWORD read = 0;
+   return ReadFile((HANDLE)_get_osfhandle(file.fd()), data, (DWORD)len,
+                   &read, &overlapped) && read == len;
+#else
+   return pread(file.fd(), data, len, (off_t)offset) == (ssize_t)len;
+#endif
+}
+
+PackedBlockStore::PackedBlockStore(const wxString &dir)
+{
+   mRefCount = 1;
+   mDir = dir;
+   mNextSegment = 0;
+   mAppendFile = NULL;
+   mAppendSegment = -1;
+   mAppendSize = 0;
+   mClosingFiles = 0;
+   mClosingFileDone = new ODCondition(&mLock);
+}
+
+PackedBlockStore::~PackedBlockStore()
+{
+   // Every reader holds a reference, so none is left
+   CloseFiles();
+   delete mClosingFileDone;
+}
+
+void PackedBlockStore::Ref()
+{
+   ODLocker locker(mLock);
+   mRefCount++;
+}
+
+void PackedBlockStore::Deref()
+{
+   mLock.Lock();
+   bool last = (--mRefCount == 0);
+   mLock.Unlock();
+
+   if (last)
+      delete this;
+}
+
+wxString PackedBlockStore::GetDir()
+{
+   ODLocker locker(mLock);
+   return mDir;
+}
+
+void PackedBlockStore::SetDir(const wxString &dir)
+{
+   ODLocker locker(mLock);
+   CloseFiles();
+   mAppendSegment = -1;
+   mDir = dir;
+}
+
+bool PackedBlockStore::MoveToDir(const wxString &dir, bool copy)
+{
+   ODLocker locker(mLock);
+
+   if (dir == mDir)
+      return true;
+
+   // Some platforms can't rename a file that is open, so wait for the
+   // reads still using one; others may open files again meanwhile
+   CloseFiles();
+   while (mClosingFiles > 0) {
+      WaitForClosedFiles();
+      CloseFiles();
+   }
+
+   std::map<int, wxFileOffset>::iterator iter;
+   std::set<int> done;
+   bool success = true;
+   for (iter = mSizes.begin(); iter != mSizes.end(); iter++) {
+      int segment = iter->first;
+
+      // A copy of the project has no use for segments about to be removed
+      if (copy && mRetired.count(segment))
+         continue;
+
+      wxString from = SegmentPath(mDir, segment);
+      if (!wxFileExists(from))
+         continue;
+
+      wxString to = SegmentPath(dir, segment);
+      if (copy ? !wxCopyFile(from, to) : !wxRenameFile(from, to)) {
+         success = false;
+         break;
+      }
+      done.insert(segment);
+   }
+
+   if (!success) {
+      // Undo what was done, so that nothing is lost
+      std::set<int>::iterator doneIter;
+      for (doneIter = done.begin(); doneIter != done.end(); doneIter++) {
+         wxString to = SegmentPath(dir, *doneIter);
+         if (copy)
+            wxRemoveFile(to);
+         else
+            wxRenameFile(to, SegmentPath(mDir, *doneIter));
+      }
+      return false;
+   }
+
+   if (copy) {
+      // The retired segments stay with the project that was copied
+      std::set<int>::iterator retiredIter;
+      for (retiredIter = mRetired.begin(); retiredIter != mRetired.end();
+           retiredIter++)
+         mSizes.erase(*retiredIter);
+      mRetired.clear();
+   }
+
+   mDir = dir;
+   return true;
+}
+
+bool PackedBlockStore::Append(const void *data, size_t bytes,
+                              PackedExtent *extent)
+{
+   ODLocker locker(mLock);
+   return AppendLocked(data, bytes, extent);
+}
+
+bool PackedBlockStore::Read(const PackedExtent &extent, size_t pos,
+                            void *data, size_t len)
+{
+   ReadFile *readFile;
+   wxFileOffset offset;
+
+   // The lock is held only to find the file, so that reads of different
+   // blocks, or of the same one, go on at once
+   {
+      ODLocker locker(mLock);
+
+      if (pos + len > extent.bytes)
+         return false;
+
+      readFile = GetReadFile(extent.segment);
+      if (!readFile)
+         return false;
+
+      readFile->readers++;
+      offset = extent.offset + pos;
+   }
+
+   bool success = ReadAt(readFile->file, offset, data, len);
+
+   {
+      ODLocker locker(mLock);
+
+      if (--readFile->readers == 0 && readFile->closed) {
+         delete readFile;
+         mClosingFiles--;
+         mClosingFileDone->Broadcast();
+      }
+   }
+
+   return success;
+}
+
+bool PackedBlockStore::Relocate(PackedExtent *extent)
+{
+   size_t bytes;
+   {
+      ODLocker locker(mLock);
+      bytes = extent->bytes;
+   }
+
+   char *buffer = new char[bytes];
+   bool success = false;
+
+   // The extent is changed only under the lock, so that a read on
+   // another thread sees either the old place or the new one
+   if (Read(*extent, 0, buffer, bytes)) {
+      ODLocker locker(mLock);
+      PackedExtent copy;
+      if (AppendLocked(buffer, bytes, &copy)) {
+         *extent = copy;
+         success = true;
+      }
+   }
+
+   delete[] buffer;
+   return success;
+}
+
+bool PackedBlockStore::Exists(const PackedExtent &extent)
+{
+   ODLocker locker(mLock);
+
+   wxFileOffset size = GetSegmentSize(extent.segment);
+   return size >= kHeaderBytes &&
+      extent.offset >= kHeaderBytes &&
+      extent.offset + (wxFileOffset)extent.bytes <= size;
+}
+
+void PackedBlockStore::NoteSegment(int segment)
+{
+   ODLocker locker(mLock);
+
+   if (mSizes.find(segment) == mSizes.end())
+      mSizes[segment] = -1;
+   if (segment >= mNextSegment)
+      mNextSegment = segment + 1;
+}
+
+bool PackedBlockStore::HasSegment(int segment)
+{
+   ODLocker locker(mLock);
+   return mSizes.find(segment) != mSizes.end();
+}
+
+void PackedBlockStore::GetSegmentSizes(std::map<int, wxFileOffset> &sizes)
+{
+   ODLocker locker(mLock);
+
+   std::map<int, wxFileOffset>::iterator iter;
+   for (iter = mSizes.begin(); iter != mSizes.end(); iter++) {
+      if (mRetired.count(iter->first))
+         continue;
+      wxFileOffset size = GetSegmentSize(iter->first);
+      if (size >= 0)
+         sizes[iter->first] = size;
+   }
+}
+
+void PackedBlockStore::Retire(int segment)
+{
+   ODLocker locker(mLock);
+
+   mRetired.insert(segment);
+   if (segment == mAppendSegment) {
+      delete mAppendFile;
+      mAppendFile = NULL;
+      mAppendSegment = -1;
+   }
+}
+
+void PackedBlockStore::Unretire()
+{
+   ODLocker locker(mLock);
+   mRetired.clear();
+}
+
+void PackedBlockStore::RemoveRetired()
+{
+   ODLocker locker(mLock);
+
+   std::set<int>::iterator iter;
+   for (iter = mRetired.begin(); iter != mRetired.end(); iter++) {
+      std::map<int, ReadFile *>::iterator fileIter = mReadFiles.find(*iter);
+      if (fileIter != mReadFiles.end()) {
+         CloseReadFile(fileIter->second);
+         mReadFiles.erase(fileIter);
+      }
+   }
+
+   // Some platforms can't remove a file that is open
+   WaitForClosedFiles();
+
+   for (iter = mRetired.begin(); iter != mRetired.end(); iter++) {
+      wxString path = SegmentPath(mDir, *iter);
+      if (wxFileExists(path))
+         wxRemoveFile(path);
+      mSizes.erase(*iter);
+   }
+   mRetired.clear();
+}
+
+// static
+bool PackedBlockStore::IsSegmentFileName(const wxString &name, int *segment)
+{
+   wxFileName fileName(name);
+   wxString base = fileName.GetName();
+   unsigned long value;
+
+   if (!fileName.GetExt().IsSameAs(wxT("aus")) ||
+       base.Length() != 9 || base[0] != wxT('s') ||
+       !base.Mid(1).ToULong(&value, 16))
+      return false;
+
+   *segment = (int)value;
+   return true;
+}
+
+wxString PackedBlockStore::GetSegmentPath(int segment)
+{
+   return SegmentPath(mDir, segment);
+}
+
+// Call with mLock held
+PackedBlockStore::ReadFile *PackedBlockStore::GetReadFile(int segment)
+{
+   std::map<int, ReadFile *>::iterator iter = mReadFiles.find(segment);
+   if (iter != mReadFiles.end())
+      return iter->second;
+
+   if (mBad.count(segment))
+      return NULL;
+
+   wxString path = GetSegmentPath(segment);
+   if (!wxFileExists(path))
+      return NULL;
+
+   if ((int)mReadFiles.size() >= kMaxReadFiles) {
+      CloseReadFile(mReadFiles.begin()->second);
+      mReadFiles.erase(mReadFiles.begin());
+   }
+
+   ReadFile *readFile = new ReadFile;
+   readFile->readers = 0;
+   readFile->closed = false;
+   wxFile *file = &readFile->file;
+   char header[kHeaderBytes];
+   if (!file->Open(path) ||
+       file->Read(header, kHeaderBytes) != kHeaderBytes) {
+      delete readFile;
+      return NULL;
+   }
+
+   wxUint32 order;
+   memcpy(&order, header + sizeof(kSegmentMagic), sizeof(order));
+   if (memcmp(header, kSegmentMagic, sizeof(kSegmentMagic)) ||
+       order != kByteOrderMark) {
+      wxLogWarning(_("Audacity cannot read the audio data file '%s'; it is damaged, or was written on a different kind of computer."),
+                   path.c_str());
+      mBad.insert(segment);
+      delete readFile;
+      return NULL;
+   }
+
+   mReadFiles[segment] = readFile;
+   return readFile;
+}
+
+// Call with mLock held
+wxFileOffset PackedBlockStore::GetSegmentSize(int segment)
+{
+   std::map<int, wxFileOffset>::iterator iter = mSizes.find(segment);
+   if (iter == mSizes.end())
+      return -1;
+
+   if (iter->second < 0) {
+      ReadFile *readFile = GetReadFile(segment);
+      if (readFile)
+         iter->second = readFile->file.Length();
+   }
+
+   return iter->second;
+}
+
+// Call with mLock held
+bool PackedBlockStore::StartSegment()
+{
+   delete mAppendFile;
+   mAppendFile = NULL;
+   mAppendSegment = -1;
+
+   if (!wxDirExists(mDir) &&
+       !wxFileName::Mkdir(mDir, 0777, wxPATH_MKDIR_FULL))
+      return false;
+
+   // Never take the number of a file already there, such as one left
+   // over from a crash
+   int segment = mNextSegment;
+   while (mSizes.find(segment) != mSizes.end() ||
+          wxFileExists(GetSegmentPath(segment)))
+      segment++;
+   mNextSegment = segment + 1;
+
+   wxString path = GetSegmentPath(segment);
+   wxFile *file = new wxFile;
+   if (!file->Create(path, false)) {
+      delete file;
+      return false;
+   }
+
+   char header[kHeaderBytes];
+   memset(header, 0, kHeaderBytes);
+   memcpy(header, kSegmentMagic, sizeof(kSegmentMagic));
+   memcpy(header + sizeof(kSegmentMagic), &kByteOrderMark,
+          sizeof(kByteOrderMark));
+   if (file->Write(header, kHeaderBytes) != kHeaderBytes) {
+      delete file;
+      wxRemoveFile(path);
+      return false;
+   }
+
+   mAppendFile = file;
+   mAppendSegment = segment;
+   mAppendSize = kHeaderBytes;
+   mSizes[segment] = mAppendSize;
+
+   return true;
+}
+
+// Call with mLock held
+bool PackedBlockStore::AppendLocked(const void *data, size_t bytes,
+                                    PackedExtent *extent)
+{
+   // Carry on with the newest segment after the files were closed
+   if (!mAppendFile && mAppendSegment >= 0) {
+      mAppendFile = new wxFile;
+      if (!mAppendFile->Open(GetSegmentPath(mAppendSegment), wxFile::read_write)) {
+         delete mAppendFile;
+         mAppendFile = NULL;
+         mAppendSegment = -1;
+      }
+   }
+
+   if (!mAppendFile || mAppendSize + (wxFileOffset)bytes > kSegmentBytes)
+      if (!StartSegment())
+         return false;
+
+   // After a failed write the same bytes are simply written over
+   if (mAppendFile->Seek(mAppendSize) == wxInvalidOffset ||
+       mAppendFile->Write(data, bytes) != bytes)
+      return false;
+
+   extent->segment = mAppendSegment;
+   extent->offset = mAppendSize;
+   extent->bytes = bytes;
+
+   mAppendSize += bytes;
+   mSizes[mAppendSegment] = mAppendSize;
+
+   return true;
+}
+
+// Call with mLock held, after taking readFile out of mReadFiles
+void PackedBlockStore::CloseReadFile(ReadFile *readFile)
+{
+   if (readFile->readers == 0)
+      delete readFile;
+   else {
+      readFile->closed = true;
+      mClosingFiles++;
+   }
+}
+
+// Call with mLock held; lets go of it while waiting
+void PackedBlockStore::WaitForClosedFiles()
+{
+   while (mClosingFiles > 0)
+      mClosingFileDone->Wait();
+}
+
+// Call with mLock held
+void PackedBlockStore::CloseFiles()
+{
+   std::map<int, ReadFile *>::iterator iter;
+   for (iter = mReadFiles.begin(); iter != mReadFiles.end(); iter++)
+      CloseReadFile(iter->second);
+   mReadFiles.clear();
+
+   // mAppendSegment is kept, so that appending carries on where it was
+   delete mAppendFile;
+   mAppendFile = NULL;
+}
@@ -0,0 +1,137 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PackedBlockStore.h
+
+*******************************************************************//**
+
+\class PackedBlockStore
+\brief Keeps the data of many PackedBlockFiles in a few large segment
+  files, instead of one file per block.
+
+  Blocks are only ever appended to the newest segment file.  A block that
+  is no longer used leaves its bytes behind; they are reclaimed when the
+  DirManager compacts the store as the project is saved, by copying the
+  blocks still in use out of mostly unused segments and then removing
+  those segments once the new project file no longer refers to them.
+
+  Every PackedBlockFile holds a reference to its store, so the store
+  lasts as long as any of its blocks.  All methods may be called from
+  any thread.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_PACKED_BLOCK_STORE__
+#define __AUDACITY_PACKED_BLOCK_STORE__
+
+#include <map>
+#include <set>
+
+#include <wx/defs.h>
+#include <wx/file.h>
+#include <wx/string.h>
+
+#include "../ondemand/ODTaskThread.h"
+
+/// Where the bytes of one packed block are
+struct PackedExtent
+{
+   int segment;
+   wxFileOffset offset;
+   size_t bytes;
+};
+
+class PackedBlockStore
+{
+ public:
+   /// Uses segment files in dir; none are opened until needed
+   PackedBlockStore(const wxString &dir);
+
+   void Ref();
+   void Deref();
+
+   wxString GetDir();
+   /// Points the store at a directory that already holds its segments
+   void SetDir(const wxString &dir);
+   /// Moves or copies all of the segment files into dir, and uses
+   /// them there
+   bool MoveToDir(const wxString &dir, bool copy);
+
+   /// Writes bytes at the end of the newest segment file
+   bool Append(const void *data, size_t bytes, PackedExtent *extent);
+   /// Reads len bytes, starting pos bytes into the extent
+   bool Read(const PackedExtent &extent, size_t pos, void *data, size_t len);
+   /// Copies the extent to the end of the newest segment file, and
+   /// points it at the copy
+   bool Relocate(PackedExtent *extent);
+   /// True if the extent lies inside a segment file on disk
+   bool Exists(const PackedExtent &extent);
+
+   /// Tells the store about a segment that a loaded block uses, so
+   /// that it is never appended to or given to a new segment
+   void NoteSegment(int segment);
+   /// True if the segment was noted, or made by this store
+   bool HasSegment(int segment);
+
+   // Compaction
+
+   /// Sizes in bytes of the segment files that are not retired
+   void GetSegmentSizes(std::map<int, wxFileOffset> &sizes);
+   /// Nothing more is appended to the segment; RemoveRetired() deletes it
+   void Retire(int segment);
+   /// Keeps the retired segments after all, if compaction failed
+   void Unretire();
+   /// Deletes the retired segment files.  Call only once nothing on
+   /// disk refers to them.
+   void RemoveRetired();
+
+   /// If name is that of a segment file, returns true and its number
+   static bool IsSegmentFileName(const wxString &name, int *segment);
+
+ private:
+   ~PackedBlockStore();
+
+   // A segment file open for reading.  Read() reads it outside the lock,
+   // so one that is closed meanwhile is deleted by the last reader.
+   struct ReadFile
+   {
+      wxFile file;
+      int readers;
+      bool closed;
+   };
+
+   wxString GetSegmentPath(int segment);
+   ReadFile *GetReadFile(int segment);
+   wxFileOffset GetSegmentSize(int segment);
+   bool StartSegment();
+   bool AppendLocked(const void *data, size_t bytes, PackedExtent *extent);
+   void CloseReadFile(ReadFile *readFile);
+   void WaitForClosedFiles();
+   void CloseFiles();
+
+   ODLock mLock;
+   int mRefCount;
+
+   wxString mDir;
+
+   // Every segment the store knows of, with its size if known, or -1
+   std::map<int, wxFileOffset> mSizes;
+   std::set<int> mRetired;
+   // Segments whose header is wrong; reads from them fail quietly
+   std::set<int> mBad;
+   int mNextSegment;
+
+   // Opened as needed, and closed when too many are open
+   std::map<int, ReadFile *> mReadFiles;
+   // Closed files that reads still use, and a condition signalled as
+   // each is deleted
+   int mClosingFiles;
+   ODCondition *mClosingFileDone;
+
+   wxFile *mAppendFile;
+   int mAppendSegment;
+   wxFileOffset mAppendSize;
+};
+
+#endif
@@ -67,6 +67,8 @@ to get its definition, rather than rolling our own.
 
 #include "SimpleBlockFile.h"
 #include "../FileFormats.h"
+#include "../MappedFileCache.h"
+#include "../Profiler.h"
 
 #include "sndfile.h"
 #include "../Internat.h"
@@ -84,6 +86,47 @@ static wxUint32 SwapUintEndianess(wxUint32 in)
   return out;
 }
 
+/// Converts samples as they are stored in a native-endian block file to
+/// the given format.  Packed 24-bit samples are unpacked to ints and then
+/// go through CopySamples(), as ReadData() does with the ints libsndfile
+/// gives it, so both ways of reading a block give the same samples.
+static void CopyDiskSamples(const char *src, sampleFormat srcFormat,
+                            samplePtr dst, sampleFormat dstFormat,
+                            sampleCount len)
+{
+   if (srcFormat == int24Sample) {
+      // 24-bit samples are packed into three bytes on disk
+      int *ints = (dstFormat == int24Sample) ?
+         (int *)dst : (int *)NewSamples(len, int24Sample);
+      const unsigned char *bytes = (const unsigned char *)src;
+
+      for (sampleCount i = 0; i < len; i++, bytes += 3) {
+         #if wxBYTE_ORDER == wxBIG_ENDIAN
+            int value = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+         #else
+            int value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+         #endif
+         if (value & 0x800000)
+            value |= ~0xffffff;
+         ints[i] = value;
+      }
+
+      if (dstFormat != int24Sample)
+         CopySamples((samplePtr)ints, int24Sample, dst, dstFormat, len);
+
+      if ((samplePtr)ints != dst)
+         DeleteSamples((samplePtr)ints);
+   }
+   else if (srcFormat == int16Sample && dstFormat == int24Sample) {
+      const short *shorts = (const short *)src;
+      int *ints = (int *)dst;
+      for (sampleCount i = 0; i < len; i++)
+         ints[i] = shorts[i] << 8;
+   }
+   else
+      CopySamples((samplePtr)src, srcFormat, dst, dstFormat, len);
+}
+
 /// Constructs a SimpleBlockFile based on sample data and writes
 /// it to disk.
 ///
@@ -109,6 +152,7 @@ SimpleBlockFile::SimpleBlockFile(wxFileName baseFileName,
    {
       bool bSuccess = WriteSimpleBlockFile(sampleData, sampleLen, format, NULL);
       wxASSERT(bSuccess); // TODO: Handle failure here by alert to user and undo partial op.
+      mWriteFailed = !bSuccess;
    }
 
    if (useCache) {
@@ -144,6 +188,11 @@ SimpleBlockFile::SimpleBlockFile(wxFileName existingFile, sampleCount len,
 
 SimpleBlockFile::~SimpleBlockFile()
 {
+   // Some platforms can't remove a file while it is mapped
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (mappings)
+      mappings->Forget(this);
+
    if (mCache.active)
    {
       delete[] mCache.sampleData;
@@ -157,6 +206,12 @@ bool SimpleBlockFile::WriteSimpleBlockFile(
     sampleFormat format,
     void* summaryData)
 {
+   PROFILE_ZONE("SimpleBlockFile::WriteSimpleBlockFile");
+
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (mappings)
+      mappings->Forget(this);
+
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
    if( !file.IsOpened() ){
       // Can't do anything else.
@@ -329,6 +384,8 @@ void SimpleBlockFile::FillCache()
 /// mSummaryinfo.totalSummaryBytes long.
 bool SimpleBlockFile::ReadSummary(void *data)
 {
+   PROFILE_ZONE("SimpleBlockFile::ReadSummary");
+
    if (mCache.active)
    {
       //wxLogDebug("SimpleBlockFile::ReadSummary(): Summary is already in cache.");
@@ -336,6 +393,18 @@ bool SimpleBlockFile::ReadSummary(void *data)
       return true;
    } else
    {
+      sampleFormat diskFormat;
+      size_t dataOffset;
+      const char *mapped = AcquireMapping(&diskFormat, &dataOffset);
+      if (mapped) {
+         memcpy(data, mapped + sizeof(auHeader),
+                (size_t)mSummaryInfo.totalSummaryBytes);
+         DirManager::GetMappingCache()->Release(this, mapped);
+
+         FixSummary(data);
+         return true;
+      }
+
       //wxLogDebug("SimpleBlockFile::ReadSummary(): Reading summary from disk.");
 
       wxFFile file(mFileName.GetFullPath(), wxT("rb"));
@@ -379,6 +448,8 @@ bool SimpleBlockFile::ReadSummary(void *data)
 int SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
                         sampleCount start, sampleCount len)
 {
+   PROFILE_ZONE("SimpleBlockFile::ReadData");
+
    if (mCache.active)
    {
       //wxLogDebug("SimpleBlockFile::ReadData(): Data are already in cache.");
@@ -392,6 +463,20 @@ int SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
       return len;
    } else
    {
+      sampleFormat diskFormat;
+      size_t dataOffset;
+      const char *mapped = AcquireMapping(&diskFormat, &dataOffset);
+      if (mapped) {
+         if (len > mLen - start)
+            len = mLen - start;
+         int diskSampleSize = (diskFormat == int24Sample) ?
+            3 : SAMPLE_SIZE(diskFormat);
+         CopyDiskSamples(mapped + dataOffset + start * diskSampleSize,
+                         diskFormat, data, format, len);
+         DirManager::GetMappingCache()->Release(this, mapped);
+         return len;
+      }
+
       //wxLogDebug("SimpleBlockFile::ReadData(): Reading data from disk.");
 
       SF_INFO info;
@@ -427,25 +512,36 @@ int SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
 
       int framesRead = 0;
 
+      // libsndfile would cut 24-bit samples down to 16 bits itself;
+      // read them as 24-bit and let CopySamples() do it, as
+      // CopyDiskSamples() does for a mapped block
+      bool narrow24 = (format == int16Sample &&
+                       (info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24);
+
       // If both the src and dest formats are integer formats,
       // read integers from the file (otherwise we would be
       // converting to float and back, which is unneccesary)
-      if (format == int16Sample &&
+      if (format == int16Sample && !narrow24 &&
           sf_subtype_is_integer(info.format)) {
          framesRead = sf_readf_short(sf, (short *)data, len);
       }
       else
-      if (format == int24Sample &&
+      if ((format == int24Sample || narrow24) &&
           sf_subtype_is_integer(info.format))
       {
-         framesRead = sf_readf_int(sf, (int *)data, len);
+         // buffer holds len floats, so it has room for len ints
+         int *intPtr = narrow24 ? (int *)buffer : (int *)data;
+         framesRead = sf_readf_int(sf, intPtr, len);
 
          // libsndfile gave us the 3 byte sample in the 3 most
          // significant bytes -- we want it in the 3 least
          // significant bytes.
-         int *intPtr = (int *)data;
          for( int i = 0; i < framesRead; i++ )
             intPtr[i] = intPtr[i] >> 8;
+
+         if (narrow24)
+            CopySamples(buffer, int24Sample,
+                        (samplePtr)data, format, framesRead);
       }
       else {
          // Otherwise, let libsndfile handle the conversion and
@@ -464,6 +560,111 @@ int SimpleBlockFile::ReadData(samplePtr data, sampleFormat format,
    }
 }
 
+/// Maps the disk file, if mapping is enabled and the file can be read in
+/// place: it must be in native byte order (otherwise libsndfile swaps it
+/// for us) and hold all of its summary and sample data.
+///
+/// @param diskFormat Receives the format of the samples on disk
+/// @param dataOffset Receives the offset of the first sample in the file
+/// @return The start of the mapped file, to be released through
+///         DirManager::GetMappingCache(), or NULL
+const char *SimpleBlockFile::AcquireMapping(sampleFormat *diskFormat,
+                                            size_t *dataOffset)
+{
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (!mappings)
+      return NULL;
+
+   size_t size;
+   const char *mapped = mappings->Acquire(this, mFileName.GetFullPath(), &size);
+   if (!mapped)
+      return NULL;
+
+   auHeader header;
+   bool ok = (size >= sizeof(header));
+   if (ok) {
+      memcpy(&header, mapped, sizeof(header));
+      ok = (header.magic == 0x2e736e64);
+   }
+
+   int diskSampleSize = 0;
+   if (ok) {
+      switch (header.encoding)
+      {
+      case AU_SAMPLE_FORMAT_16:
+         *diskFormat = int16Sample;
+         diskSampleSize = 2;
+         break;
+      case AU_SAMPLE_FORMAT_24:
+         *diskFormat = int24Sample;
+         diskSampleSize = 3;
+         break;
+      case AU_SAMPLE_FORMAT_FLOAT:
+         *diskFormat = floatSample;
+         diskSampleSize = 4;
+         break;
+      default:
+         ok = false;
+         break;
+      }
+   }
+
+   if (ok) {
+      *dataOffset = header.dataOffset;
+      ok = (*dataOffset >= sizeof(auHeader) + mSummaryInfo.totalSummaryBytes &&
+            *dataOffset + (size_t)mLen * diskSampleSize <= size);
+   }
+
+   if (!ok) {
+      mappings->Release(this, mapped);
+      return NULL;
+   }
+
+   return mapped;
+}
+
+const char *SimpleBlockFile::AcquireMappedData(sampleFormat format,
+                                               sampleCount start,
+                                               sampleCount len)
+{
+   if (mCache.active || start < 0 || start + len > mLen)
+      return NULL;
+
+   sampleFormat diskFormat;
+   size_t dataOffset;
+   const char *mapped = AcquireMapping(&diskFormat, &dataOffset);
+   if (!mapped)
+      return NULL;
+
+   // Packed 24-bit samples always need converting
+   const char *samples =
+      mapped + dataOffset + start * SAMPLE_SIZE(diskFormat);
+   if (diskFormat != format || diskFormat == int24Sample ||
+       ((size_t)samples % SAMPLE_SIZE(format)) != 0) {
+      DirManager::GetMappingCache()->Release(this, mapped);
+      return NULL;
+   }
+
+   return samples;
+}
+
+void SimpleBlockFile::ReleaseMappedData(const char *data)
+{
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (mappings)
+      mappings->Release(this, data);
+}
+
+void SimpleBlockFile::SetFileName(wxFileName &name)
+{
+   // The mapping, if any, is of the file under its old name
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (mappings)
+      mappings->Forget(this);
+
+   BlockFile::SetFileName(name);
+}
+
 void SimpleBlockFile::SaveXML(XMLWriter &xmlFile)
 {
    xmlFile.StartTag(wxT("simpleblockfile"));
@@ -548,6 +749,10 @@ wxLongLong SimpleBlockFile::GetSpaceUsage()
 }
 
 void SimpleBlockFile::Recover(){
+   MappedFileCache *mappings = DirManager::GetMappingCache();
+   if (mappings)
+      mappings->Forget(this);
+
    wxFFile file(mFileName.GetFullPath(), wxT("wb"));
    int i;
 
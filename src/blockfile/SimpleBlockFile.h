@@ -67,6 +67,12 @@ class SimpleBlockFile : public BlockFile {
    virtual int ReadData(samplePtr data, sampleFormat format,
                         sampleCount start, sampleCount len);
 
+   virtual const char *AcquireMappedData(sampleFormat format,
+                                         sampleCount start, sampleCount len);
+   virtual void ReleaseMappedData(const char *data);
+
+   virtual void SetFileName(wxFileName &name);
+
    /// Create a new block file identical to this one
    virtual BlockFile *Copy(wxFileName newFileName);
    /// Write an XML representation of this file
@@ -90,6 +96,8 @@ class SimpleBlockFile : public BlockFile {
    static bool GetCache();
    void ReadIntoCache();
 
+   const char *AcquireMapping(sampleFormat *diskFormat, size_t *dataOffset);
+
    SimpleBlockFileCache mCache;
 };
 
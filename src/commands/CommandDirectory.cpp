@@ -23,6 +23,7 @@
 #include "MessageCommand.h"
 #include "GetTrackInfoCommand.h"
 #include "GetProjectInfoCommand.h"
+#include "GetAudioHealthCommand.h"
 #include "HelpCommand.h"
 #include "SelectCommand.h"
 #include "CompareAudioCommand.h"
@@ -48,6 +49,7 @@ CommandDirectory::CommandDirectory()
    AddCommand(new MessageCommandType());
    AddCommand(new GetTrackInfoCommandType());
    AddCommand(new GetProjectInfoCommandType());
+   AddCommand(new GetAudioHealthCommandType());
 
    AddCommand(new HelpCommandType());
    AddCommand(new SelectCommandType());
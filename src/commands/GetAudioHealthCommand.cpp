@@ -0,0 +1,76 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2009 Audacity Team
+   License: wxwidgets
+
+******************************************************************//**
+
+\file GetAudioHealthCommand.cpp
+\brief Definitions for GetAudioHealthCommand class
+
+*//*******************************************************************/
+
+#include "GetAudioHealthCommand.h"
+#include "CommandType.h"
+#include "../AudioIO.h"
+
+wxString GetAudioHealthCommandType::BuildName()
+{
+   return wxT("GetAudioHealth");
+}
+
+void GetAudioHealthCommandType::BuildSignature(CommandSignature &signature)
+{
+   BoolValidator *resetValidator = new BoolValidator();
+   signature.AddParameter(wxT("Reset"), 0, resetValidator);
+}
+
+Command *GetAudioHealthCommandType::Create(CommandOutputTarget *target)
+{
+   return new GetAudioHealthCommand(*this, target);
+}
+
+bool GetAudioHealthCommand::Apply(CommandExecutionContext WXUNUSED(context))
+{
+   AudioIOStats::Counts c;
+   gAudioIO->GetHealthCounts(&c);
+
+   // Untranslated names, so that scripts can parse them
+   Status(wxString::Format(wxT("Callbacks\t%d"), c.callbacks));
+   Status(wxString::Format(wxT("BufferMicros\t%d"), c.lastBufferMicros));
+   Status(wxString::Format(wxT("MaxCallbackMicros\t%d"), c.maxCallbackMicros));
+   wxString histogram = wxT("CallbackLoadHistogram");
+   for (int i = 0; i < AudioIOStats::kNumLoadBuckets; i++)
+      histogram += wxString::Format(wxT("\t%d"), c.loadHistogram[i]);
+   Status(histogram);
+
+   Status(wxString::Format(wxT("MinPlaybackFill\t%d"), c.minPlaybackFill));
+   Status(wxString::Format(wxT("PlaybackUnderruns\t%d"), c.playbackUnderruns));
+   Status(wxString::Format(wxT("MinCaptureFree\t%d"), c.minCaptureFree));
+   Status(wxString::Format(wxT("CaptureOverruns\t%d"), c.captureOverruns));
+
+   Status(wxString::Format(wxT("InputUnderflows\t%d"),
+                           c.xruns[AudioIOStats::kInputUnderflow]));
+   Status(wxString::Format(wxT("InputOverflows\t%d"),
+                           c.xruns[AudioIOStats::kInputOverflow]));
+   Status(wxString::Format(wxT("OutputUnderflows\t%d"),
+                           c.xruns[AudioIOStats::kOutputUnderflow]));
+   Status(wxString::Format(wxT("OutputOverflows\t%d"),
+                           c.xruns[AudioIOStats::kOutputOverflow]));
+
+   Status(wxString::Format(wxT("Fills\t%d"), c.fills));
+   Status(wxString::Format(wxT("MaxFillMicros\t%d"), c.maxFillMicros));
+   histogram = wxT("FillHistogram");
+   for (int i = 0; i < AudioIOStats::kNumFillBuckets; i++)
+      histogram += wxString::Format(wxT("\t%d"), c.fillHistogram[i]);
+   Status(histogram);
+   Status(wxString::Format(wxT("RealtimeEffectsMillis\t%d"), c.effectsMillis));
+   Status(wxString::Format(wxT("MaxRealtimeEffectsMicros\t%d"),
+                           c.maxEffectsMicros));
+
+   if (GetBool(wxT("Reset")))
+      gAudioIO->ResetHealthInfo();
+
+   return true;
+}
@@ -0,0 +1,44 @@
+/**********************************************************************
+
+   Audacity - A Digital Audio Editor
+   Copyright 1999-2009 Audacity Team
+   File License: wxWidgets
+
+******************************************************************//**
+
+\file GetAudioHealthCommand.h
+\brief Contains definition of GetAudioHealthCommand class.
+
+*//***************************************************************//***
+
+\class GetAudioHealthCommand
+\brief Command that reports how well the audio callback and audio thread
+have kept up, one "name<tab>value" line per count, and optionally starts
+counting afresh.
+
+*//*******************************************************************/
+
+#ifndef __GETAUDIOHEALTHCOMMAND__
+#define __GETAUDIOHEALTHCOMMAND__
+
+#include "Command.h"
+#include "CommandType.h"
+
+class GetAudioHealthCommandType : public CommandType
+{
+public:
+   virtual wxString BuildName();
+   virtual void BuildSignature(CommandSignature &signature);
+   virtual Command *Create(CommandOutputTarget *target);
+};
+
+class GetAudioHealthCommand : public CommandImplementation
+{
+public:
+   GetAudioHealthCommand(CommandType &type,
+                         CommandOutputTarget *target)
+      : CommandImplementation(type, target) {}
+   virtual bool Apply(CommandExecutionContext context);
+};
+
+#endif /* End of include guard: __GETAUDIOHEALTHCOMMAND__ */
@@ -111,6 +111,11 @@ bool EffectAmplify::ProcessSimpleMono(float *buffer, sampleCount len)
    return true;
 }
 
+bool EffectAmplify::CanProcessInParallel()
+{
+   return true;
+}
+
 //----------------------------------------------------------------------------
 // AmplifyDialog
 //----------------------------------------------------------------------------
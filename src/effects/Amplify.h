@@ -61,6 +61,7 @@ class EffectAmplify:public EffectSimpleMono
 
  protected:
    virtual bool ProcessSimpleMono(float *buffer, sampleCount len);
+   virtual bool CanProcessInParallel();
 
  private:
    float ratio;
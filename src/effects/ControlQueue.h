@@ -0,0 +1,82 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ControlQueue.h
+
+*******************************************************************//**
+
+\class ControlQueue
+\brief Carries parameter changes from the user interface to an effect
+  that is processing in realtime, without either side taking a lock.
+
+  There must be only one thread posting, and one thread getting.  If
+  the queue is full, Post() fails and the change is dropped; the next
+  change to the same control will carry the latest value anyway.
+
+*//*******************************************************************/
+
+#ifndef __AUDACITY_CONTROL_QUEUE__
+#define __AUDACITY_CONTROL_QUEUE__
+
+#include "../LockFree.h"
+
+class ControlQueue
+{
+ public:
+   ControlQueue()
+   {
+      mStart = 0;
+      mEnd = 0;
+   }
+
+   /// Only call when neither side is using the queue.
+   void Reset()
+   {
+      mStart = 0;
+      mEnd = 0;
+   }
+
+   bool Post(int index, float value)
+   {
+      int end = mEnd;
+      int next = (end + 1) % kSize;
+      if (next == LoadAcquire(&mStart))
+         return false;
+
+      mEntries[end].index = index;
+      mEntries[end].value = value;
+      StoreRelease(&mEnd, next);
+
+      return true;
+   }
+
+   bool Get(int *index, float *value)
+   {
+      int start = mStart;
+      if (start == LoadAcquire(&mEnd))
+         return false;
+
+      *index = mEntries[start].index;
+      *value = mEntries[start].value;
+      StoreRelease(&mStart, (start + 1) % kSize);
+
+      return true;
+   }
+
+ private:
+   enum {
+      kSize = 1024
+   };
+
+   struct Entry {
+      int index;
+      float value;
+   };
+
+   Entry mEntries[kSize];
+   volatile int mStart;
+   volatile int mEnd;
+};
+
+#endif // __AUDACITY_CONTROL_QUEUE__
@@ -36,6 +36,7 @@
 
 #include "Echo.h"
 #include "../WaveTrack.h"
+#include "../WaveTrackWriter.h"
 
 EffectEcho::EffectEcho()
 {
@@ -124,6 +125,10 @@ bool EffectEcho::ProcessOne(int count, WaveTrack * track,
    float *ptr0 = buffer0;
    float *ptr1 = buffer1;
 
+   // The first block is left as it is.  The writer makes the new blocks
+   // on other threads while we go on reading.
+   WaveTrackWriter writer(track, start + blockSize);
+
    bool first = true;
 
    while (s < len) {
@@ -135,7 +140,7 @@ bool EffectEcho::ProcessOne(int count, WaveTrack * track,
       if (!first) {
          for (sampleCount i = 0; i < block; i++)
             ptr0[i] += ptr1[i] * decay;
-         track->Set((samplePtr)ptr0, floatSample, start + s, block);
+         writer.Write((samplePtr)ptr0, floatSample, block);
       }
 
       float *ptrtemp = ptr0;
@@ -157,7 +162,7 @@ bool EffectEcho::ProcessOne(int count, WaveTrack * track,
    delete[]buffer0;
    delete[]buffer1;
 
-   return true;
+   return writer.Commit();
 }
 
 //----------------------------------------------------------------------------
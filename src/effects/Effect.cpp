@@ -1817,6 +1817,16 @@ bool Effect::IsRealtimeActive()
    return mRealtimeSuspendCount == 0;
 }
 
+sampleCount Effect::GetLatency()
+{
+   if (mClient)
+   {
+      return mClient->GetLatency();
+   }
+
+   return 0;
+}
+
 void Effect::Preview(bool dryOnly)
 {
    if (mNumTracks==0) // nothing to preview
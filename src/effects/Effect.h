@@ -284,6 +284,8 @@ class AUDACITY_DLL_API Effect : public EffectHostInterface
                                sampleCount numSamples);
    bool RealtimeProcessEnd();
    bool IsRealtimeActive();
+   // Samples by which the output lags the input
+   sampleCount GetLatency();
 
  //
  // protected virtual methods
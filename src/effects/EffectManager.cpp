@@ -182,6 +182,7 @@ EffectManager::EffectManager()
    mRealtimeActive = false;
    mRealtimeSuspended = true;
    mRealtimeLatency = 0;
+   mRealtimeDelay = 0;
    mRealtimeLock.Leave();
 #endif
 
@@ -630,10 +631,17 @@ void EffectManager::RealtimeResume()
       return;
    }
 
-   // Tell the effects to get ready for more action
+   // Tell the effects to get ready for more action, and find out how much
+   // they delay the audio while we're at it, since the chain may have changed
+   mRealtimeDelay = 0;
    for (int i = 0, cnt = mRealtimeEffects.GetCount(); i < cnt; i++)
    {
       mRealtimeEffects[i]->RealtimeResume();
+
+      if (mRealtimeEffects[i]->IsRealtimeActive())
+      {
+         mRealtimeDelay += mRealtimeEffects[i]->GetLatency();
+      }
    }
 
    // And we should too
@@ -770,6 +778,21 @@ int EffectManager::GetRealtimeLatency()
    return mRealtimeLatency;
 }
 
+//
+// This will be called in a different thread than the main GUI thread.
+//
+sampleCount EffectManager::GetRealtimeDelay()
+{
+   // Protect ourselves from the main thread
+   mRealtimeLock.Enter();
+
+   sampleCount delay = mRealtimeSuspended ? 0 : mRealtimeDelay;
+
+   mRealtimeLock.Leave();
+
+   return delay;
+}
+
 Effect *EffectManager::GetEffect(const PluginID & ID)
 {
    Effect *effect;
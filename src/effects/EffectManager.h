@@ -111,6 +111,7 @@ class AUDACITY_DLL_API EffectManager
    sampleCount RealtimeProcess(int group, int chans, float **buffers, sampleCount numSamples);
    void RealtimeProcessEnd();
    int GetRealtimeLatency();
+   sampleCount GetRealtimeDelay();
 #endif
 
 #if defined(EXPERIMENTAL_EFFECTS_RACK)
@@ -170,6 +171,7 @@ private:
    wxCriticalSection mRealtimeLock;
    EffectArray mRealtimeEffects;
    int mRealtimeLatency;
+   sampleCount mRealtimeDelay;
    bool mRealtimeSuspended;
    bool mRealtimeActive;
    wxArrayInt mRealtimeChans;
@@ -35,11 +35,24 @@ bool EffectFadeIn::NewTrackSimpleMono()
 }
 
 bool EffectFadeIn::ProcessSimpleMono(float *buffer, sampleCount len)
+{
+   ProcessSimpleMonoAt(buffer, len, mSample);
+   mSample += len;
+
+   return true;
+}
+
+bool EffectFadeIn::CanProcessInParallel()
+{
+   return true;
+}
+
+bool EffectFadeIn::ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                       sampleCount offset)
 {
    for (sampleCount i = 0; i < len; i++)
-      buffer[i] = (float) (buffer[i] * (float) (mSample + i)
+      buffer[i] = (float) (buffer[i] * (float) (offset + i)
                            / (float) (mLen));
-   mSample += len;
 
    return true;
 }
@@ -53,12 +66,25 @@ bool EffectFadeOut::NewTrackSimpleMono()
 }
 
 bool EffectFadeOut::ProcessSimpleMono(float *buffer, sampleCount len)
+{
+   ProcessSimpleMonoAt(buffer, len, mSample);
+   mSample += len;
+
+   return true;
+}
+
+bool EffectFadeOut::CanProcessInParallel()
+{
+   return true;
+}
+
+bool EffectFadeOut::ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                        sampleCount offset)
 {
    for (sampleCount i = 0; i < len; i++)
       buffer[i] = (float) (buffer[i]
-                           * (float) (mLen - 1 - (mSample + i))
+                           * (float) (mLen - 1 - (offset + i))
                            / (float) (mLen));
-   mSample += len;
 
    return true;
 }
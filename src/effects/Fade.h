@@ -49,6 +49,9 @@ class EffectFadeIn: public EffectSimpleMono {
    virtual bool NewTrackSimpleMono();
 
    virtual bool ProcessSimpleMono(float *buffer, sampleCount len);
+   virtual bool CanProcessInParallel();
+   virtual bool ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                    sampleCount offset);
 };
 
 class EffectFadeOut:public EffectSimpleMono {
@@ -83,6 +86,9 @@ class EffectFadeOut:public EffectSimpleMono {
    virtual bool NewTrackSimpleMono();
 
    virtual bool ProcessSimpleMono(float *buffer, sampleCount len);
+   virtual bool CanProcessInParallel();
+   virtual bool ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                    sampleCount offset);
 };
 
 #endif
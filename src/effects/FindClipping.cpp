@@ -157,6 +157,15 @@ bool EffectFindClipping::ProcessOne(LabelTrack * l,
             break;
          }
 
+         // Outside of a run, skip to the next sample that could start
+         // one.  The block summaries let this pass over audio that never
+         // reaches full scale without reading it.
+         if (startrun == 0) {
+            s = t->FindAbove(start + s, len - s, MAX_AUDIO) - start;
+            if (s >= len)
+               break;
+         }
+
          block = s + blockSize > len ? len - s : blockSize;
 
          t->Get((samplePtr)buffer, floatSample, start + s, block);
@@ -27,3 +27,8 @@ bool EffectInvert::ProcessSimpleMono(float *buffer, sampleCount len)
    return true;
 }
 
+bool EffectInvert::CanProcessInParallel()
+{
+   return true;
+}
+
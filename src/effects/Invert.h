@@ -47,6 +47,7 @@ class EffectInvert:public EffectSimpleMono {
 
  protected:
    virtual bool ProcessSimpleMono(float *buffer, sampleCount len);
+   virtual bool CanProcessInParallel();
 };
 
 #endif
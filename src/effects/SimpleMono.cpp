@@ -22,9 +22,89 @@
 #include "../Audacity.h"
 
 #include "SimpleMono.h"
+#include "../ThreadPool.h"
 #include "../WaveTrack.h"
+#include "../WaveTrackWriter.h"
 
 #include <math.h>
+#include <vector>
+
+// The number of buffers per ThreadPool thread that may be read but not
+// yet written back.  This bounds the memory used.
+#define kBuffersInFlightPerThread 2
+
+/// One buffer of EffectSimpleMono::ProcessOneParallel()
+struct SimpleMonoBuffer
+{
+   float *data;
+   /// From the start of the selection
+   sampleCount offset;
+   sampleCount len;
+   bool done;
+   bool success;
+};
+
+/// The lock and condition the jobs of one
+/// EffectSimpleMono::ProcessOneParallel() use to report that a buffer
+/// is done.
+class SimpleMonoBatch
+{
+ public:
+   SimpleMonoBatch(EffectSimpleMono *effect)
+   {
+      mEffect = effect;
+      mDoneCondition = new ODCondition(&mLock);
+   }
+
+   ~SimpleMonoBatch()
+   {
+      delete mDoneCondition;
+   }
+
+   void Work(SimpleMonoBuffer *buffer)
+   {
+      bool success = mEffect->ProcessSimpleMonoAt(buffer->data, buffer->len,
+                                                  buffer->offset);
+
+      mLock.Lock();
+      buffer->success = success;
+      buffer->done = true;
+      mDoneCondition->Broadcast();
+      mLock.Unlock();
+   }
+
+   void WaitUntilDone(SimpleMonoBuffer *buffer)
+   {
+      mLock.Lock();
+      while (!buffer->done)
+         mDoneCondition->Wait();
+      mLock.Unlock();
+   }
+
+ private:
+   EffectSimpleMono *mEffect;
+   ODLock mLock;
+   ODCondition *mDoneCondition;
+};
+
+class SimpleMonoJob : public ThreadPoolJob
+{
+ public:
+   SimpleMonoJob(SimpleMonoBatch *batch, SimpleMonoBuffer *buffer)
+   {
+      mBatch = batch;
+      mBuffer = buffer;
+   }
+
+   virtual void Run()
+   {
+      mBatch->Work(mBuffer);
+   }
+
+ private:
+   SimpleMonoBatch *mBatch;
+   SimpleMonoBuffer *mBuffer;
+};
 
 bool EffectSimpleMono::Process()
 {
@@ -81,6 +161,9 @@ bool EffectSimpleMono::Process()
 bool EffectSimpleMono::ProcessOne(WaveTrack * track,
                                   sampleCount start, sampleCount end)
 {
+   if (ThreadPool::Get() && CanProcessInParallel())
+      return ProcessOneParallel(track, start, end);
+
    sampleCount s;
    //Get the length of the buffer (as double). len is
    //used simple to calculate a progress meter, so it is easier
@@ -91,6 +174,10 @@ bool EffectSimpleMono::ProcessOne(WaveTrack * track,
    //be shorter than the length of the track being processed.
    float *buffer = new float[track->GetMaxBlockSize()];
 
+   //The writer makes the new blocks on other threads while we go on
+   //reading, and puts them in the track when we are done.
+   WaveTrackWriter writer(track, start);
+
    //Go through the track one buffer at a time. s counts which
    //sample the current buffer starts at.
    s = start;
@@ -115,7 +202,7 @@ bool EffectSimpleMono::ProcessOne(WaveTrack * track,
 
       //Processing succeeded. copy the newly-changed samples back
       //onto the track.
-      track->Set((samplePtr) buffer, floatSample, s, block);
+      writer.Write((samplePtr) buffer, floatSample, block);
 
       //Increment s one blockfull of samples
       s += block;
@@ -130,8 +217,88 @@ bool EffectSimpleMono::ProcessOne(WaveTrack * track,
    //Clean up the buffer
    delete[]buffer;
 
-   //Return true because the effect processing succeeded.
-   return true;
+   //The effect processing succeeded, so put the new blocks in the track.
+   return writer.Commit();
+}
+
+//ProcessOneParallel() does the same as ProcessOne(), but hands the
+//buffers to the ThreadPool to process while it goes on reading
+bool EffectSimpleMono::ProcessOneParallel(WaveTrack * track,
+                                          sampleCount start, sampleCount end)
+{
+   ThreadPool *pool = ThreadPool::Get();
+   int maxInFlight = pool->GetNumThreads() * kBuffersInFlightPerThread;
+   double len = (double)(end - start);
+   bool result = true;
+   int i;
+
+   SimpleMonoBatch batch(this);
+   std::vector<SimpleMonoBuffer> buffers(maxInFlight);
+   for (i = 0; i < maxInFlight; i++)
+      buffers[i].data = new float[track->GetMaxBlockSize()];
+
+   WaveTrackWriter writer(track, start);
+
+   // Buffers are read and started in order, as far ahead of the oldest
+   // unfinished one as maxInFlight allows, and written back in order as
+   // they finish.  Only this thread reads and writes the track.
+   sampleCount s = start;
+   int started = 0;
+   int written = 0;
+   while (s < end || written < started) {
+      while (s < end && started - written < maxInFlight) {
+         SimpleMonoBuffer &b = buffers[started % maxInFlight];
+         b.len = track->GetBestBlockSize(s);
+         if (s + b.len > end)
+            b.len = end - s;
+         b.offset = s - start;
+         b.done = false;
+         b.success = false;
+
+         track->Get((samplePtr) b.data, floatSample, s, b.len);
+         pool->Add(new SimpleMonoJob(&batch, &b));
+
+         s += b.len;
+         started++;
+      }
+
+      SimpleMonoBuffer &b = buffers[written % maxInFlight];
+      batch.WaitUntilDone(&b);
+      written++;
+
+      if (!b.success) {
+         result = false;
+         break;
+      }
+
+      writer.Write((samplePtr) b.data, floatSample, b.len);
+
+      if (TrackProgress(mCurTrackNum, (b.offset + b.len) / len)) {
+         result = false;
+         break;
+      }
+   }
+
+   // The jobs still running use the buffers
+   for (i = written; i < started; i++)
+      batch.WaitUntilDone(&buffers[i % maxInFlight]);
+
+   for (i = 0; i < maxInFlight; i++)
+      delete[] buffers[i].data;
+
+   return result && writer.Commit();
+}
+
+//By default the buffers of a track are processed one at a time, in order
+bool EffectSimpleMono::CanProcessInParallel()
+{
+   return false;
+}
+
+bool EffectSimpleMono::ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                           sampleCount WXUNUSED(offset))
+{
+   return ProcessSimpleMono(buffer, len);
 }
 
 //null implementation of NewTrackSimpleMono
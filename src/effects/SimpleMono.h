@@ -20,6 +20,7 @@
 #include "Effect.h"
 
 class WaveTrack;
+class SimpleMonoBatch;
 
 class EffectSimpleMono:public Effect {
 
@@ -27,7 +28,11 @@ class EffectSimpleMono:public Effect {
    virtual bool Process();
 
  private:
+   friend class SimpleMonoBatch;
+
    bool ProcessOne(WaveTrack * t, sampleCount start, sampleCount end);
+   // Processes several buffers at once on the ThreadPool
+   bool ProcessOneParallel(WaveTrack * t, sampleCount start, sampleCount end);
 
  protected:
 
@@ -38,6 +43,19 @@ class EffectSimpleMono:public Effect {
    // Override this method to actually process audio
    virtual bool ProcessSimpleMono(float *buffer, sampleCount len) = 0;
 
+   // Override this method to return true if the buffers of a track may
+   // be processed in any order, several at once on other threads, by
+   // ProcessSimpleMonoAt().  The effect must then change no members
+   // while it processes.
+   virtual bool CanProcessInParallel();
+
+   // Used instead of ProcessSimpleMono() when CanProcessInParallel().
+   // offset is where the buffer starts, counting from mCurT0.  Override
+   // it if the processing depends on that; by default it just calls
+   // ProcessSimpleMono().
+   virtual bool ProcessSimpleMonoAt(float *buffer, sampleCount len,
+                                    sampleCount offset);
+
    // Other useful information
    int    mCurTrackNum;
    double mCurRate;
@@ -156,15 +156,10 @@ bool EffectTruncSilence::Process()
       //
       RegionList trackSilences;
       trackSilences.DeleteContents(true);
-      sampleCount blockLen = wt->GetMaxBlockSize();
       sampleCount start = wt->TimeToLongSamples(mT0);
       sampleCount end = wt->TimeToLongSamples(mT1);
 
-      // Allocate buffer
-      float *buffer = new float[blockLen];
-
       sampleCount index = start;
-      sampleCount silentFrames = 0;
       bool cancelled = false;
 
       // Keep position in overall silences list for optimization
@@ -194,70 +189,51 @@ bool EffectTruncSilence::Process()
             break;
          }
          else if ((*rit)->start > curTime) {
-            // End current silent region, skip ahead
-            if (silentFrames >= minSilenceFrames) {
-               Region *r = new Region;
-               r->start = wt->LongSamplesToTime(index - silentFrames);
-               r->end = wt->LongSamplesToTime(index);
-               trackSilences.push_back(r);
-            }
-            silentFrames = 0;
-
+            // Skip ahead
             index = wt->TimeToLongSamples((*rit)->start);
          }
          //
          // End of optimization
          //
 
-         // Limit size of current block if we've reached the end
-         sampleCount count = blockLen;
-         if ((index + count) > end) {
-            count = end - index;
+         // Look for a silence beginning within the current region.  The
+         // block summaries let this pass over loud and silent stretches
+         // alike without reading their samples.
+         sampleCount limit = wxMin(end, wt->TimeToLongSamples((*rit)->end));
+         if (limit <= index)
+            limit = wxMin(end, index + 1);
+
+         sampleCount silenceStart =
+            wt->FindQuiet(index, limit - index,
+                          truncDbSilenceThreshold, minSilenceFrames);
+         if (silenceStart >= limit) {
+            index = limit;
+            continue;
          }
 
-         // Fill buffer
-         wt->Get((samplePtr)(buffer), floatSample, index, count);
+         // It may go on past the region
+         sampleCount silenceEnd =
+            wt->FindAbove(silenceStart, end - silenceStart,
+                          truncDbSilenceThreshold);
 
-         // Look for silences in current block
-         for (sampleCount i = 0; i < count; ++i) {
-            if (fabs(buffer[i]) < truncDbSilenceThreshold) {
-               ++silentFrames;
-            }
-            else {
-               if (silentFrames >= minSilenceFrames)
-               {
-                  // Record the silent region
-                  Region *r = new Region;
-                  r->start = wt->LongSamplesToTime(index + i - silentFrames);
-                  r->end = wt->LongSamplesToTime(index + i);
-                  trackSilences.push_back(r);
-               }
-               silentFrames = 0;
-            }
+         if (silenceEnd - silenceStart >= minSilenceFrames)
+         {
+            // Record the silent region
+            Region *r = new Region;
+            r->start = wt->LongSamplesToTime(silenceStart);
+            r->end = wt->LongSamplesToTime(silenceEnd);
+            trackSilences.push_back(r);
          }
 
-         // Next block
-         index += count;
+         index = silenceEnd;
       }
 
-      delete [] buffer;
-
-      // Buffer has been freed, so we're OK to return if cancelled
       if (cancelled)
       {
          ReplaceProcessedTracks(false);
          return false;
       }
 
-      if (silentFrames >= minSilenceFrames)
-      {
-         // Track ended in silence -- record region
-         Region *r = new Region;
-         r->start = wt->LongSamplesToTime(index - silentFrames);
-         r->end = wt->LongSamplesToTime(index);
-         trackSilences.push_back(r);
-      }
-
       // Intersect with the overall silent region list
       Intersect(silences, trackSilences);
       whichTrack++;
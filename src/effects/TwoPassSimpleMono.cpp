@@ -21,6 +21,7 @@ doing the second pass over all selected tracks.
 #include "../Audacity.h"
 
 #include "TwoPassSimpleMono.h"
+#include "../WaveTrackWriter.h"
 
 bool EffectTwoPassSimpleMono::Process()
 {
@@ -111,6 +112,12 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
    //be shorter than the length of the track being processed.
    float *buffer1 = new float[maxblock];
    float *buffer2 = new float[maxblock];
+
+   //The writer makes the new blocks on other threads while we go on
+   //reading, and puts them in the track when we are done, before the
+   //next pass reads it.
+   WaveTrackWriter writer(track, start);
+
    samples1 = track->GetBestBlockSize(start);
    if(start + samples1 > end)
       samples1 = end - start;
@@ -165,7 +172,7 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
 
       //Processing succeeded. copy the newly-changed samples back
       //onto the track.
-      track->Set((samplePtr) buffer1, floatSample, s-samples1, samples1);
+      writer.Write((samplePtr) buffer1, floatSample, samples1);
 
       //Increment s one blockfull of samples
       s += samples2;
@@ -207,14 +214,14 @@ bool EffectTwoPassSimpleMono::ProcessOne(WaveTrack * track,
 
    //Processing succeeded. copy the newly-changed samples back
    //onto the track.
-   track->Set((samplePtr) buffer1, floatSample, s-samples1, samples1);
+   writer.Write((samplePtr) buffer1, floatSample, samples1);
 
    //Clean up the buffer
    delete[]buffer1;
    delete[]buffer2;
 
-   //Return true because the effect processing succeeded.
-   return true;
+   //The effect processing succeeded, so put the new blocks in the track.
+   return writer.Commit();
 }
 
 bool EffectTwoPassSimpleMono::NewTrackPass1()
@@ -27,6 +27,7 @@ effects from this one class.
 #include "ladspa.h"
 
 #include <float.h>
+#include <string.h>
 
 #include <wx/wxprec.h>
 #include <wx/button.h>
@@ -543,6 +544,7 @@ LadspaEffect::LadspaEffect(const wxString & path, int index)
    mOutputPorts = NULL;
    mInputControls = NULL;
    mOutputControls = NULL;
+   mRealtimeControls = NULL;
 
    mLatencyPort = -1;
 
@@ -571,6 +573,11 @@ LadspaEffect::~LadspaEffect()
       delete [] mInputControls;
    }
 
+   if (mRealtimeControls)
+   {
+      delete [] mRealtimeControls;
+   }
+
    if (mOutputControls)
    {
       delete [] mOutputControls;
@@ -954,12 +961,21 @@ sampleCount LadspaEffect::ProcessBlock(float **inbuf, float **outbuf, sampleCoun
 
 bool LadspaEffect::RealtimeInitialize()
 {
+   if (!mRealtimeControls)
+   {
+      mRealtimeControls = new float [mData->PortCount];
+   }
+
+   // Nothing is processing yet, so it's safe to start the queue afresh
+   memcpy(mRealtimeControls, mInputControls, mData->PortCount * sizeof(float));
+   mControlQueue.Reset();
+
    return true;
 }
 
 bool LadspaEffect::RealtimeAddProcessor(int WXUNUSED(numChannels), float sampleRate)
 {
-   LADSPA_Handle slave = InitInstance(sampleRate);
+   LADSPA_Handle slave = InitInstance(sampleRate, true);
    if (!slave)
    {
       return false;
@@ -978,6 +994,12 @@ bool LadspaEffect::RealtimeFinalize()
    }
    mSlaves.Clear();
 
+   if (mRealtimeControls)
+   {
+      delete [] mRealtimeControls;
+      mRealtimeControls = NULL;
+   }
+
    return true;
 }
 
@@ -993,6 +1015,14 @@ bool LadspaEffect::RealtimeResume()
 
 bool LadspaEffect::RealtimeProcessStart()
 {
+   // Pick up any changes the user made since the last block
+   int p;
+   float value;
+   while (mControlQueue.Get(&p, &value))
+   {
+      mRealtimeControls[p] = value;
+   }
+
    return true;
 }
 
@@ -1082,6 +1112,7 @@ bool LadspaEffect::SetAutomationParameters(EffectAutomationParameters & parms)
          }
 
          mInputControls[p] = d;
+         PostControl(p);
       }
    }
 
@@ -1521,6 +1552,7 @@ void LadspaEffect::LoadParameters(const wxString & group)
             double val = 0.0;
             st.GetNextToken().ToDouble(&val);
             mInputControls[p] = val;
+            PostControl(p);
          }
       }
    }
@@ -1537,7 +1569,7 @@ void LadspaEffect::SaveParameters(const wxString & group)
    mHost->SetPrivateConfig(group, wxT("Value"), parms.Mid(1));
 }
 
-LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
+LADSPA_Handle LadspaEffect::InitInstance(float sampleRate, bool realtime)
 {
    /* Instantiate the plugin */
    LADSPA_Handle handle = mData->instantiate(mData, sampleRate);
@@ -1553,7 +1585,8 @@ LADSPA_Handle LadspaEffect::InitInstance(float sampleRate)
       {
          if (LADSPA_IS_PORT_INPUT(d))
          {
-            mData->connect_port(handle, p, &mInputControls[p]);
+            mData->connect_port(handle, p, realtime ? &mRealtimeControls[p]
+                                                    : &mInputControls[p]);
          }
          else
          {
@@ -1585,6 +1618,7 @@ void LadspaEffect::OnCheckBox(wxCommandEvent & evt)
    int p = evt.GetId() - ID_TOGGLES;
 
    mInputControls[p] = mToggles[p]->GetValue();
+   PostControl(p);
 }
 
 void LadspaEffect::OnSlider(wxCommandEvent & evt)
@@ -1621,6 +1655,7 @@ void LadspaEffect::OnSlider(wxCommandEvent & evt)
    mFields[p]->SetValue(str);
 
    mInputControls[p] = val;
+   PostControl(p);
 }
 
 void LadspaEffect::OnTextCtrl(wxCommandEvent & evt)
@@ -1652,10 +1687,20 @@ void LadspaEffect::OnTextCtrl(wxCommandEvent & evt)
       val = upper;
 
    mInputControls[p] = val;
+   PostControl(p);
 
    that->mSliders[p]->SetValue((int)(((val-lower)/range) * 1000.0 + 0.5));
 }
 
+void LadspaEffect::PostControl(unsigned long p)
+{
+   // The slaves don't look at mInputControls, so tell them about the change
+   if (mRealtimeControls)
+   {
+      mControlQueue.Post(p, mInputControls[p]);
+   }
+}
+
 void LadspaEffect::RefreshControls(bool outputOnly)
 {
    if (!mParent)
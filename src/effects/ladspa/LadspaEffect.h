@@ -20,6 +20,7 @@ class wxCheckBox;
 #include "audacity/PluginInterface.h"
 
 #include "../../widgets/NumericTextCtrl.h"
+#include "../ControlQueue.h"
 
 #include "ladspa.h"
 
@@ -132,13 +133,14 @@ private:
    void LoadParameters(const wxString & group);
    void SaveParameters(const wxString & group);
 
-   LADSPA_Handle InitInstance(float sampleRate);
+   LADSPA_Handle InitInstance(float sampleRate, bool realtime = false);
    void FreeInstance(LADSPA_Handle handle);
 
    void OnCheckBox(wxCommandEvent & evt);
    void OnSlider(wxCommandEvent & evt);
    void OnTextCtrl(wxCommandEvent & evt);
    void RefreshControls(bool outputOnly = false);
+   void PostControl(unsigned long p);
 
 private:
 
@@ -178,6 +180,10 @@ private:
 
    // Realtime processing
    LadspaSlaveArray mSlaves;
+   // The slaves' input controls, only changed by the audio thread as it
+   // takes the changes made to mInputControls from mControlQueue
+   float *mRealtimeControls;
+   ControlQueue mControlQueue;
 
    EffectUIHostInterface *mUIHost;
    LadspaEffectEventHelper *mEventHelper;
@@ -45,6 +45,7 @@
 #include <wx/stattext.h>
 #include <wx/string.h>
 #include <wx/textctrl.h>
+#include <wx/thread.h>
 #include <wx/timer.h>
 #include <wx/dcmemory.h>
 
@@ -68,6 +69,7 @@
 #include "../LabelTrack.h"
 #include "../Mix.h"
 #include "../Prefs.h"
+#include "../Profiler.h"
 #include "../Project.h"
 #include "../Track.h"
 #include "../WaveTrack.h"
@@ -75,6 +77,8 @@
 #include "../AColor.h"
 #include "../TimeTrack.h"
 #include "../Dependencies.h"
+#include "../ondemand/ODManager.h"
+#include "../ondemand/ODTaskThread.h"
 
 // Callback to display format options
 static void ExportCallback(void *cbdata, int index)
@@ -82,6 +86,293 @@ static void ExportCallback(void *cbdata, int index)
    ((Exporter *) cbdata)->DisplayOptions(index);
 }
 
+//----------------------------------------------------------------------------
+// ExportJob
+//----------------------------------------------------------------------------
+
+// How many mixed buffers an ExportPipeline may hold
+#define kExportPipelineDepth 3
+
+/// \brief Mixes an ExportJob's buffers on a thread of its own, a few ahead
+/// of the thread encoding them.
+class ExportPipeline
+{
+ public:
+   ExportPipeline(ExportJob *job);
+   ~ExportPipeline();
+
+   void Start();
+
+   /// Waits for the next mixed buffer.  Its frames are set to 0 at the end
+   /// of the mix.
+   samplePtr *Take(sampleCount *len, double *time);
+   /// Gives back the buffer from Take() to be mixed into again
+   void Release();
+
+   /// The mixing thread's loop
+   void Mix();
+
+ private:
+   class Thread;
+
+   struct Slot {
+      samplePtr *buffers;
+      sampleCount len;
+      double time;
+   };
+
+   ExportJob *mJob;
+   Thread *mThread;
+
+   Slot mSlots[kExportPipelineDepth];
+   int mFirst;          // the next slot to encode
+   int mQueued;         // slots mixed and not yet encoded
+   bool mStop;
+
+   ODLock mLock;
+   ODCondition *mCondition;
+};
+
+#ifdef __WXMAC__
+
+// As with ODTaskThread, use pthreads rather than wxThread on Mac OS X.
+class ExportPipeline::Thread
+{
+ public:
+   Thread(ExportPipeline *pipeline) : mPipeline(pipeline) {}
+
+   void Start()
+   {
+      pthread_create(&mThread, NULL, callback, this);
+   }
+
+   void Join()
+   {
+      pthread_join(mThread, NULL);
+   }
+
+ private:
+   static void *callback(void *p)
+   {
+      ((Thread *)p)->mPipeline->Mix();
+      return NULL;
+   }
+
+   pthread_t mThread;
+   ExportPipeline *mPipeline;
+};
+
+#else
+
+class ExportPipeline::Thread : public wxThread
+{
+ public:
+   Thread(ExportPipeline *pipeline)
+      : wxThread(wxTHREAD_JOINABLE), mPipeline(pipeline) {}
+
+   void Start()
+   {
+      Create();
+      Run();
+   }
+
+   void Join()
+   {
+      Wait();
+   }
+
+ protected:
+   virtual ExitCode Entry()
+   {
+      mPipeline->Mix();
+      return 0;
+   }
+
+ private:
+   ExportPipeline *mPipeline;
+};
+
+#endif // __WXMAC__
+
+ExportPipeline::ExportPipeline(ExportJob *job)
+{
+   mJob = job;
+   mThread = NULL;
+   mFirst = 0;
+   mQueued = 0;
+   mStop = false;
+   mCondition = new ODCondition(&mLock);
+
+   for (int i = 0; i < kExportPipelineDepth; i++) {
+      mSlots[i].buffers = new samplePtr[mJob->mNumBuffers];
+      for (int j = 0; j < mJob->mNumBuffers; j++) {
+         mSlots[i].buffers[j] = (samplePtr) malloc(mJob->mBlockLen * mJob->mFrameBytes);
+      }
+      mSlots[i].len = 0;
+      mSlots[i].time = mJob->mT0;
+   }
+}
+
+ExportPipeline::~ExportPipeline()
+{
+   if (mThread) {
+      mLock.Lock();
+      mStop = true;
+      mCondition->Broadcast();
+      mLock.Unlock();
+
+      mThread->Join();
+      delete mThread;
+   }
+
+   for (int i = 0; i < kExportPipelineDepth; i++) {
+      for (int j = 0; j < mJob->mNumBuffers; j++) {
+         free(mSlots[i].buffers[j]);
+      }
+      delete [] mSlots[i].buffers;
+   }
+
+   delete mCondition;
+}
+
+void ExportPipeline::Start()
+{
+   mThread = new Thread(this);
+   mThread->Start();
+}
+
+samplePtr *ExportPipeline::Take(sampleCount *len, double *time)
+{
+   mLock.Lock();
+   while (mQueued == 0)
+      mCondition->Wait();
+   Slot &slot = mSlots[mFirst];
+   mLock.Unlock();
+
+   *len = slot.len;
+   *time = slot.time;
+
+   return slot.buffers;
+}
+
+void ExportPipeline::Release()
+{
+   mLock.Lock();
+   mFirst = (mFirst + 1) % kExportPipelineDepth;
+   mQueued--;
+   mCondition->Broadcast();
+   mLock.Unlock();
+}
+
+void ExportPipeline::Mix()
+{
+   Profiler::SetThreadName("Export mixer");
+
+   Mixer *mixer = mJob->mMixer;
+   int numBuffers = mJob->mNumBuffers;
+
+   for (;;) {
+      mLock.Lock();
+      while (mQueued == kExportPipelineDepth && !mStop)
+         mCondition->Wait();
+      if (mStop) {
+         mLock.Unlock();
+         return;
+      }
+      Slot &slot = mSlots[(mFirst + mQueued) % kExportPipelineDepth];
+      mLock.Unlock();
+
+      // The mixer is only used from this thread once it has started
+      sampleCount len = mixer->Process(mJob->mBlockLen);
+      for (int i = 0; i < numBuffers; i++) {
+         samplePtr mixed = (numBuffers == 1) ?
+            mixer->GetBuffer() : mixer->GetBuffer(i);
+         memcpy(slot.buffers[i], mixed, len * mJob->mFrameBytes);
+      }
+      slot.len = len;
+      slot.time = mixer->MixGetCurrentTime();
+
+      mLock.Lock();
+      mQueued++;
+      mCondition->Broadcast();
+      mLock.Unlock();
+
+      if (len == 0)
+         return;
+   }
+}
+
+ExportJob::ExportJob(Mixer *mixer, double t0, double t1, sampleCount blockLen,
+                     int channels, bool interleaved, sampleFormat format)
+{
+   mMixer = mixer;
+   mT0 = t0;
+   mT1 = t1;
+   mBlockLen = blockLen;
+   mNumBuffers = interleaved ? 1 : channels;
+   mFrameBytes = SAMPLE_SIZE(format) * (interleaved ? channels : 1);
+   mBuffers = new samplePtr[mNumBuffers];
+
+   mPipelined = wxThread::GetCPUCount() > 1;
+   mPipeline = NULL;
+   mTime = t0;
+   mFinished = false;
+}
+
+ExportJob::~ExportJob()
+{
+   // Stops the mixing thread before the mixer goes
+   delete mPipeline;
+
+   delete [] mBuffers;
+   delete mMixer;
+}
+
+bool ExportJob::Process()
+{
+   if (mFinished)
+      return false;
+
+   sampleCount len;
+   samplePtr *buffers;
+
+   if (mPipelined) {
+      if (!mPipeline) {
+         mPipeline = new ExportPipeline(this);
+         mPipeline->Start();
+      }
+      buffers = mPipeline->Take(&len, &mTime);
+   }
+   else {
+      len = mMixer->Process(mBlockLen);
+      for (int i = 0; i < mNumBuffers; i++) {
+         mBuffers[i] = (mNumBuffers == 1) ?
+            mMixer->GetBuffer() : mMixer->GetBuffer(i);
+      }
+      buffers = mBuffers;
+      mTime = mMixer->MixGetCurrentTime();
+   }
+
+   bool success = Encode(buffers, len);
+
+   if (mPipeline)
+      mPipeline->Release();
+
+   if (len == 0)
+      mFinished = true;
+
+   return success && !mFinished;
+}
+
+double ExportJob::GetProgress()
+{
+   if (mT1 <= mT0)
+      return 1.0;
+
+   double progress = (mTime - mT0) / (mT1 - mT0);
+   return progress < 0.0 ? 0.0 : (progress > 1.0 ? 1.0 : progress);
+}
+
 //----------------------------------------------------------------------------
 // ExportPlugin
 //----------------------------------------------------------------------------
@@ -267,6 +558,46 @@ int ExportPlugin::DoExport(AudacityProject * WXUNUSED(project),
    return false;
 }
 
+int ExportPlugin::GetMaxConcurrentJobs(int WXUNUSED(subformat))
+{
+   return 0;
+}
+
+ExportJob *ExportPlugin::CreateJob(AudacityProject * WXUNUSED(project),
+                                   int WXUNUSED(channels),
+                                   wxString WXUNUSED(fName),
+                                   bool WXUNUSED(selectedOnly),
+                                   double WXUNUSED(t0),
+                                   double WXUNUSED(t1),
+                                   MixerSpec * WXUNUSED(mixerSpec),
+                                   Tags * WXUNUSED(metadata),
+                                   int WXUNUSED(subformat))
+{
+   return NULL;
+}
+
+int ExportPlugin::RunJob(ExportJob *job, const wxString &fName)
+{
+   int updateResult = eProgressSuccess;
+
+   ProgressDialog *progress = new ProgressDialog(wxFileName(fName).GetName(),
+                                                 job->GetMessage());
+
+   while (updateResult == eProgressSuccess && job->Process())
+      updateResult = progress->Update(job->GetProgress(), 1.0);
+
+   delete progress;
+
+   updateResult = job->Finish(updateResult);
+
+   if (!job->GetError().IsEmpty())
+      wxMessageBox(job->GetError());
+
+   delete job;
+
+   return updateResult;
+}
+
 //Create a mixer by computing the time warp factor
 Mixer* ExportPlugin::CreateMixer(int numInputTracks, WaveTrack **inputTracks,
          TimeTrack *timeTrack,
@@ -822,6 +1153,8 @@ bool Exporter::ExportTracks()
       ::wxRenameFile(mActualName.GetFullPath(), mFilename.GetFullPath());
    }
 
+   SetODExporting(true);
+
    success = mPlugins[mFormat]->Export(mProject,
                                        mChannels,
                                        mActualName.GetFullPath(),
@@ -832,6 +1165,8 @@ bool Exporter::ExportTracks()
                                        NULL,
                                        mSubFormat);
 
+   SetODExporting(false);
+
    if (mActualName != mFilename) {
       // Remove backup
       if (success == eProgressSuccess || success == eProgressStopped) {
@@ -847,6 +1182,25 @@ bool Exporter::ExportTracks()
    return (success == eProgressSuccess || success == eProgressStopped);
 }
 
+// Blocks that are still being imported or decoded read as silence, so have
+// the on-demand tasks for the exported tracks work on them first, starting
+// from the beginning of the export.
+void Exporter::SetODExporting(bool exporting)
+{
+   if (!ODManager::IsInstanceCreated())
+      return;
+
+   TrackListIterator iter(mProject->GetTracks());
+   for (Track *t = iter.First(); t; t = iter.Next()) {
+      if (t->GetKind() != Track::Wave || (mSelectedOnly && !t->GetSelected()))
+         continue;
+
+      ODManager::Instance()->SetTrackExporting((WaveTrack *)t, exporting);
+      if (exporting)
+         ODManager::Instance()->DemandTrackUpdate((WaveTrack *)t, mT0);
+   }
+}
+
 //----------------------------------------------------------------------------
 // ExportMixerPanel
 //----------------------------------------------------------------------------
@@ -28,6 +28,7 @@ class MixerSpec;
 class FileDialog;
 class TimeTrack;
 class Mixer;
+class ExportPipeline;
 
 class AUDACITY_DLL_API FormatInfo
 {
@@ -45,6 +46,84 @@ class AUDACITY_DLL_API FormatInfo
 
 WX_DECLARE_USER_EXPORTED_OBJARRAY(FormatInfo, FormatInfoArray, AUDACITY_DLL_API);
 
+//----------------------------------------------------------------------------
+// ExportJob
+//----------------------------------------------------------------------------
+
+/** \brief The part of an export that mixes and encodes.
+ *
+ * ExportPlugin::CreateJob() makes one after it has done everything that
+ * needs the user interface or the preferences, so that a job can run on any
+ * thread.  It must not show messages itself; it sets mError instead, which
+ * the caller shows.
+ *
+ * Plug-ins implement Encode().  When pipelined, the job mixes on a thread
+ * of its own a few buffers ahead of the thread calling Process(), which
+ * only encodes, so that an export takes about as long as the slower of the
+ * two rather than both.
+ */
+class AUDACITY_DLL_API ExportJob
+{
+public:
+   /// The job takes ownership of the mixer, which makes up to blockLen
+   /// frames of the given channels and format at a time
+   ExportJob(Mixer *mixer, double t0, double t1, sampleCount blockLen,
+             int channels, bool interleaved, sampleFormat format);
+   virtual ~ExportJob();
+
+   /// Whether to mix on another thread while this one encodes.  On by
+   /// default if there is more than one processor.  Set it before the first
+   /// call to Process().
+   void SetPipelined(bool pipelined) { mPipelined = pipelined; }
+
+   /// Encodes the next buffer of the mix.  Returns false when the mix is
+   /// finished, or there was an error.
+   bool Process();
+
+   /// Finishes and closes the file.  Called once, when Process() has
+   /// returned false or the export has been cancelled or stopped.
+   /// @param result The progress result so far
+   /// @return The result of the export
+   virtual int Finish(int result) = 0;
+
+   /// How much of the mix is encoded, from 0 to 1
+   double GetProgress();
+
+   /// What a progress dialog for the job should say
+   void SetMessage(const wxString &message) { mMessage = message; }
+   wxString GetMessage() const { return mMessage; }
+   /// Why the export failed, or empty
+   wxString GetError() const { return mError; }
+
+protected:
+   /** \brief Encodes and writes some of the mix.
+    *
+    * @param buffers One buffer if the mixer interleaves, else one for each
+    * channel
+    * @param len The number of frames, or 0 once at the end of the mix
+    * @return false if there was an error, after setting mError */
+   virtual bool Encode(samplePtr *buffers, sampleCount len) = 0;
+
+   double mT0;
+   double mT1;
+   wxString mMessage;
+   wxString mError;
+
+private:
+   friend class ExportPipeline;
+
+   Mixer *mMixer;
+   sampleCount mBlockLen;
+   int mNumBuffers;
+   int mFrameBytes;     // bytes per frame of one buffer
+   samplePtr *mBuffers;
+
+   bool mPipelined;
+   ExportPipeline *mPipeline;
+   double mTime;        // mix time of the last buffer encoded
+   bool mFinished;
+};
+
 //----------------------------------------------------------------------------
 // ExportPlugin
 //----------------------------------------------------------------------------
@@ -117,7 +196,35 @@ public:
                          MixerSpec *mixerSpec,
                          int subformat);
 
+   /** \brief How many exports to the sub-format may run at once on other
+    * threads, using CreateJob().
+    *
+    * The default of 0 means the plug-in must be run with Export() on the
+    * main thread.  Plug-ins limited by the disk rather than the processor
+    * should return a small number. */
+   virtual int GetMaxConcurrentJobs(int subformat = 0);
+
+   /** \brief Does the part of an export that needs the main thread, such
+    * as asking the user and reading the preferences, and returns the rest
+    * as an ExportJob.
+    *
+    * Takes the same parameters as Export().  Returns NULL if the export
+    * failed or was cancelled, after telling the user about it. */
+   virtual ExportJob *CreateJob(AudacityProject *project,
+                                int channels,
+                                wxString fName,
+                                bool selectedOnly,
+                                double t0,
+                                double t1,
+                                MixerSpec *mixerSpec = NULL,
+                                Tags *metadata = NULL,
+                                int subformat = 0);
+
 protected:
+   /// Runs a job on this thread with a progress dialog, and deletes it.
+   /// Plug-ins that have CreateJob() implement Export() with this.
+   int RunJob(ExportJob *job, const wxString &fName);
+
    Mixer* CreateMixer(int numInputTracks, WaveTrack **inputTracks,
          TimeTrack *timeTrack,
          double startTime, double stopTime,
@@ -162,6 +269,7 @@ private:
    bool CheckFilename();
    bool CheckMix();
    bool ExportTracks();
+   void SetODExporting(bool exporting);
 
 private:
    FileDialog *mDialog;
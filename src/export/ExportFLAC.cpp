@@ -187,6 +187,16 @@ public:
                MixerSpec *mixerSpec = NULL,
                Tags *metadata = NULL,
                int subformat = 0);
+   int GetMaxConcurrentJobs(int subformat = 0);
+   ExportJob *CreateJob(AudacityProject *project,
+                        int channels,
+                        wxString fName,
+                        bool selectedOnly,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec = NULL,
+                        Tags *metadata = NULL,
+                        int subformat = 0);
 
 private:
 
@@ -213,6 +223,62 @@ void ExportFLAC::Destroy()
    delete this;
 }
 
+/// Encodes the mix with libFLAC.
+class ExportFLACJob : public ExportJob
+{
+public:
+   ExportFLACJob(Mixer *mixer, double t0, double t1,
+                 FLAC::Encoder::File *encoder, FILE *fp,
+                 int numChannels, sampleFormat format);
+   virtual ~ExportFLACJob();
+
+   int Finish(int result);
+
+protected:
+   bool Encode(samplePtr *buffers, sampleCount len);
+
+private:
+   FLAC::Encoder::File *mEncoder;
+   wxFFile mFile;
+   int mNumChannels;
+   sampleFormat mFormat;
+   FLAC__int32 **mTmpSmplBuf;
+};
+
+ExportFLACJob::ExportFLACJob(Mixer *mixer, double t0, double t1,
+                             FLAC::Encoder::File *encoder, FILE *fp,
+                             int numChannels, sampleFormat format)
+:  ExportJob(mixer, t0, t1, SAMPLES_PER_RUN, numChannels, false, format)
+{
+   mEncoder = encoder;
+   if (fp) {
+      mFile.Attach(fp);
+   }
+   mNumChannels = numChannels;
+   mFormat = format;
+
+   mTmpSmplBuf = new FLAC__int32*[mNumChannels];
+   for (int i = 0; i < mNumChannels; i++) {
+      mTmpSmplBuf[i] = (FLAC__int32 *) calloc(SAMPLES_PER_RUN, sizeof(FLAC__int32));
+   }
+}
+
+ExportFLACJob::~ExportFLACJob()
+{
+   for (int i = 0; i < mNumChannels; i++) {
+      free(mTmpSmplBuf[i]);
+   }
+   delete[] mTmpSmplBuf;
+
+   delete mEncoder;
+}
+
+int ExportFLAC::GetMaxConcurrentJobs(int WXUNUSED(subformat))
+{
+   // Limited by the processor; ExportMultiple caps this by the threads
+   return 64;
+}
+
 int ExportFLAC::Export(AudacityProject *project,
                         int numChannels,
                         wxString fName,
@@ -221,13 +287,30 @@ int ExportFLAC::Export(AudacityProject *project,
                         double t1,
                         MixerSpec *mixerSpec,
                         Tags *metadata,
-                        int WXUNUSED(subformat))
+                        int subformat)
+{
+   ExportJob *job = CreateJob(project, numChannels, fName, selectionOnly,
+                              t0, t1, mixerSpec, metadata, subformat);
+   if (!job)
+      return false;
+
+   return RunJob(job, fName);
+}
+
+ExportJob *ExportFLAC::CreateJob(AudacityProject *project,
+                                 int numChannels,
+                                 wxString fName,
+                                 bool selectionOnly,
+                                 double t0,
+                                 double t1,
+                                 MixerSpec *mixerSpec,
+                                 Tags *metadata,
+                                 int WXUNUSED(subformat))
 {
    double    rate    = project->GetRate();
    TrackList *tracks = project->GetTracks();
 
    wxLogNull logNo;            // temporarily disable wxWidgets error messages
-   int updateResult = eProgressSuccess;
 
    int levelPref;
    gPrefs->Read(wxT("/FileFormats/FLACLevel"), &levelPref, 5);
@@ -235,73 +318,90 @@ int ExportFLAC::Export(AudacityProject *project,
    wxString bitDepthPref =
       gPrefs->Read(wxT("/FileFormats/FLACBitDepth"), wxT("16"));
 
-   FLAC::Encoder::File encoder;
+   FLAC::Encoder::File *encoder = new FLAC::Encoder::File;
 
 #ifdef LEGACY_FLAC
-   encoder.set_filename(OSOUTPUT(fName));
+   encoder->set_filename(OSOUTPUT(fName));
 #endif
-   encoder.set_channels(numChannels);
-   encoder.set_sample_rate(lrint(rate));
+   encoder->set_channels(numChannels);
+   encoder->set_sample_rate(lrint(rate));
 
    // See note in GetMetadata() about a bug in libflac++ 1.1.2
    if (!GetMetadata(project, metadata)) {
-      return false;
+      delete encoder;
+      return NULL;
    }
 
    if (mMetadata) {
-      encoder.set_metadata(&mMetadata, 1);
+      encoder->set_metadata(&mMetadata, 1);
    }
 
    sampleFormat format;
    if (bitDepthPref == wxT("24")) {
       format = int24Sample;
-      encoder.set_bits_per_sample(24);
+      encoder->set_bits_per_sample(24);
    } else { //convert float to 16 bits
       format = int16Sample;
-      encoder.set_bits_per_sample(16);
+      encoder->set_bits_per_sample(16);
    }
 
    // Duplicate the flac command line compression levels
    if (levelPref < 0 || levelPref > 8) {
       levelPref = 5;
    }
-   encoder.set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search);
-   encoder.set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
+   encoder->set_do_exhaustive_model_search(flacLevels[levelPref].do_exhaustive_model_search);
+   encoder->set_do_escape_coding(flacLevels[levelPref].do_escape_coding);
    if (numChannels != 2) {
-      encoder.set_do_mid_side_stereo(false);
-      encoder.set_loose_mid_side_stereo(false);
+      encoder->set_do_mid_side_stereo(false);
+      encoder->set_loose_mid_side_stereo(false);
    }
    else {
-      encoder.set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo);
-      encoder.set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
+      encoder->set_do_mid_side_stereo(flacLevels[levelPref].do_mid_side_stereo);
+      encoder->set_loose_mid_side_stereo(flacLevels[levelPref].loose_mid_side_stereo);
    }
-   encoder.set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision);
-   encoder.set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order);
-   encoder.set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order);
-   encoder.set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist);
-   encoder.set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
+   encoder->set_qlp_coeff_precision(flacLevels[levelPref].qlp_coeff_precision);
+   encoder->set_min_residual_partition_order(flacLevels[levelPref].min_residual_partition_order);
+   encoder->set_max_residual_partition_order(flacLevels[levelPref].max_residual_partition_order);
+   encoder->set_rice_parameter_search_dist(flacLevels[levelPref].rice_parameter_search_dist);
+   encoder->set_max_lpc_order(flacLevels[levelPref].max_lpc_order);
 
+   FILE *fp = NULL;
 #ifdef LEGACY_FLAC
-   encoder.init();
+   encoder->init();
 #else
    wxFFile f;     // will be closed when it goes out of scope
    if (!f.Open(fName, wxT("w+b"))) {
       wxMessageBox(wxString::Format(_("FLAC export couldn't open %s"), fName.c_str()));
-      return false;
+      if (mMetadata) {
+         ::FLAC__metadata_object_delete(mMetadata);
+         mMetadata = NULL;
+      }
+      delete encoder;
+      return NULL;
    }
 
    // Even though there is an init() method that takes a filename, use the one that
    // takes a file handle because wxWidgets can open a file with a Unicode name and
    // libflac can't (under Windows).
-   int status = encoder.init(f.fp());
+   int status = encoder->init(f.fp());
    if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
       wxMessageBox(wxString::Format(_("FLAC encoder failed to initialize\nStatus: %d"), status));
-      return false;
+      if (mMetadata) {
+         ::FLAC__metadata_object_delete(mMetadata);
+         mMetadata = NULL;
+      }
+      delete encoder;
+      return NULL;
    }
+   fp = f.fp();
+   f.Detach();
 #endif
 
+   // The encoder has written the metadata with the stream header, so
+   // mMetadata is free for the next export
    if (mMetadata) {
       ::FLAC__metadata_object_delete(mMetadata);
+      mMetadata = NULL;
    }
 
    int numWaveTracks;
@@ -314,53 +414,47 @@ int ExportFLAC::Export(AudacityProject *project,
                             rate, format, true, mixerSpec);
    delete [] waveTracks;
 
-   int i, j;
-   FLAC__int32 **tmpsmplbuf = new FLAC__int32*[numChannels];
-   for (i = 0; i < numChannels; i++) {
-      tmpsmplbuf[i] = (FLAC__int32 *) calloc(SAMPLES_PER_RUN, sizeof(FLAC__int32));
-   }
-
-   ProgressDialog *progress = new ProgressDialog(wxFileName(fName).GetName(),
-         selectionOnly ?
+   ExportJob *job = new ExportFLACJob(mixer, t0, t1, encoder, fp,
+                                      numChannels, format);
+   job->SetMessage(selectionOnly ?
          _("Exporting the selected audio as FLAC") :
          _("Exporting the entire project as FLAC"));
 
-   while (updateResult == eProgressSuccess) {
-      sampleCount samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
-      if (samplesThisRun == 0) { //stop encoding
-         break;
+   return job;
+}
+
+bool ExportFLACJob::Encode(samplePtr *buffers, sampleCount samplesThisRun)
+{
+   int i, j;
+
+   if (samplesThisRun == 0) { //stop encoding
+      return true;
+   }
+
+   for (i = 0; i < mNumChannels; i++) {
+      samplePtr mixed = buffers[i];
+      if (mFormat == int24Sample) {
+         for (j = 0; j < samplesThisRun; j++) {
+            mTmpSmplBuf[i][j] = ((int *) mixed)[j];
+         }
       }
       else {
-         for (i = 0; i < numChannels; i++) {
-            samplePtr mixed = mixer->GetBuffer(i);
-            if (format == int24Sample) {
-               for (j = 0; j < samplesThisRun; j++) {
-                  tmpsmplbuf[i][j] = ((int *) mixed)[j];
-               }
-            }
-            else {
-               for (j = 0; j < samplesThisRun; j++) {
-                  tmpsmplbuf[i][j] = ((short *) mixed)[j];
-               }
-            }
+         for (j = 0; j < samplesThisRun; j++) {
+            mTmpSmplBuf[i][j] = ((short *) mixed)[j];
          }
-         encoder.process(tmpsmplbuf, samplesThisRun);
       }
-      updateResult = progress->Update(mixer->MixGetCurrentTime()-t0, t1-t0);
    }
-   f.Detach(); // libflac closes the file
-   encoder.finish();
-
-   delete progress;
+   mEncoder->process(mTmpSmplBuf, samplesThisRun);
 
-   for (i = 0; i < numChannels; i++) {
-      free(tmpsmplbuf[i]);
-   }
-   delete mixer;
+   return true;
+}
 
-   delete[] tmpsmplbuf;
+int ExportFLACJob::Finish(int result)
+{
+   mFile.Detach(); // libflac closes the file
+   mEncoder->finish();
 
-   return updateResult;
+   return result;
 }
 
 bool ExportFLAC::DisplayOptions(wxWindow *parent, int WXUNUSED(format))
@@ -1565,6 +1565,16 @@ public:
                MixerSpec *mixerSpec = NULL,
                Tags *metadata = NULL,
                int subformat = 0);
+   int GetMaxConcurrentJobs(int subformat = 0);
+   ExportJob *CreateJob(AudacityProject *project,
+                        int channels,
+                        wxString fName,
+                        bool selectedOnly,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec = NULL,
+                        Tags *metadata = NULL,
+                        int subformat = 0);
 
 private:
 
@@ -1594,6 +1604,68 @@ void ExportMP3::Destroy()
    delete this;
 }
 
+/// Encodes the mix with LAME.
+class ExportMP3Job : public ExportJob
+{
+public:
+   ExportMP3Job(Mixer *mixer, double t0, double t1, MP3Exporter *exporter,
+                FILE *fp, wxFileOffset pos, int channels, sampleCount inSamples,
+                char *id3buffer, int id3len, bool endOfFile);
+   virtual ~ExportMP3Job();
+
+   int Finish(int result);
+
+protected:
+   bool Encode(samplePtr *buffers, sampleCount len);
+
+private:
+   MP3Exporter *mExporter;
+   wxFFile mOutFile;
+   wxFileOffset mPos;
+   int mChannels;
+   sampleCount mInSamples;
+   char *mID3Buffer;
+   int mID3Len;
+   bool mEndOfFile;
+   unsigned char *mBuffer;
+};
+
+ExportMP3Job::ExportMP3Job(Mixer *mixer, double t0, double t1,
+                           MP3Exporter *exporter, FILE *fp, wxFileOffset pos,
+                           int channels, sampleCount inSamples,
+                           char *id3buffer, int id3len, bool endOfFile)
+:  ExportJob(mixer, t0, t1, inSamples, channels, true, int16Sample)
+{
+   mExporter = exporter;
+   mOutFile.Attach(fp);
+   mPos = pos;
+   mChannels = channels;
+   mInSamples = inSamples;
+   mID3Buffer = id3buffer;
+   mID3Len = id3len;
+   mEndOfFile = endOfFile;
+
+   mBuffer = new unsigned char[mExporter->GetOutBufferSize()];
+   wxASSERT(mBuffer);
+}
+
+ExportMP3Job::~ExportMP3Job()
+{
+   if (mID3Buffer) {
+      free(mID3Buffer);
+   }
+
+   delete [] mBuffer;
+
+   delete mExporter;
+}
+
+int ExportMP3::GetMaxConcurrentJobs(int WXUNUSED(subformat))
+{
+   // Limited by the processor; ExportMultiple caps this by the threads
+   return 64;
+}
+
 int ExportMP3::Export(AudacityProject *project,
                        int channels,
                        wxString fName,
@@ -1602,38 +1674,59 @@ int ExportMP3::Export(AudacityProject *project,
                        double t1,
                        MixerSpec *mixerSpec,
                        Tags *metadata,
-                       int WXUNUSED(subformat))
+                       int subformat)
+{
+   ExportJob *job = CreateJob(project, channels, fName, selectionOnly,
+                              t0, t1, mixerSpec, metadata, subformat);
+   if (!job)
+      return false;
+
+   return RunJob(job, fName);
+}
+
+ExportJob *ExportMP3::CreateJob(AudacityProject *project,
+                                int channels,
+                                wxString fName,
+                                bool selectionOnly,
+                                double t0,
+                                double t1,
+                                MixerSpec *mixerSpec,
+                                Tags *metadata,
+                                int WXUNUSED(subformat))
 {
    int rate = lrint(project->GetRate());
 #ifndef DISABLE_DYNAMIC_LOADING_LAME
    wxWindow *parent = project;
 #endif // DISABLE_DYNAMIC_LOADING_LAME
    TrackList *tracks = project->GetTracks();
-   MP3Exporter exporter;
+   MP3Exporter *exporter = new MP3Exporter;
 
 #ifdef DISABLE_DYNAMIC_LOADING_LAME
-   if (!exporter.InitLibrary(wxT(""))) {
+   if (!exporter->InitLibrary(wxT(""))) {
       wxMessageBox(_("Could not initialize MP3 encoding library!"));
       gPrefs->Write(wxT("/MP3/MP3LibPath"), wxString(wxT("")));
       gPrefs->Flush();
 
-      return false;
+      delete exporter;
+      return NULL;
    }
 #else
-   if (!exporter.LoadLibrary(parent, MP3Exporter::Maybe)) {
+   if (!exporter->LoadLibrary(parent, MP3Exporter::Maybe)) {
       wxMessageBox(_("Could not open MP3 encoding library!"));
       gPrefs->Write(wxT("/MP3/MP3LibPath"), wxString(wxT("")));
       gPrefs->Flush();
 
-      return false;
+      delete exporter;
+      return NULL;
    }
 
-   if (!exporter.ValidLibraryLoaded()) {
+   if (!exporter->ValidLibraryLoaded()) {
       wxMessageBox(_("Not a valid or supported MP3 encoding library!"));
       gPrefs->Write(wxT("/MP3/MP3LibPath"), wxString(wxT("")));
       gPrefs->Flush();
 
-      return false;
+      delete exporter;
+      return NULL;
    }
 #endif // DISABLE_DYNAMIC_LOADING_LAME
 
@@ -1655,19 +1748,19 @@ int ExportMP3::Export(AudacityProject *project,
    if (rmode == MODE_SET) {
       int q = FindValue(setRates, WXSIZEOF(setRates), brate, PRESET_STANDARD);
       int r = FindValue(varModes, WXSIZEOF(varModes), vmode, ROUTINE_FAST);
-      exporter.SetMode(MODE_SET);
-      exporter.SetQuality(q, r);
+      exporter->SetMode(MODE_SET);
+      exporter->SetQuality(q, r);
    }
    else if (rmode == MODE_VBR) {
       int q = FindValue(varRates, WXSIZEOF(varRates), brate, QUALITY_2);
       int r = FindValue(varModes, WXSIZEOF(varModes), vmode, ROUTINE_FAST);
-      exporter.SetMode(MODE_VBR);
-      exporter.SetQuality(q, r);
+      exporter->SetMode(MODE_VBR);
+      exporter->SetQuality(q, r);
    }
    else if (rmode == MODE_ABR) {
       bitrate = FindValue(fixRates, WXSIZEOF(fixRates), brate, 128);
-      exporter.SetMode(MODE_ABR);
-      exporter.SetBitrate(bitrate);
+      exporter->SetMode(MODE_ABR);
+      exporter->SetBitrate(bitrate);
 
       if (bitrate > 160) {
          lowrate = 32000;
@@ -1678,8 +1771,8 @@ int ExportMP3::Export(AudacityProject *project,
    }
    else {
       bitrate = FindValue(fixRates, WXSIZEOF(fixRates), brate, 128);
-      exporter.SetMode(MODE_CBR);
-      exporter.SetBitrate(bitrate);
+      exporter->SetMode(MODE_CBR);
+      exporter->SetBitrate(bitrate);
 
       if (bitrate > 160) {
          lowrate = 32000;
@@ -1694,22 +1787,24 @@ int ExportMP3::Export(AudacityProject *project,
       (rate < lowrate) || (rate > highrate)) {
       rate = AskResample(bitrate, rate, lowrate, highrate);
       if (rate == 0) {
-         return false;
+         delete exporter;
+         return NULL;
       }
    }
 
    // Set the channel mode
    if (cmode == CHANNEL_JOINT) {
-      exporter.SetChannel(CHANNEL_JOINT);
+      exporter->SetChannel(CHANNEL_JOINT);
    }
    else {
-      exporter.SetChannel(CHANNEL_STEREO);
+      exporter->SetChannel(CHANNEL_STEREO);
    }
 
-   sampleCount inSamples = exporter.InitializeStream(channels, rate);
+   sampleCount inSamples = exporter->InitializeStream(channels, rate);
    if (((int)inSamples) < 0) {
       wxMessageBox(_("Unable to initialize MP3 stream"));
-      return false;
+      delete exporter;
+      return NULL;
    }
 
    // Put ID3 tags at beginning of file
@@ -1720,7 +1815,8 @@ int ExportMP3::Export(AudacityProject *project,
    wxFFile outFile(fName, wxT("w+b"));
    if (!outFile.IsOpened()) {
       wxMessageBox(_("Unable to open target file for writing"));
-      return false;
+      delete exporter;
+      return NULL;
    }
 
    char *id3buffer = NULL;
@@ -1732,12 +1828,6 @@ int ExportMP3::Export(AudacityProject *project,
    }
 
    wxFileOffset pos = outFile.Tell();
-   int updateResult = eProgressSuccess;
-   long bytes;
-
-   int bufferSize = exporter.GetOutBufferSize();
-   unsigned char *buffer = new unsigned char[bufferSize];
-   wxASSERT(buffer);
 
    int numWaveTracks;
    WaveTrack **waveTracks;
@@ -1769,63 +1859,63 @@ int ExportMP3::Export(AudacityProject *project,
                    brate);
    }
 
-   ProgressDialog *progress = new ProgressDialog(wxFileName(fName).GetName(), title);
+   ExportMP3Job *job = new ExportMP3Job(mixer, t0, t1, exporter,
+                                        outFile.fp(), pos, channels, inSamples,
+                                        id3buffer, id3len, endOfFile);
+   outFile.Detach();
+   job->SetMessage(title);
 
-   while (updateResult == eProgressSuccess) {
-      sampleCount blockLen = mixer->Process(inSamples);
+   return job;
+}
 
-      if (blockLen == 0) {
-         break;
-      }
+bool ExportMP3Job::Encode(samplePtr *buffers, sampleCount blockLen)
+{
+   long bytes;
 
-      short *mixed = (short *)mixer->GetBuffer();
+   if (blockLen == 0) {
+      return true;
+   }
 
-      if (blockLen < inSamples) {
-         if (channels > 1) {
-            bytes = exporter.EncodeRemainder(mixed,  blockLen , buffer);
-         }
-         else {
-            bytes = exporter.EncodeRemainderMono(mixed,  blockLen , buffer);
-         }
+   short *mixed = (short *)buffers[0];
+
+   if (blockLen < mInSamples) {
+      if (mChannels > 1) {
+         bytes = mExporter->EncodeRemainder(mixed,  blockLen , mBuffer);
       }
       else {
-         if (channels > 1) {
-            bytes = exporter.EncodeBuffer(mixed, buffer);
-         }
-         else {
-            bytes = exporter.EncodeBufferMono(mixed, buffer);
-         }
+         bytes = mExporter->EncodeRemainderMono(mixed,  blockLen , mBuffer);
       }
-
-      if (bytes < 0) {
-         wxString msg;
-         msg.Printf(_("Error %ld returned from MP3 encoder"), bytes);
-         wxMessageBox(msg);
-         break;
+   }
+   else {
+      if (mChannels > 1) {
+         bytes = mExporter->EncodeBuffer(mixed, mBuffer);
       }
+      else {
+         bytes = mExporter->EncodeBufferMono(mixed, mBuffer);
+      }
+   }
 
-      outFile.Write(buffer, bytes);
-
-      updateResult = progress->Update(mixer->MixGetCurrentTime()-t0, t1-t0);
+   if (bytes < 0) {
+      mError.Printf(_("Error %ld returned from MP3 encoder"), bytes);
+      return false;
    }
 
-   delete progress;
+   mOutFile.Write(mBuffer, bytes);
 
-   delete mixer;
+   return true;
+}
 
-   bytes = exporter.FinishStream(buffer);
+int ExportMP3Job::Finish(int result)
+{
+   long bytes = mExporter->FinishStream(mBuffer);
 
    if (bytes) {
-      outFile.Write(buffer, bytes);
+      mOutFile.Write(mBuffer, bytes);
    }
 
    // Write ID3 tag if it was supposed to be at the end of the file
-   if (id3len && endOfFile) {
-      outFile.Write(id3buffer, id3len);
-   }
-
-   if (id3buffer) {
-      free(id3buffer);
+   if (mID3Len && mEndOfFile) {
+      mOutFile.Write(mID3Buffer, mID3Len);
    }
 
    // Always write the info (Xing/Lame) tag.  Until we stop supporting Lame
@@ -1834,14 +1924,15 @@ int ExportMP3::Export(AudacityProject *project,
    //
    // Also, if beWriteInfoTag() is used, mGF will no longer be valid after
    // this call, so do not use it.
-   exporter.PutInfoTag(outFile, pos);
+   mExporter->PutInfoTag(mOutFile, mPos);
 
    // Close the file
-   outFile.Close();
+   mOutFile.Close();
 
-   delete [] buffer;
+   if (!mError.IsEmpty() && result == eProgressSuccess)
+      return eProgressFailed;
 
-   return updateResult;
+   return result;
 }
 
 bool ExportMP3::DisplayOptions(wxWindow *parent, int WXUNUSED(format))
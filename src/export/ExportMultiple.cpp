@@ -36,6 +36,7 @@
 #include <wx/stattext.h>
 #include <wx/textctrl.h>
 #include <wx/textdlg.h>
+#include <wx/utils.h>
 
 #include "Export.h"
 #include "ExportMultiple.h"
@@ -47,7 +48,10 @@
 #include "../Project.h"
 #include "../Prefs.h"
 #include "../Tags.h"
+#include "../ThreadPool.h"
+#include "../ondemand/ODTaskThread.h"
 #include "../widgets/HelpSystem.h"
+#include "../widgets/ProgressDialog.h"
 
 
 /* define our dynamic array of export settings */
@@ -680,12 +684,18 @@ int ExportMultiple::ExportMultipleByLabel(bool byName,
       if (!setting.filetags.ShowEditDialog(mProject,_("Edit Metadata"), tagsPrompt))
          return false;
 
+      setting.channels = channels;
+
       /* add the settings to the array of settings to be used for export */
       exportSettings.Add(setting);
 
       l++;  // next label, count up one
    }
 
+   if (CanExportConcurrently(numFiles)) {
+      return ExportConcurrently(exportSettings, false, NULL);
+   }
+
    int ok = eProgressSuccess;   // did it work?
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
@@ -717,6 +727,8 @@ int ExportMultiple::ExportMultipleByTrack(bool byName,
    wxArrayString otherNames;
    wxArrayPtrVoid selected;   /**< Array of pointers to the tracks which were
                                 selected when we started */
+   wxArrayPtrVoid exportTracks;  /**< The track and linked track (or NULL) of
+                                   each file */
    ExportKitArray exportSettings; // dynamic array we will use to store the
                                   // settings needed to do the exports with in
    exportSettings.Alloc(mNumWaveTracks);   // Allocate some guessed space to use.
@@ -820,6 +832,8 @@ int ExportMultiple::ExportMultipleByTrack(bool byName,
 
       /* add the settings to the array of settings to be used for export */
       exportSettings.Add(setting);
+      exportTracks.Add(tr);
+      exportTracks.Add(tr2);
 
       l++;  // next track, count up one
    }
@@ -827,7 +841,15 @@ int ExportMultiple::ExportMultipleByTrack(bool byName,
    // loop
    int count = 0; // count the number of sucessful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
-   for (tr = mIterator.First(mTracks); tr != NULL; tr = mIterator.Next()) {
+   if (CanExportConcurrently(exportSettings.GetCount())) {
+      ok = ExportConcurrently(exportSettings, true, &exportTracks);
+      // Skip the serial loop
+      tr = NULL;
+   }
+   else {
+      tr = mIterator.First(mTracks);
+   }
+   for (; tr != NULL; tr = mIterator.Next()) {
 
       // Want only non-muted wave tracks.
       if ((tr->GetKind() != Track::Wave) || (tr->GetMute() == true)) {
@@ -887,18 +909,8 @@ int ExportMultiple::DoExport(int channels,
    if (selectedOnly) wxLogDebug(wxT("Selected Region Only"));
    else wxLogDebug(wxT("Whole Project"));
 
-   if (mOverwrite->GetValue()) {
-      // Make sure we don't overwrite (corrupt) alias files
-      if (!mProject->GetDirManager()->EnsureSafeFilename(name)) {
-         return false;
-      }
-   }
-   else {
-      int i = 2;
-      wxString base(name.GetName());
-      while (name.FileExists()) {
-         name.SetName(wxString::Format(wxT("%s-%d"), base.c_str(), i++));
-      }
+   if (!MakeExportName(name)) {
+      return false;
    }
 
    // Call the format export routine
@@ -919,6 +931,273 @@ int ExportMultiple::DoExport(int channels,
    return success;
 }
 
+bool ExportMultiple::MakeExportName(wxFileName &name)
+{
+   if (mOverwrite->GetValue()) {
+      // Make sure we don't overwrite (corrupt) alias files
+      if (!mProject->GetDirManager()->EnsureSafeFilename(name)) {
+         return false;
+      }
+   }
+   else {
+      int i = 2;
+      wxString base(name.GetName());
+      while (name.FileExists()) {
+         name.SetName(wxString::Format(wxT("%s-%d"), base.c_str(), i++));
+      }
+   }
+
+   return true;
+}
+
+bool ExportMultiple::CanExportConcurrently(int numFiles)
+{
+   ThreadPool *pool = ThreadPool::Get();
+
+   return numFiles > 1 &&
+          pool && pool->GetNumThreads() > 1 &&
+          mPlugins[mPluginIndex]->GetMaxConcurrentJobs(mSubFormatIndex) > 1;
+}
+
+/// One file of an ExportMultiple::ExportConcurrently() set.  The last three
+/// fields are shared with the thread running its job, under the lock.
+struct ExportMultipleFile
+{
+   ExportJob *job;
+   wxString path;
+   double duration;
+
+   double progress;
+   bool finished;
+   int result;
+};
+
+/// What the threads of ExportMultiple::ExportConcurrently() share.
+struct ExportMultipleState
+{
+   ODLock lock;
+   /// eProgressSuccess, or the result the unfinished jobs should stop with
+   int stop;
+};
+
+class ExportMultipleJob : public ThreadPoolJob
+{
+ public:
+   ExportMultipleJob(ExportMultipleState *state, ExportMultipleFile *file)
+   {
+      mState = state;
+      mFile = file;
+   }
+
+   void Run()
+   {
+      ExportJob *job = mFile->job;
+      int result = eProgressSuccess;
+
+      for (;;) {
+         double progress = job->GetProgress();
+
+         mState->lock.Lock();
+         mFile->progress = progress;
+         int stop = mState->stop;
+         mState->lock.Unlock();
+
+         if (stop != eProgressSuccess) {
+            result = stop;
+            break;
+         }
+
+         if (!job->Process()) {
+            break;
+         }
+      }
+
+      result = job->Finish(result);
+
+      mState->lock.Lock();
+      mFile->result = result;
+      mFile->finished = true;
+      mState->lock.Unlock();
+   }
+
+ private:
+   ExportMultipleState *mState;
+   ExportMultipleFile *mFile;
+};
+
+int ExportMultiple::ExportConcurrently(ExportKitArray &exportSettings,
+                                       bool selectedOnly,
+                                       wxArrayPtrVoid *tracks)
+{
+   ExportPlugin *plugin = mPlugins[mPluginIndex];
+   ThreadPool *pool = ThreadPool::Get();
+   int numFiles = exportSettings.GetCount();
+   int maxRunning = plugin->GetMaxConcurrentJobs(mSubFormatIndex);
+   int i;
+
+   if (maxRunning > pool->GetNumThreads()) {
+      maxRunning = pool->GetNumThreads();
+   }
+
+   ExportMultipleState state;
+   state.stop = eProgressSuccess;
+
+   ExportMultipleFile *files = new ExportMultipleFile[numFiles];
+   double total = 0.0;
+   for (i = 0; i < numFiles; i++) {
+      files[i].job = NULL;
+      files[i].duration = exportSettings[i].t1 - exportSettings[i].t0;
+      files[i].progress = 0.0;
+      files[i].finished = false;
+      files[i].result = eProgressSuccess;
+      total += files[i].duration;
+   }
+
+   ProgressDialog *progress = new ProgressDialog(_("Export Multiple"),
+      wxString::Format(_("Exporting %d files"), numFiles));
+
+   int updateResult = eProgressSuccess;
+   int failed = -1;     // the first file that did not export
+   int next = 0;        // the next file to prepare
+   int running = 0;
+   int reaped = 0;      // files before this are all finished and deleted
+
+   for (;;) {
+      // Prepare files in order, so that the names come out as they would
+      // one at a time
+      while (updateResult == eProgressSuccess && failed < 0 &&
+             running < maxRunning && next < numFiles) {
+         ExportKit &setting = exportSettings[next];
+         ExportMultipleFile &file = files[next];
+         wxFileName name = setting.destfile;
+
+         wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (name.GetFullName()).c_str());
+
+         if (MakeExportName(name)) {
+            Track *tr = NULL;
+            Track *tr2 = NULL;
+            if (tracks) {
+               tr = (Track *) tracks->Item(next * 2);
+               tr2 = (Track *) tracks->Item(next * 2 + 1);
+               tr->SetSelected(true);
+               if (tr2) {
+                  tr2->SetSelected(true);
+               }
+            }
+
+            file.path = name.GetFullPath();
+            file.job = plugin->CreateJob(mProject,
+                                         setting.channels,
+                                         file.path,
+                                         selectedOnly,
+                                         setting.t0,
+                                         setting.t1,
+                                         NULL,
+                                         &setting.filetags,
+                                         mSubFormatIndex);
+
+            // The job has its own mixer, so the selection can change again
+            if (tr) {
+               tr->SetSelected(false);
+               if (tr2) {
+                  tr2->SetSelected(false);
+               }
+            }
+         }
+
+         if (!file.job) {
+            file.result = eProgressFailed;
+            file.finished = true;
+            failed = next;
+            next++;
+            break;
+         }
+
+         pool->Add(new ExportMultipleJob(&state, &file));
+         running++;
+         next++;
+      }
+
+      // Collect the finished files, and show any errors in order
+      double done = 0.0;
+      state.lock.Lock();
+      for (i = 0; i < next; i++) {
+         if (files[i].finished) {
+            done += files[i].duration;
+         }
+         else {
+            done += files[i].progress * files[i].duration;
+         }
+      }
+      while (reaped < next && files[reaped].finished) {
+         ExportMultipleFile &file = files[reaped];
+         if (file.job) {
+            state.lock.Unlock();
+
+            wxString error = file.job->GetError();
+            if (!error.IsEmpty()) {
+               wxMessageBox(error);
+            }
+            delete file.job;
+            file.job = NULL;
+            running--;
+
+            if (file.result != eProgressSuccess &&
+                file.result != eProgressStopped && failed < 0) {
+               failed = reaped;
+            }
+
+            state.lock.Lock();
+         }
+         reaped++;
+      }
+      state.lock.Unlock();
+
+      if (running == 0 &&
+          (updateResult != eProgressSuccess || failed >= 0 || next == numFiles)) {
+         break;
+      }
+
+      if (updateResult == eProgressSuccess) {
+         updateResult = progress->Update(done, total);
+      }
+
+      // After a failure the running files are still finished, as they
+      // would have been one at a time, but cancelling or stopping applies
+      // to all of them
+      if (updateResult != eProgressSuccess) {
+         state.lock.Lock();
+         state.stop = updateResult;
+         state.lock.Unlock();
+      }
+
+      if (running > 0) {
+         wxMilliSleep(100);
+      }
+   }
+
+   delete progress;
+
+   int ok = eProgressSuccess;
+   for (i = 0; i < next; i++) {
+      if (files[i].result == eProgressSuccess ||
+          files[i].result == eProgressStopped) {
+         mExported.Add(files[i].path);
+      }
+      if (ok == eProgressSuccess) {
+         ok = files[i].result;
+      }
+   }
+
+   delete [] files;
+
+   if (ok == eProgressSuccess) {
+      ok = updateResult;
+   }
+
+   return ok;
+}
+
 wxString ExportMultiple::MakeFileName(wxString input)
 {
    wxString newname; // name we are generating
@@ -27,6 +27,7 @@ class wxRadioButton;
 class wxTextCtrl;
 
 class AudacityProject;
+class ExportKitArray;
 class ShuttleGui;
 
 class ExportMultiple : public wxDialog
@@ -78,6 +79,25 @@ private:
                  double t0,
                  double t1,
                  Tags tags);
+   /** \brief Makes the final name for one file of the set: a unique one, or
+    * one safe to overwrite.  Returns false if the file may not be written. */
+   bool MakeExportName(wxFileName &name);
+   /** \brief Whether the files of the set can be exported several at a
+    * time with ExportConcurrently() */
+   bool CanExportConcurrently(int numFiles);
+   /** \brief Export the files of a set several at a time, on the thread pool
+    *
+    * Each file is prepared in turn on this thread, which names it and asks
+    * the plug-in for an ExportJob, and its job then runs on the pool.  One
+    * progress dialog covers all of them.
+    * @param exportSettings The files to export
+    * @param selectedOnly Should we export the selected tracks only?
+    * @param tracks For ExportMultipleByTrack, two per file: the track and its
+    * linked partner (or NULL), which are selected while the file is prepared
+    */
+   int ExportConcurrently(ExportKitArray &exportSettings,
+                          bool selectedOnly,
+                          wxArrayPtrVoid *tracks);
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
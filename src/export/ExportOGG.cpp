@@ -140,6 +140,16 @@ public:
                MixerSpec *mixerSpec = NULL,
                Tags *metadata = NULL,
                int subformat = 0);
+   int GetMaxConcurrentJobs(int subformat = 0);
+   ExportJob *CreateJob(AudacityProject *project,
+                        int channels,
+                        wxString fName,
+                        bool selectedOnly,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec = NULL,
+                        Tags *metadata = NULL,
+                        int subformat = 0);
 
 private:
 
@@ -162,59 +172,59 @@ void ExportOGG::Destroy()
    delete this;
 }
 
-int ExportOGG::Export(AudacityProject *project,
-                       int numChannels,
-                       wxString fName,
-                       bool selectionOnly,
-                       double t0,
-                       double t1,
-                       MixerSpec *mixerSpec,
-                       Tags *metadata,
-                       int WXUNUSED(subformat))
+/// Encodes the mix with libvorbis.
+class ExportOGGJob : public ExportJob
 {
-   double    rate    = project->GetRate();
-   TrackList *tracks = project->GetTracks();
-   double    quality = (gPrefs->Read(wxT("/FileFormats/OggExportQuality"), 50)/(float)100.0);
+public:
+   /// Sets up the encoder and writes the headers, with the comments given
+   ExportOGGJob(Mixer *mixer, double t0, double t1, FileIO *outFile,
+                int numChannels, double rate, double quality,
+                vorbis_comment *comment);
+   virtual ~ExportOGGJob();
 
-   wxLogNull logNo;            // temporarily disable wxWidgets error messages
-   int updateResult = eProgressSuccess;
-   int       eos = 0;
+   int Finish(int result);
 
-   FileIO outFile(fName, FileIO::Output);
+protected:
+   bool Encode(samplePtr *buffers, sampleCount len);
 
-   if (!outFile.IsOpened()) {
-      wxMessageBox(_("Unable to open target file for writing"));
-      return false;
-   }
+private:
+   FileIO *mOutFile;
+   int mNumChannels;
+   int mEOS;
 
    // All the Ogg and Vorbis encoding data
-   ogg_stream_state stream;
-   ogg_page         page;
-   ogg_packet       packet;
+   ogg_stream_state mStream;
+   ogg_page         mPage;
+   ogg_packet       mPacket;
 
-   vorbis_info      info;
-   vorbis_comment   comment;
-   vorbis_dsp_state dsp;
-   vorbis_block     block;
+   vorbis_info      mInfo;
+   vorbis_dsp_state mDsp;
+   vorbis_block     mBlock;
+};
 
-   // Encoding setup
-   vorbis_info_init(&info);
-   vorbis_encode_init_vbr(&info, numChannels, int(rate + 0.5), quality);
+ExportOGGJob::ExportOGGJob(Mixer *mixer, double t0, double t1,
+                           FileIO *outFile, int numChannels,
+                           double rate, double quality,
+                           vorbis_comment *comment)
+:  ExportJob(mixer, t0, t1, SAMPLES_PER_RUN, numChannels, false, floatSample)
+{
+   mOutFile = outFile;
+   mNumChannels = numChannels;
+   mEOS = 0;
 
-   // Retrieve tags
-   if (!FillComment(project, &comment, metadata)) {
-      return false;
-   }
+   // Encoding setup
+   vorbis_info_init(&mInfo);
+   vorbis_encode_init_vbr(&mInfo, numChannels, int(rate + 0.5), quality);
 
    // Set up analysis state and auxiliary encoding storage
-   vorbis_analysis_init(&dsp, &info);
-   vorbis_block_init(&dsp, &block);
+   vorbis_analysis_init(&mDsp, &mInfo);
+   vorbis_block_init(&mDsp, &mBlock);
 
    // Set up packet->stream encoder.  According to encoder example,
    // a random serial number makes it more likely that you can make
    // chained streams with concatenation.
    srand(time(NULL));
-   ogg_stream_init(&stream, rand());
+   ogg_stream_init(&mStream, rand());
 
    // First we need to write the required headers:
    //    1. The Ogg bitstream header, which contains codec setup params
@@ -228,19 +238,88 @@ int ExportOGG::Export(AudacityProject *project,
    ogg_packet comment_header;
    ogg_packet codebook_header;
 
-   vorbis_analysis_headerout(&dsp, &comment, &bitstream_header, &comment_header,
+   vorbis_analysis_headerout(&mDsp, comment, &bitstream_header, &comment_header,
          &codebook_header);
 
    // Place these headers into the stream
-   ogg_stream_packetin(&stream, &bitstream_header);
-   ogg_stream_packetin(&stream, &comment_header);
-   ogg_stream_packetin(&stream, &codebook_header);
+   ogg_stream_packetin(&mStream, &bitstream_header);
+   ogg_stream_packetin(&mStream, &comment_header);
+   ogg_stream_packetin(&mStream, &codebook_header);
 
    // Flushing these headers now guarentees that audio data will
    // start on a new page, which apparently makes streaming easier
-   while (ogg_stream_flush(&stream, &page)) {
-      outFile.Write(page.header, page.header_len);
-      outFile.Write(page.body, page.body_len);
+   while (ogg_stream_flush(&mStream, &mPage)) {
+      mOutFile->Write(mPage.header, mPage.header_len);
+      mOutFile->Write(mPage.body, mPage.body_len);
+   }
+}
+
+ExportOGGJob::~ExportOGGJob()
+{
+   ogg_stream_clear(&mStream);
+
+   vorbis_block_clear(&mBlock);
+   vorbis_dsp_clear(&mDsp);
+   vorbis_info_clear(&mInfo);
+
+   delete mOutFile;
+}
+
+int ExportOGG::GetMaxConcurrentJobs(int WXUNUSED(subformat))
+{
+   // Limited by the processor; ExportMultiple caps this by the threads
+   return 64;
+}
+
+int ExportOGG::Export(AudacityProject *project,
+                       int numChannels,
+                       wxString fName,
+                       bool selectionOnly,
+                       double t0,
+                       double t1,
+                       MixerSpec *mixerSpec,
+                       Tags *metadata,
+                       int subformat)
+{
+   ExportJob *job = CreateJob(project, numChannels, fName, selectionOnly,
+                              t0, t1, mixerSpec, metadata, subformat);
+   if (!job)
+      return false;
+
+   return RunJob(job, fName);
+}
+
+ExportJob *ExportOGG::CreateJob(AudacityProject *project,
+                                int numChannels,
+                                wxString fName,
+                                bool selectionOnly,
+                                double t0,
+                                double t1,
+                                MixerSpec *mixerSpec,
+                                Tags *metadata,
+                                int WXUNUSED(subformat))
+{
+   double    rate    = project->GetRate();
+   TrackList *tracks = project->GetTracks();
+   double    quality = (gPrefs->Read(wxT("/FileFormats/OggExportQuality"), 50)/(float)100.0);
+
+   wxLogNull logNo;            // temporarily disable wxWidgets error messages
+
+   // The job may close the file on another thread, so give it its own
+   // copy of the name
+   FileIO *outFile = new FileIO(wxString(fName.c_str()), FileIO::Output);
+
+   if (!outFile->IsOpened()) {
+      wxMessageBox(_("Unable to open target file for writing"));
+      delete outFile;
+      return NULL;
+   }
+
+   // Retrieve tags
+   vorbis_comment comment;
+   if (!FillComment(project, &comment, metadata)) {
+      delete outFile;
+      return NULL;
    }
 
    int numWaveTracks;
@@ -253,84 +332,80 @@ int ExportOGG::Export(AudacityProject *project,
                             rate, floatSample, true, mixerSpec);
    delete [] waveTracks;
 
-   ProgressDialog *progress = new ProgressDialog(wxFileName(fName).GetName(),
-      selectionOnly ?
+   ExportJob *job = new ExportOGGJob(mixer, t0, t1, outFile, numChannels,
+                                     rate, quality, &comment);
+   vorbis_comment_clear(&comment);
+
+   job->SetMessage(selectionOnly ?
       _("Exporting the selected audio as Ogg Vorbis") :
       _("Exporting the entire project as Ogg Vorbis"));
 
-   while (updateResult == eProgressSuccess && !eos) {
-      float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
-      sampleCount samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
+   return job;
+}
 
-      if (samplesThisRun == 0) {
-         // Tell the library that we wrote 0 bytes - signalling the end.
-         vorbis_analysis_wrote(&dsp, 0);
-      }
-      else {
+bool ExportOGGJob::Encode(samplePtr *buffers, sampleCount samplesThisRun)
+{
+   float **vorbis_buffer = vorbis_analysis_buffer(&mDsp, SAMPLES_PER_RUN);
 
-         for (int i = 0; i < numChannels; i++) {
-            float *temp = (float *)mixer->GetBuffer(i);
-            memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
-         }
+   if (samplesThisRun == 0) {
+      // Tell the library that we wrote 0 bytes - signalling the end.
+      vorbis_analysis_wrote(&mDsp, 0);
+   }
+   else {
 
-         // tell the encoder how many samples we have
-         vorbis_analysis_wrote(&dsp, samplesThisRun);
+      for (int i = 0; i < mNumChannels; i++) {
+         memcpy(vorbis_buffer[i], buffers[i], sizeof(float)*samplesThisRun);
       }
 
-      // I don't understand what this call does, so here is the comment
-      // from the example, verbatim:
-      //
-      //    vorbis does some data preanalysis, then divvies up blocks
-      //    for more involved (potentially parallel) processing. Get
-      //    a single block for encoding now
-      while (vorbis_analysis_blockout(&dsp, &block) == 1) {
+      // tell the encoder how many samples we have
+      vorbis_analysis_wrote(&mDsp, samplesThisRun);
+   }
+
+   // I don't understand what this call does, so here is the comment
+   // from the example, verbatim:
+   //
+   //    vorbis does some data preanalysis, then divvies up blocks
+   //    for more involved (potentially parallel) processing. Get
+   //    a single block for encoding now
+   while (vorbis_analysis_blockout(&mDsp, &mBlock) == 1) {
 
-         // analysis, assume we want to use bitrate management
-         vorbis_analysis(&block, NULL);
-         vorbis_bitrate_addblock(&block);
+      // analysis, assume we want to use bitrate management
+      vorbis_analysis(&mBlock, NULL);
+      vorbis_bitrate_addblock(&mBlock);
 
-         while (vorbis_bitrate_flushpacket(&dsp, &packet)) {
+      while (vorbis_bitrate_flushpacket(&mDsp, &mPacket)) {
 
-            // add the packet to the bitstream
-            ogg_stream_packetin(&stream, &packet);
+         // add the packet to the bitstream
+         ogg_stream_packetin(&mStream, &mPacket);
 
-            // From vorbis-tools-1.0/oggenc/encode.c:
-            //   If we've gone over a page boundary, we can do actual output,
-            //   so do so (for however many pages are available).
+         // From vorbis-tools-1.0/oggenc/encode.c:
+         //   If we've gone over a page boundary, we can do actual output,
+         //   so do so (for however many pages are available).
 
-            while (!eos) {
-               int result = ogg_stream_pageout(&stream, &page);
-               if (!result) {
-                  break;
-               }
+         while (!mEOS) {
+            int result = ogg_stream_pageout(&mStream, &mPage);
+            if (!result) {
+               break;
+            }
 
-               outFile.Write(page.header, page.header_len);
-               outFile.Write(page.body, page.body_len);
+            mOutFile->Write(mPage.header, mPage.header_len);
+            mOutFile->Write(mPage.body, mPage.body_len);
 
-               if (ogg_page_eos(&page)) {
-                  eos = 1;
-               }
+            if (ogg_page_eos(&mPage)) {
+               mEOS = 1;
             }
          }
       }
-
-      updateResult = progress->Update(mixer->MixGetCurrentTime()-t0, t1-t0);
    }
 
-   delete progress;;
-
-   delete mixer;
-
-   ogg_stream_clear(&stream);
-
-   vorbis_block_clear(&block);
-   vorbis_dsp_clear(&dsp);
-   vorbis_info_clear(&info);
-   vorbis_comment_clear(&comment);
+   return true;
+}
 
-   outFile.Close();
+int ExportOGGJob::Finish(int result)
+{
+   mOutFile->Close();
 
-   return updateResult;
+   return result;
 }
 
 bool ExportOGG::DisplayOptions(wxWindow *parent, int format)
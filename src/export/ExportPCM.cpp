@@ -316,10 +316,21 @@ public:
                MixerSpec *mixerSpec = NULL,
                Tags *metadata = NULL,
                int subformat = 0);
+   int GetMaxConcurrentJobs(int subformat = 0);
+   ExportJob *CreateJob(AudacityProject *project,
+                        int channels,
+                        wxString fName,
+                        bool selectedOnly,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec = NULL,
+                        Tags *metadata = NULL,
+                        int subformat = 0);
    // optional
    wxString GetExtension(int index = 0);
 
 private:
+   friend class ExportPCMJob;
 
    char *AdjustString(wxString wxStr, int sf_format);
    bool AddStrings(AudacityProject *project, SNDFILE *sf, Tags *tags, int sf_format);
@@ -393,6 +404,56 @@ void ExportPCM::Destroy()
    delete this;
 }
 
+// Frames mixed and written at a time
+#define kPCMBlockLen (44100 * 5)
+
+/// Writes the mix with libsndfile.
+class ExportPCMJob : public ExportJob
+{
+public:
+   ExportPCMJob(ExportPCM *plugin, Mixer *mixer, double t0, double t1,
+                int channels, int fd, SNDFILE *sf, int sf_format,
+                sampleFormat format, const wxString &fName,
+                const wxString &formatStr, Tags *metadata)
+   :  ExportJob(mixer, t0, t1, kPCMBlockLen, channels, true, format)
+   {
+      mPlugin = plugin;
+      // The file must stay open as long as libsndfile writes to it
+      mFile.Attach(fd);
+      mSF = sf;
+      mSFFormat = sf_format;
+      mFormat = format;
+      // Copies the jobs alone use, since wxStrings share their buffers
+      mFName = wxString(fName.c_str());
+      mFormatStr = wxString(formatStr.c_str());
+      wxString n, v;
+      for (bool cont = metadata->GetFirst(n, v); cont; cont = metadata->GetNext(n, v))
+         mTags.SetTag(wxString(n.c_str()), wxString(v.c_str()));
+   }
+
+   int Finish(int result);
+
+protected:
+   bool Encode(samplePtr *buffers, sampleCount len);
+
+private:
+   ExportPCM *mPlugin;
+   wxFile mFile;
+   SNDFILE *mSF;
+   int mSFFormat;
+   sampleFormat mFormat;
+   wxString mFName;
+   wxString mFormatStr;
+   Tags mTags;
+};
+
+int ExportPCM::GetMaxConcurrentJobs(int WXUNUSED(subformat))
+{
+   // Encoding is little work, so more than a couple at once just makes the
+   // disk seek between the files
+   return 2;
+}
+
 /**
  *
  * @param subformat Control whether we are doing a "preset" export to a popular
@@ -408,6 +469,24 @@ int ExportPCM::Export(AudacityProject *project,
                        MixerSpec *mixerSpec,
                        Tags *metadata,
                        int subformat)
+{
+   ExportJob *job = CreateJob(project, numChannels, fName, selectionOnly,
+                              t0, t1, mixerSpec, metadata, subformat);
+   if (!job)
+      return false;
+
+   return RunJob(job, fName);
+}
+
+ExportJob *ExportPCM::CreateJob(AudacityProject *project,
+                                int numChannels,
+                                wxString fName,
+                                bool selectionOnly,
+                                double t0,
+                                double t1,
+                                MixerSpec *mixerSpec,
+                                Tags *metadata,
+                                int subformat)
 {
    double       rate = project->GetRate();
    TrackList   *tracks = project->GetTracks();
@@ -436,7 +515,6 @@ int ExportPCM::Export(AudacityProject *project,
    wxString     formatStr;
    SF_INFO      info;
    SNDFILE     *sf = NULL;
-   int          err;
 
    //This whole operation should not occur while a file is being loaded on OD,
    //(we are worried about reading from a file being written to,) so we block.
@@ -461,7 +539,7 @@ int ExportPCM::Export(AudacityProject *project,
       info.format = (info.format & SF_FORMAT_TYPEMASK);
    if (!sf_format_check(&info)) {
       wxMessageBox(_("Cannot export audio in this format."));
-      return false;
+      return NULL;
    }
 
    wxFile f;   // will be closed when it goes out of scope
@@ -480,7 +558,7 @@ int ExportPCM::Export(AudacityProject *project,
    if (!sf) {
       wxMessageBox(wxString::Format(_("Cannot export audio to %s"),
                                     fName.c_str()));
-      return false;
+      return NULL;
    }
    // Retrieve tags if not given a set
    if (metadata == NULL)
@@ -492,7 +570,7 @@ int ExportPCM::Export(AudacityProject *project,
         (sf_format & SF_FORMAT_TYPEMASK) != SF_FORMAT_WAVEX) {
        if (!AddStrings(project, sf, metadata, sf_format)) {
           sf_close(sf);
-          return false;
+          return NULL;
        }
    }
 
@@ -502,99 +580,101 @@ int ExportPCM::Export(AudacityProject *project,
    else
       format = int16Sample;
 
-   int maxBlockLen = 44100 * 5;
-
-   int updateResult = eProgressSuccess;
-
    int numWaveTracks;
    WaveTrack **waveTracks;
    tracks->GetWaveTracks(selectionOnly, &numWaveTracks, &waveTracks);
    Mixer *mixer = CreateMixer(numWaveTracks, waveTracks,
                             tracks->GetTimeTrack(),
                             t0, t1,
-                            info.channels, maxBlockLen, true,
+                            info.channels, kPCMBlockLen, true,
                             rate, format, true, mixerSpec);
+   delete[] waveTracks;
 
-   ProgressDialog *progress = new ProgressDialog(wxFileName(fName).GetName(),
-      selectionOnly ?
+   ExportPCMJob *job = new ExportPCMJob(this, mixer, t0, t1, info.channels,
+                                        f.Detach(), sf, sf_format, format,
+                                        fName, formatStr, metadata);
+   job->SetMessage(selectionOnly ?
       wxString::Format(_("Exporting the selected audio as %s"),
                        formatStr.c_str()) :
       wxString::Format(_("Exporting the entire project as %s"),
                        formatStr.c_str()));
 
-   while(updateResult == eProgressSuccess) {
-      sampleCount samplesWritten;
-      sampleCount numSamples = mixer->Process(maxBlockLen);
+   return job;
+}
 
-      if (numSamples == 0)
-         break;
+bool ExportPCMJob::Encode(samplePtr *buffers, sampleCount numSamples)
+{
+   sampleCount samplesWritten;
 
-      samplePtr mixed = mixer->GetBuffer();
+   if (numSamples == 0)
+      return true;
 
-      ODManager::LockLibSndFileMutex();
-      if (format == int16Sample)
-         samplesWritten = sf_writef_short(sf, (short *)mixed, numSamples);
-      else
-         samplesWritten = sf_writef_float(sf, (float *)mixed, numSamples);
-      ODManager::UnlockLibSndFileMutex();
+   samplePtr mixed = buffers[0];
 
-      if (samplesWritten != numSamples) {
-        char buffer2[1000];
-        sf_error_str(sf, buffer2, 1000);
-        wxMessageBox(wxString::Format(
-           /* i18n-hint: %s will be the error message from libsndfile, which
-            * is usually something unhelpful (and untranslated) like "system
-            * error" */
-           _("Error while writing %s file (disk full?).\nLibsndfile says \"%s\""),
-           formatStr.c_str(),
-           wxString::FromAscii(buffer2).c_str()));
-        break;
-      }
+   ODManager::LockLibSndFileMutex();
+   if (mFormat == int16Sample)
+      samplesWritten = sf_writef_short(mSF, (short *)mixed, numSamples);
+   else
+      samplesWritten = sf_writef_float(mSF, (float *)mixed, numSamples);
+   ODManager::UnlockLibSndFileMutex();
 
-      updateResult = progress->Update(mixer->MixGetCurrentTime()-t0, t1-t0);
+   if (samplesWritten != numSamples) {
+     char buffer2[1000];
+     sf_error_str(mSF, buffer2, 1000);
+     mError = wxString::Format(
+        /* i18n-hint: %s will be the error message from libsndfile, which
+         * is usually something unhelpful (and untranslated) like "system
+         * error" */
+        _("Error while writing %s file (disk full?).\nLibsndfile says \"%s\""),
+        mFormatStr.c_str(),
+        wxString::FromAscii(buffer2).c_str());
+     return false;
    }
 
-   delete progress;
-
-   delete mixer;
+   return true;
+}
 
-   delete[] waveTracks;
+int ExportPCMJob::Finish(int result)
+{
+   int err;
 
    // Install the WAV metata in a "LIST" chunk at the end of the file
-   if ((sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV ||
-       (sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAVEX) {
-      if (!AddStrings(project, sf, metadata, sf_format)) {
-         sf_close(sf);
-         return false;
-      }
+   if ((mSFFormat & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV ||
+       (mSFFormat & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAVEX) {
+      ODManager::LockLibSndFileMutex();
+      mPlugin->AddStrings(NULL, mSF, &mTags, mSFFormat);
+      ODManager::UnlockLibSndFileMutex();
    }
 
    ODManager::LockLibSndFileMutex();
-   err = sf_close(sf);
+   err = sf_close(mSF);
    ODManager::UnlockLibSndFileMutex();
 
    if (err) {
       char buffer[1000];
-      sf_error_str(sf, buffer, 1000);
-      wxMessageBox(wxString::Format
+      sf_error_str(mSF, buffer, 1000);
+      mError = wxString::Format
             /* i18n-hint: %s will be the error message from libsndfile */
                    (_("Error (file may not have been written): %s"),
-                    buffer));
+                    buffer);
    }
 
-   if (((sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_AIFF) ||
-       ((sf_format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV))
-      AddID3Chunk(fName, metadata, sf_format);
+   if (((mSFFormat & SF_FORMAT_TYPEMASK) == SF_FORMAT_AIFF) ||
+       ((mSFFormat & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV))
+      mPlugin->AddID3Chunk(mFName, &mTags, mSFFormat);
 
 #ifdef __WXMAC__
 #if !wxCHECK_VERSION(3, 0, 0)
-   wxFileName fn(fName);
-   fn.MacSetTypeAndCreator(sf_header_mactype(sf_format & SF_FORMAT_TYPEMASK),
+   wxFileName fn(mFName);
+   fn.MacSetTypeAndCreator(sf_header_mactype(mSFFormat & SF_FORMAT_TYPEMASK),
                            AUDACITY_CREATOR);
 #endif
 #endif
 
-   return updateResult;
+   if (!mError.IsEmpty() && result == eProgressSuccess)
+      return eProgressFailed;
+
+   return result;
 }
 
 char *ExportPCM::AdjustString(const wxString wxStr, int sf_format)
@@ -29,21 +29,35 @@
 #include <wx/string.h>
 #include <wx/utils.h>
 #include <wx/intl.h>
+#include <wx/file.h>
 #include <wx/ffile.h>
 #include <wx/sizer.h>
 #include <wx/checkbox.h>
 #include <wx/button.h>
 #include <wx/stattext.h>
 
+#include <vector>
+
 #include "sndfile.h"
 
 #include "../ondemand/ODManager.h"
 #include "../ondemand/ODComputeSummaryTask.h"
+#include "../blockfile/CompressedBlockFile.h"
+#include "../blockfile/PackedBlockFile.h"
+#include "../blockfile/SimpleBlockFile.h"
+#include "../DirManager.h"
+#include "../ThreadPool.h"
+#include "../WaveClip.h"
+#include "../Sequence.h"
 
 //If OD is enabled, he minimum number of samples a file has to use it.
 //Otherwise, we use the older PCMAliasBlockFile method since it should be fast enough.
 #define kMinimumODFileSampleSize 44100*30
 
+//When copying, the number of rows of blocks each ThreadPool thread may have
+//read but not yet added to the tracks.  This bounds the memory used.
+#define kRowsInFlightPerThread 2
+
 #ifndef SNDFILE_1
 #error Requires libsndfile 1.0 or higher
 #endif
@@ -102,6 +116,10 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)){}
 
 private:
+   /// Copies the file into the tracks on the ThreadPool, one row of blocks
+   /// per job.  Returns the progress result like Import().
+   int ImportParallel(WaveTrack **channels, sampleCount maxBlockSize);
+
    SNDFILE              *mFile;
    SF_INFO               mInfo;
    sampleFormat          mFormat;
@@ -306,6 +324,267 @@ How do you want to import the current file(s)?"), oldCopyPref == wxT("copy") ? _
    return oldCopyPref;
 }
 
+/// One maxBlockSize stretch of the file, which becomes one block file in
+/// each channel's track.
+struct PCMImportRow
+{
+   sampleCount start;
+   sampleCount len;
+   /// Full paths of the reserved block file names, one per channel.  They
+   /// are copied so that the job shares no strings with the main thread.
+   wxArrayString names;
+   std::vector<BlockFile *> blocks;
+   bool done;
+   bool success;
+   /// Set if the file ended before the row did; len is then what was
+   /// there, which may be nothing, and no later row has any data.
+   bool ended;
+};
+
+/// The rows of one PCMImportFileHandle::ImportParallel(), and the lock
+/// and condition its jobs use to report that a row is done.
+class PCMImportBatch
+{
+ public:
+   /// The blocks go into store if it is not NULL, else into .auc files
+   /// if compress is set, else into .au files
+   PCMImportBatch(const wxString &fileName, int channels,
+                  sampleFormat format, PackedBlockStore *store,
+                  bool compress)
+   {
+      // wxString copies share their buffer, so make one the jobs alone use
+      mFileName = wxString(fileName.c_str());
+      mChannels = channels;
+      mFormat = format;
+      mStore = store;
+      mCompress = compress;
+      mDoneCondition = new ODCondition(&mLock);
+   }
+
+   ~PCMImportBatch()
+   {
+      delete mDoneCondition;
+   }
+
+   /// Reads the row through its own libsndfile handle, de-interleaves it
+   /// and writes its block files, summaries included.
+   void Work(PCMImportRow *row)
+   {
+      bool success = Read(row);
+
+      mLock.Lock();
+      row->success = success;
+      row->done = true;
+      mDoneCondition->Broadcast();
+      mLock.Unlock();
+   }
+
+   void WaitUntilDone(PCMImportRow *row)
+   {
+      mLock.Lock();
+      while (!row->done)
+         mDoneCondition->Wait();
+      mLock.Unlock();
+   }
+
+ private:
+   bool Read(PCMImportRow *row)
+   {
+      SF_INFO info;
+      SNDFILE *file = NULL;
+
+      memset(&info, 0, sizeof(info));
+
+      // libsndfile keeps no state between handles once they are open, but
+      // opening one sets its global error state, so that is done under the
+      // lock the ODTasks use.  As in PCMImportPlugin::Open(), open by file
+      // descriptor so that Unicode names work on Windows.
+      ODManager::LockLibSndFileMutex();
+      wxFile f;
+      if (f.Open(mFileName))
+         file = sf_open_fd(f.fd(), SFM_READ, &info, TRUE);
+      f.Detach();
+      ODManager::UnlockLibSndFileMutex();
+
+      if (!file)
+         return false;
+
+      // 24 bit files are read as float like in Import(), and converted
+      // without dither below, which gives back the same samples.
+      sampleFormat readFormat =
+         (mFormat == int16Sample) ? int16Sample : floatSample;
+      samplePtr srcbuffer = NewSamples(row->len * mChannels, readFormat);
+      samplePtr buffer = NewSamples(row->len, mFormat);
+
+      // The frame count in the header can be wrong.  As in the serial
+      // loop in Import(), a seek or read that comes up short is the end
+      // of the data, not a failure: keep what is there and stop.
+      sf_count_t read = 0;
+      if (sf_seek(file, row->start, SEEK_SET) == row->start) {
+         if (readFormat == int16Sample)
+            read = sf_readf_short(file, (short *)srcbuffer, row->len);
+         else
+            read = sf_readf_float(file, (float *)srcbuffer, row->len);
+      }
+
+      row->ended = (read < row->len);
+      if (read < 0)
+         read = 0;
+      row->len = read;
+      if (read > 0) {
+         for (int c = 0; c < mChannels; c++) {
+            CopySamplesNoDither(srcbuffer + c * SAMPLE_SIZE(readFormat),
+                                readFormat, buffer, mFormat, row->len,
+                                mChannels);
+            if (mStore)
+               row->blocks[c] = new PackedBlockFile(mStore,
+                                                    wxFileName(row->names[c]),
+                                                    buffer, row->len, mFormat);
+            else if (mCompress)
+               row->blocks[c] = new CompressedBlockFile(wxFileName(row->names[c]),
+                                                        buffer, row->len, mFormat);
+            else
+               row->blocks[c] = new SimpleBlockFile(wxFileName(row->names[c]),
+                                                    buffer, row->len, mFormat);
+         }
+      }
+
+      DeleteSamples(buffer);
+      DeleteSamples(srcbuffer);
+
+      ODManager::LockLibSndFileMutex();
+      sf_close(file);
+      ODManager::UnlockLibSndFileMutex();
+
+      return true;
+   }
+
+   wxString mFileName;
+   int mChannels;
+   sampleFormat mFormat;
+   PackedBlockStore *mStore;
+   bool mCompress;
+   ODLock mLock;
+   ODCondition *mDoneCondition;
+};
+
+class PCMImportJob : public ThreadPoolJob
+{
+ public:
+   PCMImportJob(PCMImportBatch *batch, PCMImportRow *row)
+   {
+      mBatch = batch;
+      mRow = row;
+   }
+
+   virtual void Run()
+   {
+      mBatch->Work(mRow);
+   }
+
+ private:
+   PCMImportBatch *mBatch;
+   PCMImportRow *mRow;
+};
+
+int PCMImportFileHandle::ImportParallel(WaveTrack **channels,
+                                        sampleCount maxBlockSize)
+{
+   ThreadPool *pool = ThreadPool::Get();
+   DirManager *dirManager = channels[0]->GetDirManager();
+   sampleCount fileTotalFrames = (sampleCount)mInfo.frames;
+   int numRows = (int)((fileTotalFrames + maxBlockSize - 1) / maxBlockSize);
+   int maxInFlight = pool->GetNumThreads() * kRowsInFlightPerThread;
+   int updateResult = eProgressSuccess;
+   int c;
+
+   PCMImportBatch batch(mFilename, mInfo.channels, mFormat,
+                        dirManager->GetPackBlocks() ?
+                           dirManager->GetPackedStore() : NULL,
+                        dirManager->GetCompressBlocks());
+   std::vector<PCMImportRow> rows(numRows);
+
+   // Rows are started in order, as far ahead of the oldest unfinished row
+   // as maxInFlight allows, and added to the tracks in order as they finish.
+   int started = 0;
+   int added = 0;
+   while (added < numRows) {
+      while (started < numRows && started - added < maxInFlight) {
+         PCMImportRow &row = rows[started];
+         row.start = (sampleCount)started * maxBlockSize;
+         row.len = maxBlockSize;
+         if (row.start + row.len > fileTotalFrames)
+            row.len = fileTotalFrames - row.start;
+         row.blocks.resize(mInfo.channels, NULL);
+         row.done = false;
+         row.success = false;
+         row.ended = false;
+         for (c = 0; c < mInfo.channels; c++) {
+            wxFileName name = dirManager->ReserveBlockFileName();
+            row.names.Add(wxString(name.GetFullPath().c_str()));
+         }
+         pool->Add(new PCMImportJob(&batch, &row));
+         started++;
+      }
+
+      PCMImportRow &row = rows[added];
+      batch.WaitUntilDone(&row);
+      if (!row.success) {
+         updateResult = eProgressFailed;
+         break;
+      }
+
+      // The tracks are new, so the blocks go straight on the end of their
+      // sequences without being merged with a short last block.
+      if (row.len > 0) {
+         for (c = 0; c < mInfo.channels; c++) {
+            dirManager->AddBlockFile(row.blocks[c]);
+            channels[c]->RightmostOrNewClip()->GetSequence()->
+               AppendBlockFile(row.blocks[c]);
+            row.blocks[c] = NULL;
+         }
+      }
+      added++;
+
+      if (row.ended) {
+         // The file is shorter than its header says; what was read is
+         // the whole of it, as when the serial loop reaches the end
+         updateResult = mProgress->Update((long long unsigned)fileTotalFrames,
+                                          (long long unsigned)fileTotalFrames);
+         break;
+      }
+
+      updateResult = mProgress->Update((long long unsigned)(row.start + row.len),
+                                       (long long unsigned)fileTotalFrames);
+      if (updateResult != eProgressSuccess)
+         break;
+   }
+
+   // The jobs still running use the rows, and the blocks they made belong
+   // to no track, so wait for them and remove the blocks.  Past the end
+   // of a short file they made none, and their names are given back.
+   for (int i = added; i < started; i++) {
+      PCMImportRow &row = rows[i];
+      batch.WaitUntilDone(&row);
+      for (c = 0; c < mInfo.channels; c++) {
+         if (row.blocks[c]) {
+            dirManager->AddBlockFile(row.blocks[c]);
+            dirManager->Deref(row.blocks[c]);
+         }
+         else
+            dirManager->ReleaseBlockFileName(wxFileName(row.names[c]));
+      }
+   }
+
+   for (c = 0; c < mInfo.channels; c++) {
+      WaveClip *clip = channels[c]->RightmostOrNewClip();
+      clip->UpdateEnvelopeTrackLen();
+      clip->MarkChanged();
+   }
+
+   return updateResult;
+}
+
 int PCMImportFileHandle::Import(TrackFactory *trackFactory,
                                 Track ***outTracks,
                                 int *outNumTracks,
@@ -407,6 +686,13 @@ int PCMImportFileHandle::Import(TrackFactory *trackFactory,
             ODManager::Instance()->AddNewTask(computeTask);
       }
    }
+   else if (mInfo.seekable && fileTotalFrames > maxBlockSize &&
+            ThreadPool::Get() && ThreadPool::Get()->GetNumThreads() > 1) {
+      // Copy mode, where the file is long enough to share out: read
+      // it a block at a time on the ThreadPool, and make each channel's
+      // block files, summaries and all, on the same thread.
+      updateResult = ImportParallel(channels, maxBlockSize);
+   }
    else {
       // Otherwise, we're in the "copy" mode, where we read in the actual
       // samples from the file and store our own local copy of the
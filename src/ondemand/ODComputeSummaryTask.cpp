@@ -30,9 +30,16 @@ ODComputeSummaryTask::ODComputeSummaryTask()
 {
    mMaxBlockFiles = 0;
    mComputedBlockFiles = 0;
+   mBlockFilesInFlight = 0;
+   mBlockFileDone = new ODCondition(&mBlockFilesMutex);
    mHasUpdateRan=false;
 }
 
+ODComputeSummaryTask::~ODComputeSummaryTask()
+{
+   delete mBlockFileDone;
+}
+
 ODTask* ODComputeSummaryTask::Clone()
 {
    ODComputeSummaryTask* clone = new ODComputeSummaryTask;
@@ -56,53 +63,69 @@ void ODComputeSummaryTask::Terminate()
 ///Computes and writes the data for one BlockFile if it still has a refcount.
 void ODComputeSummaryTask::DoSomeInternal()
 {
-   if(mBlockFiles.size()<=0)
-   {
-      mPercentCompleteMutex.Lock();
-      mPercentComplete = 1.0;
-      mPercentCompleteMutex.Unlock();
-      return;
-   }
-
    ODPCMAliasBlockFile* bf;
    sampleCount blockStartSample = 0;
    sampleCount blockEndSample = 0;
    bool success =false;
 
    mBlockFilesMutex.Lock();
+   if(mBlockFiles.size()<=0)
+   {
+      //Other workers may still be computing the last blocks.  The task is not complete until they are,
+      //and the last of them to finish reports it, so wait for them rather than spin through DoSome().
+      while(mBlockFiles.size()<=0 && mBlockFilesInFlight>0)
+         mBlockFileDone->Wait();
+      bool complete = mBlockFiles.size()<=0;
+      mBlockFilesMutex.Unlock();
+
+      if(complete)
+      {
+         mPercentCompleteMutex.Lock();
+         mPercentComplete = 1.0;
+         mPercentCompleteMutex.Unlock();
+      }
+      return;
+   }
+
    for(size_t i=0; i < mWaveTracks.size() && mBlockFiles.size();i++)
    {
+      //take it out of the array, so that other workers in this task take the next ones.
       bf = mBlockFiles[0];
+      mBlockFiles.erase(mBlockFiles.begin());
+      mBlockFilesInFlight++;
+
+      //This is a bit of a convenience in case someone tries to terminate the task by closing the trackpanel or window.
+      //ODComputeSummaryTask::Terminate() uses this lock to remove everything, and we don't want it to wait since the UI is being blocked.
+      //It also lets the other workers take blocks while we compute this one.
+      mBlockFilesMutex.Unlock();
 
       //first check to see if the ref count is at least 2.  It should have one
       //from when we added it to this instance's mBlockFiles array, and one from
       //the Wavetrack/sequence.  If it doesn't it has been deleted and we should forget it.
-      if(bf->RefCount()>=2)
+      success = bf->RefCount()>=2;
+      if(success)
       {
          bf->DoWriteSummary();
-         success = true;
          blockStartSample = bf->GetStart();
          blockEndSample = blockStartSample + bf->GetLength();
-         mComputedBlockFiles++;
-      }
-      else
-      {
-         //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
-         //because now there is less work to do.
-         mMaxBlockFiles--;
       }
 
       //Release the refcount we placed on it.
       bf->Deref();
-      //take it out of the array - we are done with it.
-      mBlockFiles.erase(mBlockFiles.begin());
 
-      //This is a bit of a convenience in case someone tries to terminate the task by closing the trackpanel or window.
-      //ODComputeSummaryTask::Terminate() uses this lock to remove everything, and we don't want it to wait since the UI is being blocked.
-      mBlockFilesMutex.Unlock();
       wxThread::This()->Yield();
       mBlockFilesMutex.Lock();
 
+      mBlockFilesInFlight--;
+      mBlockFileDone->Broadcast();
+
+      if(success)
+         mComputedBlockFiles++;
+      else
+         //the waveform in the wavetrack now is shorter, so we need to update mMaxBlockFiles
+         //because now there is less work to do.
+         mMaxBlockFiles--;
+
       //upddate the gui for all associated blocks.  It doesn't matter that we're hitting more wavetracks then we should
       //because this loop runs a number of times equal to the number of tracks, they probably are getting processed in
       //the next iteration at the same sample window.
@@ -156,9 +179,16 @@ void ODComputeSummaryTask::CalculatePercentComplete()
 {
    bool hasUpdateRan;
    hasUpdateRan = HasUpdateRan();
+
+   //blocks other workers are still computing count as left to do, so that only
+   //the worker that finishes the last one sees the task complete.
+   mBlockFilesMutex.Lock();
+   int left = mBlockFiles.size() + mBlockFilesInFlight;
+   mBlockFilesMutex.Unlock();
+
    mPercentCompleteMutex.Lock();
    if(hasUpdateRan)
-      mPercentComplete = (float) 1.0 - ((float)mBlockFiles.size() / (mMaxBlockFiles+1));
+      mPercentComplete = (float) 1.0 - ((float)left / (mMaxBlockFiles+1));
    else
       mPercentComplete =0.0;
    mPercentCompleteMutex.Unlock();
@@ -177,7 +207,7 @@ void ODComputeSummaryTask::Update()
       if(mWaveTracks[j])
       {
          WaveClip *clip;
-         BlockArray *blocks;
+         const BlockArray *blocks;
          Sequence *seq;
 
          //gather all the blockfiles that we should process in the wavetrack.
@@ -203,19 +233,19 @@ void ODComputeSummaryTask::Update()
             for(i=0; i<(int)blocks->GetCount(); i++)
             {
                //if there is data but no summary, this blockfile needs summarizing.
-               if(blocks->Item(i)->f->IsDataAvailable() && !blocks->Item(i)->f->IsSummaryAvailable())
+               if(blocks->Item(i).f->IsDataAvailable() && !blocks->Item(i).f->IsSummaryAvailable())
                {
-                  blocks->Item(i)->f->Ref();
-                  ((ODPCMAliasBlockFile*)blocks->Item(i)->f)->SetStart(blocks->Item(i)->start);
-                  ((ODPCMAliasBlockFile*)blocks->Item(i)->f)->SetClipOffset((sampleCount)(clip->GetStartTime()*clip->GetRate()));
+                  blocks->Item(i).f->Ref();
+                  ((ODPCMAliasBlockFile*)blocks->Item(i).f)->SetStart(blocks->Item(i).start);
+                  ((ODPCMAliasBlockFile*)blocks->Item(i).f)->SetClipOffset((sampleCount)(clip->GetStartTime()*clip->GetRate()));
 
                   //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
                   while(insertCursor<(int)tempBlocks.size()&&
                      (sampleCount)(tempBlocks[insertCursor]->GetStart()+tempBlocks[insertCursor]->GetClipOffset()) <
-                        (sampleCount)(((ODPCMAliasBlockFile*)blocks->Item(i)->f)->GetStart()+((ODPCMAliasBlockFile*)blocks->Item(i)->f)->GetClipOffset()))
+                        (sampleCount)(((ODPCMAliasBlockFile*)blocks->Item(i).f)->GetStart()+((ODPCMAliasBlockFile*)blocks->Item(i).f)->GetClipOffset()))
                      insertCursor++;
 
-                  tempBlocks.insert(tempBlocks.begin()+insertCursor++,(ODPCMAliasBlockFile*)blocks->Item(i)->f);
+                  tempBlocks.insert(tempBlocks.begin()+insertCursor++,(ODPCMAliasBlockFile*)blocks->Item(i).f);
                }
             }
             seq->UnlockDeleteUpdateMutex();
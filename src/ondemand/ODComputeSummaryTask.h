@@ -34,7 +34,7 @@ class ODComputeSummaryTask:public ODTask
 
    /// Constructs an ODTask
    ODComputeSummaryTask();
-   virtual ~ODComputeSummaryTask(){};
+   virtual ~ODComputeSummaryTask();
 
    virtual ODTask* Clone();
 
@@ -46,6 +46,9 @@ class ODComputeSummaryTask:public ODTask
 
    virtual const wxChar* GetTip(){return _("Import complete. Calculating waveform");}
 
+   ///Each block's summary is independent, so several workers can share the task.
+   virtual bool CanRunConcurrently(){return true;}
+
    virtual bool UsesCustomWorkUntilPercentage(){return true;}
    virtual float ComputeNextWorkUntilPercentageComplete();
 
@@ -57,6 +60,7 @@ protected:
    virtual void CalculatePercentComplete();
 
    ///Computes and writes the data for one BlockFile if it still has a refcount.
+   ///Safe to call from several workers at once.
    virtual void DoSomeInternal();
 
    ///Readjusts the blockfile order in the default manner.  If we have had an ODRequest
@@ -75,6 +79,10 @@ protected:
    std::vector<ODPCMAliasBlockFile*> mBlockFiles;
    int mMaxBlockFiles;
    int mComputedBlockFiles;
+   //blocks taken out of mBlockFiles by a worker and not yet written; under mBlockFilesMutex.
+   int mBlockFilesInFlight;
+   //signalled under mBlockFilesMutex each time a worker finishes a block.
+   ODCondition *mBlockFileDone;
    ODLock  mHasUpdateRanMutex;
    bool mHasUpdateRan;
 };
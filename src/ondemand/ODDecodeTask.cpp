@@ -134,7 +134,7 @@ void ODDecodeTask::Update()
       if(mWaveTracks[j])
       {
          WaveClip *clip;
-         BlockArray *blocks;
+         const BlockArray *blocks;
          Sequence *seq;
 
          //gather all the blockfiles that we should process in the wavetrack.
@@ -155,19 +155,19 @@ void ODDecodeTask::Update()
             for(i=0; i<(int)blocks->GetCount(); i++)
             {
                //since we have more than one ODBlockFile, we will need type flags to cast.
-               if(!blocks->Item(i)->f->IsDataAvailable() && ((ODDecodeBlockFile*)blocks->Item(i)->f)->GetDecodeType()==this->GetODType())
+               if(!blocks->Item(i).f->IsDataAvailable() && ((ODDecodeBlockFile*)blocks->Item(i).f)->GetDecodeType()==this->GetODType())
                {
-                  blocks->Item(i)->f->Ref();
-                  ((ODDecodeBlockFile*)blocks->Item(i)->f)->SetStart(blocks->Item(i)->start);
-                  ((ODDecodeBlockFile*)blocks->Item(i)->f)->SetClipOffset((sampleCount)(clip->GetStartTime()*clip->GetRate()));
+                  blocks->Item(i).f->Ref();
+                  ((ODDecodeBlockFile*)blocks->Item(i).f)->SetStart(blocks->Item(i).start);
+                  ((ODDecodeBlockFile*)blocks->Item(i).f)->SetClipOffset((sampleCount)(clip->GetStartTime()*clip->GetRate()));
 
                   //these will always be linear within a sequence-lets take advantage of this by keeping a cursor.
                   while(insertCursor<(int)tempBlocks.size()&&
                      (sampleCount)(tempBlocks[insertCursor]->GetStart()+tempBlocks[insertCursor]->GetClipOffset()) <
-                        (sampleCount)(((ODDecodeBlockFile*)blocks->Item(i)->f)->GetStart()+((ODDecodeBlockFile*)blocks->Item(i)->f)->GetClipOffset()))
+                        (sampleCount)(((ODDecodeBlockFile*)blocks->Item(i).f)->GetStart()+((ODDecodeBlockFile*)blocks->Item(i).f)->GetClipOffset()))
                      insertCursor++;
 
-                  tempBlocks.insert(tempBlocks.begin()+insertCursor++,(ODDecodeBlockFile*)blocks->Item(i)->f);
+                  tempBlocks.insert(tempBlocks.begin()+insertCursor++,(ODDecodeBlockFile*)blocks->Item(i).f);
                }
             }
 
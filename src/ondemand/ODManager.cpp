@@ -70,6 +70,7 @@ ODManager::ODManager()
 
    //must set up the queue condition
    mQueueNotEmptyCond = new ODCondition(&mQueueNotEmptyCondLock);
+   mTasksCond = new ODCondition(&mTasksMutex);
 }
 
 //private destructor - delete with static method Quit()
@@ -81,6 +82,7 @@ ODManager::~ODManager()
       delete mQueues[i];
 
    delete mQueueNotEmptyCond;
+   delete mTasksCond;
 }
 
 ///Adds a task to running queue.  Thread-safe.
@@ -88,6 +90,8 @@ void ODManager::AddTask(ODTask* task)
 {
    mTasksMutex.Lock();
    mTasks.push_back(task);
+   //wake the workers waiting for something to do.
+   mTasksCond->Broadcast();
    mTasksMutex.Unlock();
    //signal the queue not empty condition.
    bool paused;
@@ -121,6 +125,12 @@ void ODManager::SignalTaskQueueLoop()
 void ODManager::RemoveTaskIfInQueue(ODTask* task)
 {
    mTasksMutex.Lock();
+   RemoveTaskIfInQueueLocked(task);
+   mTasksMutex.Unlock();
+}
+
+void ODManager::RemoveTaskIfInQueueLocked(ODTask* task)
+{
    //linear search okay for now, (probably only 1-5 tasks exist at a time.)
    for(unsigned int i=0;i<mTasks.size();i++)
    {
@@ -130,8 +140,6 @@ void ODManager::RemoveTaskIfInQueue(ODTask* task)
          break;
       }
    }
-   mTasksMutex.Unlock();
-
 }
 
 ///Adds a new task to the queue.  Creates a queue if the tracks associated with the task is not in the list
@@ -206,11 +214,25 @@ bool ODManager::IsInstanceCreated()
    return ret;
 }
 
-///Launches a thread for the manager and starts accepting Tasks.
+///Launches a thread for the manager and the worker threads, and starts accepting Tasks.
 void ODManager::Init()
 {
    mCurrentThreads = 0;
-   mMaxThreads = 5;
+   mMaxThreads = wxThread::GetCPUCount();
+   if(mMaxThreads < 1)
+      mMaxThreads = 1;
+
+   //the workers live as long as the manager, and wait in TakeTask() while there is nothing to do.
+   for(int i=0;i<mMaxThreads;i++)
+   {
+      ODTaskThread* thread = new ODTaskThread();
+      //thread->SetPriority(10);//default is 50.
+      thread->Create();
+      mCurrentThreadsMutex.Lock();
+      mCurrentThreads++;
+      mCurrentThreadsMutex.Unlock();
+      thread->Run();
+   }
 
    //   wxLogDebug(wxT("Initializing ODManager...Creating manager thread"));
    ODManagerHelperThread* startThread = new ODManagerHelperThread;
@@ -231,12 +253,78 @@ void ODManager::DecrementCurrentThreads()
    mCurrentThreadsMutex.Unlock();
 }
 
-///Main loop for managing threads and tasks.
-void ODManager::Start()
+ODTask* ODManager::FindTaskToTake()
+{
+   ODTask* best = NULL;
+   int bestPriority = 0;
+   int bestWorkers = 0;
+
+   for(unsigned int i=0;i<mTasks.size();i++)
+   {
+      ODTask* task = mTasks[i];
+      //a shared task stays in the list until its last worker leaves, but there is nothing left to take.
+      if(task->PercentComplete() >= 1.0 || task->IsTerminated())
+         continue;
+
+      int priority = task->GetPriority();
+      int workers = task->GetNumWorkers();
+      //the most urgent task first, and of equally urgent ones, the one fewest workers are on, so
+      //that every task gets a worker before any gets two.  The list order breaks ties, oldest first.
+      if(!best || priority > bestPriority || (priority == bestPriority && workers < bestWorkers))
+      {
+         best = task;
+         bestPriority = priority;
+         bestWorkers = workers;
+      }
+   }
+   return best;
+}
+
+ODTask* ODManager::TakeTask()
 {
-   ODTaskThread* thread;
-   bool tasksInArray;
+   ODTask* task = NULL;
+   bool terminate;
    bool paused;
+
+   mTasksMutex.Lock();
+   for(;;)
+   {
+      mTerminateMutex.Lock();
+      terminate = mTerminate;
+      mTerminateMutex.Unlock();
+      if(terminate)
+         break;
+
+      mPauseLock.Lock();
+      paused = mPause;
+      mPauseLock.Unlock();
+
+      task = paused ? NULL : FindTaskToTake();
+      if(task)
+      {
+         //tasks that only one worker can run come out of the list until DoSome() puts them back.
+         if(!task->CanRunConcurrently())
+            RemoveTaskIfInQueueLocked(task);
+
+         //fails if the task's queue is terminating it, which is the same as it not being there.
+         if(task->AddWorker())
+            break;
+         RemoveTaskIfInQueueLocked(task);
+         task = NULL;
+         continue;
+      }
+
+      //AddTask(), Pause() and Quit() wake us up.
+      mTasksCond->Wait();
+   }
+   mTasksMutex.Unlock();
+
+   return task;
+}
+
+///Main loop for retiring finished tasks and redrawing.  The worker threads take the tasks themselves.
+void ODManager::Start()
+{
    int  numQueues=0;
 
    mNeedsDraw=0;
@@ -254,45 +342,10 @@ void ODManager::Start()
       //we should look at our WaveTrack queues to see if we can process a new task to the running queue.
       UpdateQueues();
 
-      //start some threads if necessary
-
-      mTasksMutex.Lock();
-      tasksInArray = mTasks.size()>0;
-      mTasksMutex.Unlock();
-
-      mPauseLock.Lock();
-      paused=mPause;
-      mPauseLock.Unlock();
-
-      mCurrentThreadsMutex.Lock();
-      // keep adding tasks if there is work to do, up to the limit.
-      while(!paused && tasksInArray && (mCurrentThreads < mMaxThreads))
-      {
-         mCurrentThreads++;
-         mCurrentThreadsMutex.Unlock();
-
-         mTasksMutex.Lock();
-         //detach a new thread.
-         thread = new ODTaskThread(mTasks[0]);//task);
-         //thread->SetPriority(10);//default is 50.
-         thread->Create();
-         thread->Run();
-
-         mTasks.erase(mTasks.begin());
-         tasksInArray = mTasks.size()>0;
-         mTasksMutex.Unlock();
-
-         mCurrentThreadsMutex.Lock();
-      }
-
-      mCurrentThreadsMutex.Unlock();
       //use a conditon variable to block here instead of a sleep.
-
-      // JKC: If there are no tasks ready to run, or we're paused then
-      // we wait for there to be tasks in the queue.
+      //the workers signal it each time they have done some of a task, and AddTask() when there is a new one.
       mQueueNotEmptyCondLock.Lock();
-      if( (!tasksInArray) || paused)
-         mQueueNotEmptyCond->Wait();
+      mQueueNotEmptyCond->Wait();
       mQueueNotEmptyCondLock.Unlock();
 
       //if there is some ODTask running, then there will be something in the queue.  If so then redraw to show progress
@@ -337,6 +390,11 @@ void ODManager::Pause(bool pause)
       pMan->mPause = pause;
       pMan->mPauseLock.Unlock();
 
+      //the workers should check too.
+      pMan->mTasksMutex.Lock();
+      pMan->mTasksCond->Broadcast();
+      pMan->mTasksMutex.Unlock();
+
       //we should check the queue again.
       pMan->mQueueNotEmptyCondLock.Lock();
       pMan->mQueueNotEmptyCond->Signal();
@@ -361,6 +419,11 @@ void ODManager::Quit()
       pMan->mTerminate = true;
       pMan->mTerminateMutex.Unlock();
 
+      //wake the workers so they see it.
+      pMan->mTasksMutex.Lock();
+      pMan->mTasksCond->Broadcast();
+      pMan->mTasksMutex.Unlock();
+
       //This while loop waits for ODTasks to finish and the delete removes all tasks from the Queue.
       //This function is called from the main audacity event thread, so there should not be more requests for pMan
       pMan->mTerminatedMutex.Lock();
@@ -377,6 +440,22 @@ void ODManager::Quit()
          pMan->mTerminatedMutex.Lock();
       }
       pMan->mTerminatedMutex.Unlock();
+
+      //the workers finish what they are doing and leave, which must happen before the tasks are deleted.
+      pMan->mCurrentThreadsMutex.Lock();
+      while(pMan->mCurrentThreads > 0)
+      {
+         pMan->mCurrentThreadsMutex.Unlock();
+         wxThread::Sleep(50);
+
+         pMan->mTasksMutex.Lock();
+         pMan->mTasksCond->Broadcast();
+         pMan->mTasksMutex.Unlock();
+
+         pMan->mCurrentThreadsMutex.Lock();
+      }
+      pMan->mCurrentThreadsMutex.Unlock();
+
       delete pMan;
    }
 }
@@ -485,6 +564,33 @@ void ODManager::DemandTrackUpdate(WaveTrack* track, double seconds)
    mQueuesMutex.Unlock();
 }
 
+///sets the priority of the tasks associated with this Waveform, and moves them to t0 unless they are already working between t0 and t1.
+///@param track the track to update
+///@param priority one of ODTask::ODPriorityEnum
+///@param t0,t1 the time range the user needs first.  If t1<=t0 the tasks carry on from where they are.
+void ODManager::SetTrackPriority(WaveTrack* track, int priority, double t0, double t1)
+{
+   mQueuesMutex.Lock();
+   for(unsigned int i=0;i<mQueues.size();i++)
+   {
+      if(mQueues[i]->ContainsWaveTrack(track))
+         mQueues[i]->SetTrackPriority(track,priority,t0,t1);
+   }
+   mQueuesMutex.Unlock();
+}
+
+///puts the tasks associated with this Waveform ahead of all others until the matching call with false.
+void ODManager::SetTrackExporting(WaveTrack* track, bool exporting)
+{
+   mQueuesMutex.Lock();
+   for(unsigned int i=0;i<mQueues.size();i++)
+   {
+      if(mQueues[i]->ContainsWaveTrack(track))
+         mQueues[i]->SetTrackExporting(exporting);
+   }
+   mQueuesMutex.Unlock();
+}
+
 ///remove tasks from ODWaveTrackTaskQueues that have been done.  Schedules new ones if they exist
 ///Also remove queues that have become empty.
 void ODManager::UpdateQueues()
@@ -14,6 +14,12 @@
 \brief A singleton that manages currently running Tasks on an arbitrary
 number of threads.
 
+There is one worker thread per core.  Whenever a worker is free it takes
+the most urgent task (see ODTask::GetPriority()), preferring one that no
+other worker is on.  When there are fewer tasks than workers, the free
+workers join tasks that can be shared and take blocks from the same list,
+so that one long file keeps all the cores busy too.
+
 *//*******************************************************************/
 
 #ifndef __AUDACITY_ODMANAGER__
@@ -58,6 +64,17 @@ class ODManager
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///Sets the priority of the tasks for a track from how the user is using it (see ODTask::ODPriorityEnum),
+   ///and moves them to t0 unless they are already working between t0 and t1.
+   void SetTrackPriority(WaveTrack* track, int priority, double t0, double t1);
+
+   ///Puts the tasks for a track ahead of all others while it is exported.  Each call with true must be matched by one with false.
+   void SetTrackExporting(WaveTrack* track, bool exporting);
+
+   ///Waits for a task a worker can do some of, and counts the worker in it.  Returns NULL when the manager quits.
+   ///Meant to be called from ODTaskThreads.  Thread-safe.
+   ODTask* TakeTask();
+
    ///Reduces the count of current threads running.  Meant to be called when ODTaskThreads end in their own threads.  Thread-safe.
    void DecrementCurrentThreads();
 
@@ -129,6 +146,12 @@ class ODManager
    ///Remove references in our array to Tasks that have been completed/Schedule new ones
    void UpdateQueues();
 
+   ///Finds the most urgent task in mTasks that a worker can take.  mTasksMutex must be locked.
+   ODTask* FindTaskToTake();
+
+   ///RemoveTaskIfInQueue() for when mTasksMutex is already locked.
+   void RemoveTaskIfInQueueLocked(ODTask* task);
+
    //instance
    static ODManager* pMan;
 
@@ -136,10 +159,12 @@ class ODManager
    std::vector<ODWaveTrackTaskQueue*> mQueues;
    ODLock mQueuesMutex;
 
-   //List of current Task to do.
+   //List of current Task to do.  Tasks that can be shared stay in it while workers are on them.
    std::vector<ODTask*> mTasks;
    //mutex for above variable
    ODLock mTasksMutex;
+   //the workers wait on this for tasks, the end of a pause, or termination.
+   ODCondition* mTasksCond;
 
    //global pause switch for OD
    volatile bool mPause;
@@ -152,7 +177,7 @@ class ODManager
    //mutex for above variable
    ODLock mCurrentThreadsMutex;
 
-   ///Maximum number of threads allowed out.
+   ///Number of worker threads, one per core.
    int mMaxThreads;
 
    volatile bool mTerminate;
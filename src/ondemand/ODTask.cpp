@@ -21,9 +21,8 @@ in a background thread.
 #include "ODTask.h"
 #include "ODManager.h"
 #include "../WaveTrack.h"
+#include "../Profiler.h"
 #include "../Project.h"
-//temporarilly commented out till it is added to all projects
-//#include "../Profiler.h"
 
 
 DEFINE_EVENT_TYPE(EVT_ODTASK_COMPLETE)
@@ -37,39 +36,90 @@ ODTask::ODTask()
    mDoingTask=false;
    mTerminate = false;
    mNeedsODUpdate=false;
-   mIsRunning = false;
+   mCompletePosted=false;
+
+   mWorkers = 0;
+   mWorkersDone = new ODCondition(&mWorkersMutex);
+
+   mPriority = ePriorityBackground;
+   mExportCount = 0;
 
    mTaskNumber=sTaskNumber++;
 
    mDemandSample=0;
 }
 
+ODTask::~ODTask()
+{
+   delete mWorkersDone;
+}
+
 //outside code must ensure this task is not scheduled again.
 void ODTask::TerminateAndBlock()
 {
    //one mutex pair for the value of mTerminate
    mTerminateMutex.Lock();
    mTerminate=true;
-   //release all data the derived class may have allocated
    mTerminateMutex.Unlock();
 
-   //and one mutex pair for the exit of the function
-   mBlockUntilTerminateMutex.Lock();
-//TODO lock mTerminate?
-   mBlockUntilTerminateMutex.Unlock();
+   //wait till all the workers are out of DoSome() to terminate.
+   mWorkersMutex.Lock();
+   while(mWorkers > 0)
+      mWorkersDone->Wait();
+   mWorkersMutex.Unlock();
 
-   //wait till we are out of doSome() to terminate.
+   //release all data the derived class may have allocated
    Terminate();
 }
 
+bool ODTask::IsTerminated()
+{
+   bool ret;
+   mTerminateMutex.Lock();
+   ret = mTerminate;
+   mTerminateMutex.Unlock();
+   return ret;
+}
+
+//the check and the count are made under one lock, so TerminateAndBlock() either sees this worker or stops it.
+bool ODTask::AddWorker()
+{
+   bool added = false;
+   mWorkersMutex.Lock();
+   if(!IsTerminated())
+   {
+      mWorkers++;
+      added = true;
+   }
+   mWorkersMutex.Unlock();
+   return added;
+}
+
+void ODTask::RemoveWorker()
+{
+   mWorkersMutex.Lock();
+   mWorkers--;
+   if(mWorkers == 0)
+      mWorkersDone->Broadcast();
+   mWorkersMutex.Unlock();
+}
+
+int ODTask::GetNumWorkers()
+{
+   int ret;
+   mWorkersMutex.Lock();
+   ret = mWorkers;
+   mWorkersMutex.Unlock();
+   return ret;
+}
+
 ///Do a modular part of the task.  For example, if the task is to load the entire file, load one BlockFile.
 ///Relies on DoSomeInternal(), which is the subclasses must implement.
 ///@param amountWork the percent amount of the total job to do.  1.0 represents the entire job.  the default of 0.0
 /// will do the smallest unit of work possible
 void ODTask::DoSome(float amountWork)
 {
-   SetIsRunning(true);
-   mBlockUntilTerminateMutex.Lock();
+   PROFILE_ZONE("ODTask::DoSome");
 
 //   printf("%s %i subtask starting on new thread with priority\n", GetTaskName(),GetTaskNumber());
 
@@ -80,17 +130,15 @@ void ODTask::DoSome(float amountWork)
 
 
    //check periodically to see if we should exit.
-   mTerminateMutex.Lock();
-   if(mTerminate)
+   if(IsTerminated())
    {
-      mTerminateMutex.Unlock();
-      SetIsRunning(false);
-      mBlockUntilTerminateMutex.Unlock();
+      RemoveWorker();
       return;
    }
-   mTerminateMutex.Unlock();
 
-   Update();
+   //other workers already in the task have an up to date order of blocks to share.
+   if(GetNumWorkers() == 1)
+      Update();
 
 
    if(UsesCustomWorkUntilPercentage())
@@ -101,30 +149,31 @@ void ODTask::DoSome(float amountWork)
 
    //Do Some of the task.
 
-   mTerminateMutex.Lock();
-   while(PercentComplete() < workUntil && PercentComplete() < 1.0 && !mTerminate)
+   //TerminateAndBlock() waits for us to leave DoSome(), so we only need to check the flag, not hold it,
+   //and other workers can run DoSomeInternal() at the same time.
+   while(PercentComplete() < workUntil && PercentComplete() < 1.0 && !IsTerminated())
    {
       wxThread::This()->Yield();
-      //release within the loop so we can cut the number of iterations short
 
-      DoSomeInternal(); //keep the terminate mutex on so we don't remo
-      mTerminateMutex.Unlock();
+      DoSomeInternal();
+
       //check to see if ondemand has been called
       if(GetNeedsODUpdate() && PercentComplete() < 1.0)
          ODUpdate();
-
-
-      //But add the mutex lock back before we check the value again.
-      mTerminateMutex.Lock();
    }
-   mTerminateMutex.Unlock();
    mDoingTask=false;
 
+   //the ODManager locks its task list before it locks tasks, so change the list after we unlock.
+   bool requeue = false;
+   bool dequeue = false;
+
    mTerminateMutex.Lock();
    //if it is not done, put it back onto the ODManager queue.
    if(PercentComplete() < 1.0&& !mTerminate)
    {
-      ODManager::Instance()->AddTask(this);
+      //tasks that can be shared stay in the queue while they run so other workers can join in.
+      requeue = !CanRunConcurrently();
+      mCompletePosted = false;
 
       //we did a bit of progress - we should allow a resave.
       AudacityProject::AllProjectsDeleteLock();
@@ -142,13 +191,12 @@ void ODTask::DoSome(float amountWork)
 
 //      printf("%s %i is %f done\n", GetTaskName(),GetTaskNumber(),PercentComplete());
    }
-   else
+   else if(!mCompletePosted)
    {
-      //for profiling, uncomment and look in audacity.app/exe's folder for AudacityProfile.txt
-      //static int tempLog =0;
-      //if(++tempLog % 5==0)
-         //END_TASK_PROFILING("On Demand Drag and Drop 5 80 mb files into audacity, 5 wavs per task");
-      //END_TASK_PROFILING("On Demand open an 80 mb wav stereo file");
+      mCompletePosted = true;
+
+      //nothing is left for other workers to join in with.
+      dequeue = CanRunConcurrently();
 
       wxCommandEvent event( EVT_ODTASK_COMPLETE );
       AudacityProject::AllProjectsDeleteLock();
@@ -169,8 +217,13 @@ void ODTask::DoSome(float amountWork)
 //      printf("%s %i complete\n", GetTaskName(),GetTaskNumber());
    }
    mTerminateMutex.Unlock();
-   SetIsRunning(false);
-   mBlockUntilTerminateMutex.Unlock();
+
+   if(requeue)
+      ODManager::Instance()->AddTask(this);
+   else if(dequeue)
+      ODManager::Instance()->RemoveTaskIfInQueue(this);
+
+   RemoveWorker();
 }
 
 bool ODTask::IsTaskAssociatedWithProject(AudacityProject* proj)
@@ -210,22 +263,38 @@ void ODTask::ODUpdate()
    ResetNeedsODUpdate();
 }
 
-void ODTask::SetIsRunning(bool value)
+bool ODTask::IsRunning()
 {
-   mIsRunningMutex.Lock();
-   mIsRunning=value;
-   mIsRunningMutex.Unlock();
+   return GetNumWorkers() > 0;
 }
 
-bool ODTask::IsRunning()
+void ODTask::SetPriority(int priority)
 {
-   bool ret;
-   mIsRunningMutex.Lock();
-   ret= mIsRunning;
-   mIsRunningMutex.Unlock();
+   mPriorityMutex.Lock();
+   mPriority = priority;
+   mPriorityMutex.Unlock();
+}
+
+int ODTask::GetPriority()
+{
+   int ret;
+   mPriorityMutex.Lock();
+   ret = mExportCount > 0 ? (int)ePriorityExport : mPriority;
+   mPriorityMutex.Unlock();
    return ret;
 }
 
+void ODTask::SetExporting(bool exporting)
+{
+   mPriorityMutex.Lock();
+   if(exporting)
+      mExportCount++;
+   //the task may have joined the queue after the export started.
+   else if(mExportCount > 0)
+      mExportCount--;
+   mPriorityMutex.Unlock();
+}
+
 sampleCount ODTask::GetDemandSample()
 {
    sampleCount retval;
@@ -46,12 +46,21 @@ class ODTask
       eODPCMSummary  = 0x00001000,
       eODOTHER    =  0x10000000,
    } ODTypeEnum;
+
+   ///How urgently the user needs the results; the ODManager's workers take the most urgent tasks first.
+   enum {
+      ePriorityBackground = 0,
+      ePriorityVisible,
+      ePriorityPlayback,
+      ePriorityExport
+   } ODPriorityEnum;
+
    // Constructor / Destructor
 
    /// Constructs an ODTask
    ODTask();
 
-   virtual ~ODTask(){};
+   virtual ~ODTask();
 
    //clones everything except information about the tracks.
    virtual ODTask* Clone()=0;
@@ -62,10 +71,21 @@ class ODTask
 
 ///Do a modular part of the task.  For example, if the task is to load the entire file, load one BlockFile.
 ///Relies on DoSomeInternal(), which is the subclasses must implement.
+///The calling thread must have been counted with AddWorker() first.
 ///@param amountWork the percent amount of the total job to do.  1.0 represents the entire job.  the default of 0.0
 /// will do the smallest unit of work possible
    void DoSome(float amountWork=0.0);
 
+   ///Counts a thread that is about to call DoSome().  Returns false if the task is being terminated,
+   ///in which case the thread must not call DoSome().
+   bool AddWorker();
+   ///Returns the number of threads in DoSome().
+   int GetNumWorkers();
+
+   ///Returns true if several threads can be in DoSome() at once, each taking different blocks.
+   ///Subclasses whose DoSomeInternal() is safe for that should override.
+   virtual bool CanRunConcurrently(){return false;}
+
    ///Call DoSome until PercentComplete >= 1.0
    void DoAll();
 
@@ -96,6 +116,7 @@ class ODTask
    bool IsComplete();
 
    void TerminateAndBlock();
+   bool IsTerminated();
    ///releases memory that the ODTask owns.  Subclasses should override.
    virtual void Terminate(){}
 
@@ -111,6 +132,13 @@ class ODTask
    ///returns the number of tasks created before this instance.
    int GetTaskNumber(){return mTaskNumber;}
 
+   ///Sets how urgent the task is, from ePriorityBackground to ePriorityPlayback.
+   void SetPriority(int priority);
+   ///Returns how urgent the task is, which is ePriorityExport while any of its tracks are being exported.
+   int GetPriority();
+   ///Counts the exports of the task's tracks.  Each call with true must be matched by one with false.
+   void SetExporting(bool exporting);
+
    void SetNeedsODUpdate();
    bool GetNeedsODUpdate();
    void ResetNeedsODUpdate();
@@ -141,7 +169,8 @@ class ODTask
    ///special needs can override this
    virtual void ODUpdate();
 
-   void SetIsRunning(bool value);
+   ///Uncounts a thread that has finished DoSome().
+   void RemoveWorker();
 
 
 
@@ -150,10 +179,19 @@ class ODTask
    ODLock mPercentCompleteMutex;
    volatile bool  mDoingTask;
    volatile bool  mTaskStarted;
+   //so that only one of several workers finishing together announces completion.
+   bool mCompletePosted;
    volatile bool mTerminate;
    ODLock mTerminateMutex;
-   //for a function not a member var.
-   ODLock mBlockUntilTerminateMutex;
+
+   //the threads in DoSome(), and the condition TerminateAndBlock() waits on for them to leave.
+   int mWorkers;
+   ODLock mWorkersMutex;
+   ODCondition* mWorkersDone;
+
+   int mPriority;
+   int mExportCount;
+   ODLock mPriorityMutex;
 
    std::vector<WaveTrack*> mWaveTracks;
    ODLock     mWaveTrackMutex;
@@ -161,9 +199,6 @@ class ODTask
    volatile sampleCount mDemandSample;
    ODLock      mDemandSampleMutex;
 
-   volatile bool mIsRunning;
-   ODLock mIsRunningMutex;
-
 
    private:
 
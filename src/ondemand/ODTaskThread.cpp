@@ -11,7 +11,8 @@
 ******************************************************************//**
 
 \class ODTaskThread
-\brief A thread that executes a part of the task specfied by an ODTask.
+\brief One of the ODManager's worker threads, which execute parts of the
+ODTasks the manager gives them until it quits.
 
 *//*******************************************************************/
 
@@ -19,14 +20,14 @@
 #include "ODTaskThread.h"
 #include "ODTask.h"
 #include "ODManager.h"
+#include "../Profiler.h"
 
 
-ODTaskThread::ODTaskThread(ODTask* task)
+ODTaskThread::ODTaskThread()
 #ifndef __WXMAC__
 : wxThread()
 #endif
 {
-   mTask=task;
 #ifdef __WXMAC__
    mDestroy = false;
    mThread = NULL;
@@ -42,10 +43,20 @@ void *ODTaskThread::Entry()
 
 #endif
 {
+   Profiler::SetThreadName("On-demand worker");
+
    //TODO: Figure out why this has no effect at all.
    //wxThread::This()->SetPriority( 40);
-   //Do at least 5 percent of the task
-   mTask->DoSome(0.05f);
+   ODTask* task;
+   //blocks until there is something to do, and returns NULL when the ODManager quits.
+   while((task = ODManager::Instance()->TakeTask()))
+   {
+      //Do at least 5 percent of the task, then see if something more urgent has come up
+      task->DoSome(0.05f);
+
+      //let the manager retire finished tasks and redraw.
+      ODManager::Instance()->SignalTaskQueueLoop();
+   }
 
    //release the thread count so that the ODManager knows how many active threads are alive.
    ODManager::Instance()->DecrementCurrentThreads();
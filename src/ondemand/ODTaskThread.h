@@ -11,7 +11,8 @@
 ******************************************************************//**
 
 \class ODTaskThread
-\brief A thread that executes a part of the task specfied by an ODTask.
+\brief One of the ODManager's worker threads, which execute parts of the
+ODTasks the manager gives them until it quits.
 
 *//*******************************************************************/
 
@@ -38,7 +39,7 @@ class ODTask;
 class ODTaskThread {
  public:
    typedef int ExitCode;
-   ODTaskThread(ODTask* task);
+   ODTaskThread();
    /*ExitCode*/ void Entry();
    void Create() {}
    void Delete() {
@@ -76,8 +77,6 @@ class ODTaskThread {
    int mPriority;
    bool mDestroy;
    pthread_t mThread;
-
-   ODTask* mTask;
 };
 
 class ODLock {
@@ -129,14 +128,12 @@ class ODTaskThread : public wxThread
 {
 public:
    ///Constructs a ODTaskThread
-   ///@param task the task to be launched as an
-   ODTaskThread(ODTask* task);
+   ODTaskThread();
 
 
 protected:
-   ///Executes a part of the task
+   ///Executes parts of tasks until the ODManager quits
    virtual void* Entry();
-   ODTask* mTask;
 
 };
 
@@ -166,5 +163,16 @@ protected:
 
 #endif // __WXMAC__
 
+///Holds an ODLock for as long as it is in scope.
+class ODLocker
+{
+public:
+   ODLocker(ODLock &lock):mLock(lock){mLock.Lock();}
+   ~ODLocker(){mLock.Unlock();}
+
+private:
+   ODLock &mLock;
+};
+
 #endif //__AUDACITY_ODTASKTHREAD__
 
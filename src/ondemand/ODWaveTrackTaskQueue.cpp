@@ -19,6 +19,7 @@ tasks associated with a WaveTrack.
 #include "ODWaveTrackTaskQueue.h"
 #include "ODTask.h"
 #include "ODManager.h"
+#include "../WaveTrack.h"
 /// Constructs an ODWaveTrackTaskQueue
 ODWaveTrackTaskQueue::ODWaveTrackTaskQueue()
 {
@@ -201,6 +202,39 @@ void ODWaveTrackTaskQueue::DemandTrackUpdate(WaveTrack* track, double seconds)
    }
 }
 
+///sets the priority of the tasks, and moves them to t0 unless they are already working between t0 and t1.
+///@param track the track to update
+///@param priority one of ODTask::ODPriorityEnum
+///@param t0,t1 the time range the user needs first.  If t1<=t0 the tasks carry on from where they are.
+void ODWaveTrackTaskQueue::SetTrackPriority(WaveTrack* track, int priority, double t0, double t1)
+{
+   if(track)
+   {
+      mTasksMutex.Lock();
+      for(unsigned int i=0;i<mTasks.size();i++)
+      {
+         mTasks[i]->SetPriority(priority);
+
+         //tasks work forward from the demand point, so leave them if it is in or a little before the range.
+         //Moving them reorders their blocks, and the playhead moves on all the time.
+         double demand = mTasks[i]->GetDemandSample() / track->GetRate();
+         //An export has already moved the task to where it needs it.
+         if(t1 > t0 && (demand < t0 - (t1 - t0) || demand >= t1) &&
+            mTasks[i]->GetPriority() != ODTask::ePriorityExport)
+            mTasks[i]->DemandTrackUpdate(track,t0);
+      }
+      mTasksMutex.Unlock();
+   }
+}
+
+///counts an export of one of the tracks in all of the tasks.
+void ODWaveTrackTaskQueue::SetTrackExporting(bool exporting)
+{
+   mTasksMutex.Lock();
+   for(unsigned int i=0;i<mTasks.size();i++)
+      mTasks[i]->SetExporting(exporting);
+   mTasksMutex.Unlock();
+}
 
 //Replaces all instances of a wavetracck with a new one (effectively transferes the task.)
 void ODWaveTrackTaskQueue::ReplaceWaveTrack(WaveTrack* oldTrack, WaveTrack* newTrack)
@@ -304,7 +338,10 @@ void ODWaveTrackTaskQueue::RemoveFrontTask()
    mTasksMutex.Lock();
    if(mTasks.size())
    {
-      //wait for the task to stop running.
+      //wait for the task's workers to leave before deleting it.
+      mTasks[0]->TerminateAndBlock();
+      //a task that can be shared stays in the ODManager's list while it runs.
+      ODManager::Instance()->RemoveTaskIfInQueue(mTasks[0]);
       delete mTasks[0];
       mTasks.erase(mTasks.begin());
    }
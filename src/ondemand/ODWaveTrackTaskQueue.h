@@ -50,6 +50,12 @@ class ODWaveTrackTaskQueue
    ///changes the tasks associated with this Waveform to process the task from a different point in the track
    void DemandTrackUpdate(WaveTrack* track, double seconds);
 
+   ///sets the priority of the tasks, and moves them to t0 unless they are already working between t0 and t1.
+   void SetTrackPriority(WaveTrack* track, int priority, double t0, double t1);
+
+   ///counts an export of one of the tracks in all of the tasks.
+   void SetTrackExporting(bool exporting);
+
    ///replaces all instances of a WaveTrack within this task with another.
    void ReplaceWaveTrack(WaveTrack* oldTrack,WaveTrack* newTrack);
 
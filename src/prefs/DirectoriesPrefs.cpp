@@ -34,6 +34,7 @@
 
 #include "../Prefs.h"
 #include "../AudacityApp.h"
+#include "../DirManager.h"
 #include "../Internat.h"
 #include "../ShuttleGui.h"
 #include "DirectoriesPrefs.h"
@@ -100,6 +101,20 @@ void DirectoriesPrefs::PopulateOrExchange(ShuttleGui & S)
    }
    S.EndStatic();
 
+   S.StartStatic(_("Project data files"));
+   {
+      S.TieCheckBox(_("&Keep audio in a few large files instead of one file per block"),
+                    wxT("/Directories/PackBlockFiles"),
+                    false);
+#ifdef USE_LIBFLAC
+      S.TieCheckBox(_("Co&mpress audio without loss in files of their own"),
+                    wxT("/Directories/CompressBlockFiles"),
+                    false);
+#endif
+      S.AddVariableText(_("Applies to projects opened or created after the change."))->Wrap(600);
+   }
+   S.EndStatic();
+
 #ifdef DEPRECATED_AUDIO_CACHE
    // See http://bugzilla.audacityteam.org/show_bug.cgi?id=545.
    S.StartStatic(_("Audio cache"));
@@ -240,5 +255,13 @@ bool DirectoriesPrefs::Apply()
    ShuttleGui S(this, eIsSavingToPrefs);
    PopulateOrExchange(S);
 
+   // DirManagers do not read prefs themselves
+   bool packBlocks = false;
+   gPrefs->Read(wxT("/Directories/PackBlockFiles"), &packBlocks, false);
+   DirManager::SetPackBlocks(packBlocks);
+   bool compressBlocks = false;
+   gPrefs->Read(wxT("/Directories/CompressBlockFiles"), &compressBlocks, false);
+   DirManager::SetCompressBlocks(compressBlocks);
+
    return true;
 }
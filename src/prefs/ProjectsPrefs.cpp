@@ -70,6 +70,16 @@ void ProjectsPrefs::PopulateOrExchange(ShuttleGui & S)
       S.EndRadioButtonGroup();
    }
    S.EndStatic();
+
+   S.StartStatic(_("Project files"));
+   {
+      // Much faster to open and save for projects with many blocks, but
+      // older versions of Audacity cannot read them
+      S.TieCheckBox(_("Save projects in a compact &binary format"),
+                    wxT("/FileFormats/SaveProjectBinary"),
+                    false);
+   }
+   S.EndStatic();
 }
 
 bool ProjectsPrefs::Apply()
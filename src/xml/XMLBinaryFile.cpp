@@ -0,0 +1,535 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  XMLBinaryFile.cpp
+
+*******************************************************************//**
+
+\class XMLBinaryFileWriter
+\brief Writes what XMLFileWriter would, in a compact binary form that
+is much faster to read back.
+
+  The file is a 16 byte header, "AudacityBinProj" and a version byte,
+  followed by records.  Each record is a kind byte, the length of its
+  payload, then the payload, so that a reader can skip kinds it does not
+  know.  Numbers are unsigned LEB128 varints; signed ones are zigzag
+  encoded first.  Text is UTF-8.
+
+  - 'S' adds a string to the string table, which holds tag and
+    attribute names.  Each is written once, the first time it is used.
+  - 'L' adds a layout: a tag name and its attribute names and types,
+    'i' for integers and 's' for strings.
+  - 'E' starts an element: its layout, then its attribute values.
+  - 'X' ends the innermost element.
+  - 'C' is character data within the innermost element.
+  - 'T' is raw text, like the XML declaration.  It is kept so that the
+    file can be turned back into the same XML, and skipped when loading.
+
+  All of the blocks of a project share a couple of layouts, so each
+  block costs only its values, and no text has to be parsed to load it.
+
+  Floating point attributes are stored as the same text XMLFileWriter
+  writes, so that a project loads with exactly the same values from
+  either form.
+
+*//****************************************************************//**
+
+\class XMLBinaryFileReader
+\brief Reads a file written by XMLBinaryFileWriter, and passes the
+results through an XMLTagHandler, just as XMLFileReader does.
+
+*//*******************************************************************/
+
+#include "../Audacity.h"
+#include <wx/defs.h>
+#include <wx/ffile.h>
+#include <wx/intl.h>
+
+#include <string.h>
+
+#include "../Internat.h"
+#include "XMLBinaryFile.h"
+
+static const char kXMLBinaryMagic[] = "AudacityBinProj";
+static const size_t kXMLBinaryMagicLen = 15;
+static const size_t kXMLBinaryHeaderLen = 16;
+static const unsigned char kXMLBinaryVersion = 1;
+
+static void AppendVarint(wxMemoryBuffer &buf, wxULongLong_t value)
+{
+   while (value >= 0x80) {
+      buf.AppendByte((char)((value & 0x7f) | 0x80));
+      value >>= 7;
+   }
+   buf.AppendByte((char)value);
+}
+
+static void AppendUTF8(wxMemoryBuffer &buf, const wxString &s, bool withLength)
+{
+   wxCharBuffer utf8 = s.mb_str(wxConvUTF8);
+   size_t len = strlen(utf8);
+   if (withLength)
+      AppendVarint(buf, len);
+   buf.AppendData((void *)(const char *)utf8, len);
+}
+
+static bool ReadVarint(const unsigned char *&p, const unsigned char *end,
+                       wxULongLong_t &value)
+{
+   value = 0;
+   for (int shift = 0; shift < 64; shift += 7) {
+      if (p == end)
+         return false;
+      unsigned char b = *p++;
+      value |= (wxULongLong_t)(b & 0x7f) << shift;
+      if (!(b & 0x80))
+         return true;
+   }
+   return false;
+}
+
+// Formats as "%lld" would, without the cost of a format string
+static wxString FormatInt(wxLongLong_t value)
+{
+   wxChar buf[24];
+   wxChar *p = buf + 24;
+   wxULongLong_t u = value < 0 ? 0 - (wxULongLong_t)value : (wxULongLong_t)value;
+
+   *--p = 0;
+   do {
+      *--p = (wxChar)(wxT('0') + (int)(u % 10));
+      u /= 10;
+   } while (u);
+   if (value < 0)
+      *--p = wxT('-');
+
+   return wxString(p);
+}
+
+///
+/// XMLBinaryFileWriter class
+///
+XMLBinaryFileWriter::XMLBinaryFileWriter()
+{
+   mPending = false;
+   mPendingTag = 0;
+   mPendingCount = 0;
+}
+
+XMLBinaryFileWriter::~XMLBinaryFileWriter()
+{
+   // Here rather than in ~XMLFileWriter(), where the tags would be
+   // ended as text
+   if (IsOpened()) {
+      Close();
+   }
+}
+
+void XMLBinaryFileWriter::Open(const wxString &name, const wxString &mode)
+{
+   XMLFileWriter::Open(name, mode);
+
+   char header[kXMLBinaryHeaderLen];
+   memcpy(header, kXMLBinaryMagic, kXMLBinaryMagicLen);
+   header[kXMLBinaryMagicLen] = kXMLBinaryVersion;
+   WriteBytes(header, kXMLBinaryHeaderLen);
+}
+
+void XMLBinaryFileWriter::StartTag(const wxString &name)
+{
+   FlushTag();
+
+   mPending = true;
+   mPendingTag = GetStringId(name);
+   mPendingKey = name;
+   mPendingLayout.SetDataLen(0);
+   mPendingValues.SetDataLen(0);
+   mPendingCount = 0;
+
+   mTagstack.Insert(name, 0);
+   mDepth++;
+}
+
+void XMLBinaryFileWriter::EndTag(const wxString &name)
+{
+   FlushTag();
+
+   mRecord.SetDataLen(0);
+   WriteRecord('X', mRecord);
+
+   if (mTagstack.GetCount() > 0 && mTagstack[0] == name)
+      mTagstack.RemoveAt(0);
+
+   mDepth--;
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, const wxString &value)
+{
+   AddStringAttr(name, value);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, const wxChar *value)
+{
+   AddStringAttr(name, wxString(value));
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, int value)
+{
+   AddIntAttr(name, value);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, bool value)
+{
+   AddIntAttr(name, value ? 1 : 0);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, long value)
+{
+   AddIntAttr(name, value);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, long long value)
+{
+   AddIntAttr(name, value);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, size_t value)
+{
+   AddIntAttr(name, (long long) value);
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, float value, int digits)
+{
+   AddStringAttr(name, Internat::ToString(value, digits));
+}
+
+void XMLBinaryFileWriter::WriteAttr(const wxString &name, double value, int digits)
+{
+   AddStringAttr(name, Internat::ToString(value, digits));
+}
+
+void XMLBinaryFileWriter::WriteData(const wxString &value)
+{
+   FlushTag();
+
+   mRecord.SetDataLen(0);
+   AppendUTF8(mRecord, value, false);
+   WriteRecord('C', mRecord);
+}
+
+void XMLBinaryFileWriter::WriteSubTree(const wxString &value)
+{
+   Write(value);
+}
+
+void XMLBinaryFileWriter::Write(const wxString &data)
+{
+   FlushTag();
+
+   mRecord.SetDataLen(0);
+   AppendUTF8(mRecord, data, false);
+   WriteRecord('T', mRecord);
+}
+
+void XMLBinaryFileWriter::AddIntAttr(const wxString &name, wxLongLong_t value)
+{
+   if (!mPending)
+      return;
+
+   AppendVarint(mPendingLayout, GetStringId(name));
+   mPendingLayout.AppendByte('i');
+   mPendingKey << wxT(" i") << name;
+
+   AppendVarint(mPendingValues,
+                ((wxULongLong_t)value << 1) ^ (wxULongLong_t)(value >> 63));
+   mPendingCount++;
+}
+
+void XMLBinaryFileWriter::AddStringAttr(const wxString &name, const wxString &value)
+{
+   if (!mPending)
+      return;
+
+   AppendVarint(mPendingLayout, GetStringId(name));
+   mPendingLayout.AppendByte('s');
+   mPendingKey << wxT(" s") << name;
+
+   AppendUTF8(mPendingValues, value, true);
+   mPendingCount++;
+}
+
+void XMLBinaryFileWriter::FlushTag()
+{
+   if (!mPending)
+      return;
+   mPending = false;
+
+   int layout;
+   XMLBinaryIdMap::iterator it = mLayoutIds.find(mPendingKey);
+   if (it == mLayoutIds.end()) {
+      mRecord.SetDataLen(0);
+      AppendVarint(mRecord, mPendingTag);
+      AppendVarint(mRecord, mPendingCount);
+      mRecord.AppendData(mPendingLayout.GetData(), mPendingLayout.GetDataLen());
+      WriteRecord('L', mRecord);
+
+      layout = mLayoutIds.size();
+      mLayoutIds[mPendingKey] = layout;
+   }
+   else
+      layout = it->second;
+
+   mRecord.SetDataLen(0);
+   AppendVarint(mRecord, layout);
+   mRecord.AppendData(mPendingValues.GetData(), mPendingValues.GetDataLen());
+   WriteRecord('E', mRecord);
+}
+
+int XMLBinaryFileWriter::GetStringId(const wxString &s)
+{
+   XMLBinaryIdMap::iterator it = mStringIds.find(s);
+   if (it != mStringIds.end())
+      return it->second;
+
+   // mRecord may hold a record being built, so use a buffer of our own
+   wxMemoryBuffer record;
+   AppendUTF8(record, s, false);
+   WriteRecord('S', record);
+
+   int id = mStringIds.size();
+   mStringIds[s] = id;
+   return id;
+}
+
+void XMLBinaryFileWriter::WriteRecord(char kind, const wxMemoryBuffer &payload)
+{
+   wxMemoryBuffer header;
+   header.AppendByte(kind);
+   AppendVarint(header, payload.GetDataLen());
+
+   WriteBytes(header.GetData(), header.GetDataLen());
+   if (payload.GetDataLen() > 0)
+      WriteBytes(payload.GetData(), payload.GetDataLen());
+}
+
+void XMLBinaryFileWriter::WriteBytes(const void *data, size_t len)
+{
+   if (wxFFile::Write(data, len) != len)
+   {
+      // When writing fails, we try to close the file before throwing the
+      // exception, so it can at least be deleted.
+      wxFFile::Close();
+      throw new XMLFileWriterException(_("Error Writing to File"));
+   }
+}
+
+///
+/// XMLBinaryFileReader class
+///
+XMLBinaryFileReader::XMLBinaryFileReader()
+{
+   mBaseHandler = NULL;
+   mBaseHandled = false;
+}
+
+XMLBinaryFileReader::~XMLBinaryFileReader()
+{
+}
+
+// static
+bool XMLBinaryFileReader::IsBinaryFile(const char *start, size_t len)
+{
+   return len >= kXMLBinaryMagicLen &&
+          !memcmp(start, kXMLBinaryMagic, kXMLBinaryMagicLen);
+}
+
+bool XMLBinaryFileReader::Parse(XMLTagHandler *baseHandler,
+                                const wxString &fname)
+{
+   wxFFile theFile(fname, wxT("rb"));
+   if (!theFile.IsOpened()) {
+      mErrorStr.Printf(_("Could not open file: \"%s\""), fname.c_str());
+      return false;
+   }
+
+   // The whole file is read at once; it is far smaller than the XML
+   wxFileOffset fileLen = theFile.Length();
+   std::vector<unsigned char> data(fileLen > 0 ? (size_t)fileLen : 1);
+   size_t len = 0;
+   if (fileLen > 0)
+      len = theFile.Read(&data[0], (size_t)fileLen);
+   theFile.Close();
+
+   if (len < kXMLBinaryHeaderLen ||
+       !IsBinaryFile((const char *)&data[0], len)) {
+      mErrorStr.Printf(_("File may be invalid or corrupted: \n%s"),
+                       fname.c_str());
+      return false;
+   }
+
+   if (data[kXMLBinaryMagicLen] > kXMLBinaryVersion) {
+      mErrorStr.Printf(_("\"%s\" was saved by a newer version of Audacity, and cannot be opened by this one."),
+                       fname.c_str());
+      return false;
+   }
+
+   mBaseHandler = baseHandler;
+   mBaseHandled = false;
+
+   const unsigned char *p = &data[0] + kXMLBinaryHeaderLen;
+   const unsigned char *end = &data[0] + len;
+   bool ok = true;
+
+   while (ok && p < end) {
+      unsigned char kind = *p++;
+      wxULongLong_t recordLen;
+      if (!ReadVarint(p, end, recordLen) ||
+          recordLen > (wxULongLong_t)(end - p)) {
+         ok = false;
+         break;
+      }
+      const unsigned char *next = p + (size_t)recordLen;
+
+      switch (kind) {
+         case 'S':
+            mStrings.Add(wxString((const char *)p, wxConvUTF8, next - p));
+            break;
+         case 'L':
+            ok = ReadLayout(p, next);
+            break;
+         case 'E':
+            ok = ReadElement(p, next);
+            break;
+         case 'X':
+            ok = ReadEndTag();
+            break;
+         case 'C':
+            ReadContent(p, next);
+            break;
+         default:
+            // Raw text, or a kind from a later version
+            break;
+      }
+
+      p = next;
+   }
+
+   // Every element must have been ended, as an XML parser would insist
+   if (!ok || !mHandlers.empty()) {
+      mErrorStr.Printf(_("File may be invalid or corrupted: \n%s"),
+                       fname.c_str());
+      return false;
+   }
+
+   // As with XMLFileReader, we only succeed if the first-level handler
+   // actually got called, and didn't return false.
+   if (mBaseHandled)
+      return true;
+   else {
+      mErrorStr.Printf(_("Could not load file: \"%s\""), fname.c_str());
+      return false;
+   }
+}
+
+wxString XMLBinaryFileReader::GetErrorStr()
+{
+   return mErrorStr;
+}
+
+bool XMLBinaryFileReader::ReadLayout(const unsigned char *p, const unsigned char *end)
+{
+   wxULongLong_t tag, count;
+   if (!ReadVarint(p, end, tag) || tag >= mStrings.GetCount() ||
+       !ReadVarint(p, end, count) || count > (wxULongLong_t)(end - p))
+      return false;
+
+   Layout layout;
+   layout.tag = (int)tag;
+   for (wxULongLong_t i = 0; i < count; i++) {
+      wxULongLong_t name;
+      if (!ReadVarint(p, end, name) || name >= mStrings.GetCount() || p == end)
+         return false;
+      char type = (char)*p++;
+      if (type != 'i' && type != 's')
+         return false;
+      layout.names.push_back((int)name);
+      layout.types.push_back(type);
+   }
+
+   mLayouts.push_back(layout);
+   return true;
+}
+
+bool XMLBinaryFileReader::ReadElement(const unsigned char *p, const unsigned char *end)
+{
+   wxULongLong_t id;
+   if (!ReadVarint(p, end, id) || id >= mLayouts.size())
+      return false;
+   const Layout &layout = mLayouts[(size_t)id];
+
+   mValues.Empty();
+   for (size_t i = 0; i < layout.types.size(); i++) {
+      wxULongLong_t value;
+      if (!ReadVarint(p, end, value))
+         return false;
+
+      if (layout.types[i] == 'i')
+         mValues.Add(FormatInt((wxLongLong_t)(value >> 1) ^ -(wxLongLong_t)(value & 1)));
+      else {
+         if (value > (wxULongLong_t)(end - p))
+            return false;
+         mValues.Add(wxString((const char *)p, wxConvUTF8, (size_t)value));
+         p += (size_t)value;
+      }
+   }
+
+   mAttrs.clear();
+   for (size_t i = 0; i < layout.names.size(); i++) {
+      mAttrs.push_back(mStrings[layout.names[i]].c_str());
+      mAttrs.push_back(mValues[i].c_str());
+   }
+   mAttrs.push_back(NULL);
+
+   const wxChar *tag = mStrings[layout.tag].c_str();
+
+   XMLTagHandler *handler = NULL;
+   if (mHandlers.empty())
+      handler = mBaseHandler;
+   else if (mHandlers.back())
+      handler = mHandlers.back()->HandleXMLChild(tag);
+
+   if (handler && !handler->HandleXMLTag(tag, &mAttrs[0]))
+      handler = NULL;
+
+   if (mHandlers.empty())
+      mBaseHandled = (handler != NULL);
+
+   mHandlers.push_back(handler);
+   mTags.push_back(layout.tag);
+
+   return true;
+}
+
+bool XMLBinaryFileReader::ReadEndTag()
+{
+   if (mHandlers.empty())
+      return false;
+
+   XMLTagHandler *handler = mHandlers.back();
+   int tag = mTags.back();
+   mHandlers.pop_back();
+   mTags.pop_back();
+
+   if (handler)
+      handler->HandleXMLEndTag(mStrings[tag].c_str());
+
+   return true;
+}
+
+void XMLBinaryFileReader::ReadContent(const unsigned char *p, const unsigned char *end)
+{
+   if (!mHandlers.empty() && mHandlers.back())
+      mHandlers.back()->HandleXMLContent(
+         wxString((const char *)p, wxConvUTF8, end - p));
+}
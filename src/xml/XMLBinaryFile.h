@@ -0,0 +1,132 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  XMLBinaryFile.h
+
+**********************************************************************/
+#ifndef __AUDACITY_XML_XML_BINARY_FILE__
+#define __AUDACITY_XML_XML_BINARY_FILE__
+
+#include <vector>
+
+#include <wx/buffer.h>
+#include <wx/hashmap.h>
+
+#include "XMLWriter.h"
+#include "XMLTagHandler.h"
+
+WX_DECLARE_STRING_HASH_MAP(int, XMLBinaryIdMap);
+
+///
+/// XMLBinaryFileWriter
+///
+class AUDACITY_DLL_API XMLBinaryFileWriter:public XMLFileWriter {
+
+ public:
+
+   XMLBinaryFileWriter();
+   virtual ~XMLBinaryFileWriter();
+
+   /// Open the file and write the header.
+   /// Might throw XMLFileWriterException.
+   virtual void Open(const wxString &name, const wxString &mode);
+
+   virtual void StartTag(const wxString &name);
+   virtual void EndTag(const wxString &name);
+
+   virtual void WriteAttr(const wxString &name, const wxString &value);
+   virtual void WriteAttr(const wxString &name, const wxChar *value);
+
+   virtual void WriteAttr(const wxString &name, int value);
+   virtual void WriteAttr(const wxString &name, bool value);
+   virtual void WriteAttr(const wxString &name, long value);
+   virtual void WriteAttr(const wxString &name, long long value);
+   virtual void WriteAttr(const wxString &name, size_t value);
+   virtual void WriteAttr(const wxString &name, float value, int digits = -1);
+   virtual void WriteAttr(const wxString &name, double value, int digits = -1);
+
+   virtual void WriteData(const wxString &value);
+
+   virtual void WriteSubTree(const wxString &value);
+
+   /// Keeps raw text, such as the XML declaration, so that converting
+   /// back to XML gives the same file.  It is ignored when loading.
+   virtual void Write(const wxString &data);
+
+ private:
+
+   void AddIntAttr(const wxString &name, wxLongLong_t value);
+   void AddStringAttr(const wxString &name, const wxString &value);
+   void FlushTag();
+
+   int GetStringId(const wxString &s);
+   void WriteRecord(char kind, const wxMemoryBuffer &payload);
+   void WriteBytes(const void *data, size_t len);
+
+   XMLBinaryIdMap mStringIds;
+   XMLBinaryIdMap mLayoutIds;
+
+   // The start tag being written; it is only written out once all of
+   // its attributes are known, since they decide its layout
+   bool mPending;
+   int mPendingTag;
+   wxString mPendingKey;
+   wxMemoryBuffer mPendingLayout;
+   wxMemoryBuffer mPendingValues;
+   int mPendingCount;
+
+   wxMemoryBuffer mRecord;
+};
+
+///
+/// XMLBinaryFileReader
+///
+class AUDACITY_DLL_API XMLBinaryFileReader {
+
+ public:
+
+   XMLBinaryFileReader();
+   virtual ~XMLBinaryFileReader();
+
+   /// True if a file beginning with these bytes was written by
+   /// XMLBinaryFileWriter
+   static bool IsBinaryFile(const char *start, size_t len);
+
+   bool Parse(XMLTagHandler *baseHandler,
+              const wxString &fname);
+
+   wxString GetErrorStr();
+
+ private:
+
+   struct Layout
+   {
+      int tag;
+      std::vector<int> names;
+      std::vector<char> types;
+   };
+
+   bool ReadLayout(const unsigned char *p, const unsigned char *end);
+   bool ReadElement(const unsigned char *p, const unsigned char *end);
+   bool ReadEndTag();
+   void ReadContent(const unsigned char *p, const unsigned char *end);
+
+   XMLTagHandler *mBaseHandler;
+   bool mBaseHandled;
+
+   wxArrayString mStrings;
+   std::vector<Layout> mLayouts;
+
+   // The open elements, innermost last
+   std::vector<XMLTagHandler *> mHandlers;
+   std::vector<int> mTags;
+
+   // Reused for each element
+   wxArrayString mValues;
+   std::vector<const wxChar *> mAttrs;
+
+   wxString mErrorStr;
+};
+
+#endif
@@ -23,23 +23,23 @@ class AUDACITY_DLL_API XMLWriter {
    XMLWriter();
    virtual ~XMLWriter();
 
-   void StartTag(const wxString &name);
-   void EndTag(const wxString &name);
+   virtual void StartTag(const wxString &name);
+   virtual void EndTag(const wxString &name);
 
-   void WriteAttr(const wxString &name, const wxString &value);
-   void WriteAttr(const wxString &name, const wxChar *value);
+   virtual void WriteAttr(const wxString &name, const wxString &value);
+   virtual void WriteAttr(const wxString &name, const wxChar *value);
 
-   void WriteAttr(const wxString &name, int value);
-   void WriteAttr(const wxString &name, bool value);
-   void WriteAttr(const wxString &name, long value);
-   void WriteAttr(const wxString &name, long long value);
-   void WriteAttr(const wxString &name, size_t value);
-   void WriteAttr(const wxString &name, float value, int digits = -1);
-   void WriteAttr(const wxString &name, double value, int digits = -1);
+   virtual void WriteAttr(const wxString &name, int value);
+   virtual void WriteAttr(const wxString &name, bool value);
+   virtual void WriteAttr(const wxString &name, long value);
+   virtual void WriteAttr(const wxString &name, long long value);
+   virtual void WriteAttr(const wxString &name, size_t value);
+   virtual void WriteAttr(const wxString &name, float value, int digits = -1);
+   virtual void WriteAttr(const wxString &name, double value, int digits = -1);
 
-   void WriteData(const wxString &value);
+   virtual void WriteData(const wxString &value);
 
-   void WriteSubTree(const wxString &value);
+   virtual void WriteSubTree(const wxString &value);
 
    virtual void Write(const wxString &data) = 0;
 
@@ -67,7 +67,7 @@ class AUDACITY_DLL_API XMLFileWriter:public wxFFile, public XMLWriter {
    virtual ~XMLFileWriter();
 
    /// Open the file. Might throw XMLFileWriterException.
-   void Open(const wxString &name, const wxString &mode);
+   virtual void Open(const wxString &name, const wxString &mode);
 
    /// Close file. Might throw XMLFileWriterException.
    void Close();
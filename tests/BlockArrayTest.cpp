@@ -0,0 +1,146 @@
+#include <iostream>
+#include <ostream>
+#include <cassert>
+#include <cstdlib>
+#include <math.h>
+#include <vector>
+
+#include "BlockArray.h"
+#include "blockfile/SilentBlockFile.h"
+
+
+class BlockArrayTest {
+   BlockArray *blocks;
+   // The same blocks in a plain vector, to check the tree against
+   std::vector<BlockFile *> model;
+
+public:
+   BlockArrayTest()
+   {
+       std::cout << "==> Testing BlockArray\n";
+       srand(1);
+   }
+
+   void setUp() {
+      blocks = new BlockArray();
+      model.clear();
+   }
+
+   void tearDown() {
+      for (size_t i = 0; i < model.size(); i++)
+         delete model[i];
+      model.clear();
+      delete blocks;
+   }
+
+   BlockFile *NewBlock() {
+      return new SilentBlockFile(1 + rand() % 1000);
+   }
+
+   // No AVL tree of n nodes is taller than this
+   static int MaxHeight(size_t n) {
+      return (int)floor(1.4405 * log((double)n + 2.0) / log(2.0) - 0.3277);
+   }
+
+   void AssertMatchesModel() {
+      assert(blocks->GetCount() == model.size());
+
+      assert(blocks->GetHeight() <= MaxHeight(model.size()));
+      assert(blocks->IsConsistent());
+
+      sampleCount start = 0;
+      for (size_t i = 0; i < model.size(); i++) {
+         sampleCount len = model[i]->GetLength();
+
+         SeqBlock b = blocks->Item(i);
+         assert(b.f == model[i]);
+         assert(b.start == start);
+         assert(blocks->FindBlock(start) == (int)i);
+         assert(blocks->FindBlock(start + len - 1) == (int)i);
+
+         start += len;
+      }
+
+      assert(blocks->GetNumSamples() == start);
+      assert(blocks->FindBlock(start) == -1);
+   }
+
+   void testEdits() {
+       std::cout << "\tVerifying that edits keep blocks in order..." << std::flush;
+
+       for (int i = 0; i < 20000; i++) {
+          size_t n = model.size();
+
+          switch (rand() % 5) {
+          case 0: {
+             BlockFile *b = NewBlock();
+             blocks->Add(b);
+             model.push_back(b);
+             break;
+          }
+          case 1: {
+             BlockFile *b = NewBlock();
+             size_t at = rand() % (n + 1);
+             blocks->Insert(b, at);
+             model.insert(model.begin() + at, b);
+             break;
+          }
+          case 2:
+             if (n > 0) {
+                size_t at = rand() % n;
+                size_t count = 1 + rand() % (n - at < 64 ? n - at : 64);
+                blocks->RemoveAt(at, count);
+                for (size_t j = at; j < at + count; j++)
+                   delete model[j];
+                model.erase(model.begin() + at, model.begin() + at + count);
+             }
+             break;
+          case 3:
+             if (n > 0) {
+                BlockFile *b = NewBlock();
+                size_t at = rand() % n;
+                blocks->Replace(at, b);
+                delete model[at];
+                model[at] = b;
+             }
+             break;
+          case 4: {
+             BlockArray other;
+             std::vector<BlockFile *> otherModel;
+             for (int j = rand() % 64; j > 0; j--) {
+                BlockFile *b = NewBlock();
+                other.Add(b);
+                otherModel.push_back(b);
+             }
+             size_t at = rand() % (n + 1);
+             blocks->InsertArray(at, other);
+             assert(other.GetCount() == 0);
+             model.insert(model.begin() + at,
+                          otherModel.begin(), otherModel.end());
+             break;
+          }
+          }
+
+          // The splits and joins must keep the tree balanced after
+          // every edit, not just in the end
+          assert(blocks->GetHeight() <= MaxHeight(model.size()));
+
+          if (i % 500 == 0)
+             AssertMatchesModel();
+       }
+       AssertMatchesModel();
+
+       std::cout << "OK\n";
+   }
+};
+
+int main()
+{
+    BlockArrayTest tester;
+
+    tester.setUp();
+    tester.testEdits();
+    tester.tearDown();
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <ostream>
+#include <cassert>
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "blockfile/CompressedBlockFile.h"
+
+
+class CompressedBlockFileTest {
+   CompressedBlockFile *int16BlockFile;
+   CompressedBlockFile *int24BlockFile;
+   CompressedBlockFile *floatBlockFile;
+   CompressedBlockFile *scaledBlockFile;
+
+   short *int16Data;
+   int *int24Data;
+   float *floatData;
+   float *scaledData;
+   int dataLen;
+
+public:
+   CompressedBlockFileTest()
+   {
+       std::cout << "==> Testing CompressedBlockFile\n";
+   }
+
+   void setUp() {
+      dataLen = 200000;
+
+      int16Data = new short[dataLen];
+      int24Data = new int[dataLen];
+      floatData = new float[dataLen];
+      scaledData = new float[dataLen];
+
+      int i;
+      int sign = 1;
+
+      for(i = 0; i < dataLen; i++)
+      {
+         sign *= -1;
+         // These have no significance, it's just random data
+         int16Data[i] = sign*(i*i);
+         int24Data[i] = sign*((i*i*i)%0x000FFFFF);
+         float j = (float) i;
+         floatData[i] = sign*j/((j*j)+1);
+         // As if 16 bit audio were imported into a float project; these
+         // are stored as FLAC
+         scaledData[i] = int16Data[i] / 32768.0f;
+      }
+
+      wxString dir = wxT("/tmp/CompressedBlockFileTest");
+      if (!wxDirExists(dir))
+         wxMkdir(dir);
+
+      int16BlockFile = new CompressedBlockFile(wxFileName(dir, wxT("int16")),
+                                               (samplePtr)int16Data, dataLen,
+                                               int16Sample);
+      int24BlockFile = new CompressedBlockFile(wxFileName(dir, wxT("int24")),
+                                               (samplePtr)int24Data, dataLen,
+                                               int24Sample);
+      floatBlockFile = new CompressedBlockFile(wxFileName(dir, wxT("float")),
+                                               (samplePtr)floatData, dataLen,
+                                               floatSample);
+      scaledBlockFile = new CompressedBlockFile(wxFileName(dir, wxT("scaled")),
+                                                (samplePtr)scaledData, dataLen,
+                                                floatSample);
+   }
+
+   void tearDown() {
+      delete [] int16Data;
+      delete [] int24Data;
+      delete [] floatData;
+      delete [] scaledData;
+      delete int16BlockFile;
+      delete int24BlockFile;
+      delete floatBlockFile;
+      delete scaledBlockFile;
+   }
+
+   template<class T> void AssertBuffersEqual(T *b1, T *b2, int len)
+   {
+      for( int i = 0; i < len; i++ )
+          if( b1[i] != b2[i] )
+          {
+              std::cout << b1[i] << " != " << b2[i] << " (i=" << i << ")" << std::endl;
+              assert(false);
+          }
+   }
+
+   void testReads() {
+       std::cout << "\tVerifying that we can read back correctly..." << std::flush;
+
+       samplePtr int16buf = NewSamples(dataLen, int16Sample);
+       samplePtr int24buf = NewSamples(dataLen, int24Sample);
+       samplePtr floatbuf = NewSamples(dataLen, floatSample);
+       samplePtr scaledbuf = NewSamples(dataLen, floatSample);
+
+       // First try a read of the entire buffer
+       int16BlockFile->ReadData(int16buf, int16Sample, 0, dataLen);
+       int24BlockFile->ReadData(int24buf, int24Sample, 0, dataLen);
+       floatBlockFile->ReadData(floatbuf, floatSample, 0, dataLen);
+       scaledBlockFile->ReadData(scaledbuf, floatSample, 0, dataLen);
+
+       AssertBuffersEqual(int16Data, (short*)int16buf, dataLen);
+       AssertBuffersEqual(int24Data, (int*)int24buf, dataLen);
+       AssertBuffersEqual(floatData, (float*)floatbuf, dataLen);
+       AssertBuffersEqual(scaledData, (float*)scaledbuf, dataLen);
+
+       // Now try a read that starts in the middle and stops before the end
+       int someOffset = 537;
+       int someLen = dataLen / 2;
+
+       int16BlockFile->ReadData(int16buf, int16Sample, someOffset, someLen);
+       int24BlockFile->ReadData(int24buf, int24Sample, someOffset, someLen);
+       floatBlockFile->ReadData(floatbuf, floatSample, someOffset, someLen);
+       scaledBlockFile->ReadData(scaledbuf, floatSample, someOffset, someLen);
+
+       AssertBuffersEqual(int16Data+someOffset, (short*)int16buf, someLen);
+       AssertBuffersEqual(int24Data+someOffset, (int*)int24buf, someLen);
+       AssertBuffersEqual(floatData+someOffset, (float*)floatbuf, someLen);
+       AssertBuffersEqual(scaledData+someOffset, (float*)scaledbuf, someLen);
+
+       DeleteSamples(int16buf);
+       DeleteSamples(int24buf);
+       DeleteSamples(floatbuf);
+       DeleteSamples(scaledbuf);
+
+       std::cout << "OK\n";
+   }
+
+   void testSize() {
+       std::cout << "\tVerifying that integer samples take less space..." << std::flush;
+
+       if (CompressedBlockFile::CanCompress()) {
+          wxLongLong raw = (wxLongLong)dataLen * sizeof(float);
+          assert(scaledBlockFile->GetSpaceUsage() < raw);
+          assert(floatBlockFile->GetSpaceUsage() > raw);
+       }
+
+       std::cout << "OK\n";
+   }
+};
+
+int main()
+{
+    CompressedBlockFileTest tester;
+
+    tester.setUp();
+    tester.testReads();
+    tester.tearDown();
+
+    tester.setUp();
+    tester.testSize();
+    tester.tearDown();
+
+    return 0;
+}
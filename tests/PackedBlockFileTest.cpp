@@ -0,0 +1,205 @@
+#include <iostream>
+#include <ostream>
+#include <cassert>
+#include <map>
+
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "blockfile/PackedBlockFile.h"
+#include "blockfile/PackedBlockStore.h"
+
+
+class PackedBlockFileTest {
+   PackedBlockStore *store;
+
+   PackedBlockFile *int16BlockFile;
+   PackedBlockFile *int24BlockFile;
+   PackedBlockFile *floatBlockFile;
+
+   short *int16Data;
+   int *int24Data;
+   float *floatData;
+   int dataLen;
+
+public:
+   PackedBlockFileTest()
+   {
+       std::cout << "==> Testing PackedBlockFile\n";
+   }
+
+   void setUp() {
+      dataLen = 200000;
+
+      int16Data = new short[dataLen];
+      int24Data = new int[dataLen];
+      floatData = new float[dataLen];
+
+      int i;
+      int sign = 1;
+
+      for(i = 0; i < dataLen; i++)
+      {
+         sign *= -1;
+         // These have no significance, it's just random data
+         int16Data[i] = sign*(i*i);
+         int24Data[i] = sign*((i*i*i)%0x000FFFFF);
+         float j = (float) i;
+         floatData[i] = sign*j/((j*j)+1);
+      }
+
+      wxString dir = wxT("/tmp/PackedBlockFileTest");
+      if (!wxDirExists(dir))
+         wxMkdir(dir);
+      store = new PackedBlockStore(dir);
+
+      int16BlockFile = new PackedBlockFile(store, wxFileName(dir, wxT("p00000000")),
+                                           (samplePtr)int16Data, dataLen,
+                                           int16Sample);
+      int24BlockFile = new PackedBlockFile(store, wxFileName(dir, wxT("p00000001")),
+                                           (samplePtr)int24Data, dataLen,
+                                           int24Sample);
+      floatBlockFile = new PackedBlockFile(store, wxFileName(dir, wxT("p00000002")),
+                                           (samplePtr)floatData, dataLen,
+                                           floatSample);
+   }
+
+   void tearDown() {
+      delete [] int16Data;
+      delete [] int24Data;
+      delete [] floatData;
+      delete int16BlockFile;
+      delete int24BlockFile;
+      delete floatBlockFile;
+
+      // Leaves no segment files behind
+      RetireAll();
+      store->RemoveRetired();
+      store->Deref();
+   }
+
+   void RetireAll() {
+      std::map<int, wxFileOffset> sizes;
+      store->GetSegmentSizes(sizes);
+      std::map<int, wxFileOffset>::iterator iter;
+      for (iter = sizes.begin(); iter != sizes.end(); iter++)
+         store->Retire(iter->first);
+   }
+
+   template<class T> void AssertBuffersEqual(T *b1, T *b2, int len)
+   {
+      for( int i = 0; i < len; i++ )
+          if( b1[i] != b2[i] )
+          {
+              std::cout << b1[i] << " != " << b2[i] << " (i=" << i << ")" << std::endl;
+              assert(false);
+          }
+   }
+
+   void AssertReadsBack() {
+       samplePtr int16buf = NewSamples(dataLen, int16Sample);
+       samplePtr int24buf = NewSamples(dataLen, int24Sample);
+       samplePtr floatbuf = NewSamples(dataLen, floatSample);
+
+       // First try a read of the entire buffer
+       int16BlockFile->ReadData(int16buf, int16Sample, 0, dataLen);
+       int24BlockFile->ReadData(int24buf, int24Sample, 0, dataLen);
+       floatBlockFile->ReadData(floatbuf, floatSample, 0, dataLen);
+
+       AssertBuffersEqual(int16Data, (short*)int16buf, dataLen);
+       AssertBuffersEqual(int24Data, (int*)int24buf, dataLen);
+       AssertBuffersEqual(floatData, (float*)floatbuf, dataLen);
+
+       // Now test a read that starts at the beginning but quits
+       // before the end
+       int someOffset = 537;
+
+       int16BlockFile->ReadData(int16buf, int16Sample, 0, someOffset);
+       int24BlockFile->ReadData(int24buf, int24Sample, 0, someOffset);
+       floatBlockFile->ReadData(floatbuf, floatSample, 0, someOffset);
+
+       AssertBuffersEqual(int16Data, (short*)int16buf, someOffset);
+       AssertBuffersEqual(int24Data, (int*)int24buf, someOffset);
+       AssertBuffersEqual(floatData, (float*)floatbuf, someOffset);
+
+       // Now try a read that starts in the middle and goes to the
+       // end
+       int16BlockFile->ReadData(int16buf, int16Sample, someOffset, dataLen-someOffset);
+       int24BlockFile->ReadData(int24buf, int24Sample, someOffset, dataLen-someOffset);
+       floatBlockFile->ReadData(floatbuf, floatSample, someOffset, dataLen-someOffset);
+
+       AssertBuffersEqual(int16Data+someOffset, (short*)int16buf, dataLen-someOffset);
+       AssertBuffersEqual(int24Data+someOffset, (int*)int24buf, dataLen-someOffset);
+       AssertBuffersEqual(floatData+someOffset, (float*)floatbuf, dataLen-someOffset);
+
+       DeleteSamples(int16buf);
+       DeleteSamples(int24buf);
+       DeleteSamples(floatbuf);
+   }
+
+   void testReads() {
+       std::cout << "\tVerifying that we can read back correctly..." << std::flush;
+
+       AssertReadsBack();
+
+       std::cout << "OK\n";
+   }
+
+   void testCompaction() {
+       // Retire the segment the blocks are in, move them out of it, and
+       // remove it, the way DirManager::CompactPackedBlocks() does
+       std::cout << "\tVerifying that blocks survive compaction..." << std::flush;
+
+       int oldSegment = int16BlockFile->GetSegment();
+       RetireAll();
+
+       assert(int16BlockFile->Relocate());
+       assert(int24BlockFile->Relocate());
+       assert(floatBlockFile->Relocate());
+       assert(int16BlockFile->GetSegment() != oldSegment);
+
+       store->RemoveRetired();
+       assert(!store->HasSegment(oldSegment));
+       assert(int16BlockFile->Exists());
+
+       AssertReadsBack();
+
+       std::cout << "OK\n";
+   }
+
+   void testCopy() {
+       std::cout << "\tVerifying that a copy has the same data..." << std::flush;
+
+       BlockFile *copy = floatBlockFile->Copy(
+          wxFileName(store->GetDir(), wxT("p00000003")));
+       assert(copy);
+
+       float *floatbuf = new float[dataLen];
+       copy->ReadData((samplePtr)floatbuf, floatSample, 0, dataLen);
+       AssertBuffersEqual(floatData, floatbuf, dataLen);
+
+       delete [] floatbuf;
+       delete copy;
+
+       std::cout << "OK\n";
+   }
+};
+
+int main()
+{
+    PackedBlockFileTest tester;
+
+    tester.setUp();
+    tester.testReads();
+    tester.tearDown();
+
+    tester.setUp();
+    tester.testCompaction();
+    tester.tearDown();
+
+    tester.setUp();
+    tester.testCopy();
+    tester.tearDown();
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <iostream>
+#include <ostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include "SampleKernels.h"
+
+
+// Checks every kernel at every level this machine supports against
+// the scalar level.  The results must be identical, not just close.
+class SampleKernelsTest {
+   int dataLen;
+
+   float *floatData;
+   double *envData;
+   short *int16Data;
+   int *int24Data;
+
+public:
+   SampleKernelsTest()
+   {
+       std::cout << "==> Testing SampleKernels\n";
+   }
+
+   void setUp() {
+      // Not a multiple of any vector size, so the scalar tails run too
+      dataLen = 4099;
+
+      floatData = new float[dataLen];
+      envData = new double[dataLen];
+      int16Data = new short[dataLen];
+      int24Data = new int[dataLen];
+
+      srand(1);
+
+      for (int i = 0; i < dataLen; i++)
+      {
+         // Mostly in range, some clipping, some exact halves to check
+         // the rounding, and a few special values
+         floatData[i] = (rand() / (float)RAND_MAX - 0.5f) * 2.5f;
+         if (i % 17 == 0)
+            floatData[i] = (float)(rand() % 1000 - 500) / float(1 << 15) +
+                           0.5f / float(1 << 15);
+         envData[i] = rand() / (double)RAND_MAX * 2.0;
+         int16Data[i] = (short)(rand() % 65536 - 32768);
+         int24Data[i] = rand() % 16777216 - 8388608;
+      }
+
+      floatData[0] = 1.0f;
+      floatData[1] = -1.0f;
+      floatData[2] = 0.0f;
+      floatData[3] = -0.0f;
+      floatData[4] = std::numeric_limits<float>::quiet_NaN();
+      floatData[5] = std::numeric_limits<float>::infinity();
+      floatData[6] = -std::numeric_limits<float>::infinity();
+      floatData[7] = 32767.5f / float(1 << 15);
+      floatData[8] = 8388607.5f / float(1 << 23);
+      int16Data[0] = -32768;
+      int16Data[1] = 32767;
+      int24Data[0] = -8388608;
+      int24Data[1] = 8388607;
+   }
+
+   void tearDown() {
+      delete [] floatData;
+      delete [] envData;
+      delete [] int16Data;
+      delete [] int24Data;
+   }
+
+   template <class T>
+   void AssertBuffersIdentical(const T *expected, const T *actual, int len)
+   {
+      assert(memcmp(expected, actual, len * sizeof(T)) == 0);
+   }
+
+   void testLevel(SampleKernels::Level level)
+   {
+      std::cout << "\tlevel " << level << " should match the scalar level...";
+      std::cout << std::flush;
+
+      float *expectedFloats = new float[2 * dataLen];
+      float *actualFloats = new float[2 * dataLen];
+      short *expectedShorts = new short[dataLen];
+      short *actualShorts = new short[dataLen];
+      int *expectedInts = new int[dataLen];
+      int *actualInts = new int[dataLen];
+      double *expectedDoubles = new double[dataLen];
+      double *actualDoubles = new double[dataLen];
+
+      // Start at odd offsets too, so that nothing depends on alignment
+      for (int offset = 0; offset < 3; offset++)
+      {
+         int len = dataLen - offset;
+         const float *src = floatData + offset;
+
+         for (int i = 0; i < 2 * dataLen; i++)
+            expectedFloats[i] = actualFloats[i] = floatData[(i * 7) % dataLen];
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::AddScaled(expectedFloats, 1, src, 0.3f, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::AddScaled(actualFloats, 1, src, 0.3f, len);
+         AssertBuffersIdentical(expectedFloats, actualFloats, 2 * dataLen);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::AddScaledStereo(expectedFloats, src, 0.7f, -1.3f, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::AddScaledStereo(actualFloats, src, 0.7f, -1.3f, len);
+         AssertBuffersIdentical(expectedFloats, actualFloats, 2 * dataLen);
+
+         memcpy(expectedFloats, src, len * sizeof(float));
+         memcpy(actualFloats, src, len * sizeof(float));
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::ApplyEnvelope(expectedFloats, envData + offset, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::ApplyEnvelope(actualFloats, envData + offset, len);
+         AssertBuffersIdentical(expectedFloats, actualFloats, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::Int16ToFloat(int16Data + offset, expectedFloats, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::Int16ToFloat(int16Data + offset, actualFloats, len);
+         AssertBuffersIdentical(expectedFloats, actualFloats, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::Int24ToFloat(int24Data + offset, expectedFloats, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::Int24ToFloat(int24Data + offset, actualFloats, len);
+         AssertBuffersIdentical(expectedFloats, actualFloats, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::FloatToInt16(src, expectedShorts, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::FloatToInt16(src, actualShorts, len);
+         AssertBuffersIdentical(expectedShorts, actualShorts, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::FloatToInt24(src, expectedInts, len);
+         SampleKernels::SetLevel(level);
+         SampleKernels::FloatToInt24(src, actualInts, len);
+         AssertBuffersIdentical(expectedInts, actualInts, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::FillRamp(expectedDoubles, len, 0.25, -1.0 / 3.0);
+         SampleKernels::SetLevel(level);
+         SampleKernels::FillRamp(actualDoubles, len, 0.25, -1.0 / 3.0);
+         AssertBuffersIdentical(expectedDoubles, actualDoubles, len);
+
+         SampleKernels::SetLevel(SampleKernels::Scalar);
+         SampleKernels::FillGeometric(expectedDoubles, len, 0.25, 1.0001);
+         SampleKernels::SetLevel(level);
+         SampleKernels::FillGeometric(actualDoubles, len, 0.25, 1.0001);
+         AssertBuffersIdentical(expectedDoubles, actualDoubles, len);
+      }
+
+      delete [] expectedFloats;
+      delete [] actualFloats;
+      delete [] expectedShorts;
+      delete [] actualShorts;
+      delete [] expectedInts;
+      delete [] actualInts;
+      delete [] expectedDoubles;
+      delete [] actualDoubles;
+
+      std::cout << "OK\n";
+   }
+
+   void testClipping()
+   {
+      std::cout << "\tconversion to integers should clip and round...";
+      std::cout << std::flush;
+
+      float src[8] = { 2.0f, -2.0f, 1.0f, -1.0f,
+                       0.5f / float(1 << 15), 1.5f / float(1 << 15),
+                       -0.5f / float(1 << 15), 0.0f };
+      short expected[8] = { 32767, -32768, 32767, -32768, 0, 2, 0, 0 };
+      short actual[8];
+
+      SampleKernels::SetLevel(SampleKernels::GetSupportedLevel());
+      SampleKernels::FloatToInt16(src, actual, 8);
+      AssertBuffersIdentical(expected, actual, 8);
+
+      std::cout << "OK\n";
+   }
+};
+
+int main()
+{
+    SampleKernelsTest tester;
+
+    SampleKernels::Level supported = SampleKernels::GetSupportedLevel();
+    std::cout << "\tthis machine supports level " << supported << "\n";
+
+    for (int level = SampleKernels::SSE2; level <= supported; level++)
+    {
+       tester.setUp();
+       tester.testLevel((SampleKernels::Level)level);
+       tester.tearDown();
+    }
+
+    tester.setUp();
+    tester.testClipping();
+    tester.tearDown();
+
+    return 0;
+}
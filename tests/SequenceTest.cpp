@@ -1,8 +1,11 @@
 
 #include "Sequence.h"
 #include "DirManager.h"
+#include "BlockFile.h"
 #include <wx/hash.h>
+#include <math.h>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 
 class SequenceTest
@@ -131,6 +134,143 @@ public:
       std::cout << "ok\n";
    }
 
+   void TestFindQuiet()
+   {
+      std::cout << "\tSequence::FindAbove() and FindQuiet() should agree with the samples..." << std::flush;
+
+      /* Loud stretches broken by silences of various lengths, spread
+       * over several blocks */
+      int len = (int)(mSequence->GetMaxBlockSize() * 3.5);
+      float *buf = new float[len];
+      int i;
+
+      for(i = 0; i < len; i++)
+         buf[i] = (i % 2 ? 0.5f : -0.5f);
+      for(int gap = 0; gap < 40; gap++) {
+         int at = rand() % len;
+         int gapLen = rand() % (gap % 2 ? 100 : 5000);
+         for(i = at; i < at + gapLen && i < len; i++)
+            buf[i] = 0.01f;
+      }
+
+      mSequence->Append((samplePtr)buf, floatSample, len);
+
+      float level = 0.1f;
+      for(int test = 0; test < 200; test++) {
+         sampleCount start = rand() % len;
+         sampleCount count = rand() % (len - start + 1);
+         sampleCount minLen = 1 + rand() % (test % 2 ? 50 : 3000);
+         sampleCount end = start + count;
+
+         sampleCount above = end;
+         for(i = start; i < end; i++)
+            if (fabs(buf[i]) >= level) {
+               above = i;
+               break;
+            }
+
+         sampleCount quiet = end;
+         sampleCount run = -1;
+         for(i = start; i < end; i++) {
+            if (fabs(buf[i]) < level) {
+               if (run < 0)
+                  run = i;
+               if (i + 1 - run >= minLen)
+                  break;
+            }
+            else
+               run = -1;
+         }
+         if (run >= 0)
+            quiet = run;
+
+         assert(mSequence->FindAbove(start, count, level) == above);
+         assert(mSequence->FindQuiet(start, count, level, minLen) == quiet);
+      }
+
+      delete [] buf;
+
+      std::cout << "ok\n";
+   }
+
+   void CheckPyramid(const char *after)
+   {
+      /* Summaries of runs of whole blocks come from the pyramid; they
+       * should match the samples themselves */
+      const BlockArray *blocks = mSequence->GetBlocks();
+      int numBlocks = blocks->GetCount();
+
+      for(int test = 0; test < 20; test++) {
+         int b0 = rand() % numBlocks;
+         int b1 = b0 + rand() % (numBlocks - b0);
+         sampleCount start = blocks->Item(b0).start;
+         sampleCount end = blocks->Item(b1).start +
+            blocks->Item(b1).f->GetLength();
+         if (test == 0) {
+            start = 0;
+            end = mSequence->GetNumSamples();
+         }
+
+         std::vector<float> buf(end - start);
+         mSequence->Get((samplePtr)&buf[0], floatSample, start, end - start);
+         float expectMin = buf[0], expectMax = buf[0];
+         double sumsq = 0.0;
+         for(size_t i = 0; i < buf.size(); i++) {
+            expectMin = std::min(expectMin, buf[i]);
+            expectMax = std::max(expectMax, buf[i]);
+            sumsq += (double)buf[i] * buf[i];
+         }
+         double expectRMS = sqrt(sumsq / buf.size());
+
+         float min, max, rms;
+         int bl;
+         sampleCount where[2] = { start, end };
+         assert(mSequence->GetWaveDisplay(&min, &max, &rms, &bl, 1, where,
+                                          (double)(end - start)));
+         if (min != expectMin || max != expectMax ||
+             fabs(rms - expectRMS) > 1e-4 * (1.0 + expectRMS)) {
+            std::cout << "mismatch after " << after << "\n";
+            assert(false);
+         }
+      }
+   }
+
+   void TestPyramid()
+   {
+      std::cout << "\tsummaries from the pyramid should match the samples after edits..." << std::flush;
+
+      int appendLen = (int)(mSequence->GetMaxBlockSize() * 1.7);
+      std::vector<float> buf(appendLen);
+      int i;
+
+      for(int round = 0; round < 8; round++) {
+         /* Each append at its own level, so that stale summaries show */
+         float scale = (float)(1 + rand() % 100) / 100.0f;
+         for(i = 0; i < appendLen; i++)
+            buf[i] = scale * ((rand() % 2001) - 1000) / 1000.0f;
+         mSequence->Append((samplePtr)&buf[0], floatSample, appendLen);
+         CheckPyramid("Append");
+
+         Sequence *tmpSequence;
+         sampleCount numSamples = mSequence->GetNumSamples();
+         sampleCount s0 = rand() % numSamples;
+         sampleCount len = 1 + rand() % std::min(numSamples - s0,
+                                                 (sampleCount)appendLen);
+         mSequence->Copy(s0, s0 + len, &tmpSequence);
+         mSequence->Paste(rand() % numSamples, tmpSequence);
+         delete tmpSequence;
+         CheckPyramid("Paste");
+
+         numSamples = mSequence->GetNumSamples();
+         sampleCount del = rand() % numSamples;
+         sampleCount dellen = rand() % ((numSamples - del) / 2 + 1);
+         mSequence->Delete(del, dellen);
+         CheckPyramid("Delete");
+      }
+
+      std::cout << "ok\n";
+   }
+
 };
 
 int main()
@@ -149,6 +289,14 @@ int main()
    tester.TestGetGarbageInput();
    tester.TearDown();
 
+   tester.SetUp();
+   tester.TestFindQuiet();
+   tester.TearDown();
+
+   tester.SetUp();
+   tester.TestPyramid();
+   tester.TearDown();
+
    return 0;
 }
 
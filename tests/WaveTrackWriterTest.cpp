@@ -0,0 +1,171 @@
+
+#include "WaveTrack.h"
+#include "WaveTrackWriter.h"
+#include "DirManager.h"
+#include "BenchmarkSuite.h"
+#include "Prefs.h"
+#include <wx/fileconf.h>
+#include <wx/filefn.h>
+#include <cassert>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <iostream>
+
+class WaveTrackWriterTest
+{
+private:
+   // Owns the DirManager and the TrackFactory the tracks are made with
+   BenchmarkSuite *mSuite;
+   TrackFactory *mFactory;
+   // The same effect is run on both, through Set() on one and through
+   // a WaveTrackWriter on the other
+   WaveTrack *mSetTrack;
+   WaveTrack *mWriterTrack;
+   sampleCount mLen;
+
+public:
+   WaveTrackWriterTest()
+   {
+      std::cout << "==> Testing WaveTrackWriter\n";
+      srand(time(NULL));
+   }
+
+   void SetUp()
+   {
+      // New WaveTracks read their view mode from the prefs
+      gPrefs = new wxFileConfig(wxT("Audacity"), wxEmptyString,
+                                wxT("/tmp/wavetrackwriter-test.cfg"),
+                                wxEmptyString, wxCONFIG_USE_LOCAL_FILE);
+
+      DirManager::SetTempDir(wxT("/tmp/wavetrackwriter-test-dir"));
+      mSuite = new BenchmarkSuite;
+      mFactory = mSuite->GetTrackFactory();
+
+      mSetTrack = mFactory->NewWaveTrack(floatSample, 44100);
+
+      mLen = (sampleCount)(mSetTrack->GetMaxBlockSize() * 5.5);
+      std::vector<float> buf(mLen);
+      for(sampleCount i = 0; i < mLen; i++)
+         buf[i] = ((rand() % 2001) - 1000) / 1000.0f;
+      mSetTrack->Append((samplePtr)&buf[0], floatSample, mLen);
+      mSetTrack->Flush();
+
+      mWriterTrack = NULL;
+   }
+
+   void TearDown()
+   {
+      delete mSetTrack;
+      delete mWriterTrack;
+      delete mSuite;
+
+      delete gPrefs;
+      gPrefs = NULL;
+      wxRemoveFile(wxT("/tmp/wavetrackwriter-test.cfg"));
+   }
+
+   static void Process(float *buf, sampleCount len)
+   {
+      for(sampleCount i = 0; i < len; i++)
+         buf[i] = buf[i] * 0.5f - 0.25f;
+   }
+
+   void RunEffect(sampleCount start, sampleCount len)
+   {
+      mWriterTrack = mFactory->DuplicateWaveTrack(*mSetTrack);
+
+      // Not a divisor of the block size, so that writes straddle blocks
+      const sampleCount bufLen = 10007;
+      float *buf = new float[bufLen];
+
+      WaveTrackWriter writer(mWriterTrack, start);
+      for(sampleCount s = start; s < start + len; s += bufLen) {
+         sampleCount n = bufLen;
+         if (s + n > start + len)
+            n = start + len - s;
+
+         mSetTrack->Get((samplePtr)buf, floatSample, s, n);
+         Process(buf, n);
+         mSetTrack->Set((samplePtr)buf, floatSample, s, n);
+
+         mWriterTrack->Get((samplePtr)buf, floatSample, s, n);
+         Process(buf, n);
+         writer.Write((samplePtr)buf, floatSample, n);
+      }
+      assert(writer.Commit());
+
+      delete [] buf;
+   }
+
+   void AssertSame()
+   {
+      assert(mSetTrack->GetNumClips() == mWriterTrack->GetNumClips());
+      assert(mSetTrack->GetEndTime() == mWriterTrack->GetEndTime());
+
+      sampleCount end = mSetTrack->TimeToLongSamples(mSetTrack->GetEndTime());
+      std::vector<float> a(end), b(end);
+      mSetTrack->Get((samplePtr)&a[0], floatSample, 0, end);
+      mWriterTrack->Get((samplePtr)&b[0], floatSample, 0, end);
+      assert(memcmp(&a[0], &b[0], end * sizeof(float)) == 0);
+   }
+
+   void TestPartialBlock()
+   {
+      std::cout << "\twriting from part way into a block should match Set()..." << std::flush;
+
+      sampleCount blockLen = mSetTrack->GetMaxBlockSize();
+      RunEffect(blockLen / 3 + 17, blockLen * 2 + 1234);
+      AssertSame();
+
+      std::cout << "ok\n";
+   }
+
+   void TestGap()
+   {
+      std::cout << "\twriting across a gap between clips should match Set()..." << std::flush;
+
+      double rate = mSetTrack->GetRate();
+      mSetTrack->SplitDelete(mLen * 0.4 / rate, mLen * 0.5 / rate);
+      assert(mSetTrack->GetNumClips() == 2);
+
+      RunEffect(mLen * 3 / 10 + 5, mLen * 4 / 10);
+      AssertSame();
+
+      std::cout << "ok\n";
+   }
+};
+
+int main()
+{
+   WaveTrackWriterTest tester;
+
+   tester.SetUp();
+   tester.TestPartialBlock();
+   tester.TearDown();
+
+   tester.SetUp();
+   tester.TestGap();
+   tester.TearDown();
+
+   return 0;
+}
+
+class wxWindow;
+
+void ShowWarningDialog(wxWindow *parent,
+                      wxString internalDialogName,
+                      wxString message)
+{
+   std::cout << "warning: " << message << std::endl;
+}
+
+// Indentation settings for Vim and Emacs and unique identifier for Arch, a
+// version control system. Please do not modify past this point.
+//
+// Local Variables:
+// c-basic-offset: 3
+// indent-tabs-mode: nil
+// End:
+//
+// vim: et sts=3 sw=3
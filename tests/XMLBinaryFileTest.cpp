@@ -0,0 +1,202 @@
+#include <iostream>
+#include <ostream>
+#include <cassert>
+
+#include <wx/arrstr.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "xml/XMLBinaryFile.h"
+#include "xml/XMLFileReader.h"
+
+// Records everything a reader reports, one line per tag, attribute,
+// piece of content and end tag
+class RecordingHandler : public XMLTagHandler {
+public:
+   wxArrayString events;
+
+   bool HandleXMLTag(const wxChar *tag, const wxChar **attrs)
+   {
+      events.Add(wxString(wxT("<")) + tag);
+      while (*attrs) {
+         wxString name = *attrs++;
+         wxString value = *attrs++;
+         events.Add(wxT("  ") + name + wxT("=") + value);
+      }
+      return true;
+   }
+
+   void HandleXMLEndTag(const wxChar *tag)
+   {
+      events.Add(wxString(wxT("</")) + tag);
+   }
+
+   void HandleXMLContent(const wxString &content)
+   {
+      // The text file has indentation between the tags
+      wxString trimmed = content;
+      trimmed.Trim(true).Trim(false);
+      if (!trimmed.IsEmpty())
+         events.Add(wxT("  ") + trimmed);
+   }
+
+   XMLTagHandler *HandleXMLChild(const wxChar *WXUNUSED(tag))
+   {
+      return this;
+   }
+};
+
+class XMLBinaryFileTest {
+   wxString dir;
+
+public:
+   XMLBinaryFileTest()
+   {
+       std::cout << "==> Testing XMLBinaryFile\n";
+   }
+
+   void setUp() {
+      dir = wxT("/tmp/XMLBinaryFileTest");
+      if (!wxDirExists(dir))
+         wxMkdir(dir);
+   }
+
+   void tearDown() {
+      wxRemoveFile(wxFileName(dir, wxT("project.aup")).GetFullPath());
+      wxRemoveFile(wxFileName(dir, wxT("project.aupb")).GetFullPath());
+      wxRmdir(dir);
+   }
+
+   // Something like what a project writes, with the attribute types it uses
+   static void WriteProject(XMLFileWriter &xmlFile)
+   {
+      xmlFile.Write(wxT("<?xml version=\"1.0\" standalone=\"no\" ?>\n"));
+
+      xmlFile.StartTag(wxT("project"));
+      xmlFile.WriteAttr(wxT("projname"), wxT("test <&> \"quoted\" 'data'"));
+      xmlFile.WriteAttr(wxT("version"), wxT("1.3.0"));
+      xmlFile.WriteAttr(wxT("rate"), 44100.0);
+      xmlFile.WriteAttr(wxT("snapto"), wxT("off"));
+      xmlFile.WriteAttr(wxT("selectionformat"), wxT("hh:mm:ss + milliseconds"));
+
+      xmlFile.StartTag(wxT("tags"));
+      xmlFile.StartTag(wxT("tag"));
+      xmlFile.WriteAttr(wxT("name"), wxT("TITLE"));
+      xmlFile.WriteAttr(wxT("value"), wxT("Caf\u00e9 & \"Bar\" <live>"));
+      xmlFile.EndTag(wxT("tag"));
+      xmlFile.EndTag(wxT("tags"));
+
+      for (int t = 0; t < 2; t++) {
+         xmlFile.StartTag(wxT("wavetrack"));
+         xmlFile.WriteAttr(wxT("name"), wxString::Format(wxT("Track %d"), t));
+         xmlFile.WriteAttr(wxT("channel"), t);
+         xmlFile.WriteAttr(wxT("linked"), t == 0);
+         xmlFile.WriteAttr(wxT("offset"), 0.0, 8);
+         xmlFile.WriteAttr(wxT("rate"), 44100.0);
+         xmlFile.WriteAttr(wxT("gain"), 0.5f);
+         xmlFile.WriteAttr(wxT("pan"), -0.25f);
+
+         xmlFile.StartTag(wxT("waveclip"));
+         xmlFile.WriteAttr(wxT("offset"), 1.0 / 3.0, 8);
+
+         xmlFile.StartTag(wxT("sequence"));
+         xmlFile.WriteAttr(wxT("maxsamples"), 262144);
+         xmlFile.WriteAttr(wxT("sampleformat"), 262159);
+         xmlFile.WriteAttr(wxT("numsamples"), (long long)3000000000LL);
+
+         for (int b = 0; b < 3; b++) {
+            xmlFile.StartTag(wxT("waveblock"));
+            xmlFile.WriteAttr(wxT("start"), (long long)b * 262144);
+            xmlFile.StartTag(wxT("simpleblockfile"));
+            xmlFile.WriteAttr(wxT("filename"),
+                              wxString::Format(wxT("e00000%02d.au"), b));
+            xmlFile.WriteAttr(wxT("len"), (size_t)262144);
+            xmlFile.WriteAttr(wxT("min"), -0.123456789f);
+            xmlFile.WriteAttr(wxT("max"), 0.987654321f);
+            xmlFile.WriteAttr(wxT("rms"), 1.0e-7f);
+            xmlFile.EndTag(wxT("simpleblockfile"));
+            xmlFile.EndTag(wxT("waveblock"));
+         }
+         xmlFile.EndTag(wxT("sequence"));
+
+         xmlFile.StartTag(wxT("envelope"));
+         xmlFile.WriteAttr(wxT("numpoints"), 2);
+         for (int p = 0; p < 2; p++) {
+            xmlFile.StartTag(wxT("controlpoint"));
+            xmlFile.WriteAttr(wxT("t"), p * 2.5, 12);
+            xmlFile.WriteAttr(wxT("val"), p ? 0.1 : 1.0, 12);
+            xmlFile.EndTag(wxT("controlpoint"));
+         }
+         xmlFile.EndTag(wxT("envelope"));
+
+         xmlFile.EndTag(wxT("waveclip"));
+         xmlFile.EndTag(wxT("wavetrack"));
+      }
+
+      xmlFile.StartTag(wxT("labeltrack"));
+      xmlFile.StartTag(wxT("label"));
+      xmlFile.WriteAttr(wxT("t"), 1.5, 8);
+      xmlFile.WriteAttr(wxT("title"), wxT("a < b && c > d"));
+      xmlFile.EndTag(wxT("label"));
+      xmlFile.EndTag(wxT("labeltrack"));
+
+      xmlFile.StartTag(wxT("import"));
+      xmlFile.WriteData(wxT("some <text> & more"));
+      xmlFile.EndTag(wxT("import"));
+
+      xmlFile.EndTag(wxT("project"));
+   }
+
+   void testRoundTrip() {
+       std::cout << "\tVerifying that a binary project reads back like the XML one..." << std::flush;
+
+       wxString textName = wxFileName(dir, wxT("project.aup")).GetFullPath();
+       wxString binaryName = wxFileName(dir, wxT("project.aupb")).GetFullPath();
+
+       XMLFileWriter textFile;
+       textFile.Open(textName, wxT("wb"));
+       WriteProject(textFile);
+       textFile.Close();
+
+       XMLBinaryFileWriter binaryFile;
+       binaryFile.Open(binaryName, wxT("wb"));
+       WriteProject(binaryFile);
+       binaryFile.Close();
+
+       RecordingHandler fromText;
+       XMLFileReader textReader;
+       assert(textReader.Parse(&fromText, textName));
+
+       RecordingHandler fromBinary;
+       XMLBinaryFileReader binaryReader;
+       assert(binaryReader.Parse(&fromBinary, binaryName));
+
+       assert(fromText.events.GetCount() > 0);
+       assert(fromBinary.events.GetCount() == fromText.events.GetCount());
+       for (size_t i = 0; i < fromText.events.GetCount(); i++) {
+          if (fromBinary.events[i] != fromText.events[i]) {
+             std::cout << "\n\t" << fromText.events[i].mb_str(wxConvUTF8)
+                       << " != " << fromBinary.events[i].mb_str(wxConvUTF8)
+                       << "\n";
+             assert(false);
+          }
+       }
+
+       // Escaping must not show through on either side
+       assert(fromText.events.Index(wxT("  projname=test <&> \"quoted\" 'data'"))
+              != wxNOT_FOUND);
+
+       std::cout << "OK\n";
+   }
+};
+
+int main()
+{
+    XMLBinaryFileTest tester;
+
+    tester.setUp();
+    tester.testRoundTrip();
+    tester.tearDown();
+
+    return 0;
+}